@@ -150,7 +150,9 @@ public:
         // error message if job crashes (not fully implemented)
         JobMessage,
         // Item status (ready or not, missing, waiting, ...)
-        ClipStatus
+        ClipStatus,
+        // Measured playback load (decoding time relative to frame duration)
+        DataDecodeLoad
     };
 
     enum CLIPSTATUS {
@@ -174,7 +176,7 @@ public:
     /**
      * @brief Returns the amount of different types of data this item supports.
      *
-     * This base class supports only DataName and DataDescription, so the return value is always 2.
+     * This base class supports DataName, DataDate, DataDescription and DataDecodeLoad, so the return value is always 4.
      * This function is necessary for interaction with ProjectItemModel.
      */
     virtual int supportedDataCount() const;
@@ -33,6 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "project/clipmanager.h"
 #include "project/dialogs/slideshowclip.h"
 #include "project/jobs/jobmanager.h"
+#include "project/jobs/proxyclipjob.h"
 #include "monitor/monitor.h"
 #include "doc/kdenlivedoc.h"
 #include "dialogs/clipcreationdialog.h"
@@ -45,6 +46,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "project/projectcommands.h"
 #include "project/invaliddialog.h"
 #include "projectsortproxymodel.h"
+#include "clipprofiler.h"
+#include "doc/thumbnailstore.h"
+#include "doc/analysisstore.h"
+#include "doc/cacheaccounting.h"
 #include "bincommands.h"
 #include "doc/documentchecker.h"
 #include "mlt++/Mlt.h"
@@ -68,6 +73,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QUndoCommand>
 #include <QCryptographicHash>
 
+#include <algorithm>
+
 MyListView::MyListView(QWidget *parent) : QListView(parent)
 {
     setViewMode(QListView::IconMode);
@@ -526,6 +533,7 @@ Bin::Bin(QWidget *parent) :
     , m_transcodeAction(nullptr)
     , m_clipsActionsMenu(nullptr)
     , m_inTimelineAction(nullptr)
+    , m_profiledClips(0)
     , m_listType((BinViewType) KdenliveSettings::binMode())
     , m_iconSize(160, 90)
     , m_propertiesPanel(nullptr)
@@ -536,6 +544,9 @@ Bin::Bin(QWidget *parent) :
     , m_processedAudio(0)
 {
     m_layout = new QVBoxLayout(this);
+    m_profiler = new ClipProfiler(this);
+    connect(m_profiler, &ClipProfiler::clipProfiled, this, &Bin::slotClipProfiled);
+    connect(m_profiler, &ClipProfiler::finished, this, &Bin::slotProfilingFinished);
 
     // Create toolbar for buttons
     m_toolbar = new QToolBar(this);
@@ -611,6 +622,11 @@ Bin::Bin(QWidget *parent) :
     disableEffects->setChecked(false);
     pCore->window()->actionCollection()->addAction(QStringLiteral("disable_bin_effects"), disableEffects);
 
+    m_profileAction = new QAction(i18n("Profile Playback Cost"), this);
+    m_profileAction->setData("profile_clips");
+    connect(m_profileAction, &QAction::triggered, this, &Bin::slotProfileClips);
+    pCore->window()->actionCollection()->addAction(QStringLiteral("profile_clips"), m_profileAction);
+
 #if KXMLGUI_VERSION_MINOR > 24 || KXMLGUI_VERSION_MAJOR > 5
     m_renameAction = KStandardAction::renameFile(this, SLOT(slotRenameItem()), this);
     m_renameAction->setText(i18n("Rename"));
@@ -640,8 +656,13 @@ Bin::Bin(QWidget *parent) :
     m_showDesc = new QAction(i18n("Show description"), this);
     m_showDesc->setCheckable(true);
     connect(m_showDesc, &QAction::triggered, this, &Bin::slotShowDescColumn);
+    m_showLoad = new QAction(i18n("Show playback load"), this);
+    m_showLoad->setCheckable(true);
+    connect(m_showLoad, &QAction::triggered, this, &Bin::slotShowLoadColumn);
     settingsMenu->addAction(m_showDate);
     settingsMenu->addAction(m_showDesc);
+    settingsMenu->addAction(m_showLoad);
+    settingsMenu->addAction(m_profileAction);
     settingsMenu->addAction(disableEffects);
     QToolButton *button = new QToolButton;
     button->setIcon(KoIconUtils::themedIcon(QStringLiteral("kdenlive-menu")));
@@ -749,6 +770,7 @@ void Bin::abortOperations()
 {
     blockSignals(true);
     abortAudioThumbs();
+    m_profiler->abort();
     if (m_propertiesPanel) {
         foreach (QWidget *w, m_propertiesPanel->findChildren<ClipPropertiesController *>()) {
             delete w;
@@ -1210,6 +1232,11 @@ ProjectFolder *Bin::rootFolder()
     return m_rootFolder;
 }
 
+BinSearchIndex *Bin::searchIndex()
+{
+    return m_itemModel->searchIndex();
+}
+
 void Bin::setMonitor(Monitor *monitor)
 {
     m_monitor = monitor;
@@ -1781,6 +1808,8 @@ void Bin::slotInitView(QAction *action)
             view->setColumnHidden(1, true);
             view->setColumnHidden(2, true);
         }
+        // Profiling results are not saved, only show the load column on request
+        view->setColumnHidden(3, !m_showLoad->isChecked());
         m_showDate->setChecked(!view->isColumnHidden(1));
         m_showDesc->setChecked(!view->isColumnHidden(2));
         connect(view->header(), &QHeaderView::sectionResized, this, &Bin::slotSaveHeaders);
@@ -2105,7 +2134,10 @@ void Bin::slotThumbnailReady(const QString &id, const QImage &img, bool fromFile
         // Save thumbnail for later reuse
         bool ok = false;
         if (!fromFile) {
-            img.save(m_doc->getCacheDir(CacheThumbs, &ok).absoluteFilePath(clip->hash() + QStringLiteral(".png")));
+            const QString path = m_doc->getCacheDir(CacheThumbs, &ok).absoluteFilePath(clip->hash() + QStringLiteral(".png"));
+            if (img.save(path)) {
+                m_doc->clipManager()->cacheAccounting->fileAdded(CacheThumbs, path);
+            }
         }
     }
 }
@@ -2169,15 +2201,16 @@ void Bin::slotProducerReady(const requestClipInfo &info, ClipController *control
             if (m_doc->useProxy()) {
                 if (t == AV || t == Video) {
                     int width = clip->getProducerIntProperty(QStringLiteral("meta.media.width"));
-                    if (m_doc->autoGenerateProxy(width)) {
+                    // Intra-frame sources at moderate resolution are fast enough without proxy
+                    if (m_doc->autoGenerateProxy(width) && !ProxyJob::isLightweight(clip)) {
                         // Start proxy
                         m_doc->slotProxyCurrentItem(true, QList<ProjectClip *>() << clip);
                     }
                 } else if (t == Playlist) {
                     // always proxy playlists
                     m_doc->slotProxyCurrentItem(true, QList<ProjectClip *>() << clip);
-                } else if (t == Image && m_doc->autoGenerateImageProxy(clip->getProducerIntProperty(QStringLiteral("meta.media.width")))) {
-                    // Start proxy
+                } else if ((t == Image || t == SlideShow) && m_doc->autoGenerateImageProxy(clip->getProducerIntProperty(QStringLiteral("meta.media.width")))) {
+                    // Start proxy, image sequences are rendered as a video to avoid loading full resolution stills
                     m_doc->slotProxyCurrentItem(true, QList<ProjectClip *>() << clip);
                 }
             }
@@ -2314,6 +2347,7 @@ void Bin::setupGeneratorMenu()
     if (m_proxyAction) {
         m_menu->addAction(m_proxyAction);
     }
+    m_menu->addAction(m_profileAction);
 
     addMenu = qobject_cast<QMenu *>(pCore->window()->factory()->container(QStringLiteral("clip_timeline"), pCore->window()));
     if (addMenu) {
@@ -2455,6 +2489,9 @@ void Bin::slotShowJobLog()
 
 void Bin::gotProxy(const QString &id, const QString &path)
 {
+    CacheAccounting *accounting = m_doc->clipManager()->cacheAccounting;
+    accounting->setProjectProxies(getProxyHashList());
+    accounting->fileAdded(CacheProxy, path);
     ProjectClip *clip = m_rootFolder->clip(id);
     if (clip) {
         QDomDocument doc;
@@ -3177,6 +3214,21 @@ void Bin::slotStartFilterJob(const ItemInfo &info, const QString &id, QMap<QStri
 
     QMap<QString, QString> producerParams = QMap<QString, QString> ();
     producerParams.insert(QStringLiteral("producer"), clip->url());
+    if (extraParams.contains(QStringLiteral("proxyanalysis"))) {
+        // The effect can map its analysis from the proxy resolution, which is much faster to decode
+        const QString proxy = clip->getProducerProperty(QStringLiteral("kdenlive:proxy"));
+        if (KdenliveSettings::analyseproxy() && m_doc->useProxy() && clip->hasProxy() && QFile::exists(proxy)) {
+            producerParams.insert(QStringLiteral("producer"), proxy);
+            if (extraParams.contains(QStringLiteral("framestep")) && KdenliveSettings::analysisframestep() > 1) {
+                extraParams.insert(QStringLiteral("framestep"), QString::number(KdenliveSettings::analysisframestep()));
+            } else {
+                extraParams.remove(QStringLiteral("framestep"));
+            }
+        } else {
+            extraParams.remove(QStringLiteral("proxyanalysis"));
+            extraParams.remove(QStringLiteral("framestep"));
+        }
+    }
     if (info.cropDuration != GenTime()) {
         producerParams.insert(QStringLiteral("in"), QString::number((int) info.cropStart.frames(m_doc->fps())));
         producerParams.insert(QStringLiteral("out"), QString::number((int)(info.cropStart + info.cropDuration).frames(m_doc->fps())));
@@ -3677,6 +3729,77 @@ void Bin::slotShowDescColumn(bool show)
     }
 }
 
+void Bin::slotShowLoadColumn(bool show)
+{
+    QTreeView *view = qobject_cast<QTreeView *>(m_itemView);
+    if (view) {
+        view->setColumnHidden(3, !show);
+    }
+}
+
+void Bin::slotProfileClips()
+{
+    QList<ProjectClip *> clips = selectedClips();
+    if (clips.isEmpty()) {
+        clips = m_rootFolder->childClips();
+    }
+    m_profiledClips = 0;
+    emitMessage(i18n("Measuring playback cost of %1 clips", clips.count()), 0, ProcessingJobMessage);
+    m_profiler->profileClips(clips);
+}
+
+void Bin::slotClipProfiled(const QString &id)
+{
+    m_profiledClips++;
+    ProjectClip *clip = m_rootFolder->clip(id);
+    if (!clip) {
+        return;
+    }
+    clip->setDecodeStats(m_profiler->takeResult(id));
+    emitItemUpdated(clip);
+}
+
+void Bin::slotProfilingFinished()
+{
+    emitMessage(i18np("Measured playback cost of %1 clip", "Measured playback cost of %1 clips", m_profiledClips), 100, OperationCompletedMessage);
+    m_showLoad->setChecked(true);
+    slotShowLoadColumn(true);
+    // Report all profiled clips, most expensive first
+    QList<ProjectClip *> clips = m_rootFolder->childClips();
+    QList<ProjectClip *> profiled;
+    for (ProjectClip *clip : clips) {
+        if (clip->decodeStats().isValid()) {
+            profiled << clip;
+        }
+    }
+    if (profiled.isEmpty()) {
+        return;
+    }
+    std::sort(profiled.begin(), profiled.end(), [](ProjectClip *a, ProjectClip *b) {
+        return a->decodeStats().load > b->decodeStats().load;
+    });
+    QStringList report;
+    QList<ProjectClip *> toProxy;
+    const QLocale locale;
+    for (ProjectClip *clip : profiled) {
+        const ClipDecodeStats &stats = clip->decodeStats();
+        report << i18n("%1: load %2 (decoding %3 ms, seeking %4 ms, effects %5 ms)", clip->name(), locale.toString(stats.load, 'f', 2),
+                       locale.toString(stats.decodeTime, 'f', 1), locale.toString(stats.seekTime, 'f', 1), locale.toString(stats.effectsTime, 'f', 1));
+        // Only the decoding cost can be reduced with a proxy
+        ClipType type = clip->clipType();
+        if (stats.decodeTime * clip->getOriginalFps() / 1000.0 > 1 && !clip->hasProxy() && (type == AV || type == Video || type == Playlist)) {
+            toProxy << clip;
+        }
+    }
+    if (m_doc->useProxy() && !toProxy.isEmpty()) {
+        if (KMessageBox::questionYesNoList(this, i18n("Some clips cannot be decoded in real time (a load above 1 drops frames).\nCreate proxy clips for the clips that would benefit from it?"), report, i18n("Playback Cost")) == KMessageBox::Yes) {
+            m_doc->slotProxyCurrentItem(true, toProxy);
+        }
+        return;
+    }
+    KMessageBox::informationList(this, i18n("Measured playback cost of the clips, a load above 1 drops frames."), report, i18n("Playback Cost"));
+}
+
 void Bin::slotQueryRemoval(const QString &id, const QString &url, const QString &errorMessage)
 {
     if (m_invalidClipDialog) {
@@ -3721,7 +3844,12 @@ void Bin::slotAddClipExtraData(const QString &id, const QString &key, const QStr
     QMap<QString, QString> oldProps;
     oldProps.insert(key, oldValue);
     QMap<QString, QString> newProps;
-    newProps.insert(key, data);
+    if (key.startsWith(QLatin1String("kdenlive:clipanalysis.")) && !data.isEmpty() && !AnalysisStore::isReference(data)) {
+        // Imported analysis data, move it to the analysis store
+        newProps.insert(key, clip->storeAnalysisData(data));
+    } else {
+        newProps.insert(key, data);
+    }
     EditClipCommand *command = new EditClipCommand(this, id, oldProps, newProps, true, groupCommand);
     if (!groupCommand) {
         m_doc->commandStack()->push(command);
@@ -3829,7 +3957,7 @@ void Bin::refreshProxySettings()
                 toProxy << clp;
                 continue;
             } else if ((t == AV || t == Video)
-                       && m_doc->autoGenerateProxy(clp->getProducerIntProperty(QStringLiteral("meta.media.width")))) {
+                       && m_doc->autoGenerateProxy(clp->getProducerIntProperty(QStringLiteral("meta.media.width"))) && !ProxyJob::isLightweight(clp)) {
                 // Start proxy
                 toProxy << clp;
                 continue;
@@ -3948,18 +4076,39 @@ void Bin::getBinStats(uint *used, uint *unused, qint64 *usedSize, qint64 *unused
     }
 }
 
-QImage Bin::findCachedPixmap(const QString &path)
+QImage Bin::findCachedThumb(const QString &hash, int frame)
 {
-    QImage img;
-    m_doc->clipManager()->pixmapCache->findImage(path, &img);
-    return img;
+    return m_doc->clipManager()->thumbnailStore->find(hash, frame);
 }
 
-void Bin::cachePixmap(const QString &path, const QImage &img)
+void Bin::cacheThumb(const QString &hash, int frame, const QImage &img)
 {
-    if (!m_doc->clipManager()->pixmapCache->contains(path)) {
-        m_doc->clipManager()->pixmapCache->insertImage(path, img);
-    }
+    m_doc->clipManager()->thumbnailStore->insert(hash, frame, img);
+}
+
+QImage Bin::findFilmstripTile(const QString &hash, int level, int index)
+{
+    return m_doc->clipManager()->thumbnailStore->findTile(hash, level, index);
+}
+
+bool Bin::hasFilmstripTile(const QString &hash, int level, int index)
+{
+    return m_doc->clipManager()->thumbnailStore->containsTile(hash, level, index);
+}
+
+void Bin::cacheFilmstripTile(const QString &hash, int level, int index, const QImage &img)
+{
+    m_doc->clipManager()->thumbnailStore->insertTile(hash, level, index, img);
+}
+
+AnalysisStore *Bin::analysisStore() const
+{
+    return m_doc->clipManager()->analysisStore;
+}
+
+CacheAccounting *Bin::cacheAccounting() const
+{
+    return m_doc->clipManager()->cacheAccounting;
 }
 
 QDir Bin::getCacheDir(CacheType type, bool *ok) const
@@ -63,6 +63,10 @@ class InvalidDialog;
 class BinItemDelegate;
 class BinMessageWidget;
 class SmallJobLabel;
+class BinSearchIndex;
+class ClipProfiler;
+class AnalysisStore;
+class CacheAccounting;
 
 namespace Mlt
 {
@@ -185,6 +189,8 @@ public:
 
     /** @brief Returns the root folder, which is the parent for all items in the view */
     ProjectFolder *rootFolder();
+    /** @brief Returns the search data of all bin items */
+    BinSearchIndex *searchIndex();
 
     /** @brief Create a clip item from its xml description  */
     void createClip(const QDomElement &xml);
@@ -331,9 +337,17 @@ public:
     void getBinStats(uint *used, uint *unused, qint64 *usedSize, qint64 *unusedSize);
     /** @brief Returns the clip properties dockwidget. */
     QDockWidget *clipPropertiesDock();
-    /** @brief Returns a cached thumbnail. */
-    QImage findCachedPixmap(const QString &path);
-    void cachePixmap(const QString &path, const QImage &img);
+    /** @brief Returns a cached thumbnail for a frame of the clip with @param hash, null if not cached. */
+    QImage findCachedThumb(const QString &hash, int frame);
+    void cacheThumb(const QString &hash, int frame, const QImage &img);
+    /** @brief Returns a cached timeline filmstrip tile of the clip with @param hash, null if not cached. */
+    QImage findFilmstripTile(const QString &hash, int level, int index);
+    bool hasFilmstripTile(const QString &hash, int level, int index);
+    void cacheFilmstripTile(const QString &hash, int level, int index, const QImage &img);
+    /** @brief Returns the store holding the clips analysis data. */
+    AnalysisStore *analysisStore() const;
+    /** @brief Returns the disk space accounting of the project's cache folders. */
+    CacheAccounting *cacheAccounting() const;
     /** @brief Returns a document's cache dir. ok is set to false if folder does not exist */
     QDir getCacheDir(CacheType type, bool *ok) const;
     /** @brief Command adding a bin clip */
@@ -354,6 +368,13 @@ private slots:
     /** @brief Show/hide date column */
     void slotShowDateColumn(bool show);
     void slotShowDescColumn(bool show);
+    void slotShowLoadColumn(bool show);
+    /** @brief Measure the playback cost of the selected clips, or all clips if none is selected. */
+    void slotProfileClips();
+    /** @brief Store the profiling result of a clip. */
+    void slotClipProfiled(const QString &id);
+    /** @brief Display the profiling report, offering to proxy clips that cannot be decoded in real time. */
+    void slotProfilingFinished();
 
     /** @brief Setup the bin view type (icon view, tree view, ...).
     * @param action The action whose data defines the view type or nullptr to keep default view */
@@ -497,6 +518,12 @@ private:
     QAction *m_inTimelineAction;
     QAction *m_showDate;
     QAction *m_showDesc;
+    QAction *m_showLoad;
+    QAction *m_profileAction;
+    /** @brief Measures the playback cost of clips. */
+    ClipProfiler *m_profiler;
+    /** @brief Number of clips measured in the current profiling run. */
+    int m_profiledClips;
     /** @brief Holds an available unique id for a clip to be created */
     int m_clipCounter;
     /** @brief Holds an available unique id for a folder to be created */
@@ -0,0 +1,219 @@
+/*
+Copyright (C) 2017  Kdenlive team <kdenlive@kde.org>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "binsearchindex.h"
+#include "abstractprojectitem.h"
+#include "projectclip.h"
+
+#include <QRegExp>
+
+static QStringList searchFields()
+{
+    static const QStringList fields = QStringList() << QStringLiteral("name") << QStringLiteral("description") << QStringLiteral("date") << QStringLiteral("marker")
+                                      << QStringLiteral("codec") << QStringLiteral("vcodec") << QStringLiteral("acodec") << QStringLiteral("file");
+    return fields;
+}
+
+// Returns the field name of a key=value token, or an empty string for plain tokens
+static QString tokenField(const QString &token)
+{
+    int pos = token.indexOf(QLatin1Char('='));
+    if (pos <= 0) {
+        return QString();
+    }
+    const QString field = token.left(pos);
+    return searchFields().contains(field) ? field : QString();
+}
+
+BinSearchIndex::BinSearchIndex(QObject *parent) : QObject(parent)
+    , m_revision(0)
+{
+}
+
+//static
+QStringList BinSearchIndex::parseQuery(const QString &query)
+{
+    return query.toCaseFolded().split(QRegExp(QStringLiteral("\\s+")), QString::SkipEmptyParts);
+}
+
+//static
+bool BinSearchIndex::isRefinement(const QStringList &previous, const QStringList &tokens)
+{
+    if (previous.isEmpty() || previous.count() > tokens.count()) {
+        return false;
+    }
+    for (int i = 0; i < previous.count(); ++i) {
+        const QString &prev = previous.at(i);
+        const QString &token = tokens.at(i);
+        if (prev == token) {
+            continue;
+        }
+        // An extended token matches less items, as long as it searches the same field
+        if (!token.startsWith(prev) || tokenField(prev) != tokenField(token)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BinSearchIndex::addItem(AbstractProjectItem *item)
+{
+    if (!item) {
+        return;
+    }
+    if (!m_entries.contains(item)) {
+        connect(item, &QObject::destroyed, this, &BinSearchIndex::slotItemDestroyed, Qt::UniqueConnection);
+    }
+    Entry &entry = m_entries[item];
+    entry.dirty = true;
+    entry.revision = ++m_revision;
+    for (AbstractProjectItem *child : *item) {
+        addItem(child);
+    }
+    emit revisionChanged();
+}
+
+void BinSearchIndex::removeItem(AbstractProjectItem *item)
+{
+    if (m_entries.remove(item) > 0) {
+        disconnect(item, &QObject::destroyed, this, &BinSearchIndex::slotItemDestroyed);
+    }
+}
+
+void BinSearchIndex::slotItemDestroyed(QObject *object)
+{
+    // Item is being destroyed, only use it as a key
+    m_entries.remove(static_cast<AbstractProjectItem *>(object));
+}
+
+void BinSearchIndex::updateItem(AbstractProjectItem *item)
+{
+    QHash<AbstractProjectItem *, Entry>::iterator it = m_entries.find(item);
+    if (it == m_entries.end()) {
+        return;
+    }
+    it->dirty = true;
+    it->revision = ++m_revision;
+    emit revisionChanged();
+}
+
+int BinSearchIndex::revision() const
+{
+    return m_revision;
+}
+
+bool BinSearchIndex::isModifiedSince(AbstractProjectItem *item, int revision) const
+{
+    QHash<AbstractProjectItem *, Entry>::const_iterator it = m_entries.constFind(item);
+    return it == m_entries.constEnd() || it->revision > revision;
+}
+
+const BinSearchIndex::Entry &BinSearchIndex::entry(AbstractProjectItem *item)
+{
+    Entry &entry = m_entries[item];
+    // Name and description can be changed without update notification. Comparing implicitly shared strings is cheap.
+    if (entry.dirty || entry.name != item->name() || entry.description != item->description()) {
+        buildEntry(item, entry);
+    }
+    return entry;
+}
+
+void BinSearchIndex::buildEntry(AbstractProjectItem *item, Entry &entry) const
+{
+    entry.dirty = false;
+    entry.name = item->name();
+    entry.description = item->description();
+    entry.fields.clear();
+    entry.fields.insert(QStringLiteral("name"), entry.name.toCaseFolded());
+    entry.fields.insert(QStringLiteral("description"), entry.description.toCaseFolded());
+    entry.fields.insert(QStringLiteral("date"), item->data(AbstractProjectItem::DataDate).toString().toCaseFolded());
+    if (item->itemType() == AbstractProjectItem::ClipItem) {
+        ProjectClip *clip = static_cast<ProjectClip *>(item);
+        QStringList comments;
+        const QList<CommentedTime> markers = clip->commentedSnapMarkers();
+        comments.reserve(markers.count());
+        for (const CommentedTime &marker : markers) {
+            comments << marker.comment();
+        }
+        entry.fields.insert(QStringLiteral("marker"), comments.join(QLatin1Char('\n')).toCaseFolded());
+        const QString vcodec = clip->codec(false).toCaseFolded();
+        const QString acodec = clip->codec(true).toCaseFolded();
+        entry.fields.insert(QStringLiteral("vcodec"), vcodec);
+        entry.fields.insert(QStringLiteral("acodec"), acodec);
+        entry.fields.insert(QStringLiteral("codec"), vcodec + QLatin1Char('\n') + acodec);
+        entry.fields.insert(QStringLiteral("file"), clip->url().section(QLatin1Char('/'), -1).toCaseFolded());
+    }
+    QStringList text;
+    for (const QString &field : searchFields()) {
+        if (field != QLatin1String("codec")) {
+            text << entry.fields.value(field);
+        }
+    }
+    // Tokens never contain line breaks, so they cannot match across fields
+    entry.text = text.join(QLatin1Char('\n'));
+}
+
+//static
+bool BinSearchIndex::matchEntry(const Entry &entry, const QStringList &tokens)
+{
+    for (const QString &token : tokens) {
+        const QString field = tokenField(token);
+        if (field.isEmpty()) {
+            if (!entry.text.contains(token)) {
+                return false;
+            }
+        } else if (!entry.fields.value(field).contains(token.midRef(field.length() + 1))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BinSearchIndex::matches(AbstractProjectItem *item, const QStringList &tokens)
+{
+    if (!item) {
+        return false;
+    }
+    if (!m_entries.contains(item)) {
+        addItem(item);
+    }
+    return matchEntry(entry(item), tokens);
+}
+
+QSet<AbstractProjectItem *> BinSearchIndex::search(const QStringList &tokens, const QSet<AbstractProjectItem *> *candidates)
+{
+    QSet<AbstractProjectItem *> result;
+    if (candidates) {
+        for (AbstractProjectItem *item : *candidates) {
+            // Candidates may contain items that were deleted since
+            if (m_entries.contains(item) && matchEntry(entry(item), tokens)) {
+                result.insert(item);
+            }
+        }
+        return result;
+    }
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (matchEntry(entry(it.key()), tokens)) {
+            result.insert(it.key());
+        }
+    }
+    return result;
+}
@@ -0,0 +1,93 @@
+/*
+Copyright (C) 2017  Kdenlive team <kdenlive@kde.org>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BINSEARCHINDEX_H
+#define BINSEARCHINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+class AbstractProjectItem;
+
+/**
+ * @class BinSearchIndex
+ * @brief Case folded search data for all project bin items, used to filter the bin.
+ * Each item stores its name, description, date, marker comments, codecs and file name.
+ * A query is split into tokens, and an item matches if it matches all tokens. A token
+ * like vcodec=h264 only searches the given field (name, description, date, marker,
+ * codec, vcodec, acodec, file), other tokens search all fields. Entries are rebuilt
+ * lazily when their item is updated.
+ */
+
+class BinSearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BinSearchIndex(QObject *parent = nullptr);
+    /** @brief Split a search string into case folded tokens. */
+    static QStringList parseQuery(const QString &query);
+    /** @brief Returns true if all items matching @param tokens also match @param previous, so that a search can be restricted to previous results. */
+    static bool isRefinement(const QStringList &previous, const QStringList &tokens);
+    /** @brief Register an item and its children. */
+    void addItem(AbstractProjectItem *item);
+    /** @brief Unregister an item. */
+    void removeItem(AbstractProjectItem *item);
+    /** @brief Item data changed, its search data will be rebuilt on next query. */
+    void updateItem(AbstractProjectItem *item);
+    /** @brief Returns true if the item matches all tokens. */
+    bool matches(AbstractProjectItem *item, const QStringList &tokens);
+    /** @brief Returns all items matching the tokens.
+     *  @param candidates if not null, only these items are checked */
+    QSet<AbstractProjectItem *> search(const QStringList &tokens, const QSet<AbstractProjectItem *> *candidates = nullptr);
+    /** @brief Current index revision, increased on each item change. */
+    int revision() const;
+    /** @brief Returns true if the item was added or updated after @param revision. */
+    bool isModifiedSince(AbstractProjectItem *item, int revision) const;
+
+private:
+    struct Entry {
+        QString name;
+        QString description;
+        /** @brief All fields joined, used for tokens without field. */
+        QString text;
+        QHash<QString, QString> fields;
+        int revision = 0;
+        bool dirty = true;
+    };
+    QHash<AbstractProjectItem *, Entry> m_entries;
+    int m_revision;
+    /** @brief Returns the up to date entry of an item, rebuilding it if needed. */
+    const Entry &entry(AbstractProjectItem *item);
+    void buildEntry(AbstractProjectItem *item, Entry &entry) const;
+    static bool matchEntry(const Entry &entry, const QStringList &tokens);
+
+private slots:
+    void slotItemDestroyed(QObject *object);
+
+signals:
+    /** @brief An item was added or updated, running searches may have new results. */
+    void revisionChanged();
+};
+
+#endif
@@ -0,0 +1,213 @@
+/*
+Copyright (C) 2017  Kdenlive team <kdenlive@kde.org>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "clipprofiler.h"
+#include "projectclip.h"
+#include "timeline/clip.h"
+#include "mltcontroller/clipcontroller.h"
+#include "kdenlivesettings.h"
+
+#include "kdenlive_debug.h"
+#include <QElapsedTimer>
+#include <QtConcurrent>
+
+#include <mlt++/Mlt.h>
+
+// Number of seeks used to measure seek latency
+static const int seekSamples = 4;
+// Number of consecutive frames decoded to measure decoding time
+static const int decodeSamples = 12;
+
+ClipProfiler::ClipProfiler(QObject *parent) : QObject(parent)
+    , m_abort(0)
+{
+}
+
+ClipProfiler::~ClipProfiler()
+{
+    abort();
+}
+
+void ClipProfiler::profileClips(const QList<ProjectClip *> &clips)
+{
+    QList<ProfileTask> tasks;
+    for (ProjectClip *clip : clips) {
+        ClipType type = clip->clipType();
+        ClipController *controller = clip->controller();
+        if (type == Audio || type == Unknown || !controller || !clip->isReady()) {
+            continue;
+        }
+        ProfileTask task;
+        task.id = clip->clipId();
+        // Producers are prepared here, cloning them in the worker thread is not safe
+        QMutexLocker locker(&controller->producerMutex);
+        Mlt::Producer &prod = controller->originalProducer();
+        if (!prod.is_valid()) {
+            continue;
+        }
+        Clip source(prod);
+        task.source = source.softClone(ClipController::getPassPropertiesList());
+        task.filtered = controller->hasEffects() ? source.clone() : nullptr;
+        tasks << task;
+    }
+    if (tasks.isEmpty()) {
+        emit finished();
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    m_queue << tasks;
+    if (!m_worker.isRunning()) {
+        m_abort.store(0);
+        m_worker = QtConcurrent::run(this, &ClipProfiler::processQueue);
+    }
+}
+
+void ClipProfiler::abort()
+{
+    m_mutex.lock();
+    m_abort.store(1);
+    for (const ProfileTask &task : m_queue) {
+        deleteTask(task);
+    }
+    m_queue.clear();
+    m_mutex.unlock();
+    m_worker.waitForFinished();
+    QMutexLocker lock(&m_mutex);
+    m_results.clear();
+}
+
+bool ClipProfiler::isRunning() const
+{
+    return m_worker.isRunning();
+}
+
+ClipDecodeStats ClipProfiler::takeResult(const QString &id)
+{
+    QMutexLocker lock(&m_mutex);
+    return m_results.take(id);
+}
+
+// static
+void ClipProfiler::deleteTask(const ProfileTask &task)
+{
+    delete task.source;
+    delete task.filtered;
+}
+
+void ClipProfiler::processQueue()
+{
+    while (true) {
+        m_mutex.lock();
+        if (m_abort.load() != 0 || m_queue.isEmpty()) {
+            m_mutex.unlock();
+            break;
+        }
+        ProfileTask task = m_queue.takeFirst();
+        m_mutex.unlock();
+        ClipDecodeStats stats = measure(task.source, task.filtered);
+        deleteTask(task);
+        m_mutex.lock();
+        if (m_abort.load() != 0) {
+            m_mutex.unlock();
+            return;
+        }
+        m_results.insert(task.id, stats);
+        m_mutex.unlock();
+        emit clipProfiled(task.id);
+    }
+    if (m_abort.load() == 0) {
+        emit finished();
+    }
+}
+
+double ClipProfiler::decodeFrames(Mlt::Producer *producer, int count)
+{
+    const int width = producer->profile()->width();
+    const int height = producer->profile()->height();
+    int decoded = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count && m_abort.load() == 0; ++i) {
+        Mlt::Frame *frame = producer->get_frame();
+        if (!frame || !frame->is_valid()) {
+            delete frame;
+            break;
+        }
+        mlt_image_format format = mlt_image_yuv422;
+        int w = width;
+        int h = height;
+        frame->set("rescale.interp", KdenliveSettings::mltinterpolation().toUtf8().constData());
+        frame->get_image(format, w, h);
+        delete frame;
+        decoded++;
+    }
+    if (decoded == 0) {
+        return -1;
+    }
+    return (double) timer.nsecsElapsed() / 1000000.0 / decoded;
+}
+
+ClipDecodeStats ClipProfiler::measure(Mlt::Producer *source, Mlt::Producer *filtered)
+{
+    ClipDecodeStats stats;
+    if (!source || !source->is_valid()) {
+        return stats;
+    }
+    const int length = source->get_length();
+    const double fps = source->profile()->fps();
+    if (length <= 0 || fps <= 0) {
+        return stats;
+    }
+    // Seek latency, sampled over the whole clip
+    double seekTotal = 0;
+    int seeks = 0;
+    int position = 0;
+    for (int i = 1; i <= seekSamples && m_abort.load() == 0; ++i) {
+        position = length * i / (seekSamples + 1);
+        source->seek(position);
+        double time = decodeFrames(source, 1);
+        if (time >= 0) {
+            seekTotal += time;
+            seeks++;
+        }
+    }
+    if (seeks == 0) {
+        return stats;
+    }
+    stats.seekTime = seekTotal / seeks;
+    // Sequential decoding, following the last seek position
+    stats.decodeTime = decodeFrames(source, qMin(decodeSamples, length - position - 1));
+    if (stats.decodeTime < 0) {
+        // Very short clip, the seek is all we have
+        stats.decodeTime = stats.seekTime;
+    }
+    if (filtered && filtered->is_valid() && m_abort.load() == 0) {
+        // Same frames with the effect stack, after a first frame to absorb the seek
+        filtered->seek(position);
+        decodeFrames(filtered, 1);
+        double filteredTime = decodeFrames(filtered, qMin(decodeSamples, length - position - 1));
+        if (filteredTime >= 0) {
+            stats.effectsTime = qMax(0.0, filteredTime - stats.decodeTime);
+        }
+    }
+    stats.load = (stats.decodeTime + stats.effectsTime) * fps / 1000.0;
+    return stats;
+}
@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2017  Kdenlive team <kdenlive@kde.org>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLIPPROFILER_H
+#define CLIPPROFILER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QMap>
+#include <QMutex>
+#include <QFuture>
+
+class ProjectClip;
+
+namespace Mlt
+{
+class Producer;
+}
+
+/** @brief Decoding cost of a clip, as measured by ClipProfiler. */
+struct ClipDecodeStats {
+    ClipDecodeStats() : decodeTime(-1), seekTime(-1), effectsTime(0), load(-1) {}
+    /** @brief Average time to decode a frame in sequential playback (ms). */
+    double decodeTime;
+    /** @brief Average time to display a frame after a seek (ms). */
+    double seekTime;
+    /** @brief Average time added by the clip's effect stack for a frame (ms). */
+    double effectsTime;
+    /** @brief Time to decode and process a frame relative to the frame duration, above 1 the clip cannot play in real time. */
+    double load;
+    bool isValid() const
+    {
+        return load >= 0;
+    }
+};
+
+/**
+ * @class ClipProfiler
+ * @brief Measures the playback cost of bin clips in a background thread.
+ * For each clip, a copy of the producer used for playback (the proxy if enabled) is
+ * sampled at a few positions to measure seek latency, then a run of consecutive frames
+ * is decoded with and without the clip's effects. Results are expressed relative to the
+ * frame duration so that clips dropping frames on this machine are easy to spot.
+ */
+
+class ClipProfiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ClipProfiler(QObject *parent = nullptr);
+    virtual ~ClipProfiler();
+    /** @brief Queue clips for profiling, clips without video are ignored. */
+    void profileClips(const QList<ProjectClip *> &clips);
+    /** @brief Stop profiling and drop queued clips. */
+    void abort();
+    bool isRunning() const;
+    /** @brief Returns and forgets the measure for a clip. */
+    ClipDecodeStats takeResult(const QString &id);
+
+private:
+    struct ProfileTask {
+        QString id;
+        Mlt::Producer *source;
+        Mlt::Producer *filtered;
+    };
+    QList<ProfileTask> m_queue;
+    QMap<QString, ClipDecodeStats> m_results;
+    mutable QMutex m_mutex;
+    QFuture<void> m_worker;
+    /** @brief Set from the main thread to stop the worker, read while measuring. */
+    QAtomicInt m_abort;
+    void processQueue();
+    /** @brief Run the measures on a clip's producers. */
+    ClipDecodeStats measure(Mlt::Producer *source, Mlt::Producer *filtered);
+    /** @brief Decode consecutive frames from current position, returns the average time per frame in ms or -1. */
+    double decodeFrames(Mlt::Producer *producer, int count);
+    static void deleteTask(const ProfileTask &task);
+
+signals:
+    /** @brief A clip was measured, result can be fetched with takeResult. */
+    void clipProfiled(const QString &id);
+    /** @brief All queued clips were processed. */
+    void finished();
+};
+
+#endif
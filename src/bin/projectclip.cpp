@@ -24,8 +24,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "projectfolder.h"
 #include "projectsubclip.h"
 #include "bin.h"
+#include "binsearchindex.h"
 #include "timecode.h"
 #include "doc/kthumb.h"
+#include "doc/analysisstore.h"
+#include "doc/cacheaccounting.h"
 #include "kdenlivesettings.h"
 #include "timeline/clip.h"
 #include "project/projectcommands.h"
@@ -39,6 +42,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDir>
 #include "kdenlive_debug.h"
 #include <QCryptographicHash>
+#include <QPainter>
 #include <QtConcurrent>
 #include <KLocalizedString>
 #include <KMessageBox>
@@ -48,6 +52,7 @@ ProjectClip::ProjectClip(const QString &id, const QIcon &thumb, ClipController *
     , m_abortAudioThumb(false)
     , m_controller(controller)
     , m_thumbsProducer(nullptr)
+    , m_extractingTiles(false)
 {
     m_clipStatus = StatusReady;
     m_name = m_controller->clipName();
@@ -75,6 +80,7 @@ ProjectClip::ProjectClip(const QDomElement &description, const QIcon &thumb, Pro
     , m_controller(nullptr)
     , m_type(Unknown)
     , m_thumbsProducer(nullptr)
+    , m_extractingTiles(false)
 {
     Q_ASSERT(description.hasAttribute(QStringLiteral("id")));
     m_clipStatus = StatusWaiting;
@@ -111,6 +117,10 @@ ProjectClip::~ProjectClip()
     m_requestedThumbs.clear();
     m_thumbMutex.unlock();
     m_thumbThread.waitForFinished();
+    m_tileMutex.lock();
+    m_requestedTiles.clear();
+    m_tileMutex.unlock();
+    m_tileThread.waitForFinished();
     delete m_thumbsProducer;
     audioFrameCache.clear();
 }
@@ -379,6 +389,12 @@ bool ProjectClip::setProducer(ClipController *controller, bool replaceProducer)
     bin()->emitItemUpdated(this);
     // Make sure we have a hash for this clip
     getFileHash();
+    if (m_type == AV || m_type == Video || m_type == Playlist) {
+        bin()->cacheAccounting()->addProjectProxy(hash());
+    }
+    if (hasProxy()) {
+        bin()->cacheAccounting()->fileUsed(CacheProxy, getProducerProperty(QStringLiteral("kdenlive:proxy")));
+    }
     createAudioThumbs();
     return isNewProducer;
 }
@@ -724,7 +740,7 @@ void ProjectClip::setJobStatus(int jobType, int status, int progress, const QStr
 
 ClipPropertiesController *ProjectClip::buildProperties(QWidget *parent)
 {
-    ClipPropertiesController *panel = new ClipPropertiesController(bin()->projectTimecode(), m_controller, parent);
+    ClipPropertiesController *panel = new ClipPropertiesController(bin()->projectTimecode(), m_controller, bin()->analysisStore(), parent);
     connect(this, &ProjectClip::refreshPropertiesPanel, panel, &ClipPropertiesController::slotReloadProperties);
     connect(this, &ProjectClip::refreshAnalysisPanel, panel, &ClipPropertiesController::slotFillAnalysisData);
     return panel;
@@ -738,9 +754,7 @@ void ProjectClip::updateParentInfo(const QString &folderid, const QString &folde
 
 bool ProjectClip::matches(const QString &condition)
 {
-    //TODO
-    Q_UNUSED(condition)
-    return true;
+    return bin()->searchIndex()->matches(this, BinSearchIndex::parseQuery(condition));
 }
 
 const QString ProjectClip::codec(bool audioCodec) const
@@ -836,6 +850,8 @@ void ProjectClip::addMarkers(QList<CommentedTime> &markers)
     }
     // refresh markers in clip monitor
     bin()->refreshClipMarkers(m_id);
+    // marker comments are searchable
+    bin()->emitItemUpdated(this);
     // refresh markers in timeline clips
     emit refreshClipDisplay();
 }
@@ -869,58 +885,109 @@ QVariant ProjectClip::data(DataType type) const
     case AbstractProjectItem::IconOverlay:
         return m_controller != nullptr ? (m_controller->hasEffects() ? QVariant("kdenlive-track_has_effect") : QVariant()) : QVariant();
         break;
+    case AbstractProjectItem::DataDecodeLoad:
+        return m_decodeStats.isValid() ? QVariant(QLocale().toString(m_decodeStats.load, 'f', 2)) : QVariant();
+        break;
     default:
         break;
     }
     return AbstractProjectItem::data(type);
 }
 
-void ProjectClip::slotQueryIntraThumbs(const QList<int> &frames)
+// Frame interval between thumbnails for each filmstrip zoom level
+static const int filmstripLevelCount = 4;
+static const int filmstripSteps[filmstripLevelCount] = {1, 4, 16, 64};
+// Height of the thumbnails in filmstrip tiles, they are scaled to the track height on painting
+static const int filmstripHeight = 100;
+
+// static
+int ProjectClip::filmstripStep(int level)
 {
-    QMutexLocker lock(&m_intraThumbMutex);
-    for (int i = 0; i < frames.count(); i++) {
-        if (!m_intraThumbs.contains(frames.at(i))) {
-            m_intraThumbs << frames.at(i);
+    return filmstripSteps[qBound(0, level, filmstripLevelCount - 1)];
+}
+
+// static
+int ProjectClip::filmstripLevel(double frames)
+{
+    for (int level = 0; level < filmstripLevelCount; ++level) {
+        if (frames <= filmstripSteps[level] + 0.001) {
+            return level;
+        }
+    }
+    return -1;
+}
+
+QImage ProjectClip::findFilmstripTile(int level, int index)
+{
+    return bin()->findFilmstripTile(hash(), level, index);
+}
+
+void ProjectClip::slotQueryFilmstripTiles(int level, const QList<int> &tiles)
+{
+    QMutexLocker lock(&m_tileMutex);
+    for (int index : tiles) {
+        const QPair<int, int> tile(level, index);
+        if (!m_requestedTiles.contains(tile)) {
+            m_requestedTiles << tile;
         }
     }
-    qSort(m_intraThumbs);
-    if (!m_intraThread.isRunning()) {
-        m_intraThread = QtConcurrent::run(this, &ProjectClip::doExtractIntra);
+    qSort(m_requestedTiles);
+    if (!m_extractingTiles) {
+        m_extractingTiles = true;
+        m_tileThread = QtConcurrent::run(this, &ProjectClip::doExtractTiles);
     }
 }
 
-void ProjectClip::doExtractIntra()
+void ProjectClip::doExtractTiles()
 {
     Mlt::Producer *prod = thumbProducer();
-    if (prod == nullptr || !prod->is_valid()) {
+    const QString clipHash = hash();
+    if (prod == nullptr || !prod->is_valid() || clipHash.isEmpty()) {
+        QMutexLocker lock(&m_tileMutex);
+        m_requestedTiles.clear();
+        m_extractingTiles = false;
         return;
     }
-    int fullWidth = 150 * prod->profile()->dar() + 0.5;
-    int max = prod->get_length();
-    int pos;
-    while (!m_intraThumbs.isEmpty()) {
-        m_intraThumbMutex.lock();
-        pos = m_intraThumbs.takeFirst();
-        m_intraThumbMutex.unlock();
-        if (pos >= max) {
-            pos = max - 1;
+    const int frameWidth = filmstripHeight * prod->profile()->dar() + 0.5;
+    const int max = prod->get_length();
+    while (true) {
+        m_tileMutex.lock();
+        if (m_requestedTiles.isEmpty()) {
+            m_extractingTiles = false;
+            m_tileMutex.unlock();
+            return;
         }
-        const QString path = url() + QLatin1Char('_') + QString::number(pos);
-        QImage img = bin()->findCachedPixmap(path);
-        if (!img.isNull()) {
-            // Cache already contains image
+        const QPair<int, int> tile = m_requestedTiles.takeFirst();
+        m_tileMutex.unlock();
+        const int step = filmstripStep(tile.first);
+        const int firstFrame = tile.second * filmstripTileFrames * step;
+        if (firstFrame >= max || bin()->hasFilmstripTile(clipHash, tile.first, tile.second)) {
             continue;
         }
-        prod->seek(pos);
-        Mlt::Frame *frame = prod->get_frame();
-        frame->set("deinterlace_method", "onefield");
-        frame->set("top_field_first", -1);
-        if (frame->is_valid()) {
-            img = KThumb::getFrame(frame, fullWidth, 150);
-            bin()->cachePixmap(path, img);
-            emit thumbReady(pos, img);
+        // Decode all thumbnails of the tile in a row. Fetching a frame moves the producer to the
+        // next one, so consecutive frames (step 1) are decoded without a new seek
+        QImage sheet(frameWidth * filmstripTileFrames, filmstripHeight, QImage::Format_ARGB32);
+        sheet.fill(Qt::black);
+        QPainter painter(&sheet);
+        for (int i = 0; i < filmstripTileFrames; ++i) {
+            const int pos = firstFrame + i * step;
+            if (pos >= max) {
+                break;
+            }
+            if (prod->position() != pos) {
+                prod->seek(pos);
+            }
+            Mlt::Frame *frame = prod->get_frame();
+            frame->set("deinterlace_method", "onefield");
+            frame->set("top_field_first", -1);
+            if (frame->is_valid()) {
+                painter.drawImage(i * frameWidth, 0, KThumb::getFrame(frame, frameWidth, filmstripHeight));
+            }
+            delete frame;
         }
-        delete frame;
+        painter.end();
+        bin()->cacheFilmstripTile(clipHash, tile.first, tile.second, sheet);
+        emit filmstripTileReady(tile.first, tile.second);
     }
 }
 
@@ -945,22 +1012,15 @@ void ProjectClip::doExtractImage()
         return;
     }
     int frameWidth = 150 * prod->profile()->dar() + 0.5;
-    bool ok = false;
-    QDir thumbFolder = bin()->getCacheDir(CacheThumbs, &ok);
     int max = prod->get_length();
     while (!m_requestedThumbs.isEmpty()) {
         m_thumbMutex.lock();
         int pos = m_requestedThumbs.takeFirst();
         m_thumbMutex.unlock();
-        if (ok && thumbFolder.exists(hash() + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".png"))) {
-            emit thumbReady(pos, QImage(thumbFolder.absoluteFilePath(hash() + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".png"))));
-            continue;
-        }
         if (pos >= max) {
             pos = max - 1;
         }
-        const QString path = url() + QLatin1Char('_') + QString::number(pos);
-        QImage img = bin()->findCachedPixmap(path);
+        QImage img = bin()->findCachedThumb(hash(), pos);
         if (!img.isNull()) {
             emit thumbReady(pos, img);
             continue;
@@ -971,7 +1031,7 @@ void ProjectClip::doExtractImage()
         frame->set("top_field_first", -1);
         if (frame->is_valid()) {
             img = KThumb::getFrame(frame, frameWidth, 150, prod->profile()->sar() != 1);
-            bin()->cachePixmap(path, img);
+            bin()->cacheThumb(hash(), pos, img);
             emit thumbReady(pos, img);
         }
         delete frame;
@@ -1060,6 +1120,7 @@ void ProjectClip::slotCreateAudioThumbs()
             audioLevels << qBlue(p);
             audioLevels << qAlpha(p);
         }
+        bin()->cacheAccounting()->fileUsed(CacheAudio, audioPath);
     }
     if (!audioLevels.isEmpty()) {
         emit updateJobStatus(AbstractClipJob::THUMBJOB, JobDone, 0);
@@ -1289,7 +1350,9 @@ void ProjectClip::slotCreateAudioThumbs()
             }
             image.setPixel(i / channels, i % channels, p);
         }
-        image.save(audioPath);
+        if (image.save(audioPath)) {
+            bin()->cacheAccounting()->fileAdded(CacheAudio, audioPath);
+        }
     }
     m_abortAudioThumb = false;
 }
@@ -1331,73 +1394,82 @@ QStringList ProjectClip::updatedAnalysisData(const QString &name, const QString
         // Remove data
         return QStringList() << QString("kdenlive:clipanalysis." + name) << QString();
         //m_controller->resetProperty("kdenlive:clipanalysis." + name);
-    } else {
-        QString current = m_controller->property("kdenlive:clipanalysis." + name);
-        if (!current.isEmpty()) {
-            if (KMessageBox::questionYesNo(QApplication::activeWindow(), i18n("Clip already contains analysis data %1", name), QString(), KGuiItem(i18n("Merge")), KGuiItem(i18n("Add"))) == KMessageBox::Yes) {
-                // Merge data
-                Mlt::Profile *profile = m_controller->profile();
-                Mlt::Geometry geometry(current.toUtf8().data(), duration().frames(profile->fps()), profile->width(), profile->height());
-                Mlt::Geometry newGeometry(data.toUtf8().data(), duration().frames(profile->fps()), profile->width(), profile->height());
-                Mlt::GeometryItem item;
-                int pos = 0;
-                while (!newGeometry.next_key(&item, pos)) {
-                    pos = item.frame();
-                    item.frame(pos + offset);
-                    pos++;
-                    geometry.insert(item);
-                }
-                return QStringList() << QString("kdenlive:clipanalysis." + name) << geometry.serialise();
-                //m_controller->setProperty("kdenlive:clipanalysis." + name, geometry.serialise());
-            } else {
-                // Add data with another name
-                int i = 1;
-                QString previous = m_controller->property("kdenlive:clipanalysis." + name + QString::number(i));
-                while (!previous.isEmpty()) {
-                    ++i;
-                    previous = m_controller->property("kdenlive:clipanalysis." + name + QString::number(i));
-                }
-                return QStringList() << QString("kdenlive:clipanalysis." + name + QString::number(i)) << geometryWithOffset(data, offset);
-                //m_controller->setProperty("kdenlive:clipanalysis." + name + QLatin1Char(' ') + QString::number(i), geometryWithOffset(data, offset));
-            }
+    }
+    QVector<AnalysisKeyframe> keyframes = analysisKeyframes(data);
+    if (offset != 0) {
+        for (int i = 0; i < keyframes.count(); ++i) {
+            keyframes[i].frame += offset;
+        }
+    }
+    QString current = m_controller->property("kdenlive:clipanalysis." + name);
+    if (!current.isEmpty()) {
+        if (KMessageBox::questionYesNo(QApplication::activeWindow(), i18n("Clip already contains analysis data %1", name), QString(), KGuiItem(i18n("Merge")), KGuiItem(i18n("Add"))) == KMessageBox::Yes) {
+            // Merge data
+            return QStringList() << QString("kdenlive:clipanalysis." + name) << storeAnalysisKeyframes(AnalysisStore::merge(analysisKeyframes(current), keyframes));
         } else {
-            return QStringList() << QString("kdenlive:clipanalysis." + name) << geometryWithOffset(data, offset);
-            //m_controller->setProperty("kdenlive:clipanalysis." + name, geometryWithOffset(data, offset));
+            // Add data with another name
+            int i = 1;
+            QString previous = m_controller->property("kdenlive:clipanalysis." + name + QString::number(i));
+            while (!previous.isEmpty()) {
+                ++i;
+                previous = m_controller->property("kdenlive:clipanalysis." + name + QString::number(i));
+            }
+            return QStringList() << QString("kdenlive:clipanalysis." + name + QString::number(i)) << storeAnalysisKeyframes(keyframes);
         }
     }
+    return QStringList() << QString("kdenlive:clipanalysis." + name) << storeAnalysisKeyframes(keyframes);
 }
 
-QMap<QString, QString> ProjectClip::analysisData(bool withPrefix)
+QMap<QString, QString> ProjectClip::analysisData(bool withPrefix, int from, int to)
 {
-    return m_controller->getPropertiesFromPrefix(QStringLiteral("kdenlive:clipanalysis."), withPrefix);
+    QMap<QString, QString> data = m_controller->getPropertiesFromPrefix(QStringLiteral("kdenlive:clipanalysis."), withPrefix);
+    Mlt::Profile *profile = m_controller->profile();
+    QMap<QString, QString>::iterator i = data.begin();
+    while (i != data.end()) {
+        if (AnalysisStore::isReference(i.value())) {
+            i.value() = AnalysisStore::serialise(bin()->analysisStore()->keyframes(i.value(), from, to), profile->width(), profile->height());
+        }
+        ++i;
+    }
+    return data;
 }
 
-const QString ProjectClip::geometryWithOffset(const QString &data, int offset)
+QString ProjectClip::storeAnalysisData(const QString &data)
 {
-    if (offset == 0) {
-        return data;
+    return storeAnalysisKeyframes(analysisKeyframes(data));
+}
+
+QVector<AnalysisKeyframe> ProjectClip::analysisKeyframes(const QString &value)
+{
+    if (AnalysisStore::isReference(value)) {
+        return bin()->analysisStore()->keyframes(value);
     }
     Mlt::Profile *profile = m_controller->profile();
-    Mlt::Geometry geometry(data.toUtf8().data(), duration().frames(profile->fps()), profile->width(), profile->height());
-    Mlt::Geometry newgeometry(nullptr, duration().frames(profile->fps()), profile->width(), profile->height());
-    Mlt::GeometryItem item;
-    int pos = 0;
-    while (!geometry.next_key(&item, pos)) {
-        pos = item.frame();
-        item.frame(pos + offset);
-        pos++;
-        newgeometry.insert(item);
-    }
-    return newgeometry.serialise();
+    return AnalysisStore::parse(value, duration().frames(profile->fps()), profile->width(), profile->height());
 }
 
-QImage ProjectClip::findCachedThumb(int pos)
+QString ProjectClip::storeAnalysisKeyframes(const QVector<AnalysisKeyframe> &keyframes)
 {
-    const QString path = url() + QLatin1Char('_') + QString::number(pos);
-    return bin()->findCachedPixmap(path);
+    const QString reference = bin()->analysisStore()->insert(keyframes);
+    if (!reference.isEmpty()) {
+        return reference;
+    }
+    // No project cache folder, keep data in the project file
+    Mlt::Profile *profile = m_controller->profile();
+    return AnalysisStore::serialise(keyframes, profile->width(), profile->height());
 }
 
 bool ProjectClip::isSplittable() const
 {
     return (m_type == AV || m_type == Playlist);
 }
+
+void ProjectClip::setDecodeStats(const ClipDecodeStats &stats)
+{
+    m_decodeStats = stats;
+}
+
+const ClipDecodeStats &ProjectClip::decodeStats() const
+{
+    return m_decodeStats;
+}
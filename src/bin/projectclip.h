@@ -24,11 +24,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PROJECTCLIP_H
 
 #include "abstractprojectitem.h"
+#include "clipprofiler.h"
 #include "definitions.h"
 
 #include <QUrl>
 #include <QMutex>
 #include <QFuture>
+#include <QVector>
 
 class ProjectFolder;
 class AudioStreamInfo;
@@ -37,6 +39,7 @@ class ClipController;
 class ClipPropertiesController;
 class ProjectSubClip;
 class QUndoCommand;
+struct AnalysisKeyframe;
 
 namespace Mlt
 {
@@ -201,7 +204,12 @@ public:
     int audioChannels() const;
     /** @brief get data analysis value. */
     QStringList updatedAnalysisData(const QString &name, const QString &data, int offset);
-    QMap<QString, QString> analysisData(bool withPrefix = false);
+    /** @brief Returns the clip analysis data, as geometry strings.
+     *  @param from first frame of the range to read from stored data
+     *  @param to last frame of the range, -1 to read until the end */
+    QMap<QString, QString> analysisData(bool withPrefix = false, int from = 0, int to = -1);
+    /** @brief Write a geometry string to the analysis store, returns the value to put in the clip property. */
+    QString storeAnalysisData(const QString &data);
     /** @brief Abort running audio thumb process if any. */
     void abortAudioThumbs();
     /** @brief Returns the list of this clip's subclip's ids. */
@@ -210,11 +218,23 @@ public:
     void discardAudioThumb();
     /** @brief Get path for this clip's audio thumbnail */
     const QString getAudioThumbPath(AudioStreamInfo *audioInfo);
-    /** @brief Returns a cached pixmap for a frame of this clip */
-    QImage findCachedThumb(int pos);
-    void slotQueryIntraThumbs(const QList<int> &frames);
+    /** @brief Number of thumbnails in a timeline filmstrip tile. */
+    static const int filmstripTileFrames = 10;
+    /** @brief Returns the frame interval between two thumbnails of a filmstrip zoom level. */
+    static int filmstripStep(int level);
+    /** @brief Returns the filmstrip zoom level to use when a thumbnail covers @param frames frames, -1 if thumbnails would be too far apart. */
+    static int filmstripLevel(double frames);
+    /** @brief Returns a cached filmstrip tile, null if it was not created yet.
+     *  Tile @param index of a @param level contains the thumbnails of frames index * filmstripTileFrames * step + n * step. */
+    QImage findFilmstripTile(int level, int index);
+    /** @brief Queue creation of filmstrip tiles, filmstripTileReady is emitted for each created tile. */
+    void slotQueryFilmstripTiles(int level, const QList<int> &tiles);
     /** @brief Returns true if this producer has audio and can be splitted on timeline*/
     bool isSplittable() const;
+    /** @brief Store the playback cost measured by the clip profiler. */
+    void setDecodeStats(const ClipDecodeStats &stats);
+    /** @brief Returns the measured playback cost, invalid if the clip was not profiled. */
+    const ClipDecodeStats &decodeStats() const;
 
 public slots:
     void updateAudioThumbnail(const QVariantList &audioLevels);
@@ -238,16 +258,24 @@ private:
     QString m_temporaryUrl;
     ClipType m_type;
     Mlt::Producer *m_thumbsProducer;
+    ClipDecodeStats m_decodeStats;
     QMutex m_producerMutex;
     QMutex m_thumbMutex;
-    QMutex m_intraThumbMutex;
+    QMutex m_tileMutex;
     QFuture <void> m_thumbThread;
     QList<int> m_requestedThumbs;
-    QFuture <void> m_intraThread;
-    QList<int> m_intraThumbs;
-    const QString geometryWithOffset(const QString &data, int offset);
+    QFuture <void> m_tileThread;
+    /** @brief Requested filmstrip tiles, as (level, index) pairs. */
+    QList<QPair<int, int> > m_requestedTiles;
+    /** @brief True while the tile thread is processing requests. */
+    bool m_extractingTiles;
+    /** @brief Returns the keyframes of an analysis property value, stored or inline. */
+    QVector<AnalysisKeyframe> analysisKeyframes(const QString &value);
+    /** @brief Write keyframes to the analysis store, returns the value to put in the clip property. */
+    QString storeAnalysisKeyframes(const QVector<AnalysisKeyframe> &keyframes);
     void doExtractImage();
-    void doExtractIntra();
+    /** @brief Decode the frames of the requested filmstrip tiles and assemble them. */
+    void doExtractTiles();
 
 private slots:
     void updateFfmpegProgress();
@@ -258,6 +286,7 @@ signals:
     void refreshAnalysisPanel();
     void refreshClipDisplay();
     void thumbReady(int, const QImage &);
+    void filmstripTileReady(int level, int index);
     void thumbUpdated(const QImage &);
     void updateJobStatus(int jobType, int status, int progress = 0, const QString &statusMessage = QString());
     /** @brief Clip is ready, load properties. */
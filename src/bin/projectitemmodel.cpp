@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "projectclip.h"
 #include "projectsubclip.h"
 #include "projectfolder.h"
+#include "binsearchindex.h"
 #include "bin.h"
 
 #include <qvarlengtharray.h>
@@ -35,6 +36,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ProjectItemModel::ProjectItemModel(Bin *bin) :
     QAbstractItemModel(bin)
     , m_bin(bin)
+    , m_searchIndex(new BinSearchIndex(this))
 {
     connect(m_bin, &Bin::itemUpdated, this, &ProjectItemModel::onItemUpdated);
 }
@@ -55,6 +57,9 @@ int ProjectItemModel::mapToColumn(int column) const
     case 2:
         return AbstractProjectItem::DataDescription;
         break;
+    case 3:
+        return AbstractProjectItem::DataDecodeLoad;
+        break;
     default:
         return AbstractProjectItem::DataName;
     }
@@ -87,6 +92,7 @@ bool ProjectItemModel::setData(const QModelIndex &index, const QVariant &value,
 {
     AbstractProjectItem *item = static_cast<AbstractProjectItem *>(index.internalPointer());
     if (item->rename(value.toString(), index.column())) {
+        m_searchIndex->updateItem(item);
         emit dataChanged(index, index, QVector<int> () << role);
         return true;
     }
@@ -173,6 +179,9 @@ QVariant ProjectItemModel::headerData(int section, Qt::Orientation orientation,
         case 2:
             columnName = i18n("Description");
             break;
+        case 3:
+            columnName = i18n("Playback Load");
+            break;
         default:
             columnName = i18n("Unknown");
             break;
@@ -301,12 +310,13 @@ void ProjectItemModel::onAboutToAddItem(AbstractProjectItem *item)
 
 void ProjectItemModel::onItemAdded(AbstractProjectItem *item)
 {
-    Q_UNUSED(item)
+    m_searchIndex->addItem(item);
     endInsertRows();
 }
 
 void ProjectItemModel::onAboutToRemoveItem(AbstractProjectItem *item)
 {
+    m_searchIndex->removeItem(item);
     AbstractProjectItem *parentItem = item->parent();
     if (parentItem == nullptr) {
         return;
@@ -330,6 +340,7 @@ void ProjectItemModel::onItemUpdated(AbstractProjectItem *item)
     if (!item || item->clipStatus() == AbstractProjectItem::StatusDeleting) {
         return;
     }
+    m_searchIndex->updateItem(item);
     AbstractProjectItem *parentItem = item->parent();
     if (parentItem == nullptr) {
         return;
@@ -340,3 +351,8 @@ void ProjectItemModel::onItemUpdated(AbstractProjectItem *item)
     }
     emit dataChanged(parentIndex, parentIndex);
 }
+
+BinSearchIndex *ProjectItemModel::searchIndex()
+{
+    return m_searchIndex;
+}
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 class AbstractProjectItem;
 class Bin;
+class BinSearchIndex;
 
 /**
  * @class ProjectItemModel
@@ -73,6 +74,8 @@ public:
     /** @brief Prepare some stuff after removing a new item */
     void onItemRemoved(AbstractProjectItem *item);
     bool dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent) Q_DECL_OVERRIDE;
+    /** @brief Returns the search data of all items, used to filter the bin */
+    BinSearchIndex *searchIndex();
     Qt::DropActions supportedDropActions() const Q_DECL_OVERRIDE;
 
 public slots:
@@ -82,6 +85,8 @@ public slots:
 private:
     /** @brief Reference to the project bin */
     Bin *m_bin;
+    /** @brief Search data, kept up to date when items are added, updated or removed */
+    BinSearchIndex *m_searchIndex;
     /** @brief Return reference to column specific data */
     int mapToColumn(int column) const;
 
@@ -21,71 +21,59 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "projectsortproxymodel.h"
 #include "abstractprojectitem.h"
+#include "projectitemmodel.h"
+#include "binsearchindex.h"
 
 #include <QItemSelectionModel>
 
 ProjectSortProxyModel::ProjectSortProxyModel(QObject *parent)
     : QSortFilterProxyModel(parent)
+    , m_searchRevision(0)
 {
     m_collator.setNumericMode(true);
     m_selection = new QItemSelectionModel(this);
     connect(m_selection, &QItemSelectionModel::selectionChanged, this, &ProjectSortProxyModel::onCurrentRowChanged);
     setDynamicSortFilter(true);
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(200);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &ProjectSortProxyModel::slotRefreshSearch);
 }
 
-// Responsible for item sorting!
-bool ProjectSortProxyModel::filterAcceptsRow(int sourceRow,
-        const QModelIndex &sourceParent) const
+void ProjectSortProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
 {
-    if (filterAcceptsRowItself(sourceRow, sourceParent)) {
-        return true;
+    if (this->sourceModel()) {
+        disconnect(searchIndex(), &BinSearchIndex::revisionChanged, &m_refreshTimer, nullptr);
     }
-    //accept if any of the children is accepted on it's own merits
-    if (hasAcceptedChildren(sourceRow, sourceParent)) {
-        return true;
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+    if (sourceModel) {
+        connect(searchIndex(), &BinSearchIndex::revisionChanged, &m_refreshTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
     }
-    return false;
 }
 
-bool ProjectSortProxyModel::filterAcceptsRowItself(int sourceRow,
+// Responsible for item sorting!
+bool ProjectSortProxyModel::filterAcceptsRow(int sourceRow,
         const QModelIndex &sourceParent) const
 {
-    int cols = sourceModel()->columnCount();
-    for (int i = 0; i < cols; i++) {
-        QModelIndex index0 = sourceModel()->index(sourceRow, i, sourceParent);
-        if (!index0.isValid()) {
-            return false;
-        }
-        if (sourceModel()->data(index0).toString().contains(m_searchString, Qt::CaseInsensitive)) {
-            return true;
-        }
+    if (m_searchTokens.isEmpty()) {
+        return true;
     }
-    return false;
-}
-
-bool ProjectSortProxyModel::hasAcceptedChildren(int sourceRow, const QModelIndex &source_parent) const
-{
-    QModelIndex item = sourceModel()->index(sourceRow, 0, source_parent);
-    if (!item.isValid()) {
+    QModelIndex index0 = sourceModel()->index(sourceRow, 0, sourceParent);
+    if (!index0.isValid()) {
         return false;
     }
-
-    //check if there are children
-    int childCount = item.model()->rowCount(item);
-    if (childCount == 0) {
-        return false;
+    AbstractProjectItem *item = static_cast<AbstractProjectItem *>(index0.internalPointer());
+    if (m_visibleItems.contains(item)) {
+        return true;
     }
+    // Items added or modified after the search are checked individually until the search
+    // runs again, which also shows their parent folders
+    BinSearchIndex *index = searchIndex();
+    return index->isModifiedSince(item, m_searchRevision) && index->matches(item, m_searchTokens);
+}
 
-    for (int i = 0; i < childCount; ++i) {
-        if (filterAcceptsRowItself(i, item)) {
-            return true;
-        }
-        //recursive call -> NOTICE that this is depth-first searching, you're probably better off with breadth first search...
-        if (hasAcceptedChildren(i, item)) {
-            return true;
-        }
-    }
-    return false;
+BinSearchIndex *ProjectSortProxyModel::searchIndex() const
+{
+    return static_cast<ProjectItemModel *>(sourceModel())->searchIndex();
 }
 
 bool ProjectSortProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
@@ -123,7 +111,48 @@ QItemSelectionModel *ProjectSortProxyModel::selectionModel()
 
 void ProjectSortProxyModel::slotSetSearchString(const QString &str)
 {
+    const QStringList tokens = BinSearchIndex::parseQuery(str);
     m_searchString = str;
+    if (tokens.isEmpty() || !sourceModel()) {
+        m_searchTokens.clear();
+        m_matches.clear();
+        m_visibleItems.clear();
+        invalidateFilter();
+        return;
+    }
+    // When the query is only extended, matches are a subset of the previous ones
+    updateMatches(tokens, BinSearchIndex::isRefinement(m_searchTokens, tokens));
+}
+
+void ProjectSortProxyModel::slotRefreshSearch()
+{
+    if (m_searchTokens.isEmpty() || !sourceModel() || searchIndex()->revision() == m_searchRevision) {
+        return;
+    }
+    updateMatches(m_searchTokens, false);
+}
+
+void ProjectSortProxyModel::updateMatches(const QStringList &tokens, bool refine)
+{
+    BinSearchIndex *index = searchIndex();
+    if (refine && index->revision() == m_searchRevision) {
+        m_matches = index->search(tokens, &m_matches);
+    } else {
+        m_matches = index->search(tokens);
+    }
+    m_searchTokens = tokens;
+    m_searchRevision = index->revision();
+    // Folders containing a match must be visible
+    QSet<AbstractProjectItem *> parents;
+    for (AbstractProjectItem *item : m_matches) {
+        AbstractProjectItem *parentItem = item->parent();
+        while (parentItem && !parents.contains(parentItem)) {
+            parents.insert(parentItem);
+            parentItem = parentItem->parent();
+        }
+    }
+    m_visibleItems = m_matches;
+    m_visibleItems.unite(parents);
     invalidateFilter();
 }
 
@@ -24,8 +24,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QSortFilterProxyModel>
 #include <QCollator>
+#include <QSet>
+#include <QTimer>
 
 class QItemSelectionModel;
+class AbstractProjectItem;
+class BinSearchIndex;
 
 /**
  * @class ProjectSortProxyModel
@@ -39,6 +43,7 @@ class ProjectSortProxyModel : public QSortFilterProxyModel
 public:
     explicit ProjectSortProxyModel(QObject *parent = nullptr);
     QItemSelectionModel *selectionModel();
+    void setSourceModel(QAbstractItemModel *sourceModel) Q_DECL_OVERRIDE;
 
 public slots:
     /** @brief Set search string that will filter the view */
@@ -49,6 +54,8 @@ public slots:
 private slots:
     /** @brief Called when a row change is detected by selection model */
     void onCurrentRowChanged(const QItemSelection &current, const QItemSelection &previous);
+    /** @brief Run the current search again after items were added or updated */
+    void slotRefreshSearch();
 
 protected:
     /** @brief Decide which items should be displayed depending on the search string  */
@@ -56,13 +63,24 @@ protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const Q_DECL_OVERRIDE;
     /** @brief Reimplemented to show folders first  */
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const Q_DECL_OVERRIDE;
-    bool filterAcceptsRowItself(int source_row, const QModelIndex &source_parent) const;
-    bool hasAcceptedChildren(int source_row, const QModelIndex &source_parent) const;
 
 private:
     QItemSelectionModel *m_selection;
     QString m_searchString;
+    /** @brief Case folded tokens of the search string */
+    QStringList m_searchTokens;
+    /** @brief Items matching the current search */
+    QSet<AbstractProjectItem *> m_matches;
+    /** @brief Matching items and their parent folders */
+    QSet<AbstractProjectItem *> m_visibleItems;
+    /** @brief Search index revision when the search was performed */
+    int m_searchRevision;
+    /** @brief Groups item changes before running the search again */
+    QTimer m_refreshTimer;
     QCollator m_collator;
+    BinSearchIndex *searchIndex() const;
+    /** @brief Search the index and show the matches with their parent folders */
+    void updateMatches(const QStringList &tokens, bool refine);
 
 signals:
     /** @brief Emitted when the row changes, used to prepare action for selected item  */
@@ -90,6 +90,8 @@ KdenliveSettingsDialog::KdenliveSettingsDialog(const QMap<QString, QString> &map
     m_configProject.projecturl->setUrl(QUrl::fromLocalFile(KdenliveSettings::defaultprojectfolder()));
     connect(m_configProject.kcfg_generateimageproxy, &QAbstractButton::toggled, m_configProject.kcfg_proxyimageminsize, &QWidget::setEnabled);
     m_configProject.kcfg_proxyimageminsize->setEnabled(KdenliveSettings::generateimageproxy());
+    connect(m_configProject.kcfg_analyseproxy, &QAbstractButton::toggled, m_configProject.kcfg_analysisframestep, &QWidget::setEnabled);
+    m_configProject.kcfg_analysisframestep->setEnabled(KdenliveSettings::analyseproxy());
 
     QWidget *p3 = new QWidget;
     m_configTimeline.setupUi(p3);
@@ -0,0 +1,308 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "analysisstore.h"
+
+#include "kdenlive_debug.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <mlt++/Mlt.h>
+
+// Magic number and format version of the data files
+static const quint32 analysisMagic = 0x4b44414e;
+static const quint32 analysisVersion = 1;
+// Magic, version and keyframe count
+static const qint64 headerSize = 12;
+// Frame number and 5 single precision values
+static const qint64 recordSize = 24;
+static const QString referencePrefix = QStringLiteral("analysis:");
+// Magic number and format version of the buffer embedded in project files
+static const quint32 packMagic = 0x4b444150;
+static const quint32 packVersion = 1;
+
+AnalysisStore::AnalysisStore()
+    : m_hasFolder(false)
+{
+}
+
+void AnalysisStore::setFolder(const QDir &folder)
+{
+    QMutexLocker lock(&m_mutex);
+    m_folder = folder;
+    m_hasFolder = m_folder.exists() || m_folder.mkpath(QStringLiteral("."));
+}
+
+// static
+bool AnalysisStore::isReference(const QString &value)
+{
+    return value.startsWith(referencePrefix);
+}
+
+QString AnalysisStore::filePath(const QString &reference) const
+{
+    return m_folder.absoluteFilePath(reference.mid(referencePrefix.length()) + QStringLiteral(".analysis"));
+}
+
+QString AnalysisStore::insert(const QVector<AnalysisKeyframe> &keyframes)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    stream << analysisMagic << analysisVersion << (quint32) keyframes.count();
+    for (const AnalysisKeyframe &keyframe : keyframes) {
+        stream << (qint32) keyframe.frame << keyframe.x << keyframe.y << keyframe.w << keyframe.h << keyframe.mix;
+    }
+    const QString reference = referencePrefix + QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+    QMutexLocker lock(&m_mutex);
+    if (!m_hasFolder) {
+        return QString();
+    }
+    const QString path = filePath(reference);
+    if (QFile::exists(path)) {
+        // Same data was already stored
+        return reference;
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qCDebug(KDENLIVE_LOG) << "Cannot write analysis data: " << path;
+        return QString();
+    }
+    return reference;
+}
+
+bool AnalysisStore::contains(const QString &reference)
+{
+    QMutexLocker lock(&m_mutex);
+    return m_hasFolder && isReference(reference) && QFile::exists(filePath(reference));
+}
+
+QByteArray AnalysisStore::pack(const QStringList &references, const QByteArray &previous)
+{
+    QMap<QString, QByteArray> entries;
+    QMap<QString, QByteArray> previousEntries;
+    bool previousRead = false;
+    QMutexLocker lock(&m_mutex);
+    for (const QString &reference : references) {
+        if (!isReference(reference) || entries.contains(reference)) {
+            continue;
+        }
+        QFile file(filePath(reference));
+        if (m_hasFolder && file.open(QIODevice::ReadOnly)) {
+            entries.insert(reference, file.readAll());
+            continue;
+        }
+        // File was removed from the cache, keep the data we embedded before
+        if (!previousRead) {
+            previousEntries = unpackData(previous);
+            previousRead = true;
+        }
+        if (previousEntries.contains(reference)) {
+            entries.insert(reference, previousEntries.value(reference));
+        }
+    }
+    if (entries.isEmpty()) {
+        return QByteArray();
+    }
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << packMagic << packVersion << entries;
+    return qCompress(data);
+}
+
+void AnalysisStore::unpack(const QByteArray &packed)
+{
+    const QMap<QString, QByteArray> entries = unpackData(packed);
+    QMutexLocker lock(&m_mutex);
+    if (!m_hasFolder) {
+        return;
+    }
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        const QString path = filePath(it.key());
+        if (!isReference(it.key()) || QFile::exists(path)) {
+            continue;
+        }
+        // Files are named after their content, skip corrupted entries
+        if (QString::fromLatin1(QCryptographicHash::hash(it.value(), QCryptographicHash::Md5).toHex()) != it.key().mid(referencePrefix.length())) {
+            qCDebug(KDENLIVE_LOG) << "Corrupted embedded analysis data: " << it.key();
+            continue;
+        }
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(it.value()) != it.value().size() || !file.commit()) {
+            qCDebug(KDENLIVE_LOG) << "Cannot write analysis data: " << path;
+        }
+    }
+}
+
+// static
+QMap<QString, QByteArray> AnalysisStore::unpackData(const QByteArray &packed)
+{
+    QMap<QString, QByteArray> entries;
+    if (packed.isEmpty()) {
+        return entries;
+    }
+    const QByteArray data = qUncompress(packed);
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_6);
+    quint32 magic;
+    quint32 version;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != packMagic || version != packVersion) {
+        return entries;
+    }
+    stream >> entries;
+    if (stream.status() != QDataStream::Ok) {
+        entries.clear();
+    }
+    return entries;
+}
+
+int AnalysisStore::count(const QString &reference)
+{
+    QMutexLocker lock(&m_mutex);
+    QFile file(filePath(reference));
+    if (!isReference(reference) || !file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    QDataStream stream(&file);
+    quint32 magic;
+    quint32 version;
+    quint32 count;
+    stream >> magic >> version >> count;
+    if (stream.status() != QDataStream::Ok || magic != analysisMagic || version != analysisVersion || file.size() != headerSize + count * recordSize) {
+        return -1;
+    }
+    return (int) count;
+}
+
+QVector<AnalysisKeyframe> AnalysisStore::keyframes(const QString &reference, int from, int to)
+{
+    QVector<AnalysisKeyframe> result;
+    const int total = count(reference);
+    if (total <= 0) {
+        return result;
+    }
+    QMutexLocker lock(&m_mutex);
+    QFile file(filePath(reference));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return result;
+    }
+    QDataStream stream(&file);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    // Keyframes are sorted, find the first one in range
+    int first = 0;
+    int last = total;
+    while (first < last) {
+        const int middle = (first + last) / 2;
+        qint32 frame;
+        file.seek(headerSize + middle * recordSize);
+        stream >> frame;
+        if (frame < from) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    if (first > 0 && from > 0) {
+        // Include the previous keyframe, needed to interpolate the first frames of the range
+        first--;
+    }
+    file.seek(headerSize + first * recordSize);
+    for (int i = first; i < total; ++i) {
+        AnalysisKeyframe keyframe;
+        qint32 frame;
+        stream >> frame >> keyframe.x >> keyframe.y >> keyframe.w >> keyframe.h >> keyframe.mix;
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+        keyframe.frame = frame;
+        result << keyframe;
+        if (to >= 0 && frame >= to) {
+            // First keyframe after the range, needed to interpolate its last frames
+            break;
+        }
+    }
+    return result;
+}
+
+// static
+QVector<AnalysisKeyframe> AnalysisStore::parse(const QString &geometry, int length, int width, int height)
+{
+    QVector<AnalysisKeyframe> result;
+    Mlt::Geometry geom(geometry.toUtf8().data(), length, width, height);
+    Mlt::GeometryItem item;
+    int pos = 0;
+    while (!geom.next_key(&item, pos)) {
+        AnalysisKeyframe keyframe;
+        keyframe.frame = item.frame();
+        keyframe.x = item.x();
+        keyframe.y = item.y();
+        keyframe.w = item.w();
+        keyframe.h = item.h();
+        keyframe.mix = item.mix();
+        result << keyframe;
+        pos = item.frame() + 1;
+    }
+    return result;
+}
+
+// static
+QString AnalysisStore::serialise(const QVector<AnalysisKeyframe> &keyframes, int width, int height)
+{
+    if (keyframes.isEmpty()) {
+        return QString();
+    }
+    Mlt::Geometry geom(nullptr, keyframes.constLast().frame + 1, width, height);
+    for (const AnalysisKeyframe &keyframe : keyframes) {
+        Mlt::GeometryItem item;
+        item.frame(keyframe.frame);
+        item.x(keyframe.x);
+        item.y(keyframe.y);
+        item.w(keyframe.w);
+        item.h(keyframe.h);
+        item.mix(keyframe.mix);
+        geom.insert(item);
+    }
+    return QString::fromUtf8(geom.serialise());
+}
+
+// static
+QVector<AnalysisKeyframe> AnalysisStore::merge(const QVector<AnalysisKeyframe> &existing, const QVector<AnalysisKeyframe> &added)
+{
+    QVector<AnalysisKeyframe> result;
+    result.reserve(existing.count() + added.count());
+    int i = 0;
+    int j = 0;
+    while (i < existing.count() || j < added.count()) {
+        if (j == added.count() || (i < existing.count() && existing.at(i).frame < added.at(j).frame)) {
+            result << existing.at(i++);
+        } else {
+            if (i < existing.count() && existing.at(i).frame == added.at(j).frame) {
+                // Replace existing keyframe
+                ++i;
+            }
+            result << added.at(j++);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,94 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef ANALYSISSTORE_H
+#define ANALYSISSTORE_H
+
+#include <QDir>
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+/** @brief One keyframe of a clip analysis (for example a motion tracking rectangle). */
+struct AnalysisKeyframe {
+    int frame;
+    float x;
+    float y;
+    float w;
+    float h;
+    float mix;
+};
+
+/**
+ * @class AnalysisStore
+ * @brief Binary storage of the clip analysis data of a project.
+ * Analysis results (motion tracking, ...) used to be stored as serialized geometry strings
+ * in the clip's kdenlive:clipanalysis properties, which makes the project file huge for
+ * long tracked shots. They are now written in compact files sorted by frame in the
+ * project's cache folder, and the clip property only holds a reference to the file.
+ * Files are named after the hash of their content and never modified, so undoing an
+ * analysis change simply restores the previous reference. Files are only read when the
+ * data is requested, and a range of frames can be read without loading the whole file.
+ * As the cache folder is left behind when the project is moved, the files referenced by an
+ * archived project are packed in a compressed buffer embedded in the project file, and
+ * missing files are restored from it when the project is opened.
+ */
+
+class AnalysisStore
+{
+public:
+    AnalysisStore();
+    /** @brief Set the folder used to store analysis data. */
+    void setFolder(const QDir &folder);
+    /** @brief Returns true if a clip property value is a reference to stored data, false if it is a geometry string. */
+    static bool isReference(const QString &value);
+    /** @brief Write keyframes to the store.
+     *  @return the reference to put in the clip property, empty if data could not be written */
+    QString insert(const QVector<AnalysisKeyframe> &keyframes);
+    /** @brief Returns true if the data of a reference is available in the store. */
+    bool contains(const QString &reference);
+    /** @brief Pack the data of some references in a compressed buffer, to embed in the project file.
+     *  @param previous a previously packed buffer, used for the data missing from the folder */
+    QByteArray pack(const QStringList &references, const QByteArray &previous = QByteArray());
+    /** @brief Write the data of a packed buffer that is missing from the folder. */
+    void unpack(const QByteArray &packed);
+    /** @brief Returns the number of keyframes in stored data, -1 if the reference is not valid. */
+    int count(const QString &reference);
+    /** @brief Read stored keyframes. The keyframes surrounding the range are included so that values can be interpolated at its ends.
+     *  @param from first frame to read
+     *  @param to last frame to read, -1 to read until the end */
+    QVector<AnalysisKeyframe> keyframes(const QString &reference, int from = 0, int to = -1);
+    /** @brief Parse a geometry string. */
+    static QVector<AnalysisKeyframe> parse(const QString &geometry, int length, int width, int height);
+    /** @brief Build a geometry string from keyframes. */
+    static QString serialise(const QVector<AnalysisKeyframe> &keyframes, int width, int height);
+    /** @brief Merge two keyframe lists, keyframes from @param added replace existing ones on the same frame. */
+    static QVector<AnalysisKeyframe> merge(const QVector<AnalysisKeyframe> &existing, const QVector<AnalysisKeyframe> &added);
+
+private:
+    QMutex m_mutex;
+    QDir m_folder;
+    bool m_hasFolder;
+    QString filePath(const QString &reference) const;
+    /** @brief Returns the data files of a packed buffer, by reference. */
+    static QMap<QString, QByteArray> unpackData(const QByteArray &packed);
+};
+
+#endif
@@ -0,0 +1,447 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "cacheaccounting.h"
+#include "thumbnailstore.h"
+#include "kdenlivesettings.h"
+
+#include "kdenlive_debug.h"
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+CacheAccounting::CacheAccounting(ThumbnailStore *thumbnails, QObject *parent) : QObject(parent)
+    , m_thumbnails(thumbnails)
+    , m_otherSize(0)
+    , m_proxiesKnown(false)
+    , m_scanned(false)
+    , m_scanning(false)
+    , m_scanStart(0)
+{
+    for (int i = 0; i <= CacheAnalysis; ++i) {
+        m_totals[i] = 0;
+        m_quotas[i] = 0;
+    }
+    connect(&m_scanWatcher, &QFutureWatcher<ScanResult>::finished, this, &CacheAccounting::slotScanFinished);
+    updateQuotas();
+}
+
+CacheAccounting::~CacheAccounting()
+{
+    m_abortScan.store(1);
+    m_scanWatcher.waitForFinished();
+}
+
+void CacheAccounting::setFolders(const QDir &cacheRoot, const QString &documentId)
+{
+    if (m_scanning) {
+        m_abortScan.store(1);
+        m_scanWatcher.waitForFinished();
+        m_abortScan.store(0);
+    }
+    QMutexLocker lock(&m_mutex);
+    const QString base = cacheRoot.absoluteFilePath(documentId);
+    m_folders[CacheBase] = base;
+    m_folders[CachePreview] = base + QStringLiteral("/preview");
+    m_folders[CacheProxy] = cacheRoot.absoluteFilePath(QStringLiteral("proxy"));
+    m_folders[CacheAudio] = base + QStringLiteral("/audiothumbs");
+    m_folders[CacheThumbs] = base + QStringLiteral("/videothumbs");
+    m_folders[CacheAnalysis] = base + QStringLiteral("/analysis");
+    m_systemRoot = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absolutePath();
+    m_documentId = documentId;
+    for (int i = 0; i <= CacheAnalysis; ++i) {
+        m_entries[i].clear();
+        m_totals[i] = 0;
+    }
+    m_otherSize = 0;
+    m_projectProxies.clear();
+    m_proxiesKnown = false;
+    m_scanned = false;
+    m_scanning = false;
+    lock.unlock();
+    reconcile();
+}
+
+void CacheAccounting::setProjectProxies(const QStringList &hashes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_projectProxies = hashes.toSet();
+    m_proxiesKnown = true;
+}
+
+void CacheAccounting::addProjectProxy(const QString &hash)
+{
+    QMutexLocker lock(&m_mutex);
+    m_projectProxies.insert(hash);
+}
+
+void CacheAccounting::updateQuotas()
+{
+    QMutexLocker lock(&m_mutex);
+    m_quotas[CachePreview] = (qint64) KdenliveSettings::previewcachesize() * 1024 * 1024;
+    m_quotas[CacheProxy] = (qint64) KdenliveSettings::proxycachesize() * 1024 * 1024;
+    m_quotas[CacheAudio] = (qint64) KdenliveSettings::audiothumbcachesize() * 1024 * 1024;
+    QStringList evicted;
+    for (int i = CachePreview; i <= CacheAnalysis; ++i) {
+        evicted << evictFiles(i);
+    }
+    lock.unlock();
+    if (!evicted.isEmpty()) {
+        QtConcurrent::run(&CacheAccounting::deleteFiles, evicted);
+        scheduleNotify();
+    }
+}
+
+void CacheAccounting::fileAdded(CacheType type, const QString &path)
+{
+    if (type < CachePreview || type > CacheAnalysis) {
+        return;
+    }
+    // Stat the file outside of the lock
+    const QFileInfo info(path);
+    if (!info.exists()) {
+        return;
+    }
+    Entry entry;
+    entry.size = info.size();
+    entry.lastUse = QDateTime::currentMSecsSinceEpoch();
+    const QString key = info.absoluteFilePath();
+    QMutexLocker lock(&m_mutex);
+    m_totals[type] += entry.size - m_entries[type].value(key, Entry{0, 0}).size;
+    m_entries[type].insert(key, entry);
+    const QStringList evicted = evictFiles(type);
+    lock.unlock();
+    if (!evicted.isEmpty()) {
+        QtConcurrent::run(&CacheAccounting::deleteFiles, evicted);
+    }
+    scheduleNotify();
+}
+
+void CacheAccounting::fileRemoved(CacheType type, const QString &path)
+{
+    folderRemoved(type, path);
+}
+
+void CacheAccounting::folderRemoved(CacheType type, const QString &path)
+{
+    const QFileInfo info(path);
+    QMutexLocker lock(&m_mutex);
+    if (type == SystemCacheRoot) {
+        // A project folder was deleted from the system cache folder
+        if (m_folderSizes.remove(info.fileName()) == 0) {
+            return;
+        }
+    } else if (type >= CachePreview && type <= CacheAnalysis) {
+        removeEntries(type, info.absoluteFilePath());
+    } else {
+        return;
+    }
+    lock.unlock();
+    scheduleNotify();
+}
+
+void CacheAccounting::fileUsed(CacheType type, const QString &path)
+{
+    if (type < CachePreview || type > CacheAnalysis) {
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    QHash<QString, Entry>::iterator entry = m_entries[type].find(QFileInfo(path).absoluteFilePath());
+    if (entry != m_entries[type].end()) {
+        entry->lastUse = QDateTime::currentMSecsSinceEpoch();
+    }
+}
+
+qint64 CacheAccounting::size(CacheType type) const
+{
+    QMutexLocker lock(&m_mutex);
+    return currentSize(type);
+}
+
+qint64 CacheAccounting::currentSize(CacheType type) const
+{
+    switch (type) {
+    case CacheBase:
+        return m_otherSize + m_totals[CachePreview] + m_totals[CacheAudio] + currentSize(CacheThumbs) + m_totals[CacheAnalysis];
+    case CacheProxy: {
+        // The proxy folder is shared by all projects
+        qint64 total = 0;
+        QHash<QString, Entry>::const_iterator it = m_entries[CacheProxy].constBegin();
+        for (; it != m_entries[CacheProxy].constEnd(); ++it) {
+            if (isProjectProxy(it.key())) {
+                total += it->size;
+            }
+        }
+        return total;
+    }
+    case CacheThumbs:
+        return m_totals[CacheThumbs] + (m_thumbnails ? m_thumbnails->diskSize() : 0);
+    case CachePreview:
+    case CacheAudio:
+    case CacheAnalysis:
+        return m_totals[type];
+    default: {
+        qint64 total = 0;
+        const QMap<QString, qint64> sizes = currentFolderSizes();
+        for (qint64 folderSize : sizes) {
+            total += folderSize;
+        }
+        return total;
+    }
+    }
+}
+
+QMap<QString, qint64> CacheAccounting::folderSizes() const
+{
+    QMutexLocker lock(&m_mutex);
+    return currentFolderSizes();
+}
+
+QMap<QString, qint64> CacheAccounting::currentFolderSizes() const
+{
+    QMap<QString, qint64> sizes = m_folderSizes;
+    // Folders of the current project are kept up to date by the writers
+    if (QFileInfo(m_folders[CacheBase]).absolutePath() == m_systemRoot) {
+        sizes.insert(m_documentId, currentSize(CacheBase));
+    }
+    if (QFileInfo(m_folders[CacheProxy]).absolutePath() == m_systemRoot) {
+        sizes.insert(QStringLiteral("proxy"), m_totals[CacheProxy]);
+    }
+    return sizes;
+}
+
+bool CacheAccounting::isScanning() const
+{
+    QMutexLocker lock(&m_mutex);
+    return !m_scanned;
+}
+
+void CacheAccounting::reconcile()
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_scanning || m_folders[CacheBase].isEmpty()) {
+        return;
+    }
+    QStringList folders;
+    for (int i = 0; i <= CacheAnalysis; ++i) {
+        folders << m_folders[i];
+    }
+    // Folders of the current project are scanned file by file
+    QStringList skipped;
+    skipped << m_folders[CacheBase] << m_folders[CacheProxy];
+    m_scanning = true;
+    m_scanStart = QDateTime::currentMSecsSinceEpoch();
+    m_removedDuringScan.clear();
+    m_scanWatcher.setFuture(QtConcurrent::run(&CacheAccounting::scanFolders, folders, m_systemRoot, skipped, &m_abortScan));
+}
+
+void CacheAccounting::slotScanFinished()
+{
+    if (m_abortScan.load() != 0) {
+        return;
+    }
+    const ScanResult result = m_scanWatcher.result();
+    QMutexLocker lock(&m_mutex);
+    QStringList evicted;
+    for (int i = CachePreview; i <= CacheAnalysis; ++i) {
+        QHash<QString, Entry> entries = result.entries[i];
+        // Apply the changes that happened while scanning
+        for (const QString &removed : m_removedDuringScan) {
+            QHash<QString, Entry>::iterator it = entries.begin();
+            while (it != entries.end()) {
+                if (it.key() == removed || it.key().startsWith(removed + QLatin1Char('/'))) {
+                    it = entries.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        QHash<QString, Entry>::const_iterator current = m_entries[i].constBegin();
+        for (; current != m_entries[i].constEnd(); ++current) {
+            if (current->lastUse >= m_scanStart) {
+                entries.insert(current.key(), current.value());
+            }
+        }
+        qint64 total = 0;
+        for (const Entry &entry : entries) {
+            total += entry.size;
+        }
+        if (m_scanned && total != m_totals[i]) {
+            qCDebug(KDENLIVE_LOG) << "Cache accounting reconciled" << m_folders[i] << ":" << m_totals[i] << "->" << total;
+        }
+        m_entries[i] = entries;
+        m_totals[i] = total;
+        evicted << evictFiles(i);
+    }
+    m_otherSize = result.otherSize;
+    m_folderSizes = result.folderSizes;
+    m_removedDuringScan.clear();
+    m_scanned = true;
+    m_scanning = false;
+    lock.unlock();
+    if (!evicted.isEmpty()) {
+        QtConcurrent::run(&CacheAccounting::deleteFiles, evicted);
+    }
+    emit sizesChanged();
+}
+
+bool CacheAccounting::isProjectProxy(const QString &path) const
+{
+    // Proxies are named after the clip hash, followed by the proxy size and extension
+    const QString fileName = path.section(QLatin1Char('/'), -1);
+    return m_projectProxies.contains(fileName.section(QLatin1Char('.'), 0, 0).section(QLatin1Char('-'), 0, 0));
+}
+
+bool CacheAccounting::isEvictable(int type, const QString &path) const
+{
+    switch (type) {
+    case CacheProxy:
+        return m_proxiesKnown && !isProjectProxy(path);
+    case CacheAudio:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void CacheAccounting::removeEntries(int type, const QString &path)
+{
+    if (m_scanning) {
+        m_removedDuringScan << path;
+    }
+    QHash<QString, Entry>::iterator entry = m_entries[type].find(path);
+    if (entry != m_entries[type].end()) {
+        m_totals[type] -= entry->size;
+        m_entries[type].erase(entry);
+        return;
+    }
+    const QString folder = path + QLatin1Char('/');
+    QHash<QString, Entry>::iterator it = m_entries[type].begin();
+    while (it != m_entries[type].end()) {
+        if (it.key().startsWith(folder)) {
+            m_totals[type] -= it->size;
+            it = m_entries[type].erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+QStringList CacheAccounting::evictFiles(int type)
+{
+    QStringList evicted;
+    if (m_quotas[type] <= 0 || m_totals[type] <= m_quotas[type]) {
+        return evicted;
+    }
+    QList<QPair<qint64, QString> > candidates;
+    QHash<QString, Entry>::const_iterator it = m_entries[type].constBegin();
+    for (; it != m_entries[type].constEnd(); ++it) {
+        if (isEvictable(type, it.key())) {
+            candidates << qMakePair(it->lastUse, it.key());
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    // Free some more space so that we don't evict on each insertion
+    const qint64 target = m_quotas[type] * 9 / 10;
+    for (const QPair<qint64, QString> &candidate : candidates) {
+        if (m_totals[type] <= target) {
+            break;
+        }
+        evicted << candidate.second;
+        removeEntries(type, candidate.second);
+    }
+    return evicted;
+}
+
+void CacheAccounting::scheduleNotify()
+{
+    if (m_notifyPending.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "slotNotify", Qt::QueuedConnection);
+    }
+}
+
+void CacheAccounting::slotNotify()
+{
+    m_notifyPending.store(0);
+    emit sizesChanged();
+}
+
+// static
+CacheAccounting::ScanResult CacheAccounting::scanFolders(const QStringList &folders, const QString &systemRoot, const QStringList &skipped, const QAtomicInt *abort)
+{
+    ScanResult result;
+    result.otherSize = 0;
+    for (int i = CachePreview; i <= CacheAnalysis; ++i) {
+        // Thumbnail tiles are accounted by the thumbnail store
+        scanFolder(folders.at(i), result.entries[i], abort, i == CacheThumbs ? folders.at(i) + QStringLiteral("/tiles") : QString());
+    }
+    const QFileInfoList baseFiles = QDir(folders.at(CacheBase)).entryInfoList(QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
+    for (const QFileInfo &info : baseFiles) {
+        result.otherSize += info.size();
+    }
+    QDir root(systemRoot);
+    const QStringList projectFolders = root.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &folder : projectFolders) {
+        const QString path = root.absoluteFilePath(folder);
+        if (skipped.contains(path)) {
+            continue;
+        }
+        qint64 total = 0;
+        QDirIterator it(path, QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext() && abort->load() == 0) {
+            it.next();
+            total += it.fileInfo().size();
+        }
+        result.folderSizes.insert(folder, total);
+    }
+    return result;
+}
+
+// static
+void CacheAccounting::scanFolder(const QString &path, QHash<QString, Entry> &entries, const QAtomicInt *abort, const QString &skipped)
+{
+    QDirIterator it(path, QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext() && abort->load() == 0) {
+        const QString filePath = it.next();
+        if (!skipped.isEmpty() && filePath.startsWith(skipped + QLatin1Char('/'))) {
+            continue;
+        }
+        const QFileInfo info = it.fileInfo();
+        Entry entry;
+        entry.size = info.size();
+        // Access time is not always updated by the system, so keep the most recent one
+        entry.lastUse = qMax(info.lastModified(), info.lastRead()).toMSecsSinceEpoch();
+        entries.insert(filePath, entry);
+    }
+}
+
+// static
+void CacheAccounting::deleteFiles(const QStringList &files)
+{
+    for (const QString &file : files) {
+        if (!QFile::remove(file)) {
+            qCDebug(KDENLIVE_LOG) << "Cannot evict cache file" << file;
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef CACHEACCOUNTING_H
+#define CACHEACCOUNTING_H
+
+#include "definitions.h"
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QDir>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+
+class ThumbnailStore;
+
+/**
+ * @class CacheAccounting
+ * @brief Keeps track of the disk space used by the cache folders of a project.
+ * Computing the cache sizes by walking the folders is slow on large cache trees or network
+ * storage, so the size of each cached file is recorded when it is written or deleted by the
+ * preview renderer, the proxy jobs and the audio thumbnails, and running totals are kept per
+ * cache type and per project folder. A background scan of the folders reconciles the totals
+ * with what is really on disk. Video thumbnail tiles are accounted by the ThumbnailStore.
+ * When a cache type exceeds its configured quota, the least recently used files that can be
+ * regenerated are deleted: proxies not used by the current project and audio thumbnails.
+ * Preview files are never evicted, they are either used by the timeline or kept for undo, the
+ * preview quota limits automatic preview rendering instead.
+ * Writers can notify from any thread.
+ */
+
+class CacheAccounting : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CacheAccounting(ThumbnailStore *thumbnails, QObject *parent = nullptr);
+    virtual ~CacheAccounting();
+    /** @brief Set the project's cache folders and start a background scan.
+     *  @param cacheRoot the folder containing the project folder and the shared proxy folder
+     *  @param documentId the project's folder name */
+    void setFolders(const QDir &cacheRoot, const QString &documentId);
+    /** @brief Set the hashes of the project clips, used to count the project's proxies and keep them from eviction. */
+    void setProjectProxies(const QStringList &hashes);
+    /** @brief Add the hash of a clip added to the project, its proxy is kept from eviction. */
+    void addProjectProxy(const QString &hash);
+    /** @brief A file was written or replaced in a cache folder. */
+    void fileAdded(CacheType type, const QString &path);
+    /** @brief A file was deleted from a cache folder. */
+    void fileRemoved(CacheType type, const QString &path);
+    /** @brief A folder and all its content was deleted from a cache, or from the system cache folder if @param type is SystemCacheRoot. */
+    void folderRemoved(CacheType type, const QString &path);
+    /** @brief A cached file was read, so that it is not the first one to be evicted. */
+    void fileUsed(CacheType type, const QString &path);
+    /** @brief Returns the size in bytes of a project cache, CacheBase for the whole project folder,
+     *  SystemCacheRoot for all folders in the system cache folder. */
+    qint64 size(CacheType type) const;
+    /** @brief Returns the size of each folder in the system cache folder (projects and shared proxies). */
+    QMap<QString, qint64> folderSizes() const;
+    /** @brief Returns true until the first scan completed, sizes are then incomplete. */
+    bool isScanning() const;
+    /** @brief Start a background scan of the cache folders. */
+    void reconcile();
+    /** @brief Read the quotas from the settings and evict files if needed. */
+    void updateQuotas();
+
+private:
+    struct Entry {
+        qint64 size;
+        qint64 lastUse;
+    };
+    struct ScanResult {
+        QHash<QString, Entry> entries[CacheAnalysis + 1];
+        qint64 otherSize;
+        QMap<QString, qint64> folderSizes;
+    };
+    mutable QMutex m_mutex;
+    ThumbnailStore *m_thumbnails;
+    QString m_folders[CacheAnalysis + 1];
+    QString m_systemRoot;
+    QString m_documentId;
+    QHash<QString, Entry> m_entries[CacheAnalysis + 1];
+    qint64 m_totals[CacheAnalysis + 1];
+    qint64 m_quotas[CacheAnalysis + 1];
+    /** @brief Size of the files in the project folder outside of the known caches. */
+    qint64 m_otherSize;
+    QMap<QString, qint64> m_folderSizes;
+    QSet<QString> m_projectProxies;
+    /** @brief False until the project clips are known, proxies are not evicted before. */
+    bool m_proxiesKnown;
+    QFutureWatcher<ScanResult> m_scanWatcher;
+    bool m_scanned;
+    bool m_scanning;
+    QAtomicInt m_abortScan;
+    /** @brief Time when the running scan started, files changed after it are kept when merging its result. */
+    qint64 m_scanStart;
+    /** @brief Paths removed while a scan is running, that the scan might still have found. */
+    QStringList m_removedDuringScan;
+    QAtomicInt m_notifyPending;
+    /** @brief Returns the size of a cache. Mutex must be locked. */
+    qint64 currentSize(CacheType type) const;
+    /** @brief Returns the size of each folder in the system cache folder. Mutex must be locked. */
+    QMap<QString, qint64> currentFolderSizes() const;
+    /** @brief Returns true if a proxy file belongs to the current project. Mutex must be locked. */
+    bool isProjectProxy(const QString &path) const;
+    /** @brief Returns true if a file can be deleted to respect the quota. Mutex must be locked. */
+    bool isEvictable(int type, const QString &path) const;
+    /** @brief Remove entries of a file or folder. Mutex must be locked. */
+    void removeEntries(int type, const QString &path);
+    /** @brief Collect least recently used files until the cache fits in its quota. Mutex must be locked. */
+    QStringList evictFiles(int type);
+    /** @brief Emit sizesChanged from the main thread, at most once per event loop iteration. */
+    void scheduleNotify();
+    static ScanResult scanFolders(const QStringList &folders, const QString &systemRoot, const QStringList &skipped, const QAtomicInt *abort);
+    static void scanFolder(const QString &path, QHash<QString, Entry> &entries, const QAtomicInt *abort, const QString &skipped = QString());
+    static void deleteFiles(const QStringList &files);
+
+private slots:
+    void slotScanFinished();
+    void slotNotify();
+
+signals:
+    /** @brief Emitted when the cache sizes changed. */
+    void sizesChanged();
+};
+
+#endif
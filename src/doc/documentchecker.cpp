@@ -36,6 +36,7 @@
 #include <QFileDialog>
 #include <QCryptographicHash>
 #include <QStandardPaths>
+#include <QSet>
 
 const int hashRole = Qt::UserRole;
 const int sizeRole = Qt::UserRole + 1;
@@ -123,7 +124,8 @@ bool DocumentChecker::hasErrorInClips()
     m_safeFonts.clear();
     m_missingFonts.clear();
     max = documentProducers.count();
-    QStringList verifiedPaths;
+    // Projects can have tens of thousands of producers, use hashes for lookups
+    QSet<QString> verifiedPaths;
     QStringList serviceToCheck;
     serviceToCheck << QStringLiteral("kdenlivetitle") << QStringLiteral("qimage") << QStringLiteral("pixbuf") << QStringLiteral("timewarp") << QStringLiteral("framebuffer") << QStringLiteral("xml");
     for (int i = 0; i < max; ++i) {
@@ -200,7 +202,7 @@ bool DocumentChecker::hasErrorInClips()
                 // clip has proxy but original clip is missing
                 missingSources.append(e);
             }
-            verifiedPaths.append(resource);
+            verifiedPaths.insert(resource);
             continue;
         }
         // Check for slideshows
@@ -213,12 +215,12 @@ bool DocumentChecker::hasErrorInClips()
             m_missingClips.append(e);
         }
         // Make sure we don't query same path twice
-        verifiedPaths.append(resource);
+        verifiedPaths.insert(resource);
     }
 
     // Get list of used Luma files
     QStringList missingLumas;
-    QStringList filesToCheck;
+    QSet<QString> filesToCheck;
     QString filePath;
     QDomNodeList trans = m_doc.elementsByTagName(QStringLiteral("transition"));
     max = trans.count();
@@ -231,8 +233,8 @@ bool DocumentChecker::hasErrorInClips()
         } else if (service == QLatin1String("composite")) {
             luma = getProperty(transition, QStringLiteral("luma"));
         }
-        if (!luma.isEmpty() && !filesToCheck.contains(luma)) {
-            filesToCheck.append(luma);
+        if (!luma.isEmpty()) {
+            filesToCheck.insert(luma);
         }
     }
 
@@ -34,6 +34,7 @@
 #include <QColor>
 #include <QString>
 #include <QDir>
+#include <QSet>
 
 #include <mlt++/Mlt.h>
 
@@ -1463,24 +1464,25 @@ void DocumentValidator::checkOrphanedProducers()
     QDomElement mlt = m_doc.firstChildElement(QStringLiteral("mlt"));
     QDomElement main = mlt.firstChildElement(QStringLiteral("playlist"));
     QDomNodeList bin_producers = main.childNodes();
-    QStringList binProducers;
+    // Use hashes, this runs on every project load and projects can have thousands of producers
+    QSet<QString> binProducers;
     for (int k = 0; k < bin_producers.count(); k++) {
         QDomElement mltprod = bin_producers.at(k).toElement();
         if (mltprod.tagName() != QLatin1String("entry")) {
             continue;
         }
-        binProducers << mltprod.attribute(QStringLiteral("producer"));
+        binProducers.insert(mltprod.attribute(QStringLiteral("producer")));
     }
 
     QDomNodeList producers = m_doc.elementsByTagName(QStringLiteral("producer"));
     int max = producers.count();
-    QStringList allProducers;
+    QSet<QString> allProducers;
     for (int i = 0; i < max; ++i) {
         QDomElement prod = producers.at(i).toElement();
         if (prod.isNull()) {
             continue;
         }
-        allProducers << prod.attribute(QStringLiteral("id"));
+        allProducers.insert(prod.attribute(QStringLiteral("id")));
     }
 
     QDomDocumentFragment frag = m_doc.createDocumentFragment();
@@ -1539,7 +1541,7 @@ void DocumentValidator::checkOrphanedProducers()
                                 QDomElement cloned = binProd.cloneNode(true).toElement();
                                 cloned.setAttribute(QStringLiteral("id"), entryId);
                                 trackProds.appendChild(cloned);
-                                allProducers << entryId;
+                                allProducers.insert(entryId);
                             }
                             entry.setAttribute(QStringLiteral("producer"), entryId);
                             m_modified = true;
@@ -27,6 +27,9 @@
 #include "renderer.h"
 #include "mainwindow.h"
 #include "project/clipmanager.h"
+#include "doc/thumbnailstore.h"
+#include "doc/analysisstore.h"
+#include "doc/cacheaccounting.h"
 #include "project/projectcommands.h"
 #include "bin/bincommands.h"
 #include "effectslist/initeffects.h"
@@ -50,7 +53,10 @@
 #include <KBookmark>
 
 #include <QCryptographicHash>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent>
 #include "kdenlive_debug.h"
 #include <QFileDialog>
 #include <QDomImplementation>
@@ -168,12 +174,20 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, const QString &projectFolder, QUndoGro
             //KMessageBox::error(parent, KIO::NetAccess::lastErrorString());
         } else {
             qCDebug(KDENLIVE_LOG) << " // / processing file open";
+            // Time each loading phase, large projects can be very slow to open.
+            // The project is not loaded by a streaming parser: DocumentValidator upgrades the
+            // QDomDocument in place and the document is then edited and saved from m_document
+            // for the whole session, so the full tree is needed anyway. Loading only avoids
+            // extra passes over it, MLT still parses the serialized document on its own.
+            QElapsedTimer loadTimer;
+            loadTimer.start();
             QString errorMsg;
             int line;
             int col;
             QDomImplementation::setInvalidDataPolicy(QDomImplementation::DropInvalidChars);
             success = m_document.setContent(&file, false, &errorMsg, &line, &col);
             file.close();
+            qCDebug(KDENLIVE_LOG) << "Project loading, xml parsing:" << loadTimer.restart() << "ms";
 
             if (!success) {
                 // It is corrupted
@@ -234,12 +248,14 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, const QString &projectFolder, QUndoGro
                     if (success && !KdenliveSettings::gpu_accel()) {
                         success = validator.checkMovit();
                     }
+                    qCDebug(KDENLIVE_LOG) << "Project loading, validation:" << loadTimer.restart() << "ms";
                     if (success) { // Let the validator handle error messages
                         qCDebug(KDENLIVE_LOG) << " // / processing file validate ok";
                         parent->slotGotProgressInfo(i18n("Check missing clips"), 100);
                         qApp->processEvents();
                         DocumentChecker d(m_url, m_document);
                         success = !d.hasErrorInClips();
+                        qCDebug(KDENLIVE_LOG) << "Project loading, clip check:" << loadTimer.restart() << "ms";
                         if (success) {
                             loadDocumentProperties();
                             if (m_document.documentElement().attribute(QStringLiteral("modified")) == QLatin1String("1")) {
@@ -279,10 +295,51 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, const QString &projectFolder, QUndoGro
         }
     }
     initCacheDirs();
+    if (success) {
+        restoreAnalysisData(parent);
+    }
 
     updateProjectFolderPlacesEntry();
 }
 
+void KdenliveDoc::restoreAnalysisData(MainWindow *parent)
+{
+    QStringList references;
+    QDomElement packed;
+    QDomNodeList props = m_document.elementsByTagName(QStringLiteral("property"));
+    for (int i = 0; i < props.count(); ++i) {
+        QDomElement e = props.item(i).toElement();
+        const QString name = e.attribute(QStringLiteral("name"));
+        if (name.startsWith(QLatin1String("kdenlive:clipanalysis.")) && AnalysisStore::isReference(e.text())) {
+            references << e.text();
+        } else if (name == QLatin1String("kdenlive:analysisdata")) {
+            packed = e;
+        }
+    }
+    QStringList missingReferences;
+    for (const QString &reference : references) {
+        if (!m_clipManager->analysisStore->contains(reference)) {
+            missingReferences << reference;
+        }
+    }
+    if (missingReferences.isEmpty()) {
+        return;
+    }
+    if (!packed.isNull()) {
+        // The cache folder was cleared, or the project was extracted from an archive
+        m_clipManager->analysisStore->unpack(QByteArray::fromBase64(packed.text().toLatin1()));
+    }
+    int missing = 0;
+    for (const QString &reference : missingReferences) {
+        if (!m_clipManager->analysisStore->contains(reference)) {
+            missing++;
+        }
+    }
+    if (missing > 0) {
+        KMessageBox::sorry(parent, i18np("The data of %1 clip analysis could not be found, it will be empty.", "The data of %1 clip analyses could not be found, they will be empty.", missing));
+    }
+}
+
 void KdenliveDoc::slotSetDocumentNotes(const QString &notes)
 {
     m_notesWidget->setHtml(notes);
@@ -306,6 +363,7 @@ KdenliveDoc::~KdenliveDoc()
     //qCDebug(KDENLIVE_LOG) << "// DEL CLP MAN";
     delete m_clipManager;
     //qCDebug(KDENLIVE_LOG) << "// DEL CLP MAN done";
+    m_autosaveThread.waitForFinished();
     if (m_autosave) {
         if (!m_autosave->fileName().isEmpty()) {
             m_autosave->remove();
@@ -319,10 +377,13 @@ int KdenliveDoc::setSceneList()
     //m_render->resetProfile(m_profile);
     pCore->bin()->isLoading = true;
     pCore->producerQueue()->abortOperations();
+    QElapsedTimer loadTimer;
+    loadTimer.start();
     if (m_render->setSceneList(m_document.toString(), m_documentProperties.value(QStringLiteral("position")).toInt()) == -1) {
         // INVALID MLT Consumer, something is wrong
         return -1;
     }
+    qCDebug(KDENLIVE_LOG) << "Project loading, MLT playlist:" << loadTimer.elapsed() << "ms";
     pCore->bin()->isLoading = false;
 
     bool ok = false;
@@ -568,18 +629,30 @@ void KdenliveDoc::slotAutoSave()
             qCDebug(KDENLIVE_LOG) << "ERROR; CANNOT CREATE AUTOSAVE FILE";
         }
         //qCDebug(KDENLIVE_LOG) << "// AUTOSAVE FILE: " << m_autosave->fileName();
-        QDomDocument sceneList = xmlSceneList(m_render->sceneList(m_url.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile()));
-        if (sceneList.isNull()) {
+        if (m_autosaveThread.isRunning()) {
+            // Previous autosave is still being written, try again later
+            QTimer::singleShot(1000, this, &KdenliveDoc::slotAutoSave);
+            return;
+        }
+        prepareSceneList();
+        const QString sceneList = m_render->sceneList(m_url.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile());
+        if (!sceneList.contains(QLatin1String("</mlt>"))) {
             //Make sure we don't save if scenelist is corrupted
             KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave->fileName()));
             return;
         }
-        m_autosave->resize(0);
-        m_autosave->write(sceneList.toString().toUtf8());
-        m_autosave->flush();
+        // Encoding and writing the file can take a while on large projects, do it in a thread
+        m_autosaveThread = QtConcurrent::run(this, &KdenliveDoc::writeAutoSave, sceneList.toUtf8());
     }
 }
 
+void KdenliveDoc::writeAutoSave(const QByteArray &scene)
+{
+    m_autosave->resize(0);
+    m_autosave->write(scene);
+    m_autosave->flush();
+}
+
 void KdenliveDoc::setZoom(int horizontal, int vertical)
 {
     m_documentProperties[QStringLiteral("zoom")] = QString::number(horizontal);
@@ -612,66 +685,93 @@ QDomDocument KdenliveDoc::xmlSceneList(const QString &scene)
         return sceneList;
     }
 
-    // Set playlist audio volume to 100%
-    QDomElement tractor = mlt.firstChildElement(QStringLiteral("tractor"));
-    if (!tractor.isNull()) {
-        QDomNodeList props = tractor.elementsByTagName(QStringLiteral("property"));
-        for (int i = 0; i < props.count(); ++i) {
-            if (props.at(i).toElement().attribute(QStringLiteral("name")) == QLatin1String("meta.volume")) {
-                props.at(i).firstChild().setNodeValue(QStringLiteral("1"));
-                break;
-            }
-        }
-    }
-    QDomNodeList pls = mlt.elementsByTagName(QStringLiteral("playlist"));
-    QDomElement mainPlaylist;
-    for (int i = 0; i < pls.count(); ++i) {
-        if (pls.at(i).toElement().attribute(QStringLiteral("id")) == pCore->binController()->binPlaylistId()) {
-            mainPlaylist = pls.at(i).toElement();
-            break;
-        }
+    // Playlist volume and custom effects are set on the MLT objects before serializing, see Render::sceneList and prepareSceneList()
+    //TODO: move metadata to previous step in saving process
+    QDomElement docmetadata = sceneList.createElement(QStringLiteral("documentmetadata"));
+    QMapIterator<QString, QString> j(m_documentMetadata);
+    while (j.hasNext()) {
+        j.next();
+        docmetadata.setAttribute(j.key(), j.value());
     }
+    //addedXml.appendChild(docmetadata);
 
+    return sceneList;
+}
+
+void KdenliveDoc::prepareSceneList(bool selfContained)
+{
     // check if project contains custom effects to embed them in project file
-    QDomNodeList effects = mlt.elementsByTagName(QStringLiteral("filter"));
-    int maxEffects = effects.count();
-    //qCDebug(KDENLIVE_LOG) << "// FOUD " << maxEffects << " EFFECTS+++++++++++++++++++++";
     QMap<QString, QString> effectIds;
-    for (int i = 0; i < maxEffects; ++i) {
-        QDomNode m = effects.at(i);
-        QDomNodeList params = m.childNodes();
-        QString id;
-        QString tag;
-        for (int j = 0; j < params.count(); ++j) {
-            QDomElement e = params.item(j).toElement();
-            if (e.attribute(QStringLiteral("name")) == QLatin1String("kdenlive_id")) {
-                id = e.firstChild().nodeValue();
-            }
-            if (e.attribute(QStringLiteral("name")) == QLatin1String("tag")) {
-                tag = e.firstChild().nodeValue();
-            }
-            if (!id.isEmpty() && !tag.isEmpty()) {
-                effectIds.insert(id, tag);
+    Mlt::Producer *tractor = m_render->getProducer();
+    if (tractor && tractor->is_valid()) {
+        collectEffectIds(*tractor, effectIds);
+    }
+    const QList<ClipController *> controllers = pCore->binController()->getControllerList();
+    for (ClipController *controller : controllers) {
+        collectEffectIds(controller->originalProducer(), effectIds);
+    }
+    // Analysis data lives in the cache folder, it is only embedded in archived projects so that
+    // they do not depend on it. Data embedded by a previous archive is kept as long as the cache
+    // folder does not have all of it, without packing it again on each save
+    const QString previousAnalysis = pCore->binController()->getProperty(QStringLiteral("kdenlive:analysisdata"));
+    if (selfContained || !previousAnalysis.isEmpty()) {
+        QStringList analysisReferences;
+        bool resolved = true;
+        for (ClipController *controller : controllers) {
+            const QMap<QString, QString> analysis = controller->getPropertiesFromPrefix(QStringLiteral("kdenlive:clipanalysis."));
+            for (const QString &value : analysis) {
+                if (AnalysisStore::isReference(value)) {
+                    analysisReferences << value;
+                    resolved = resolved && m_clipManager->analysisStore->contains(value);
+                }
             }
         }
+        if (selfContained) {
+            const QByteArray analysisData = m_clipManager->analysisStore->pack(analysisReferences, QByteArray::fromBase64(previousAnalysis.toLatin1()));
+            pCore->binController()->saveProperty(QStringLiteral("kdenlive:analysisdata"), QString::fromLatin1(analysisData.toBase64()));
+        } else if (resolved) {
+            pCore->binController()->saveProperty(QStringLiteral("kdenlive:analysisdata"), QString());
+        }
     }
-    //TODO: find a way to process this before rendering MLT scenelist to xml
     QDomDocument customeffects = initEffects::getUsedCustomEffects(effectIds);
     if (!customeffects.documentElement().childNodes().isEmpty()) {
-        EffectsList::setProperty(mainPlaylist, QStringLiteral("kdenlive:customeffects"), customeffects.toString());
+        pCore->binController()->saveProperty(QStringLiteral("kdenlive:customeffects"), customeffects.toString());
+    } else if (!pCore->binController()->getProperty(QStringLiteral("kdenlive:customeffects")).isEmpty()) {
+        pCore->binController()->saveProperty(QStringLiteral("kdenlive:customeffects"), QString());
     }
-    //addedXml.appendChild(sceneList.importNode(customeffects.documentElement(), true));
+}
 
-    //TODO: move metadata to previous step in saving process
-    QDomElement docmetadata = sceneList.createElement(QStringLiteral("documentmetadata"));
-    QMapIterator<QString, QString> j(m_documentMetadata);
-    while (j.hasNext()) {
-        j.next();
-        docmetadata.setAttribute(j.key(), j.value());
+//static
+void KdenliveDoc::collectEffectIds(Mlt::Service &service, QMap<QString, QString> &effectIds)
+{
+    for (int i = 0; i < service.filter_count(); ++i) {
+        QScopedPointer<Mlt::Filter> filter(service.filter(i));
+        const QString id = QString::fromUtf8(filter->get("kdenlive_id"));
+        const QString tag = QString::fromUtf8(filter->get("tag"));
+        if (!id.isEmpty() && !tag.isEmpty()) {
+            effectIds.insert(id, tag);
+        }
+    }
+    if (service.type() == tractor_type) {
+        Mlt::Tractor tractor(service);
+        for (int i = 0; i < tractor.count(); ++i) {
+            QScopedPointer<Mlt::Producer> track(tractor.track(i));
+            if (track && track->is_valid()) {
+                collectEffectIds(*track, effectIds);
+            }
+        }
+    } else if (service.type() == playlist_type) {
+        Mlt::Playlist playlist(service);
+        for (int i = 0; i < playlist.count(); ++i) {
+            if (playlist.is_blank(i)) {
+                continue;
+            }
+            QScopedPointer<Mlt::Producer> clip(playlist.get_clip(i));
+            if (clip && clip->is_valid()) {
+                collectEffectIds(*clip, effectIds);
+            }
+        }
     }
-    //addedXml.appendChild(docmetadata);
-
-    return sceneList;
 }
 
 QString KdenliveDoc::documentNotes() const
@@ -685,8 +785,7 @@ QString KdenliveDoc::documentNotes() const
 
 bool KdenliveDoc::saveSceneList(const QString &path, const QString &scene)
 {
-    QDomDocument sceneList = xmlSceneList(scene);
-    if (sceneList.isNull()) {
+    if (!scene.contains(QLatin1String("</mlt>"))) {
         //Make sure we don't save if scenelist is corrupted
         KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", path));
         return false;
@@ -694,23 +793,13 @@ bool KdenliveDoc::saveSceneList(const QString &path, const QString &scene)
 
     // Backup current version
     backupLastSavedVersion(path);
-    QFile file(path);
-
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (!writeSceneList(path, scene.toUtf8())) {
         qCWarning(KDENLIVE_LOG) << "//////  ERROR writing to file: " << path;
         KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1", path));
         return false;
     }
-
-    file.write(sceneList.toString().toUtf8());
-    if (file.error() != QFile::NoError) {
-        KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1", path));
-        file.close();
-        return false;
-    }
-    file.close();
     cleanupBackupFiles();
-    QFileInfo info(file);
+    QFileInfo info(path);
     QString fileName = QUrl::fromLocalFile(path).fileName().section(QLatin1Char('.'), 0, -2);
     fileName.append(QLatin1Char('-') + m_documentProperties.value(QStringLiteral("documentid")));
     fileName.append(info.lastModified().toString(QStringLiteral("-yyyy-MM-dd-hh-mm")));
@@ -1015,13 +1104,9 @@ void KdenliveDoc::slotCreateTextTemplateClip(const QString &group, const QString
     emit selectLastAddedClip(QString::number(m_clipManager->lastClipId()));
 }
 
-void KdenliveDoc::cacheImage(const QString &fileId, const QImage &img) const
+void KdenliveDoc::cacheImage(const QString &hash, int frame, const QImage &img) const
 {
-    bool ok = false;
-    QDir dir = getCacheDir(CacheThumbs, &ok);
-    if (ok) {
-        img.save(dir.absoluteFilePath(fileId + QStringLiteral(".png")));
-    }
+    m_clipManager->thumbnailStore->insertMarker(hash, frame, img);
 }
 
 void KdenliveDoc::setDocumentProperty(const QString &name, const QString &value)
@@ -1746,9 +1831,23 @@ void KdenliveDoc::checkPreviewStack()
     emit removeInvalidUndo(m_commandStack->count());
 }
 
-void KdenliveDoc::saveMltPlaylist(const QString &fileName)
+const QString KdenliveDoc::previewSceneList(const QString &root)
 {
-    m_render->preparePreviewRendering(fileName);
+    return m_render->previewSceneList(root);
+}
+
+//static
+bool KdenliveDoc::writeSceneList(const QString &path, const QByteArray &scene)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    if (file.write(scene) != scene.size()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
 }
 
 void KdenliveDoc::initCacheDirs()
@@ -1771,8 +1870,12 @@ void KdenliveDoc::initCacheDirs()
     dir.mkdir(QStringLiteral("preview"));
     dir.mkdir(QStringLiteral("audiothumbs"));
     dir.mkdir(QStringLiteral("videothumbs"));
+    dir.mkdir(QStringLiteral("analysis"));
     QDir cacheDir(kdenliveCacheDir);
     cacheDir.mkdir(QStringLiteral("proxy"));
+    m_clipManager->thumbnailStore->setFolder(QDir(basePath + QStringLiteral("/videothumbs")));
+    m_clipManager->analysisStore->setFolder(QDir(basePath + QStringLiteral("/analysis")));
+    m_clipManager->cacheAccounting->setFolders(cacheDir, documentId);
 }
 
 QDir KdenliveDoc::getCacheDir(CacheType type, bool *ok) const
@@ -1811,6 +1914,9 @@ QDir KdenliveDoc::getCacheDir(CacheType type, bool *ok) const
     case CacheThumbs:
         basePath.append(QStringLiteral("/videothumbs"));
         break;
+    case CacheAnalysis:
+        basePath.append(QStringLiteral("/analysis"));
+        break;
     default:
         break;
     }
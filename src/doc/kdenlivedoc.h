@@ -32,6 +32,7 @@
 #include <QObject>
 #include <QTimer>
 #include <QUrl>
+#include <QFuture>
 
 #include <kautosavefile.h>
 #include <KDirWatch>
@@ -59,6 +60,7 @@ class QUndoGroup;
 namespace Mlt
 {
 class Profile;
+class Service;
 }
 
 class DocUndoStack: public QUndoStack
@@ -119,11 +121,18 @@ public:
     double projectDuration() const;
     /** @brief Returns the project file xml. */
     QDomDocument xmlSceneList(const QString &scene);
+    /** @brief Store document data that lives outside MLT (used custom effects) in the bin playlist, must be called before serializing the project.
+     *  @param selfContained also embed the analysis data of the cache folder, used when archiving the project */
+    void prepareSceneList(bool selfContained = false);
     /** @brief Saves the project file xml to a file. */
     bool saveSceneList(const QString &path, const QString &scene);
-    /** @brief Saves only the MLT xml to a file for preview rendering. */
-    void saveMltPlaylist(const QString &fileName);
-    void cacheImage(const QString &fileId, const QImage &img) const;
+    /** @brief Returns only the MLT xml for preview rendering, it is written to disk by the preview thread.
+     *  @param root the folder where the playlist will be saved */
+    const QString previewSceneList(const QString &root);
+    /** @brief Write a scenelist to a file, safe to call from a thread. */
+    static bool writeSceneList(const QString &path, const QByteArray &scene);
+    /** @brief Store the marker image of the clip with @param hash in the project thumbnail store. */
+    void cacheImage(const QString &hash, int frame, const QImage &img) const;
     void setProjectFolder(const QUrl &url);
     void setZone(int start, int end);
     QPoint zone() const;
@@ -206,7 +215,14 @@ private:
     QMap<QString, QString> m_documentProperties;
     QMap<QString, QString> m_documentMetadata;
 
+    /** @brief The autosave file writing thread. */
+    QFuture<void> m_autosaveThread;
+
     QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const;
+    /** @brief Collect the id and tag of all kdenlive effects attached to a service and its children. */
+    static void collectEffectIds(Mlt::Service &service, QMap<QString, QString> &effectIds);
+    /** @brief Write the scenelist to the autosave file, runs in a thread. */
+    void writeAutoSave(const QByteArray &scene);
 
     /** @brief Creates a new project. */
     QDomDocument createEmptyDocument(int videotracks, int audiotracks);
@@ -218,6 +234,8 @@ private:
     void cleanupBackupFiles();
     /** @brief Load document properties from the xml file */
     void loadDocumentProperties();
+    /** @brief Restore analysis data embedded in the xml file if missing from the cache, warn if some cannot be found. */
+    void restoreAnalysisData(MainWindow *parent);
     /** @brief update document properties to reflect a change in the current profile */
     void updateProjectProfile(bool reloadProducers = false);
 
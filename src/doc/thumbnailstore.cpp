@@ -0,0 +1,289 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "thumbnailstore.h"
+#include "kdenlivesettings.h"
+
+#include "kdenlive_debug.h"
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+
+// JPEG quality of the stored tiles, thumbnails are small so artifacts are barely visible
+static const int tileQuality = 85;
+
+ThumbnailStore::ThumbnailStore()
+    : m_hasFolder(false)
+    , m_diskSize(0)
+    , m_maxDiskSize(0)
+    , m_useCounter(0)
+{
+    updateLimits();
+}
+
+void ThumbnailStore::updateLimits()
+{
+    QMutexLocker lock(&m_mutex);
+    // Memory cost is counted in kB
+    m_memory.setMaxCost(KdenliveSettings::thumbnailmemorysize() * 1024);
+    m_maxDiskSize = (qint64) KdenliveSettings::thumbnailcachesize() * 1024 * 1024;
+    evictFiles();
+}
+
+void ThumbnailStore::setFolder(const QDir &folder)
+{
+    QMutexLocker lock(&m_mutex);
+    m_memory.clear();
+    m_disk.clear();
+    m_diskSize = 0;
+    m_useCounter = 0;
+    m_folder = QDir(folder.absoluteFilePath(QStringLiteral("tiles")));
+    m_hasFolder = folder.exists() && (m_folder.exists() || m_folder.mkpath(QStringLiteral(".")));
+    if (!m_hasFolder) {
+        return;
+    }
+    // Index existing tiles, oldest files are the first to be evicted
+    QList<QPair<qint64, QString> > files;
+    QDirIterator it(m_folder.absolutePath(), QStringList() << QStringLiteral("*.jpg"), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        const QString tileKey = info.dir().dirName() + QLatin1Char('#') + info.completeBaseName();
+        files << qMakePair(info.lastModified().toMSecsSinceEpoch(), tileKey);
+        DiskEntry entry;
+        entry.size = info.size();
+        entry.lastUse = 0;
+        m_disk.insert(tileKey, entry);
+        m_diskSize += entry.size;
+    }
+    std::sort(files.begin(), files.end());
+    for (const QPair<qint64, QString> &file : files) {
+        m_disk[file.second].lastUse = ++m_useCounter;
+    }
+    evictFiles();
+}
+
+// static
+QString ThumbnailStore::key(const QString &hash, int frame)
+{
+    return hash + QLatin1Char('#') + QString::number(frame);
+}
+
+// static
+QString ThumbnailStore::tileKey(const QString &hash, int level, int index)
+{
+    // Stored next to the single frame thumbnails of the clip, as <level>_<index>.jpg
+    return hash + QLatin1Char('#') + QString::number(level) + QLatin1Char('_') + QString::number(index);
+}
+
+// static
+QString ThumbnailStore::markerKey(const QString &hash, int frame)
+{
+    // Markers are stored as m<frame>.jpg, next to the filmstrip thumbnails that are subject to eviction
+    return hash + QStringLiteral("#m") + QString::number(frame);
+}
+
+// static
+bool ThumbnailStore::isMarkerKey(const QString &key)
+{
+    const int pos = key.indexOf(QLatin1Char('#'));
+    return pos >= 0 && pos + 1 < key.length() && key.at(pos + 1) == QLatin1Char('m');
+}
+
+QString ThumbnailStore::tilePath(const QString &key) const
+{
+    return m_folder.absoluteFilePath(key.section(QLatin1Char('#'), 0, 0) + QLatin1Char('/') + key.section(QLatin1Char('#'), 1) + QStringLiteral(".jpg"));
+}
+
+QImage ThumbnailStore::find(const QString &hash, int frame)
+{
+    if (hash.isEmpty()) {
+        return QImage();
+    }
+    return findKey(key(hash, frame));
+}
+
+QImage ThumbnailStore::findTile(const QString &hash, int level, int index)
+{
+    if (hash.isEmpty()) {
+        return QImage();
+    }
+    return findKey(tileKey(hash, level, index));
+}
+
+QImage ThumbnailStore::findKey(const QString &entryKey)
+{
+    QString path;
+    {
+        QMutexLocker lock(&m_mutex);
+        QImage *img = m_memory.object(entryKey);
+        if (img) {
+            return *img;
+        }
+        QHash<QString, DiskEntry>::iterator entry = m_disk.find(entryKey);
+        if (entry == m_disk.end()) {
+            return QImage();
+        }
+        entry->lastUse = ++m_useCounter;
+        path = tilePath(entryKey);
+    }
+    // Decode outside of the lock
+    QImage img(path);
+    QMutexLocker lock(&m_mutex);
+    if (img.isNull()) {
+        // File was removed or is corrupted
+        m_diskSize -= m_disk.value(entryKey).size;
+        m_disk.remove(entryKey);
+        return img;
+    }
+    m_memory.insert(entryKey, new QImage(img), qMax(1, img.byteCount() / 1024));
+    return img;
+}
+
+bool ThumbnailStore::contains(const QString &hash, int frame)
+{
+    return containsKey(key(hash, frame));
+}
+
+bool ThumbnailStore::containsTile(const QString &hash, int level, int index)
+{
+    return containsKey(tileKey(hash, level, index));
+}
+
+bool ThumbnailStore::containsKey(const QString &entryKey)
+{
+    QMutexLocker lock(&m_mutex);
+    return m_memory.contains(entryKey) || m_disk.contains(entryKey);
+}
+
+void ThumbnailStore::insert(const QString &hash, int frame, const QImage &img)
+{
+    if (img.isNull() || hash.isEmpty()) {
+        return;
+    }
+    insertKey(key(hash, frame), img);
+}
+
+void ThumbnailStore::insertTile(const QString &hash, int level, int index, const QImage &img)
+{
+    if (img.isNull() || hash.isEmpty()) {
+        return;
+    }
+    insertKey(tileKey(hash, level, index), img);
+}
+
+void ThumbnailStore::insertMarker(const QString &hash, int frame, const QImage &img)
+{
+    if (img.isNull() || hash.isEmpty()) {
+        return;
+    }
+    insertKey(markerKey(hash, frame), img, true);
+}
+
+void ThumbnailStore::insertKey(const QString &entryKey, const QImage &img, bool replace)
+{
+    QString path;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_memory.insert(entryKey, new QImage(img), qMax(1, img.byteCount() / 1024));
+        if (!m_hasFolder || (!replace && m_disk.contains(entryKey))) {
+            return;
+        }
+        path = tilePath(entryKey);
+    }
+    // Encode and write outside of the lock
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || !img.save(&file, "JPG", tileQuality) || !file.commit()) {
+        qCDebug(KDENLIVE_LOG) << "Cannot write thumbnail tile" << path;
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    DiskEntry entry;
+    entry.size = QFileInfo(path).size();
+    entry.lastUse = ++m_useCounter;
+    if (m_disk.contains(entryKey)) {
+        m_diskSize -= m_disk.value(entryKey).size;
+    }
+    m_disk.insert(entryKey, entry);
+    m_diskSize += entry.size;
+    if (m_diskSize > m_maxDiskSize) {
+        evictFiles();
+    }
+}
+
+QString ThumbnailStore::filePath(const QString &hash, int frame)
+{
+    return existingPath(key(hash, frame));
+}
+
+QString ThumbnailStore::markerPath(const QString &hash, int frame)
+{
+    return existingPath(markerKey(hash, frame));
+}
+
+QString ThumbnailStore::existingPath(const QString &entryKey)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_disk.contains(entryKey)) {
+        return QString();
+    }
+    return tilePath(entryKey);
+}
+
+void ThumbnailStore::clearMemory()
+{
+    QMutexLocker lock(&m_mutex);
+    m_memory.clear();
+}
+
+qint64 ThumbnailStore::diskSize()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_diskSize;
+}
+
+void ThumbnailStore::evictFiles()
+{
+    if (!m_hasFolder || m_diskSize <= m_maxDiskSize) {
+        return;
+    }
+    QList<QPair<quint64, QString> > entries;
+    entries.reserve(m_disk.count());
+    QHash<QString, DiskEntry>::const_iterator it = m_disk.constBegin();
+    for (; it != m_disk.constEnd(); ++it) {
+        if (!isMarkerKey(it.key())) {
+            entries << qMakePair(it->lastUse, it.key());
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    // Free some more space so that we don't evict on each insertion
+    const qint64 target = m_maxDiskSize * 9 / 10;
+    for (const QPair<quint64, QString> &entry : entries) {
+        if (m_diskSize <= target) {
+            break;
+        }
+        QFile::remove(tilePath(entry.second));
+        m_diskSize -= m_disk.value(entry.second).size;
+        m_disk.remove(entry.second);
+    }
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QCache>
+#include <QDir>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+
+/**
+ * @class ThumbnailStore
+ * @brief Two level cache for the video frame thumbnails of a project.
+ * Thumbnails are keyed by clip hash and frame number, so they stay valid when a clip is
+ * moved and are shared by the bin, the timeline and the monitor markers. Timeline
+ * filmstrips are stored as tiles of several frames, keyed by zoom level and tile number.
+ * Marker images have their own keys, as they are not regenerated they are never evicted.
+ * Recently used thumbnails are kept in memory, and all of them are written as JPEG
+ * tiles in the project's thumbnail cache folder, so they survive a restart. Both levels
+ * have a configurable size and evict the least recently used entries. The store is
+ * thread safe, thumbnails being created in worker threads.
+ */
+
+class ThumbnailStore
+{
+public:
+    ThumbnailStore();
+    /** @brief Set the folder used to store thumbnails on disk and index the thumbnails it contains.
+     *  If @param folder does not exist, thumbnails are only kept in memory. */
+    void setFolder(const QDir &folder);
+    /** @brief Read the cache sizes from the settings. */
+    void updateLimits();
+    /** @brief Returns a thumbnail, or a null image if it is not in the store. */
+    QImage find(const QString &hash, int frame);
+    bool contains(const QString &hash, int frame);
+    void insert(const QString &hash, int frame, const QImage &img);
+    /** @brief Returns the path of the thumbnail file, empty if it is not on disk. */
+    QString filePath(const QString &hash, int frame);
+    /** @brief Store the image of a clip marker, replacing any previous one. */
+    void insertMarker(const QString &hash, int frame, const QImage &img);
+    /** @brief Returns the path of a clip marker image, empty if it is not on disk. */
+    QString markerPath(const QString &hash, int frame);
+    /** @brief Returns a filmstrip tile, or a null image if it is not in the store.
+     *  @param level the zoom level of the filmstrip
+     *  @param index the tile number in this level */
+    QImage findTile(const QString &hash, int level, int index);
+    /** @brief Returns true if a filmstrip tile is in memory or on disk, without decoding it. */
+    bool containsTile(const QString &hash, int level, int index);
+    void insertTile(const QString &hash, int level, int index, const QImage &img);
+    /** @brief Drop thumbnails kept in memory, for example when thumbnail size changed. */
+    void clearMemory();
+    /** @brief Returns the disk space used by the stored tiles. */
+    qint64 diskSize();
+
+private:
+    struct DiskEntry {
+        qint64 size;
+        quint64 lastUse;
+    };
+    QMutex m_mutex;
+    QCache<QString, QImage> m_memory;
+    QHash<QString, DiskEntry> m_disk;
+    QDir m_folder;
+    bool m_hasFolder;
+    qint64 m_diskSize;
+    qint64 m_maxDiskSize;
+    /** @brief Incremented on each access, used to find the least recently used files. */
+    quint64 m_useCounter;
+    static QString key(const QString &hash, int frame);
+    static QString tileKey(const QString &hash, int level, int index);
+    static QString markerKey(const QString &hash, int frame);
+    static bool isMarkerKey(const QString &key);
+    QImage findKey(const QString &entryKey);
+    bool containsKey(const QString &entryKey);
+    /** @brief Store an image in memory and on disk. If @param replace is false and the key is already on disk, the file is not written again. */
+    void insertKey(const QString &entryKey, const QImage &img, bool replace = false);
+    /** @brief Returns the path of the file of a key, empty if it is not on disk. */
+    QString existingPath(const QString &entryKey);
+    QString tilePath(const QString &key) const;
+    /** @brief Delete least recently used files until we are below the disk budget. Mutex must be locked. */
+    void evictFiles();
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include "doc/kthumb.h"
 #include "kdenlivesettings.h"
 #include "timecode.h"
+#include "project/transcodequeue.h"
 #include "dialogs/clipcreationdialog.h"
 #include <mlt++/Mlt.h>
 
@@ -78,7 +79,7 @@ void DvdTreeWidget::dropEvent(QDropEvent *event)
 DvdWizardVob::DvdWizardVob(QWidget *parent) :
     QWizardPage(parent)
     , m_installCheck(true)
-    , m_duration(0)
+    , m_transcodeQueue(nullptr)
 {
     m_view.setupUi(this);
     m_view.button_add->setIcon(QIcon::fromTheme(QStringLiteral("list-add")));
@@ -151,20 +152,17 @@ DvdWizardVob::DvdWizardVob(QWidget *parent) :
     m_view.button_transcode->setHidden(true);
     slotCheckVobList();
 
-    m_transcodeProcess.setProcessChannelMode(QProcess::MergedChannels);
-    connect(&m_transcodeProcess, &QProcess::readyReadStandardOutput, this, &DvdWizardVob::slotShowTranscodeInfo);
-    connect(&m_transcodeProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &DvdWizardVob::slotTranscodeFinished);
+    m_transcodeQueue = new TranscodeQueue(this);
+    connect(m_transcodeQueue, &TranscodeQueue::overallProgress, m_view.convert_progress, &QProgressBar::setValue);
+    connect(m_transcodeQueue, &TranscodeQueue::jobFinished, this, &DvdWizardVob::slotTranscodeJobFinished);
+    connect(m_transcodeQueue, &TranscodeQueue::finished, this, &DvdWizardVob::slotTranscodeFinished);
 }
 
 DvdWizardVob::~DvdWizardVob()
 {
     delete m_capacityBar;
     // Abort running transcoding
-    if (m_transcodeProcess.state() != QProcess::NotRunning) {
-        disconnect(&m_transcodeProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &DvdWizardVob::slotTranscodeFinished);
-        m_transcodeProcess.close();
-        m_transcodeProcess.waitForFinished();
-    }
+    delete m_transcodeQueue;
 }
 
 bool DvdWizardVob::isComplete() const
@@ -172,74 +170,40 @@ bool DvdWizardVob::isComplete() const
     return m_vobList->topLevelItemCount() > 0;
 }
 
-void DvdWizardVob::slotShowTranscodeInfo()
-{
-    QString log = QString(m_transcodeProcess.readAll());
-    if (m_duration == 0) {
-        if (log.contains(QStringLiteral("Duration:"))) {
-            QString durationstr = log.section(QStringLiteral("Duration:"), 1, 1).section(QLatin1Char(','), 0, 0).simplified();
-            const QStringList numbers = durationstr.split(QLatin1Char(':'));
-            if (numbers.size() < 3) {
-                return;
-            }
-            m_duration = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
-            //log_text->setHidden(true);
-            //job_progress->setHidden(false);
-        } else {
-            //log_text->setHidden(false);
-            //job_progress->setHidden(true);
-        }
-    } else if (log.contains(QStringLiteral("time="))) {
-        int progress;
-        QString time = log.section(QStringLiteral("time="), 1, 1).simplified().section(QLatin1Char(' '), 0, 0);
-        if (time.contains(QLatin1Char(':'))) {
-            const QStringList numbers = time.split(QLatin1Char(':'));
-            if (numbers.size() < 3) {
-                return;
-            }
-            progress = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
-        } else {
-            progress = (int) time.toDouble();
-        }
-        m_view.convert_progress->setValue((int)(100.0 * progress / m_duration));
-    }
-    //log_text->setPlainText(log);
-}
-
 void DvdWizardVob::slotAbortTranscode()
 {
-    if (m_transcodeProcess.state() != QProcess::NotRunning) {
-        m_transcodeProcess.close();
-        m_transcodeProcess.waitForFinished();
-    }
-    m_transcodeQueue.clear();
+    m_transcodeQueue->abort();
+    m_transcodeJobs.clear();
     m_view.convert_box->hide();
     slotCheckProfiles();
 }
 
-void DvdWizardVob::slotTranscodeFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void DvdWizardVob::slotTranscodeJobFinished(int id, bool success, bool reused)
 {
-    if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
-        slotTranscodedClip(m_currentTranscoding.filename, m_currentTranscoding.filename + m_currentTranscoding.params.section(QStringLiteral("%1"), 1, 1).section(QLatin1Char(' '), 0, 0));
-        if (!m_transcodeQueue.isEmpty()) {
-            m_transcodeProcess.close();
-            processTranscoding();
-            return;
-        }
-    } else {
-        // Something failed
-        //TODO show log
-        m_warnMessage->setMessageType(KMessageWidget::Warning);
-        m_warnMessage->setText(i18n("Transcoding failed!"));
-        m_warnMessage->animatedShow();
-        m_transcodeQueue.clear();
-    }
-    m_duration = 0;
-    m_transcodeProcess.close();
-    if (m_transcodeQueue.isEmpty()) {
-        m_view.convert_box->setHidden(true);
-        slotCheckProfiles();
+    Q_UNUSED(reused)
+    if (!m_transcodeJobs.contains(id)) {
+        // Job was aborted
+        return;
+    }
+    const QPair<QString, QString> job = m_transcodeJobs.take(id);
+    if (success) {
+        slotTranscodedClip(job.first, job.second);
+        return;
     }
+    // Something failed, cancel remaining jobs
+    qCDebug(KDENLIVE_LOG) << "Transcoding failed: " << m_transcodeQueue->log(id);
+    m_warnMessage->setMessageType(KMessageWidget::Warning);
+    m_warnMessage->setText(i18n("Transcoding failed!"));
+    m_warnMessage->animatedShow();
+    m_transcodeQueue->abort();
+    m_transcodeJobs.clear();
+    slotTranscodeFinished();
+}
+
+void DvdWizardVob::slotTranscodeFinished()
+{
+    m_view.convert_box->setHidden(true);
+    slotCheckProfiles();
 }
 
 void DvdWizardVob::slotCheckProfiles()
@@ -660,13 +624,18 @@ void DvdWizardVob::slotTranscodeFiles()
         finalSize = QSize(720, 576);
     }
     QString params = transConfig.readEntry(profileEasyName);
-    m_transcodeQueue.clear();
+    if (m_transcodeQueue->isRunning()) {
+        return;
+    }
+    m_transcodeJobs.clear();
     m_view.convert_progress->setValue(0);
-    m_duration = 0;
+    QStringList postParams;
+    params = params.section(QLatin1Char(';'), 0, 0);
+    const QString extension = params.section(QStringLiteral("%1"), 1, 1).section(QLatin1Char(' '), 0, 0);
+    QMap<QString, QStringList> jobs;
     // Transcode files that do not match selected profile
     int max = m_vobList->topLevelItemCount();
     int format = m_view.dvd_profile->currentIndex();
-    m_view.convert_box->setVisible(true);
     for (int i = 0; i < max; ++i) {
         QTreeWidgetItem *item = m_vobList->topLevelItem(i);
         if (item->data(0, Qt::UserRole + 1).toInt() != format) {
@@ -674,7 +643,7 @@ void DvdWizardVob::slotTranscodeFiles()
             m_transcodeAction->setEnabled(false);
             QSize original = item->data(0, Qt::UserRole + 2).toSize();
             double input_aspect = (double) original.width() / original.height();
-            QStringList postParams;
+            postParams.clear();
             if (input_aspect > (double) destSize.width() / destSize.height()) {
                 // letterboxing
                 int conv_height = (int)(destSize.width() / input_aspect);
@@ -692,44 +661,43 @@ void DvdWizardVob::slotTranscodeFiles()
                 }
                 postParams << QStringLiteral("-vf") << QStringLiteral("scale=%1:%2,pad=%3:%4:%5:0,setdar=%6").arg(finalSize.width() - 2 * conv_pad).arg(destSize.height()).arg(finalSize.width()).arg(finalSize.height()).arg(conv_pad).arg(input_aspect);
             }
-            TranscodeJobInfo jobInfo;
-            jobInfo.filename = item->text(0);
-            jobInfo.params = params.section(QLatin1Char(';'), 0, 0);
-            jobInfo.postParams = postParams;
-            m_transcodeQueue << jobInfo;
+            const QString filename = item->text(0);
+            QStringList parameters;
+            parameters << QStringLiteral("-i") << filename << transcodeParameters(params, postParams, filename);
+            if (QFile::exists(filename + extension) && !TranscodeQueue::hasValidOutput(filename, filename + extension, parameters)) {
+                if (KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", filename + extension)) == KMessageBox::No) {
+                    m_transcodeAction->setEnabled(true);
+                    return;
+                }
+                parameters.prepend(QStringLiteral("-y"));
+            }
+            jobs.insert(filename, parameters);
         }
     }
-    processTranscoding();
-}
-
-void DvdWizardVob::processTranscoding()
-{
-    if (m_transcodeQueue.isEmpty()) {
+    if (jobs.isEmpty()) {
         return;
     }
-    m_currentTranscoding = m_transcodeQueue.takeFirst();
-    QStringList parameters;
-    QStringList postParams = m_currentTranscoding.postParams;
-    QString params = m_currentTranscoding.params;
-    QString extension = params.section(QStringLiteral("%1"), 1, 1).section(QLatin1Char(' '), 0, 0);
-    parameters << QStringLiteral("-i") << m_currentTranscoding.filename;
-    if (QFile::exists(m_currentTranscoding.filename + extension)) {
-        if (KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", m_currentTranscoding.filename + extension)) == KMessageBox::No) {
-            // TODO inform about abortion
-            m_transcodeQueue.clear();
-            return;
-        }
-        parameters << QStringLiteral("-y");
+    m_view.convert_box->setVisible(true);
+    m_view.convert_label->setText(i18np("Transcoding %1 clip", "Transcoding %1 clips", jobs.count()));
+    QMapIterator<QString, QStringList> i(jobs);
+    while (i.hasNext()) {
+        i.next();
+        const int id = m_transcodeQueue->addJob(i.key(), i.key() + extension, i.value());
+        m_transcodeJobs.insert(id, qMakePair(i.key(), i.key() + extension));
     }
+}
 
+QStringList DvdWizardVob::transcodeParameters(const QString &params, const QStringList &postParams, const QString &filename) const
+{
+    QStringList parameters;
     bool replaceVfParams = false;
     const QStringList splitted = params.split(QLatin1Char(' '));
-    foreach (QString s, splitted) {
+    for (QString s : splitted) {
         if (replaceVfParams) {
             parameters << postParams.at(1);
             replaceVfParams = false;
         } else if (s.startsWith(QLatin1String("%1"))) {
-            parameters << s.replace(0, 2, m_currentTranscoding.filename);
+            parameters << s.replace(0, 2, filename);
         } else if (!postParams.isEmpty() && s == QLatin1String("-vf")) {
             replaceVfParams = true;
             parameters << s;
@@ -737,9 +705,7 @@ void DvdWizardVob::processTranscoding()
             parameters << s;
         }
     }
-    qCDebug(KDENLIVE_LOG) << " / / /STARTING TCODE JB: \n" << KdenliveSettings::ffmpegpath() << " = " << parameters;
-    m_transcodeProcess.start(KdenliveSettings::ffmpegpath(), parameters);
-    m_view.convert_label->setText(i18n("Transcoding: %1", QUrl::fromLocalFile(m_currentTranscoding.filename).fileName()));
+    return parameters;
 }
 
 void DvdWizardVob::slotTranscodedClip(const QString &src, const QString &transcoded)
@@ -829,7 +795,7 @@ void DvdWizardVob::slotTranscodedClip(const QString &src, const QString &transco
             }
             delete producer;
             slotCheckVobList();
-            if (m_transcodeQueue.isEmpty()) {
+            if (m_transcodeJobs.isEmpty()) {
                 slotCheckProfiles();
             }
             break;
@@ -32,15 +32,12 @@
 #include <QTreeWidget>
 #include <QDragEnterEvent>
 #include <QDropEvent>
-#include <QProcess>
+#include <QMap>
+#include <QPair>
 
 enum DVDFORMAT { PAL, PAL_WIDE, NTSC, NTSC_WIDE };
 
-struct TranscodeJobInfo {
-    QString filename;
-    QString params;
-    QStringList postParams;
-};
+class TranscodeQueue;
 
 class DvdTreeWidget : public QTreeWidget
 {
@@ -130,13 +127,13 @@ private:
     QAction *m_transcodeAction;
     bool m_installCheck;
     KMessageWidget *m_warnMessage;
-    int m_duration;
-    QProcess m_transcodeProcess;
-    QList<TranscodeJobInfo> m_transcodeQueue;
-    TranscodeJobInfo m_currentTranscoding;
+    TranscodeQueue *m_transcodeQueue;
+    /** @brief Source file and transcoded file of each queued transcode job. */
+    QMap<int, QPair<QString, QString> > m_transcodeJobs;
     void showProfileError();
     void showError(const QString &error);
-    void processTranscoding();
+    /** @brief Build the FFmpeg output arguments for one file. */
+    QStringList transcodeParameters(const QString &params, const QStringList &postParams, const QString &filename) const;
 
 public slots:
     void slotAddVobFile(const QUrl &url = QUrl(), const QString &chapters = QString(), bool checkFormats = true);
@@ -150,8 +147,8 @@ private slots:
     void slotItemDown();
     void slotTranscodeFiles();
     void slotTranscodedClip(const QString &, const QString &);
-    void slotShowTranscodeInfo();
-    void slotTranscodeFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void slotTranscodeJobFinished(int id, bool success, bool reused);
+    void slotTranscodeFinished();
     void slotAbortTranscode();
 };
 
@@ -0,0 +1,223 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "effectscache.h"
+#include "effectslist.h"
+#include "mainwindow.h"
+#include <config-kdenlive.h>
+
+#include "kdenlive_debug.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QLocale>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#include <framework/mlt_version.h>
+#include <mlt++/Mlt.h>
+
+// Magic number and format version of the cache file, bump version when changing the catalogue building logic
+static const quint32 cacheMagic = 0x4b444543;
+static const quint32 cacheVersion = 1;
+
+static void addFolderToHash(QCryptographicHash &hash, const QString &folder, const QStringList &filters, bool recursive)
+{
+    QDir dir(folder);
+    if (!dir.exists()) {
+        return;
+    }
+    hash.addData(dir.absolutePath().toUtf8());
+    const QFileInfoList files = dir.entryInfoList(filters, QDir::Files, QDir::Name);
+    for (const QFileInfo &info : files) {
+        hash.addData(info.fileName().toUtf8());
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+        hash.addData(QByteArray::number(info.size()));
+    }
+    if (recursive) {
+        const QStringList subFolders = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+        for (const QString &sub : subFolders) {
+            addFolderToHash(hash, dir.absoluteFilePath(sub), filters, false);
+        }
+    }
+}
+
+static void addFileToHash(QCryptographicHash &hash, const QString &path)
+{
+    QFileInfo info(path);
+    hash.addData(path.toUtf8());
+    if (info.exists()) {
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+        hash.addData(QByteArray::number(info.size()));
+    }
+}
+
+/** @brief Folders where MLT looks for frei0r or ladspa plugins: the environment variable if set, else
+ *  the plugin folder next to the MLT modules, the usual system folders and @param homeFolder */
+static QStringList pluginSearchPath(const char *variable, const QString &folderName, const QString &homeFolder)
+{
+    if (qEnvironmentVariableIsSet(variable)) {
+        return QString::fromLocal8Bit(qgetenv(variable)).split(QDir::listSeparator(), QString::SkipEmptyParts);
+    }
+    QStringList folders;
+    // MLT_REPOSITORY is <prefix>/lib/mlt, bundled plugins are installed in the same prefix
+    QDir libDir(QString::fromUtf8(mlt_environment("MLT_REPOSITORY")));
+    if (libDir.cdUp()) {
+        folders << libDir.absoluteFilePath(folderName);
+    }
+    folders << QStringLiteral("/usr/lib/") + folderName << QStringLiteral("/usr/lib64/") + folderName << QStringLiteral("/usr/local/lib/") + folderName;
+    folders << QDir::home().absoluteFilePath(homeFolder);
+    folders.removeDuplicates();
+    return folders;
+}
+
+EffectsCache::EffectsCache(const QString &locale, const QStringList &services)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(cacheVersion));
+    hash.addData(KDENLIVE_VERSION);
+    hash.addData(mlt_version_get_string());
+    hash.addData(locale.toUtf8());
+    hash.addData(QLocale().name().toUtf8());
+    hash.addData(QString(QLocale().decimalPoint()).toUtf8());
+    hash.addData(services.join(QLatin1Char(',')).toUtf8());
+    const QStringList xmlFilter = QStringList() << QStringLiteral("*.xml");
+    const QStringList effectFolders = QStandardPaths::locateAll(QStandardPaths::AppDataLocation, QStringLiteral("effects"), QStandardPaths::LocateDirectory);
+    for (const QString &folder : effectFolders) {
+        addFolderToHash(hash, folder, xmlFilter, false);
+    }
+    const QStringList transitionFolders = QStandardPaths::locateAll(QStandardPaths::AppDataLocation, QStringLiteral("transitions"), QStandardPaths::LocateDirectory);
+    for (const QString &folder : transitionFolders) {
+        addFolderToHash(hash, folder, xmlFilter, false);
+    }
+    addFileToHash(hash, QStandardPaths::locate(QStandardPaths::AppDataLocation, QStringLiteral("blacklisted_effects.txt")));
+    addFileToHash(hash, QStandardPaths::locate(QStandardPaths::AppDataLocation, QStringLiteral("blacklisted_transitions.txt")));
+    m_key = hash.result();
+}
+
+// static
+QString EffectsCache::cacheFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/effectscatalogue.cache");
+}
+
+// static
+QByteArray EffectsCache::pluginsFingerprint()
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    // MLT modules and their yml metadata files
+    addFolderToHash(hash, QString::fromUtf8(mlt_environment("MLT_REPOSITORY")), QStringList(), false);
+    addFolderToHash(hash, QString::fromUtf8(mlt_environment("MLT_DATA")), QStringList() << QStringLiteral("*.yml") << QStringLiteral("*.txt"), true);
+    // frei0r and ladspa plugins can be installed without changing MLT
+    QStringList pluginFolders = pluginSearchPath("FREI0R_PATH", QStringLiteral("frei0r-1"), QStringLiteral(".frei0r-1/lib"));
+    pluginFolders << pluginSearchPath("LADSPA_PATH", QStringLiteral("ladspa"), QStringLiteral(".ladspa"));
+    for (const QString &folder : pluginFolders) {
+        addFolderToHash(hash, folder, QStringList(), false);
+    }
+    return hash.result();
+}
+
+bool EffectsCache::load()
+{
+    QFile file(cacheFile());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+    quint32 magic;
+    quint32 version;
+    QByteArray key;
+    QByteArray fingerprint;
+    stream >> magic >> version;
+    if (magic != cacheMagic || version != cacheVersion) {
+        return false;
+    }
+    stream >> key >> fingerprint;
+    if (key != m_key) {
+        qCDebug(KDENLIVE_LOG) << "Effects catalogue cache is outdated, rebuilding";
+        return false;
+    }
+    QByteArray transitions;
+    QByteArray customEffects;
+    QByteArray audioEffects;
+    QByteArray videoEffects;
+    stream >> transitions >> customEffects >> audioEffects >> videoEffects;
+    if (stream.status() != QDataStream::Ok) {
+        qCDebug(KDENLIVE_LOG) << "Corrupted effects catalogue cache, rebuilding";
+        return false;
+    }
+    if (!MainWindow::transitions.loadXml(qUncompress(transitions)) || !MainWindow::customEffects.loadXml(qUncompress(customEffects)) ||
+        !MainWindow::audioEffects.loadXml(qUncompress(audioEffects)) || !MainWindow::videoEffects.loadXml(qUncompress(videoEffects))) {
+        // Make sure we don't keep a partially loaded catalogue
+        MainWindow::transitions.clearList();
+        MainWindow::customEffects.clearList();
+        MainWindow::audioEffects.clearList();
+        MainWindow::videoEffects.clearList();
+        return false;
+    }
+    QtConcurrent::run(&EffectsCache::revalidate, fingerprint);
+    return true;
+}
+
+void EffectsCache::save() const
+{
+    // QDomDocument is not thread safe, so serialize the lists here and only write in a thread
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << qCompress(MainWindow::transitions.toByteArray(-1)) << qCompress(MainWindow::customEffects.toByteArray(-1))
+           << qCompress(MainWindow::audioEffects.toByteArray(-1)) << qCompress(MainWindow::videoEffects.toByteArray(-1));
+    QtConcurrent::run(&EffectsCache::writeCache, m_key, data);
+}
+
+// static
+void EffectsCache::writeCache(const QByteArray &key, const QByteArray &data)
+{
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    QSaveFile file(cacheFile());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCDebug(KDENLIVE_LOG) << "Cannot write effects catalogue cache: " << file.fileName();
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << cacheMagic << cacheVersion << key << pluginsFingerprint();
+    stream.writeRawData(data.constData(), data.size());
+    file.commit();
+}
+
+// static
+void EffectsCache::revalidate(const QByteArray &fingerprint)
+{
+    if (pluginsFingerprint() != fingerprint) {
+        qCDebug(KDENLIVE_LOG) << "MLT plugins changed, effects catalogue will be rebuilt on next startup";
+        invalidate();
+    }
+}
+
+// static
+void EffectsCache::invalidate()
+{
+    QFile::remove(cacheFile());
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef EFFECTSCACHE_H
+#define EFFECTSCACHE_H
+
+#include <QByteArray>
+#include <QStringList>
+
+/**
+ * @class EffectsCache
+ * @brief Binary cache of the resolved effects and transitions catalogue.
+ * Building the catalogue requires parsing every effect XML file and querying MLT
+ * metadata for each filter, which is slow on startup. Once built, the 4 global lists
+ * are stored in a versioned binary file. The cache key is made of the MLT version,
+ * the numeric locale, the list of available MLT services and the modification
+ * times of the effect, transition and blacklist files, so it is cheap to check.
+ * After a cache hit, the MLT plugin folders are checked in a background thread and
+ * the cache is discarded if they changed, so that the next startup rebuilds it.
+ */
+
+class EffectsCache
+{
+public:
+    /** @brief Prepare the cache key.
+     * @param locale the numeric locale used to parse effects
+     * @param services sorted names of all MLT filters, transitions and producers */
+    EffectsCache(const QString &locale, const QStringList &services);
+    /** @brief Try to fill the global effects and transitions lists from the cache.
+     * @return true if the cache was valid and loaded */
+    bool load();
+    /** @brief Write the current global lists to the cache file (file writing happens in a thread). */
+    void save() const;
+    /** @brief Delete the cache file, called when custom effects were saved or deleted and when plugins changed. */
+    static void invalidate();
+
+private:
+    QByteArray m_key;
+    /** @brief Path of the cache file. */
+    static QString cacheFile();
+    /** @brief Fingerprint of the MLT plugins and metadata folders, slower to compute. */
+    static QByteArray pluginsFingerprint();
+    /** @brief Compare the stored plugins fingerprint with the current one, delete cache on mismatch. */
+    static void revalidate(const QByteArray &fingerprint);
+    /** @brief Write serialized data to the cache file. */
+    static void writeCache(const QByteArray &key, const QByteArray &data);
+};
+
+#endif
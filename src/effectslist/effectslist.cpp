@@ -21,6 +21,7 @@
 #include <klocalizedstring.h>
 
 EffectsList::EffectsList(bool indexRequired) : m_useIndex(indexRequired)
+    , m_lookup(new LookupIndex)
 {
     m_baseElement = createElement(QStringLiteral("list"));
     appendChild(m_baseElement);
@@ -57,70 +58,78 @@ QDomElement EffectsList::getEffectByName(const QString &name) const
 
 QDomElement EffectsList::getEffectByTag(const QString &tag, const QString &id) const
 {
-    QDomNodeList effects = m_baseElement.childNodes();
-    if (effects.isEmpty()) {
-        return QDomElement();
+    if (!id.isEmpty()) {
+        return lookup(true, id);
     }
-    for (int i = 0; i < effects.count(); ++i) {
-        QDomElement effect =  effects.at(i).toElement();
-        if (!id.isEmpty()) {
-            if (effect.attribute(QStringLiteral("id")) == id) {
-                if (effect.tagName() == QLatin1String("effectgroup")) {
-                    // Effect group
-                    QDomNodeList subeffects = effect.elementsByTagName(QStringLiteral("effect"));
-                    for (int j = 0; j < subeffects.count(); ++j) {
-                        QDomElement sub = subeffects.at(j).toElement();
-                    }
-                }
-                return effect;
-            }
-        } else if (!tag.isEmpty()) {
-            if (effect.attribute(QStringLiteral("tag")) == tag) {
-                return effect;
-            }
-        }
+    if (!tag.isEmpty()) {
+        return lookup(false, tag);
     }
     return QDomElement();
 }
 
 QDomElement EffectsList::effectById(const QString &id) const
 {
-    QDomNodeList effects = m_baseElement.childNodes();
-    for (int i = 0; i < effects.count(); ++i) {
-        QDomElement effect =  effects.at(i).toElement();
-        if (!id.isEmpty() && effect.attribute(QStringLiteral("id")) == id) {
-            return effect;
-        }
+    if (id.isEmpty()) {
+        return QDomElement();
     }
-    return QDomElement();
+    return lookup(true, id);
 }
 
 bool EffectsList::hasTransition(const QString &tag) const
 {
-    QDomNodeList trans = m_baseElement.childNodes();
-    for (int i = 0; i < trans.count(); ++i) {
-        QDomElement effect =  trans.at(i).toElement();
-        if (effect.attribute(QStringLiteral("tag")) == tag) {
-            return true;
-        }
-    }
-    return false;
+    return !lookup(false, tag).isNull();
 }
 
 int EffectsList::hasEffect(const QString &tag, const QString &id) const
 {
-    QDomNodeList effects = m_baseElement.childNodes();
-    for (int i = 0; i < effects.count(); ++i) {
-        QDomElement effect =  effects.at(i).toElement();
-        if (!id.isEmpty()) {
-            if (effect.attribute(QStringLiteral("id")) == id) {
-                return effect.attribute(QStringLiteral("kdenlive_ix")).toInt();
-            }
-        } else if (!tag.isEmpty() && effect.attribute(QStringLiteral("tag")) == tag) {
-            return effect.attribute(QStringLiteral("kdenlive_ix")).toInt();
+    QDomElement effect = getEffectByTag(tag, id);
+    if (effect.isNull()) {
+        return -1;
+    }
+    return effect.attribute(QStringLiteral("kdenlive_ix")).toInt();
+}
+
+void EffectsList::ensureLookup() const
+{
+    if (!m_lookup->dirty) {
+        return;
+    }
+    m_lookup->ids.clear();
+    m_lookup->tags.clear();
+    QDomElement effect = m_baseElement.firstChildElement();
+    while (!effect.isNull()) {
+        const QString id = effect.attribute(QStringLiteral("id"));
+        if (!id.isEmpty() && !m_lookup->ids.contains(id)) {
+            m_lookup->ids.insert(id, effect);
+        }
+        const QString tag = effect.attribute(QStringLiteral("tag"));
+        if (!tag.isEmpty() && !m_lookup->tags.contains(tag)) {
+            m_lookup->tags.insert(tag, effect);
         }
+        effect = effect.nextSiblingElement();
     }
-    return -1;
+    m_lookup->dirty = false;
+}
+
+void EffectsList::invalidateLookup()
+{
+    QMutexLocker lock(&m_lookup->mutex);
+    m_lookup->dirty = true;
+}
+
+QDomElement EffectsList::lookup(bool byId, const QString &value) const
+{
+    const QString attribute = byId ? QStringLiteral("id") : QStringLiteral("tag");
+    QMutexLocker lock(&m_lookup->mutex);
+    ensureLookup();
+    QDomElement effect = byId ? m_lookup->ids.value(value) : m_lookup->tags.value(value);
+    if (!effect.isNull() && (effect.parentNode() != m_baseElement || effect.attribute(attribute) != value)) {
+        // The element was modified or moved outside of the list API, rebuild
+        m_lookup->dirty = true;
+        ensureLookup();
+        effect = byId ? m_lookup->ids.value(value) : m_lookup->tags.value(value);
+    }
+    return effect;
 }
 
 QStringList EffectsList::effectIdInfo(const int ix) const
@@ -220,10 +229,25 @@ void EffectsList::clone(const EffectsList &original)
 {
     setContent(original.toString());
     m_baseElement = documentElement();
+    invalidateLookup();
+}
+
+bool EffectsList::loadXml(const QByteArray &data)
+{
+    invalidateLookup();
+    if (!setContent(data, false) || documentElement().tagName() != QLatin1String("list")) {
+        clear();
+        m_baseElement = createElement(QStringLiteral("list"));
+        appendChild(m_baseElement);
+        return false;
+    }
+    m_baseElement = documentElement();
+    return true;
 }
 
 void EffectsList::clearList()
 {
+    invalidateLookup();
     while (!m_baseElement.firstChild().isNull()) {
         m_baseElement.removeChild(m_baseElement.firstChild());
     }
@@ -349,6 +373,7 @@ QDomElement EffectsList::append(const QDomElement &e)
     QDomElement result;
     if (!e.isNull()) {
         result = m_baseElement.appendChild(importNode(e, true)).toElement();
+        invalidateLookup();
         if (m_useIndex) {
             updateIndexes(m_baseElement.childNodes(), m_baseElement.childNodes().count() - 1);
         }
@@ -382,6 +407,7 @@ void EffectsList::removeAt(int ix)
         return;
     }
     m_baseElement.removeChild(effects.at(ix - 1));
+    invalidateLookup();
     if (m_useIndex) {
         updateIndexes(effects, ix - 1);
     }
@@ -408,6 +434,7 @@ QDomElement EffectsList::insert(const QDomElement &effect)
         QDomElement listeffect =  effects.at(ix - 1).toElement();
         result = m_baseElement.insertBefore(importNode(effect, true), listeffect).toElement();
     }
+    invalidateLookup();
     if (m_useIndex && ix > 0) {
         updateIndexes(effects, ix - 1);
     }
@@ -456,4 +483,5 @@ void EffectsList::updateEffect(const QDomElement &effect)
     } else {
         m_baseElement.appendChild(importNode(effect, true));
     }
+    invalidateLookup();
 }
@@ -26,6 +26,9 @@
 #define EFFECTSLIST_H
 
 #include <QDomDocument>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
 
 namespace Kdenlive
 {
@@ -70,6 +73,9 @@ public:
     QString getInfoFromIndex(const int ix) const;
     QString getEffectInfo(const QDomElement &effect) const;
     void clone(const EffectsList &original);
+    /** @brief Replace the list content with a serialized list (as returned by toByteArray()).
+     * @return false if the data could not be parsed */
+    bool loadXml(const QByteArray &data);
     QDomElement append(const QDomElement &e);
     bool isEmpty() const;
     int count() const;
@@ -100,8 +106,24 @@ public:
     bool enableEffects(const QList<int> &indexes, bool disable);
 
 private:
+    /** @brief Hash tables used to find effects by id or tag without walking the list.
+     * It is shared between copies of the list since they also share the DOM tree, and rebuilt
+     * on first lookup after a modification. The mutex protects it from concurrent const lookups. */
+    struct LookupIndex {
+        QHash<QString, QDomElement> ids;
+        QHash<QString, QDomElement> tags;
+        bool dirty = true;
+        QMutex mutex;
+    };
     QDomElement m_baseElement;
     bool m_useIndex;
+    QSharedPointer<LookupIndex> m_lookup;
+    /** @brief Rebuild the lookup tables if the list was modified. The lookup mutex must be locked. */
+    void ensureLookup() const;
+    /** @brief Mark lookup tables as outdated, must be called on each list modification. */
+    void invalidateLookup();
+    /** @brief Returns the first effect whose attribute (id or tag) matches value. */
+    QDomElement lookup(bool byId, const QString &value) const;
 };
 
 #endif
@@ -19,6 +19,7 @@
 
 #include "initeffects.h"
 #include "effectslist.h"
+#include "effectscache.h"
 
 #include "kdenlivesettings.h"
 #include "mainwindow.h"
@@ -195,6 +196,17 @@ bool initEffects::parseEffectFiles(std::unique_ptr<Mlt::Repository> &repository,
     }
     delete transitions;
 
+    // Get list of installed luma files
+    refreshLumas();
+
+    // Check if we have a valid cached catalogue, so we don't need to parse all files and query MLT metadata
+    QStringList servicesList = filtersList + producersList + transitionsItemList;
+    servicesList.sort();
+    EffectsCache cache(locale.isEmpty() ? QString::fromLatin1(setlocale(LC_NUMERIC, nullptr)) : locale, servicesList);
+    if (cache.load()) {
+        return movit;
+    }
+
     // Create structure holding all transitions descriptions so that if an XML file has no description, we take it from MLT
     QMap<QString, QString> transDescriptions;
     foreach (const QString &transname, transitionsItemList) {
@@ -210,9 +222,6 @@ bool initEffects::parseEffectFiles(std::unique_ptr<Mlt::Repository> &repository,
     }
     transitionsItemList.sort();
 
-    // Get list of installed luma files
-    refreshLumas();
-
     // Parse xml transition files
     QStringList direc = QStandardPaths::locateAll(QStandardPaths::AppDataLocation, QStringLiteral("transitions"), QStandardPaths::LocateDirectory);
     // Iterate through effects directories to parse all XML files.
@@ -382,6 +391,7 @@ bool initEffects::parseEffectFiles(std::unique_ptr<Mlt::Repository> &repository,
         MainWindow::videoEffects.append(effect);
     }
 
+    cache.save();
     return movit;
 }
 
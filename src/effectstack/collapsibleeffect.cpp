@@ -44,6 +44,7 @@
 #include <klocalizedstring.h>
 #include <KMessageBox>
 #include <KDualAction>
+#include <KColorScheme>
 
 CollapsibleEffect::CollapsibleEffect(const QDomElement &effect, const QDomElement &original_effect, const ItemInfo &info, EffectMetaInfo *metaInfo, bool canMoveUp, bool lastEffect, QWidget *parent) :
     AbstractCollapsibleWidget(parent),
@@ -102,6 +103,9 @@ CollapsibleEffect::CollapsibleEffect(const QDomElement &effect, const QDomElemen
     m_colorIcon->setMinimumSize(iconSize);
     title = new QLabel(this);
     l->insertWidget(2, title);
+    m_costLabel = new QLabel(this);
+    l->insertWidget(3, m_costLabel);
+    m_costLabel->setVisible(false);
 
     m_enabledButton = new KDualAction(i18n("Disable Effect"), i18n("Enable Effect"), this);
     m_enabledButton->setActiveIcon(KoIconUtils::themedIcon(QStringLiteral("hint")));
@@ -492,6 +496,23 @@ int CollapsibleEffect::groupIndex() const
     return m_info.groupIndex;
 }
 
+void CollapsibleEffect::setCost(double time, double frameDuration)
+{
+    if (time < 0) {
+        m_costLabel->setVisible(false);
+        return;
+    }
+    m_costLabel->setText(i18n("%1 ms", QLocale().toString(time, 'f', 1)));
+    m_costLabel->setToolTip(i18n("Processing time for a frame, a frame lasts %1 ms", QLocale().toString(frameDuration, 'f', 1)));
+    QPalette pal = palette();
+    if (frameDuration > 0 && time > frameDuration) {
+        KColorScheme scheme(pal.currentColorGroup(), KColorScheme::Window, KSharedConfig::openConfig(KdenliveSettings::colortheme()));
+        pal.setColor(QPalette::WindowText, scheme.foreground(KColorScheme::NegativeText).color());
+    }
+    m_costLabel->setPalette(pal);
+    m_costLabel->setVisible(true);
+}
+
 int CollapsibleEffect::effectIndex() const
 {
     if (m_effect.isNull()) {
@@ -85,6 +85,10 @@ public:
     void setActiveKeyframe(int kf);
     /** @brief Returns true if effect can be moved (false for speed effect). */
     bool isMovable() const;
+    /** @brief Display the measured processing time of this effect.
+     *  @param time the time spent in this effect for a frame (ms), -1 to hide it
+     *  @param frameDuration the duration of a frame (ms), the cost is highlighted if the effect alone exceeds it */
+    void setCost(double time, double frameDuration);
 
 public slots:
     void slotSyncEffectsPos(int pos);
@@ -129,6 +133,7 @@ private:
     QAction *m_groupAction;
     KDualAction *m_enabledButton;
     QLabel *m_colorIcon;
+    QLabel *m_costLabel;
     QPixmap m_iconPix;
     /** @brief Check if collapsed state changed and inform MLT. */
     void updateCollapsedState();
@@ -30,6 +30,7 @@
 #include "project/transitionsettings.h"
 #include "utils/KoIconUtils.h"
 #include "mltcontroller/clipcontroller.h"
+#include "mltcontroller/effectprofiler.h"
 #include "timeline/transition.h"
 
 #include "kdenlive_debug.h"
@@ -70,6 +71,10 @@ EffectStackView2::EffectStackView2(Monitor *projectMonitor, QWidget *parent) :
     m_scrollTimer.setSingleShot(true);
     m_scrollTimer.setInterval(200);
     connect(&m_scrollTimer, &QTimer::timeout, this, &EffectStackView2::slotCheckWheelEventFilter);
+    m_costTimer.setSingleShot(true);
+    m_costTimer.setInterval(1000);
+    connect(&m_costTimer, &QTimer::timeout, this, &EffectStackView2::slotProfileEffects);
+    connect(EffectProfiler::shared(), &EffectProfiler::costReady, this, &EffectStackView2::slotEffectCostReady);
 
     m_layout.addWidget(m_effect);
     m_layout.addWidget(m_transition);
@@ -440,6 +445,8 @@ void EffectStackView2::setupListView()
 
     // Wait a little bit for the new layout to be ready, then check if we have a scrollbar
     m_scrollTimer.start();
+    displayEffectCosts();
+    m_costTimer.start();
 }
 
 int EffectStackView2::activeEffectIndex() const
@@ -628,6 +635,7 @@ void EffectStackView2::slotUpdateEffectState(bool disable, int index, MonitorSce
         emit changeEffectState(m_clipref, -1, QList<int>() << index, disable);
     }
     slotUpdateCheckAllButton();
+    m_costTimer.start();
 }
 
 void EffectStackView2::raiseWindow(QWidget *dock)
@@ -788,6 +796,7 @@ void EffectStackView2::slotUpdateEffectParams(const QDomElement &old, const QDom
         emit updateMasterEffect(m_masterclipref->clipId(), old, e, ix, false, update);
     }
     m_scrollTimer.start();
+    m_costTimer.start();
 }
 
 void EffectStackView2::slotSetCurrentEffect(int ix)
@@ -1340,3 +1349,43 @@ void EffectStackView2::slotSwitchCompare(bool enable)
     }
 }
 
+QString EffectStackView2::profilerKey() const
+{
+    if (m_status == TIMELINE_CLIP && m_clipref) {
+        return m_clipref->profilerKey();
+    }
+    if (m_status == MASTER_CLIP && m_masterclipref) {
+        return m_masterclipref->clipId();
+    }
+    return QString();
+}
+
+void EffectStackView2::slotProfileEffects()
+{
+    if (m_status == TIMELINE_CLIP && m_clipref) {
+        emit profileClipEffects(m_clipref);
+    } else if (m_status == MASTER_CLIP && m_masterclipref && m_masterclipref->isValid()) {
+        QMutexLocker lock(&m_masterclipref->producerMutex);
+        EffectProfiler::shared()->profile(m_masterclipref->clipId(), m_masterclipref->originalProducer());
+    }
+}
+
+void EffectStackView2::slotEffectCostReady(const QString &key)
+{
+    if (!key.isEmpty() && key == profilerKey()) {
+        displayEffectCosts();
+    }
+}
+
+void EffectStackView2::displayEffectCosts()
+{
+    const QString key = profilerKey();
+    const EffectCost cost = key.isEmpty() ? EffectCost() : EffectProfiler::shared()->cost(key);
+    for (CollapsibleEffect *effect : m_effects) {
+        if (cost.isValid() && cost.effects.contains(effect->effectIndex())) {
+            effect->setCost(cost.effects.value(effect->effectIndex()), cost.frameDuration);
+        } else {
+            effect->setCost(-1, 0);
+        }
+    }
+}
@@ -126,6 +126,8 @@ private:
     MonitorSceneType m_monitorSceneWanted;
     QMutex m_mutex;
     QTimer m_scrollTimer;
+    /** @brief Delays effect profiling while the stack is being edited. */
+    QTimer m_costTimer;
 
     /** If in track mode: Info of the edited track to be able to access its duration. */
     TrackInfo m_trackInfo;
@@ -159,6 +161,10 @@ private:
     int getPreviousIndex(int current);
     /** @brief Returns index of next effect in stack. */
     int getNextIndex(int ix);
+    /** @brief Key of the current clip in the effect profiler results. */
+    QString profilerKey() const;
+    /** @brief Display the last measured cost of each effect. */
+    void displayEffectCosts();
 
 public slots:
     /** @brief Sets the clip whose effect list should be managed.
@@ -254,6 +260,10 @@ private slots:
 
     /** @brief Dis/Enable monitor effect compare */
     void slotSwitchCompare(bool enable);
+    /** @brief Measure the cost of the current clip's effects. */
+    void slotProfileEffects();
+    /** @brief The effects of a clip were profiled, update display if it is the current one. */
+    void slotEffectCostReady(const QString &key);
 
 signals:
     void removeEffectGroup(ClipItem *, int, const QDomDocument &);
@@ -285,6 +295,8 @@ signals:
     void startFilterJob(const ItemInfo &info, const QString &clipId, QMap<QString, QString> &, QMap<QString, QString> &, QMap<QString, QString> &);
     void addEffect(ClipItem *, const QDomElement &, int);
     void importClipKeyframes(GraphicsRectItem, ItemInfo, const QDomElement &, const QMap<QString, QString> &keyframes = QMap<QString, QString>());
+    /** Measure the cost of a timeline clip's effects */
+    void profileClipEffects(ClipItem *);
 };
 
 #endif
@@ -15,6 +15,10 @@
 
 #include <QString>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 // Uncomment for debugging, like writing a GNU Octave .m file to /tmp
 //#define DEBUG_FFTTOOLS
 
@@ -31,19 +35,67 @@ FFTTools::FFTTools() :
 }
 FFTTools::~FFTTools()
 {
-    QHash<QString, kiss_fftr_cfg>::iterator i;
+    QHash<int, kiss_fftr_cfg>::iterator i;
     for (i = m_fftCfgs.begin(); i != m_fftCfgs.end(); ++i) {
         free(*i);
     }
 }
 
-const QString FFTTools::windowSignature(const WindowType windowType, const int size, const float param)
+// Key of a window function in the cache
+static inline int windowKey(const FFTTools::WindowType windowType, const uint size)
 {
-    return QStringLiteral("s%1_t%2_p%3").arg(size).arg(windowType).arg(param, 0, 'f', 3);
+    return size * 4 + windowType;
+}
+
+// Copy one channel of the interleaved samples, normalized to [-1,1] and multiplied by the window function
+static void applyWindow(const qint16 *samples, const uint channel, const uint numChannels, const float *window, float *data, const uint count)
+{
+    const float scale = 1.0f / 32767.0f;
+    uint i = 0;
+#ifdef __SSE2__
+    if (numChannels == 1 || numChannels == 2) {
+        const __m128 factor = _mm_set1_ps(scale);
+        for (; i + 4 <= count; i += 4) {
+            __m128i values;
+            if (numChannels == 1) {
+                // Sign extend 4 samples to 32 bit
+                values = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(samples + i));
+                values = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+            } else {
+                // 4 stereo sample pairs, each in a 32 bit lane: keep the requested channel
+                values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + 2 * i));
+                values = channel == 0 ? _mm_srai_epi32(_mm_slli_epi32(values, 16), 16) : _mm_srai_epi32(values, 16);
+            }
+            const __m128 result = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(values), factor), _mm_loadu_ps(window + i));
+            _mm_storeu_ps(data + i, result);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        data[i] = samples[i * numChannels + channel] * scale * window[i];
+    }
 }
-const QString FFTTools::cfgSignature(const int size)
+
+// Squared magnitude of complex FFT values
+static void powerSpectrum(const kiss_fft_cpx *freqData, float *power, const uint count)
 {
-    return QStringLiteral("s%1").arg(size);
+    uint i = 0;
+#ifdef __SSE2__
+    const float *values = reinterpret_cast<const float *>(freqData);
+    for (; i + 4 <= count; i += 4) {
+        // r0 i0 r1 i1 and r2 i2 r3 i3
+        const __m128 low = _mm_loadu_ps(values + 2 * i);
+        const __m128 high = _mm_loadu_ps(values + 2 * i + 4);
+        const __m128 lowSquare = _mm_mul_ps(low, low);
+        const __m128 highSquare = _mm_mul_ps(high, high);
+        const __m128 real = _mm_shuffle_ps(lowSquare, highSquare, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 imaginary = _mm_shuffle_ps(lowSquare, highSquare, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(power + i, _mm_add_ps(real, imaginary));
+    }
+#endif
+    for (; i < count; ++i) {
+        power[i] = freqData[i].r * freqData[i].r + freqData[i].i * freqData[i].i;
+    }
 }
 
 // http://cplusplus.syntaxerrors.info/index.php?title=Cannot_declare_member_function_%E2%80%98static_int_Foo::bar%28%29%E2%80%99_to_have_static_linkage
@@ -124,76 +176,53 @@ void FFTTools::fftNormalized(const audioShortVector &audioFrame, const uint chan
         return;
     }
 
-    const QString cfgSig = cfgSignature(windowSize);
-    const QString winSig = windowSignature(windowType, windowSize, param);
-
     // Get the kiss_fft configuration from the config cache
     // or build a new configuration if the requested one is not available.
-    kiss_fftr_cfg myCfg;
-    if (m_fftCfgs.contains(cfgSig)) {
-#ifdef DEBUG_FFTTOOLS
-        qCDebug(KDENLIVE_LOG) << "Re-using FFT configuration with size " << windowSize;
-#endif
-        myCfg = m_fftCfgs.value(cfgSig);
-    } else {
+    kiss_fftr_cfg myCfg = m_fftCfgs.value(windowSize, nullptr);
+    if (myCfg == nullptr) {
 #ifdef DEBUG_FFTTOOLS
         qCDebug(KDENLIVE_LOG) << "Creating FFT configuration with size " << windowSize;
 #endif
         myCfg = kiss_fftr_alloc(windowSize, false, nullptr, nullptr);
-        m_fftCfgs.insert(cfgSig, myCfg);
+        m_fftCfgs.insert(windowSize, myCfg);
     }
 
-    // Get the window function from the cache
-    // (except for a rectangular window; nothing to do there).
+    // Get the window function from the cache. Only the default parameter is cached,
+    // and a rectangular window simply contains ones.
     QVector<float> window;
-    float windowScaleFactor = 1;
-    if (windowType != FFTTools::Window_Rect) {
-
-        if (m_windowFunctions.contains(winSig)) {
-#ifdef DEBUG_FFTTOOLS
-            qCDebug(KDENLIVE_LOG) << "Re-using window function with signature " << winSig;
-#endif
-            window = m_windowFunctions.value(winSig);
-        } else {
-#ifdef DEBUG_FFTTOOLS
-            qCDebug(KDENLIVE_LOG) << "Building new window function with signature " << winSig;
-#endif
-            window = FFTTools::window(windowType, windowSize, 0);
-            m_windowFunctions.insert(winSig, window);
+    if (param == 0) {
+        const int key = windowKey(windowType, windowSize);
+        window = m_windowFunctions.value(key);
+        if (window.isEmpty()) {
+            window = FFTTools::window(windowType, windowSize, param);
+            m_windowFunctions.insert(key, window);
         }
-        windowScaleFactor = 1.0 / window[windowSize];
+    } else {
+        window = FFTTools::window(windowType, windowSize, param);
     }
+    const float windowScaleFactor = 1.0 / window.at(windowSize);
 
-    // Prepare frequency space vector. The resulting FFT vector is only half as long.
-    kiss_fft_cpx freqData[windowSize / 2];
+    // Prepare frequency space vector. The real FFT returns windowSize / 2 + 1 values.
+    kiss_fft_cpx freqData[windowSize / 2 + 1];
     float data[windowSize];
 
-    // Copy the first channel's audio into a vector for the FFT display;
-    // Fill the data vector indices that cannot be covered with sample data with 0
-    if (numSamples < windowSize) {
-        std::fill(&data[numSamples], &data[windowSize - 1], 0);
-    }
-    // Normalize signals to [0,1] to get correct dB values later on
-    for (uint i = 0; i < numSamples && i < windowSize; ++i) {
-        // Performance note: Benchmarking has shown that using the if/else inside the loop
-        // does not do noticeable worse than keeping it outside (perhaps the branch predictor
-        // is good enough), so it remains in there for better readability.
-        if (windowType != FFTTools::Window_Rect) {
-            data[i] = (float) audioFrame.data()[i * numChannels + channel] / 32767.0f * window[i];
-        } else {
-            data[i] = (float) audioFrame.data()[i * numChannels + channel] / 32767.0f;
-        }
-    }
+    // Copy the channel's audio into a vector for the FFT display, normalized to [-1,1]
+    // to get correct dB values later on. Fill the data vector indices that cannot be
+    // covered with sample data with 0
+    const uint count = qMin(numSamples, windowSize);
+    applyWindow(audioFrame.constData(), channel, numChannels, window.constData(), data, count);
+    std::fill(&data[count], &data[windowSize], 0);
 
     // Calculate the Fast Fourier Transform for the input data
     kiss_fftr(myCfg, data, freqData);
 
     // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
-    // with N = FFT size (after FFT, 1/2 window size)
+    // with N = FFT size (after FFT, 1/2 window size), computed from the power as
+    // 10 * log(r² + i²) + 20 * log(2 * windowScaleFactor / N)
+    powerSpectrum(freqData, freqSpectrum, windowSize / 2);
+    const float offset = 20 * log10(windowScaleFactor / ((float)windowSize / 2.0f));
     for (uint i = 0; i < windowSize / 2; ++i) {
-        // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
-        // with N = FFT size (after FFT, 1/2 window size)
-        freqSpectrum[i] = 20 * log(pow(pow(fabs(freqData[i].r * windowScaleFactor), 2) + pow(fabs(freqData[i].i * windowScaleFactor), 2), .5) / ((float)windowSize / 2.0f)) / log(10);;
+        freqSpectrum[i] = 10 * log10(freqSpectrum[i]) + offset;
     }
 
 #ifdef DEBUG_FFTTOOLS
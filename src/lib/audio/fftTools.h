@@ -39,12 +39,6 @@ public:
     */
     static const QVector<float> window(const WindowType windowType, const int size, const float param = 0);
 
-    static const QString windowSignature(const WindowType windowType, const int size, const float param = 0);
-
-    /** Returns a signature for a kiss_fft configuration
-        used as a hash in the cache */
-    static const QString cfgSignature(const int size);
-
     /** Calculates the Fourier Tranformation of the input audio frame.
         The resulting values will be given in relative dezibel: The maximum power is 0 dB, lower powers have
         negative dB values.
@@ -74,8 +68,8 @@ public:
     static const QVector<float> interpolatePeakPreserving(const QVector<float> &in, const uint targetSize, uint left = 0, uint right = 0, float fill = 0.0);
 
 private:
-    QHash<QString, kiss_fftr_cfg> m_fftCfgs; // FFT cfg cache
-    QHash<QString, QVector<float> > m_windowFunctions; // Window function cache
+    QHash<int, kiss_fftr_cfg> m_fftCfgs; // FFT cfg cache, by FFT size
+    QHash<int, QVector<float> > m_windowFunctions; // Window function cache, by size and window type
 
 };
 
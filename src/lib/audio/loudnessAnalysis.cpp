@@ -0,0 +1,140 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "loudnessAnalysis.h"
+#include "kdenlivesettings.h"
+
+#include "kdenlive_debug.h"
+#include <QtConcurrent>
+
+#include <mlt++/Mlt.h>
+
+// Audio format requested from the playlist, the K-weighting prototype rate
+static const int analysisFrequency = 48000;
+static const int analysisChannels = 2;
+// Duration of a chunk, in seconds
+static const int chunkDuration = 60;
+// Decoded before each chunk to settle the filters, in seconds
+static const double prerollDuration = 0.5;
+
+LoudnessAnalysis::LoudnessAnalysis(QObject *parent) : QObject(parent)
+    , m_truePeak(0)
+    , m_run(0)
+    , m_chunks(0)
+    , m_finishedChunks(0)
+{
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+    connect(this, &LoudnessAnalysis::chunkFinished, this, &LoudnessAnalysis::slotChunkFinished, Qt::QueuedConnection);
+}
+
+LoudnessAnalysis::~LoudnessAnalysis()
+{
+    m_abort.store(1);
+    m_pool.waitForDone();
+}
+
+bool LoudnessAnalysis::isRunning() const
+{
+    return m_finishedChunks < m_chunks;
+}
+
+void LoudnessAnalysis::abort()
+{
+    m_abort.store(1);
+    m_pool.waitForDone();
+    m_chunks = 0;
+    m_finishedChunks = 0;
+}
+
+void LoudnessAnalysis::start(const QString &scene, int length)
+{
+    abort();
+    m_abort.store(0);
+    m_scene = scene.toUtf8();
+    m_profile = KdenliveSettings::current_profile().toUtf8();
+    m_blocks.clear();
+    m_truePeak = 0;
+    m_run++;
+    Mlt::Profile profile(m_profile.constData());
+    const int chunkLength = qMax(1, (int)(profile.fps() * chunkDuration));
+    m_chunks = (length + chunkLength - 1) / chunkLength;
+    m_finishedChunks = 0;
+    for (int i = 0; i < m_chunks; ++i) {
+        QtConcurrent::run(&m_pool, this, &LoudnessAnalysis::analyseChunk, m_run, i * chunkLength, qMin(length, (i + 1) * chunkLength));
+    }
+}
+
+void LoudnessAnalysis::analyseChunk(int run, int start, int end)
+{
+    if (m_abort.load()) {
+        emit chunkFinished(run);
+        return;
+    }
+    // Each worker needs its own profile and playlist
+    Mlt::Profile profile(m_profile.constData());
+    Mlt::Producer producer(profile, "xml-string", m_scene.constData());
+    if (!producer.is_valid()) {
+        qCDebug(KDENLIVE_LOG) << "Cannot load playlist for loudness analysis";
+        emit chunkFinished(run);
+        return;
+    }
+    const double fps = profile.fps();
+    const int preroll = qMin(start, (int)(fps * prerollDuration));
+    LoudnessMeter meter(analysisFrequency, analysisChannels);
+    producer.seek(start - preroll);
+    producer.set_speed(1.0);
+    for (int pos = start - preroll; pos < end; ++pos) {
+        if (m_abort.load()) {
+            break;
+        }
+        QScopedPointer<Mlt::Frame> frame(producer.get_frame());
+        if (!frame || !frame->is_valid()) {
+            break;
+        }
+        // Only fetch audio, so that no image is rendered
+        mlt_audio_format format = mlt_audio_s16;
+        int frequency = analysisFrequency;
+        int channels = analysisChannels;
+        int samples = mlt_sample_calculator(fps, frequency, pos);
+        const qint16 *data = static_cast<qint16 *>(frame->get_audio(format, frequency, channels, samples));
+        if (data && samples > 0 && channels == analysisChannels) {
+            meter.process(data, samples, mlt_sample_calculator_to_now(fps, frequency, pos), pos >= start);
+        }
+    }
+    m_mutex.lock();
+    meter.addBlocks(m_blocks);
+    m_truePeak = qMax(m_truePeak, meter.truePeak());
+    m_mutex.unlock();
+    emit chunkFinished(run);
+}
+
+void LoudnessAnalysis::slotChunkFinished(int run)
+{
+    if (run != m_run || m_chunks == 0) {
+        // Chunk of an aborted analysis
+        return;
+    }
+    m_finishedChunks++;
+    emit progress(100 * m_finishedChunks / m_chunks);
+    if (m_finishedChunks < m_chunks || m_abort.load()) {
+        return;
+    }
+    LoudnessMeter meter(analysisFrequency, analysisChannels);
+    emit finished(meter.result(m_blocks, m_truePeak));
+}
@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef LOUDNESSANALYSIS_H
+#define LOUDNESSANALYSIS_H
+
+#include "loudnessMeter.h"
+
+#include <QObject>
+#include <QMutex>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+/**
+ * @class LoudnessAnalysis
+ * @brief Offline EBU R128 loudness analysis of an MLT playlist.
+ * The playlist is split in chunks that are analysed in parallel, each worker loading its
+ * own copy of the playlist and only requesting audio from the frames, so that no video is
+ * rendered. Each chunk starts decoding a little earlier so that the K-weighting filters
+ * are settled when reaching the chunk, and the 100ms block energies of all chunks are
+ * merged before computing the program loudness.
+ */
+
+class LoudnessAnalysis : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoudnessAnalysis(QObject *parent = nullptr);
+    virtual ~LoudnessAnalysis();
+    /** @brief Start analysing a playlist.
+     *  @param scene the MLT xml playlist
+     *  @param length the number of frames to analyse */
+    void start(const QString &scene, int length);
+    /** @brief Stop the analysis, finished() will not be emitted. */
+    void abort();
+    bool isRunning() const;
+
+private:
+    QThreadPool m_pool;
+    QByteArray m_scene;
+    QByteArray m_profile;
+    QMutex m_mutex;
+    QAtomicInt m_abort;
+    /** @brief Merged block energies of the analysed chunks. */
+    QVector<double> m_blocks;
+    double m_truePeak;
+    /** @brief Incremented on each start, so that chunks of an aborted analysis are ignored. */
+    int m_run;
+    int m_chunks;
+    int m_finishedChunks;
+    /** @brief Analyse the frames of a chunk, in a worker thread. */
+    void analyseChunk(int run, int start, int end);
+
+private slots:
+    void slotChunkFinished(int run);
+
+signals:
+    void chunkFinished(int run);
+    void progress(int percent);
+    void finished(const LoudnessMeter::Result &result);
+};
+
+#endif
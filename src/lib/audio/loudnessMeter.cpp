@@ -0,0 +1,230 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "loudnessMeter.h"
+#include "monitor/scopes/audiolevels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Absolute gate of ITU-R BS.1770, also used as the lowest displayed loudness
+const double LoudnessMeter::silence = -70.0;
+
+// Number of samples kept between calls, the true peak filter length minus one
+static const int historySamples = 11;
+
+LoudnessMeter::LoudnessMeter(int frequency, int channels) :
+    m_channels(channels),
+    m_blockSamples(frequency / 10),
+    m_state(channels * 8, 0.0),
+    m_history(historySamples * channels, 0),
+    m_weights(channels, 1.0),
+    m_firstBlock(-1),
+    m_truePeak(0)
+{
+    // K-weighting filters for any sample rate, from the 48kHz prototypes of BS.1770
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / frequency);
+    const double vh = pow(10.0, gain / 20.0);
+    const double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    m_shelving.b0 = (vh + vb * k / q + k * k) / a0;
+    m_shelving.b1 = 2.0 * (k * k - vh) / a0;
+    m_shelving.b2 = (vh - vb * k / q + k * k) / a0;
+    m_shelving.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_shelving.a2 = (1.0 - k / q + k * k) / a0;
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / frequency);
+    a0 = 1.0 + k / q + k * k;
+    m_highPass.b0 = 1.0;
+    m_highPass.b1 = -2.0;
+    m_highPass.b2 = 1.0;
+    m_highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_highPass.a2 = (1.0 - k / q + k * k) / a0;
+    if (channels == 6) {
+        // 5.1 layout: LFE is ignored and surround channels are weighted
+        m_weights[3] = 0.0;
+        m_weights[4] = 1.41;
+        m_weights[5] = 1.41;
+    }
+}
+
+int LoudnessMeter::blockSamples() const
+{
+    return m_blockSamples;
+}
+
+void LoudnessMeter::process(const qint16 *samples, int sampleCount, qint64 position, bool accumulate)
+{
+    if (sampleCount <= 0) {
+        return;
+    }
+    if (accumulate && m_firstBlock < 0) {
+        m_firstBlock = position / m_blockSamples;
+    }
+    double *state = m_state.data();
+    for (int i = 0; i < sampleCount; ++i) {
+        double energy = 0;
+        for (int c = 0; c < m_channels; ++c) {
+            double *s = state + c * 8;
+            const double x = samples[i * m_channels + c] / 32768.0;
+            const double y = m_shelving.b0 * x + m_shelving.b1 * s[0] + m_shelving.b2 * s[1] - m_shelving.a1 * s[2] - m_shelving.a2 * s[3];
+            s[1] = s[0];
+            s[0] = x;
+            s[3] = s[2];
+            s[2] = y;
+            const double z = m_highPass.b0 * y + m_highPass.b1 * s[4] + m_highPass.b2 * s[5] - m_highPass.a1 * s[6] - m_highPass.a2 * s[7];
+            s[5] = s[4];
+            s[4] = y;
+            s[7] = s[6];
+            s[6] = z;
+            energy += m_weights.at(c) * z * z;
+        }
+        if (accumulate) {
+            const int index = (position + i) / m_blockSamples - m_firstBlock;
+            if (index >= m_blocks.size()) {
+                m_blocks.resize(index + 1);
+            }
+            m_blocks[index] += energy;
+        }
+    }
+    // Detect intersample peaks, including the ones between the previous call's last samples and ours
+    const int historySize = historySamples * m_channels;
+    QVector<qint16> buffer(historySize + sampleCount * m_channels);
+    memcpy(buffer.data(), m_history.constData(), historySize * sizeof(qint16));
+    memcpy(buffer.data() + historySize, samples, sampleCount * m_channels * sizeof(qint16));
+    if (accumulate) {
+        QVector<double> peaks(m_channels);
+        AudioLevels::truePeak(buffer.constData(), historySamples + sampleCount, m_channels, m_channels, peaks.data());
+        for (int c = 0; c < m_channels; ++c) {
+            if (m_weights.at(c) > 0) {
+                m_truePeak = qMax(m_truePeak, peaks.at(c));
+            }
+        }
+    }
+    memcpy(m_history.data(), buffer.constData() + sampleCount * m_channels, historySize * sizeof(qint16));
+}
+
+void LoudnessMeter::addBlocks(QVector<double> &blocks) const
+{
+    if (m_firstBlock < 0) {
+        return;
+    }
+    if (blocks.size() < m_firstBlock + m_blocks.size()) {
+        blocks.resize(m_firstBlock + m_blocks.size());
+    }
+    for (int i = 0; i < m_blocks.size(); ++i) {
+        blocks[m_firstBlock + i] += m_blocks.at(i);
+    }
+}
+
+double LoudnessMeter::truePeak() const
+{
+    return m_truePeak;
+}
+
+// static
+double LoudnessMeter::loudness(double power)
+{
+    if (power <= 0) {
+        return silence;
+    }
+    return qMax(silence, -0.691 + 10.0 * log10(power));
+}
+
+LoudnessMeter::Result LoudnessMeter::result(const QVector<double> &blocks, double peak) const
+{
+    Result result;
+    const int count = blocks.size();
+    // Integrated loudness on 400ms gating blocks overlapping by 75%
+    QVector<double> powers;
+    double sum = 0;
+    for (int i = 3; i < count; ++i) {
+        const double power = (blocks.at(i - 3) + blocks.at(i - 2) + blocks.at(i - 1) + blocks.at(i)) / (4.0 * m_blockSamples);
+        if (loudness(power) > silence) {
+            powers << power;
+            sum += power;
+        }
+    }
+    result.integrated = silence;
+    if (!powers.isEmpty()) {
+        const double relativeGate = loudness(sum / powers.count()) - 10.0;
+        sum = 0;
+        int gated = 0;
+        for (double power : powers) {
+            if (loudness(power) > relativeGate) {
+                sum += power;
+                gated++;
+            }
+        }
+        if (gated > 0) {
+            result.integrated = loudness(sum / gated);
+        }
+    }
+    // Loudness range (EBU Tech 3342) on 3s short term loudness values
+    QVector<double> shortTerm;
+    sum = 0;
+    double window = 0;
+    for (int i = 0; i < count; ++i) {
+        window += blocks.at(i);
+        if (i >= 30) {
+            window -= blocks.at(i - 30);
+        }
+        if (i < 29) {
+            continue;
+        }
+        const double power = window / (30.0 * m_blockSamples);
+        if (loudness(power) > silence) {
+            shortTerm << power;
+            sum += power;
+        }
+    }
+    result.range = 0;
+    if (!shortTerm.isEmpty()) {
+        const double relativeGate = loudness(sum / shortTerm.count()) - 20.0;
+        QVector<double> values;
+        for (double power : shortTerm) {
+            const double value = loudness(power);
+            if (value > relativeGate) {
+                values << value;
+            }
+        }
+        if (!values.isEmpty()) {
+            std::sort(values.begin(), values.end());
+            const int last = values.count() - 1;
+            result.range = values.at(qRound(last * 0.95)) - values.at(qRound(last * 0.1));
+        }
+    }
+    result.truePeak = peak > 0 ? 20.0 * log10(peak) : silence;
+    // One loudness value per second for display
+    const int blocksPerSecond = 10;
+    for (int i = 0; i < count; i += blocksPerSecond) {
+        const int end = qMin(count, i + blocksPerSecond);
+        double power = 0;
+        for (int j = i; j < end; ++j) {
+            power += blocks.at(j);
+        }
+        result.curve << loudness(power / ((end - i) * m_blockSamples));
+    }
+    return result;
+}
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <QVector>
+
+/**
+ * @class LoudnessMeter
+ * @brief EBU R128 / ITU-R BS.1770 loudness measurement.
+ * Samples are K-weighted and their energy is accumulated in 100ms blocks, indexed from
+ * the start of the program. Several meters can process consecutive parts of a program
+ * in parallel: their blocks are merged with addBlocks() and the program loudness values
+ * are computed from the merged blocks.
+ */
+
+class LoudnessMeter
+{
+public:
+    /** @brief Loudness values of a program, loudness in LUFS, range in LU and peak in dBTP. */
+    struct Result {
+        double integrated;
+        double range;
+        double truePeak;
+        /** @brief Loudness of each second of the program. */
+        QVector<double> curve;
+    };
+
+    /** @brief Loudness value used for silence. */
+    static const double silence;
+
+    LoudnessMeter(int frequency, int channels);
+    /** @brief Number of samples in a 100ms block. */
+    int blockSamples() const;
+    /** @brief Process interleaved audio samples.
+     *  @param position the program sample position of the first sample
+     *  @param accumulate if false, the samples only prime the filters (used before a chunk start) */
+    void process(const qint16 *samples, int sampleCount, qint64 position, bool accumulate = true);
+    /** @brief Add our block energies to a program's blocks, resizing it if necessary. */
+    void addBlocks(QVector<double> &blocks) const;
+    /** @brief Highest true peak seen in accumulated samples, linear. */
+    double truePeak() const;
+    /** @brief Compute the program loudness values.
+     *  @param blocks the merged block energies of the whole program
+     *  @param peak the highest true peak of the program, linear */
+    Result result(const QVector<double> &blocks, double peak) const;
+
+private:
+    /** @brief Biquad filter coefficients, a0 being normalized to 1. */
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+    int m_channels;
+    int m_blockSamples;
+    Biquad m_shelving;
+    Biquad m_highPass;
+    /** @brief Filter state, 4 values per channel and filter. */
+    QVector<double> m_state;
+    /** @brief Last input samples, kept to detect intersample peaks across calls. */
+    QVector<qint16> m_history;
+    QVector<double> m_weights;
+    /** @brief Index of the first block in m_blocks. */
+    qint64 m_firstBlock;
+    QVector<double> m_blocks;
+    double m_truePeak;
+    /** @brief Loudness of a mean square energy. */
+    static double loudness(double power);
+};
+
+#endif
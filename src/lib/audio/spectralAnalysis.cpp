@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "spectralAnalysis.h"
+
+class SpectralAnalysisCreator
+{
+public:
+    SpectralAnalysis object;
+};
+
+Q_GLOBAL_STATIC(SpectralAnalysisCreator, creator)
+
+SpectralAnalysis::SpectralAnalysis() :
+    m_block(-1)
+{
+}
+
+// static
+SpectralAnalysis *SpectralAnalysis::shared()
+{
+    return &creator->object;
+}
+
+QVector<float> SpectralAnalysis::spectrum(int block, const audioShortVector &audioFrame, uint channel, uint numChannels,
+                                          FFTTools::WindowType windowType, uint windowSize)
+{
+    QMutexLocker lock(&m_mutex);
+    if (block != m_block) {
+        // New audio, previous spectra are not needed anymore
+        m_spectra.clear();
+        m_block = block;
+    }
+    const int key = ((windowSize * 4 + windowType) << 4) + channel;
+    QHash<int, QVector<float> >::const_iterator it = m_spectra.constFind(key);
+    if (it != m_spectra.constEnd()) {
+        return it.value();
+    }
+    QVector<float> result(windowSize / 2);
+    m_fftTools.fftNormalized(audioFrame, channel, numChannels, result.data(), windowType, windowSize);
+    m_spectra.insert(key, result);
+    return result;
+}
+
+void SpectralAnalysis::fftNormalized(const audioShortVector &audioFrame, uint channel, uint numChannels, float *freqSpectrum,
+                                     FFTTools::WindowType windowType, uint windowSize)
+{
+    QMutexLocker lock(&m_mutex);
+    m_fftTools.fftNormalized(audioFrame, channel, numChannels, freqSpectrum, windowType, windowSize);
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SPECTRALANALYSIS_H
+#define SPECTRALANALYSIS_H
+
+#include "fftTools.h"
+
+#include <QMutex>
+
+/**
+ * @class SpectralAnalysis
+ * @brief Spectral analysis stage shared by the audio scopes.
+ * Audio scopes receive the same audio blocks and often display the same windowed FFT.
+ * The spectrum of a block is computed once for each window size and function, and
+ * returned to all scopes asking for it. FFT configurations and window functions are
+ * cached for all scopes as well. Scopes render in worker threads, so access is serialized.
+ */
+
+class SpectralAnalysis
+{
+public:
+    /** @brief The instance shared by all audio scopes. */
+    static SpectralAnalysis *shared();
+    /** @brief Returns the normalized spectrum of an audio block, see FFTTools::fftNormalized().
+     *  @param block identifies the audio block, a block number must always come with the same samples
+     *  @return windowSize / 2 dB values */
+    QVector<float> spectrum(int block, const audioShortVector &audioFrame, uint channel, uint numChannels,
+                            FFTTools::WindowType windowType, uint windowSize);
+    /** @brief Compute the normalized spectrum of samples that are not shared with other scopes. */
+    void fftNormalized(const audioShortVector &audioFrame, uint channel, uint numChannels, float *freqSpectrum,
+                       FFTTools::WindowType windowType, uint windowSize);
+
+private:
+    QMutex m_mutex;
+    FFTTools m_fftTools;
+    /** @brief The block whose spectra are currently cached. */
+    int m_block;
+    QHash<int, QVector<float> > m_spectra;
+    SpectralAnalysis();
+    friend class SpectralAnalysisCreator;
+};
+
+#endif
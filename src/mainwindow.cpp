@@ -29,8 +29,11 @@
 #include "dialogs/kdenlivesettingsdialog.h"
 #include "dialogs/clipcreationdialog.h"
 #include "effectslist/initeffects.h"
+#include "effectslist/effectscache.h"
 #include "project/dialogs/projectsettings.h"
 #include "project/clipmanager.h"
+#include "doc/cacheaccounting.h"
+#include "doc/thumbnailstore.h"
 #include "monitor/monitor.h"
 #include "monitor/recmonitor.h"
 #include "monitor/monitormanager.h"
@@ -581,6 +584,11 @@ void MainWindow::init(const QString &MltPath, const QUrl &Url, const QString &cl
     autoRender->setChecked(KdenliveSettings::autopreview());
     connect(autoRender, &QAction::triggered, this, &MainWindow::slotToggleAutoPreview);
     tlMenu->addAction(autoRender);
+    QAction *heavyRender = new QAction(i18n("Preview Heavy Regions When Idle"), this);
+    heavyRender->setCheckable(true);
+    heavyRender->setChecked(KdenliveSettings::autopreviewheavy());
+    connect(heavyRender, &QAction::triggered, this, &MainWindow::slotToggleHeavyPreview);
+    tlMenu->addAction(heavyRender);
     tlMenu->addSeparator();
     tlMenu->addAction(actionCollection()->action(QStringLiteral("disable_preview")));
     tlMenu->addAction(actionCollection()->action(QStringLiteral("manage_cache")));
@@ -875,6 +883,8 @@ void MainWindow::saveNewToolbarConfig()
 
 void MainWindow::slotReloadEffects()
 {
+    // A custom effect was saved or deleted, the cached catalogue is outdated
+    EffectsCache::invalidate();
     initEffects::parseCustomEffectsFile();
     m_effectList->reloadEffectList(m_effectsMenu, m_effectActions);
 }
@@ -1372,6 +1382,7 @@ void MainWindow::setupActions()
     addAction(QStringLiteral("clear_render_timeline_zone"), i18n("Remove All Preview Zones"), this, SLOT(slotClearPreviewRender()), KoIconUtils::themedIcon(QStringLiteral("preview-remove-all")));
     addAction(QStringLiteral("prerender_timeline_zone"), i18n("Start Preview Render"), this, SLOT(slotPreviewRender()), KoIconUtils::themedIcon(QStringLiteral("preview-render-on")), QKeySequence(Qt::SHIFT + Qt::Key_Return));
     addAction(QStringLiteral("stop_prerender_timeline"), i18n("Stop Preview Render"), this, SLOT(slotStopPreviewRender()), KoIconUtils::themedIcon(QStringLiteral("preview-render-off")));
+    addAction(QStringLiteral("analyse_timeline_loudness"), i18n("Analyse Timeline Loudness"), this, SLOT(slotAnalyseLoudness()), KoIconUtils::themedIcon(QStringLiteral("audio-volume-high")));
 
     addAction(QStringLiteral("select_timeline_clip"), i18n("Select Clip"), this, SLOT(slotSelectTimelineClip()), KoIconUtils::themedIcon(QStringLiteral("edit-select")), Qt::Key_Plus);
     addAction(QStringLiteral("deselect_timeline_clip"), i18n("Deselect Clip"), this, SLOT(slotDeselectTimelineClip()), KoIconUtils::themedIcon(QStringLiteral("edit-select")), Qt::Key_Minus);
@@ -2003,6 +2014,7 @@ void MainWindow::connectDocument()
     // Effect stack signals
     connect(m_effectStack, &EffectStackView2::updateEffect, trackView->projectView(), &CustomTrackView::slotUpdateClipEffect);
     connect(m_effectStack, &EffectStackView2::updateClipRegion, trackView->projectView(), &CustomTrackView::slotUpdateClipRegion);
+    connect(m_effectStack, &EffectStackView2::profileClipEffects, trackView->projectView(), &CustomTrackView::slotProfileClipEffects);
     connect(m_effectStack, SIGNAL(removeEffect(ClipItem *, int, QDomElement)), trackView->projectView(), SLOT(slotDeleteEffect(ClipItem *, int, QDomElement)));
     connect(m_effectStack, SIGNAL(removeEffectGroup(ClipItem *, int, QDomDocument)), trackView->projectView(), SLOT(slotDeleteEffectGroup(ClipItem *, int, QDomDocument)));
 
@@ -2178,6 +2190,10 @@ void MainWindow::updateConfiguration()
     m_buttonShowMarkers->setChecked(KdenliveSettings::showmarkers());
     slotSwitchSplitAudio(KdenliveSettings::splitaudio());
     slotSwitchAutomaticTransition();
+    if (pCore->projectManager()->current()) {
+        pCore->projectManager()->current()->clipManager()->cacheAccounting->updateQuotas();
+        pCore->projectManager()->current()->clipManager()->thumbnailStore->updateLimits();
+    }
 
     // Update list of transcoding profiles
     buildDynamicActions();
@@ -2288,7 +2304,7 @@ void MainWindow::slotAddClipMarker()
         pCore->bin()->slotAddClipMarker(id, QList<CommentedTime>() << d->newMarker());
         QString hash = clip->getClipHash();
         if (!hash.isEmpty()) {
-            project->cacheImage(hash + QLatin1Char('#') + QString::number(d->newMarker().time().frames(project->fps())), d->markerImage());
+            project->cacheImage(hash, (int) d->newMarker().time().frames(project->fps()), d->markerImage());
         }
     }
     delete d;
@@ -2382,7 +2398,7 @@ void MainWindow::slotEditClipMarker()
         pCore->bin()->slotAddClipMarker(id, QList<CommentedTime>() << d->newMarker());
         QString hash = clip->getClipHash();
         if (!hash.isEmpty()) {
-            pCore->projectManager()->current()->cacheImage(hash + QLatin1Char('#') + QString::number(d->newMarker().time().frames(pCore->projectManager()->current()->fps())), d->markerImage());
+            pCore->projectManager()->current()->cacheImage(hash, (int) d->newMarker().time().frames(pCore->projectManager()->current()->fps()), d->markerImage());
         }
         if (d->newMarker().time() != pos) {
             // remove old marker
@@ -2578,6 +2594,13 @@ void MainWindow::slotStopPreviewRender()
     }
 }
 
+void MainWindow::slotAnalyseLoudness()
+{
+    if (pCore->projectManager()->current()) {
+        pCore->projectManager()->currentTimeline()->analyseLoudness();
+    }
+}
+
 void MainWindow::slotDefinePreviewRender()
 {
     if (pCore->projectManager()->current()) {
@@ -3763,6 +3786,8 @@ void MainWindow::slotArchiveProject()
     QList<ClipController *> list = pCore->binController()->getControllerList();
     KdenliveDoc *doc = pCore->projectManager()->current();
     pCore->binController()->saveDocumentProperties(pCore->projectManager()->currentTimeline()->documentProperties(), doc->metadata(), pCore->projectManager()->currentTimeline()->projectView()->guidesData());
+    // The archive must not depend on the project cache folder
+    doc->prepareSceneList(true);
     QDomDocument xmlDoc = doc->xmlSceneList(m_projectMonitor->sceneList(doc->url().adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile()));
     QPointer<ArchiveWidget> d = new ArchiveWidget(doc->url().fileName(), xmlDoc, list, pCore->projectManager()->currentTimeline()->projectView()->extractTransitionsLumas(), this);
     if (d->exec()) {
@@ -3939,6 +3964,14 @@ void MainWindow::slotToggleAutoPreview(bool enable)
     }
 }
 
+void MainWindow::slotToggleHeavyPreview(bool enable)
+{
+    KdenliveSettings::setAutopreviewheavy(enable);
+    if (pCore->projectManager()->currentTimeline()) {
+        pCore->projectManager()->currentTimeline()->checkAutoPreview();
+    }
+}
+
 void MainWindow::configureToolbars()
 {
     // Since our timeline toolbar is a non-standard toolbar (as it is docked in a custom widget, not
@@ -329,6 +329,7 @@ private slots:
     void slotLiftZone();
     void slotPreviewRender();
     void slotStopPreviewRender();
+    void slotAnalyseLoudness();
     void slotDefinePreviewRender();
     void slotRemovePreviewRender();
     void slotClearPreviewRender();
@@ -456,6 +457,8 @@ private slots:
     void slotCheckTabPosition();
     /** @brief Toggle automatic timeline preview on/off */
     void slotToggleAutoPreview(bool enable);
+    /** @brief Toggle background preview rendering of timeline regions that cannot play in real time */
+    void slotToggleHeavyPreview(bool enable);
     /** @brief Rebuild/reload timeline toolbar. */
     void rebuildTimlineToolBar();
     void showTimelineToolbarMenu(const QPoint &pos);
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "timeline/markerdialog.h"
 #include "timecodedisplay.h"
 #include "clipcontroller.h"
+#include "doc/analysisstore.h"
 #include "kdenlivesettings.h"
 #include "effectstack/widgets/choosecolorwidget.h"
 #include "dialogs/profilesdialog.h"
@@ -57,7 +58,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QMimeData>
 #include <QTextEdit>
 
-AnalysisTree::AnalysisTree(QWidget *parent) : QTreeWidget(parent)
+AnalysisTree::AnalysisTree(AnalysisStore *store, Mlt::Profile *profile, QWidget *parent) : QTreeWidget(parent)
+    , m_store(store)
+    , m_profile(profile)
 {
     setRootIsDecorated(false);
     setColumnCount(2);
@@ -66,13 +69,22 @@ AnalysisTree::AnalysisTree(QWidget *parent) : QTreeWidget(parent)
     setDragEnabled(true);
 }
 
+QString AnalysisTree::geometry(QTreeWidgetItem *item) const
+{
+    const QString value = item->data(1, Qt::UserRole).toString();
+    if (!AnalysisStore::isReference(value)) {
+        return value;
+    }
+    return AnalysisStore::serialise(m_store->keyframes(value), m_profile->width(), m_profile->height());
+}
+
 //virtual
 QMimeData *AnalysisTree::mimeData(const QList<QTreeWidgetItem *> list) const
 {
     QString data;
     for (QTreeWidgetItem *item : list) {
         if (item->flags() & Qt::ItemIsDragEnabled) {
-            data.append(item->text(1));
+            data.append(geometry(item));
         }
     }
     QMimeData *mime = new QMimeData;
@@ -145,8 +157,9 @@ private:
 };
 #endif
 
-ClipPropertiesController::ClipPropertiesController(const Timecode &tc, ClipController *controller, QWidget *parent) : QWidget(parent)
+ClipPropertiesController::ClipPropertiesController(const Timecode &tc, ClipController *controller, AnalysisStore *analysisStore, QWidget *parent) : QWidget(parent)
     , m_controller(controller)
+    , m_analysisStore(analysisStore)
     , m_tc(tc)
     , m_id(controller->clipId())
     , m_type(controller->clipType())
@@ -215,7 +228,7 @@ ClipPropertiesController::ClipPropertiesController(const Timecode &tc, ClipContr
 
     // Clip analysis
     QVBoxLayout *aBox = new QVBoxLayout;
-    m_analysisTree = new AnalysisTree(this);
+    m_analysisTree = new AnalysisTree(m_analysisStore, m_controller->profile(), this);
     aBox ->addWidget(new QLabel(i18n("Analysis data")));
     aBox ->addWidget(m_analysisTree);
     QToolBar *bar2 = new QToolBar;
@@ -1083,7 +1096,13 @@ void ClipPropertiesController::slotFillAnalysisData()
     subProperties.pass_values(m_properties, "kdenlive:clipanalysis.");
     if (subProperties.count() > 0) {
         for (int i = 0; i < subProperties.count(); i++) {
-            new QTreeWidgetItem(m_analysisTree, QStringList() << subProperties.get_name(i) << subProperties.get(i));
+            const QString value = QString::fromUtf8(subProperties.get(i));
+            QTreeWidgetItem *item = new QTreeWidgetItem(m_analysisTree, QStringList() << subProperties.get_name(i) << value);
+            if (AnalysisStore::isReference(value)) {
+                // Data is in the analysis store, only display a summary, keyframes are read on export or drag
+                item->setText(1, i18np("%1 keyframe", "%1 keyframes", qMax(0, m_analysisStore->count(value))));
+            }
+            item->setData(1, Qt::UserRole, value);
         }
     }
     m_analysisTree->resizeColumnToContents(0);
@@ -1107,7 +1126,7 @@ void ClipPropertiesController::slotSaveAnalysis()
     KSharedConfigPtr config = KSharedConfig::openConfig(url, KConfig::SimpleConfig);
     KConfigGroup analysisConfig(config, "Analysis");
     QTreeWidgetItem *current = m_analysisTree->currentItem();
-    analysisConfig.writeEntry(current->text(0), current->text(1));
+    analysisConfig.writeEntry(current->text(0), m_analysisTree->geometry(current));
 }
 
 void ClipPropertiesController::slotLoadAnalysis()
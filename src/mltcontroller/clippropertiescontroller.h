@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QString>
 
 class ClipController;
+class AnalysisStore;
 class QMimeData;
 class QTextEdit;
 class QLabel;
@@ -36,10 +37,16 @@ class QLabel;
 class AnalysisTree : public QTreeWidget
 {
 public:
-    explicit AnalysisTree(QWidget *parent = nullptr);
+    AnalysisTree(AnalysisStore *store, Mlt::Profile *profile, QWidget *parent = nullptr);
+    /** @brief Returns the analysis data of an item as a geometry string, reading it from the store if needed. */
+    QString geometry(QTreeWidgetItem *item) const;
 
 protected:
     QMimeData *mimeData(const QList<QTreeWidgetItem *> list) const Q_DECL_OVERRIDE;
+
+private:
+    AnalysisStore *m_store;
+    Mlt::Profile *m_profile;
 };
 
 /**
@@ -55,9 +62,10 @@ public:
      * @brief Constructor.
      * @param id The clip's id
      * @param properties The clip's properties
+     * @param analysisStore The store holding the project's analysis data
      * @param parent The widget where our infos will be displayed
      */
-    explicit ClipPropertiesController(const Timecode &tc, ClipController *controller, QWidget *parent);
+    explicit ClipPropertiesController(const Timecode &tc, ClipController *controller, AnalysisStore *analysisStore, QWidget *parent);
     virtual ~ClipPropertiesController();
 
 public slots:
@@ -89,6 +97,7 @@ private slots:
 
 private:
     ClipController *m_controller;
+    AnalysisStore *m_analysisStore;
     QTabWidget *m_tabWidget;
     QLabel *m_clipLabel;
     Timecode m_tc;
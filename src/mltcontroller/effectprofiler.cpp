@@ -0,0 +1,280 @@
+/*
+Copyright (C) 2017  Kdenlive team <kdenlive@kde.org>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "effectprofiler.h"
+#include "timeline/clip.h"
+#include "kdenlivesettings.h"
+
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <QtConcurrent>
+
+#include <mlt++/Mlt.h>
+
+// Number of consecutive frames processed to measure the effects
+static const int processSamples = 12;
+
+static int probe_get_image(mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable)
+{
+    mlt_properties probe = (mlt_properties) mlt_frame_pop_service(frame);
+    QElapsedTimer timer;
+    timer.start();
+    int error = mlt_frame_get_image(frame, image, format, width, height, writable);
+    mlt_properties_set_int64(probe, "_elapsed", mlt_properties_get_int64(probe, "_elapsed") + timer.nsecsElapsed());
+    return error;
+}
+
+static int probe_get_audio(mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples)
+{
+    mlt_properties probe = (mlt_properties) mlt_frame_pop_audio(frame);
+    QElapsedTimer timer;
+    timer.start();
+    int error = mlt_frame_get_audio(frame, buffer, format, frequency, channels, samples);
+    mlt_properties_set_int64(probe, "_elapsed", mlt_properties_get_int64(probe, "_elapsed") + timer.nsecsElapsed());
+    return error;
+}
+
+static mlt_frame probe_process(mlt_filter filter, mlt_frame frame)
+{
+    mlt_properties properties = MLT_FILTER_PROPERTIES(filter);
+    mlt_frame_push_service(frame, properties);
+    mlt_frame_push_get_image(frame, probe_get_image);
+    mlt_frame_push_audio(frame, properties);
+    mlt_frame_push_audio(frame, (void *) probe_get_audio);
+    return frame;
+}
+
+// A filter measuring the time spent processing the frame up to its position in the filter chain
+static Mlt::Filter *createProbe()
+{
+    mlt_filter filter = mlt_filter_new();
+    if (!filter) {
+        return nullptr;
+    }
+    filter->process = probe_process;
+    Mlt::Filter *probe = new Mlt::Filter(filter);
+    mlt_filter_close(filter);
+    return probe;
+}
+
+class EffectProfilerCreator
+{
+public:
+    EffectProfiler object;
+};
+
+Q_GLOBAL_STATIC(EffectProfilerCreator, creator)
+
+EffectProfiler::EffectProfiler(QObject *parent) : QObject(parent)
+    , m_abort(0)
+{
+}
+
+EffectProfiler::~EffectProfiler()
+{
+    clear();
+}
+
+// static
+EffectProfiler *EffectProfiler::shared()
+{
+    return &creator->object;
+}
+
+void EffectProfiler::profile(const QString &key, Mlt::Producer &producer)
+{
+    if (!producer.is_valid() || KdenliveSettings::gpu_accel()) {
+        return;
+    }
+    // Producers are prepared here, cloning them in the worker thread is not safe
+    Clip source(producer.parent());
+    Mlt::Producer *clone = source.clone();
+    if (!clone->is_valid()) {
+        delete clone;
+        return;
+    }
+    Clip(*clone).deleteEffects();
+    ProfileTask task;
+    task.key = key;
+    task.producer = clone->cut(producer.get_in(), producer.get_out());
+    delete clone;
+    Mlt::Filter *probe = createProbe();
+    if (!probe) {
+        delete task.producer;
+        return;
+    }
+    task.producer->attach(*probe);
+    task.probes << Probe{-1, probe};
+    for (int ix = 0; ix < producer.filter_count(); ++ix) {
+        QScopedPointer<Mlt::Filter> effect(producer.filter(ix));
+        // Only measure enabled Kdenlive effects
+        if (!effect->is_valid() || QString::fromLatin1(effect->get("kdenlive_ix")).isEmpty() || effect->get_int("disable") == 1) {
+            continue;
+        }
+        Mlt::Filter copy(*effect->profile(), effect->get("mlt_service"));
+        if (!copy.is_valid()) {
+            continue;
+        }
+        for (int i = 0; i < effect->count(); ++i) {
+            const char *name = effect->get_name(i);
+            if (name && name[0] != '_') {
+                copy.set(name, effect->get(i));
+            }
+        }
+        task.producer->attach(copy);
+        probe = createProbe();
+        if (!probe) {
+            break;
+        }
+        task.producer->attach(*probe);
+        task.probes << Probe{effect->get_int("kdenlive_ix"), probe};
+    }
+    QMutexLocker lock(&m_mutex);
+    // Only keep the latest request for a clip
+    for (int i = m_queue.count() - 1; i >= 0; --i) {
+        if (m_queue.at(i).key == key) {
+            deleteTask(m_queue.takeAt(i));
+        }
+    }
+    m_queue << task;
+    if (!m_worker.isRunning()) {
+        m_abort.store(0);
+        m_worker = QtConcurrent::run(this, &EffectProfiler::processQueue);
+    }
+}
+
+EffectCost EffectProfiler::cost(const QString &key) const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_results.value(key);
+}
+
+void EffectProfiler::forget(const QString &key)
+{
+    QMutexLocker lock(&m_mutex);
+    m_results.remove(key);
+}
+
+void EffectProfiler::clear()
+{
+    m_mutex.lock();
+    m_abort.store(1);
+    for (const ProfileTask &task : m_queue) {
+        deleteTask(task);
+    }
+    m_queue.clear();
+    m_mutex.unlock();
+    m_worker.waitForFinished();
+    QMutexLocker lock(&m_mutex);
+    m_results.clear();
+}
+
+// static
+void EffectProfiler::deleteTask(const ProfileTask &task)
+{
+    for (const Probe &probe : task.probes) {
+        delete probe.filter;
+    }
+    delete task.producer;
+}
+
+void EffectProfiler::processQueue()
+{
+    while (true) {
+        m_mutex.lock();
+        if (m_abort.load() != 0 || m_queue.isEmpty()) {
+            m_mutex.unlock();
+            return;
+        }
+        ProfileTask task = m_queue.takeFirst();
+        m_mutex.unlock();
+        EffectCost cost = measure(task);
+        deleteTask(task);
+        m_mutex.lock();
+        if (m_abort.load() != 0) {
+            m_mutex.unlock();
+            return;
+        }
+        m_results.insert(task.key, cost);
+        m_mutex.unlock();
+        emit costReady(task.key);
+    }
+}
+
+EffectCost EffectProfiler::measure(const ProfileTask &task)
+{
+    EffectCost cost;
+    Mlt::Producer *producer = task.producer;
+    const int length = producer->get_playtime();
+    const double fps = producer->get_fps();
+    if (length <= 0 || fps <= 0) {
+        return cost;
+    }
+    cost.frameDuration = 1000.0 / fps;
+    const int width = producer->profile()->width();
+    const int height = producer->profile()->height();
+    // Process frames from the middle of the clip, the first one absorbs the seek
+    const int start = qMax(0, (length - processSamples) / 2);
+    const int count = qMin(processSamples, length - start);
+    producer->seek(start);
+    int processed = 0;
+    for (int i = 0; i < count && m_abort.load() == 0; ++i) {
+        if (i == 1) {
+            for (const Probe &probe : task.probes) {
+                probe.filter->set("_elapsed", (int64_t) 0);
+            }
+        }
+        Mlt::Frame *frame = producer->get_frame();
+        if (!frame || !frame->is_valid()) {
+            delete frame;
+            break;
+        }
+        mlt_image_format format = mlt_image_yuv422;
+        int w = width;
+        int h = height;
+        frame->set("rescale.interp", KdenliveSettings::mltinterpolation().toUtf8().constData());
+        frame->get_image(format, w, h);
+        mlt_audio_format audioFormat = mlt_audio_s16;
+        int frequency = 48000;
+        int channels = 2;
+        int samples = mlt_sample_calculator(fps, frequency, start + i);
+        frame->get_audio(audioFormat, frequency, channels, samples);
+        delete frame;
+        if (i > 0) {
+            processed++;
+        }
+    }
+    if (processed == 0 || m_abort.load() != 0) {
+        return cost;
+    }
+    // Each probe measured the source and all effects before it
+    double previous = 0;
+    for (const Probe &probe : task.probes) {
+        const double elapsed = probe.filter->get_int64("_elapsed") / 1000000.0 / processed;
+        if (probe.index == -1) {
+            cost.sourceTime = elapsed;
+        } else {
+            cost.effects.insert(probe.index, qMax(0.0, elapsed - previous));
+        }
+        previous = elapsed;
+    }
+    return cost;
+}
@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2017  Kdenlive team <kdenlive@kde.org>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EFFECTPROFILER_H
+#define EFFECTPROFILER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QFuture>
+
+namespace Mlt
+{
+class Filter;
+class Producer;
+}
+
+/** @brief Processing cost of a clip's effect stack, as measured by EffectProfiler. */
+struct EffectCost {
+    EffectCost() : sourceTime(-1), frameDuration(0) {}
+    /** @brief Average time to produce a source frame, before effects (ms). */
+    double sourceTime;
+    /** @brief Average time spent in each effect for a frame (ms), by kdenlive_ix. */
+    QMap<int, double> effects;
+    /** @brief Duration of a frame (ms). */
+    double frameDuration;
+    bool isValid() const
+    {
+        return sourceTime >= 0;
+    }
+    /** @brief Time spent in all effects for a frame (ms). */
+    double effectsTime() const
+    {
+        double total = 0;
+        for (double time : effects) {
+            total += time;
+        }
+        return total;
+    }
+    /** @brief Time to produce a frame relative to the frame duration, above 1 the clip cannot play in real time. */
+    double load() const
+    {
+        return frameDuration > 0 ? (sourceTime + effectsTime()) / frameDuration : 0;
+    }
+};
+
+/**
+ * @class EffectProfiler
+ * @brief Measures the time spent in each effect of a clip.
+ * MLT does not report filter timings, so a copy of the clip is built with a small probe
+ * filter after the source and after each of its effects. Filters push their image and audio
+ * processing on the frame's stack, so each probe measures everything processed below it,
+ * and the cost of an effect is the difference between the probes surrounding it.
+ * A run of consecutive frames is processed in a background thread, and results are kept
+ * by key (bin clip id or timeline item) until the clip is profiled again.
+ */
+
+class EffectProfiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EffectProfiler(QObject *parent = nullptr);
+    virtual ~EffectProfiler();
+    /** @brief The instance shared by the effect stack, timeline and preview manager. */
+    static EffectProfiler *shared();
+    /** @brief Queue a clip for profiling. Must be called from the main thread.
+     *  @param key the key of the results
+     *  @param producer the bin clip producer or timeline cut carrying the effects */
+    void profile(const QString &key, Mlt::Producer &producer);
+    /** @brief Returns the last measure for a key, invalid if the clip was never profiled. */
+    EffectCost cost(const QString &key) const;
+    /** @brief Forget the measure for a key, for example when the clip was removed. */
+    void forget(const QString &key);
+    /** @brief Stop profiling, drop queued clips and results. */
+    void clear();
+
+private:
+    struct Probe {
+        int index;
+        Mlt::Filter *filter;
+    };
+    struct ProfileTask {
+        QString key;
+        Mlt::Producer *producer;
+        /** @brief The probe measuring the source, then one per effect. */
+        QList<Probe> probes;
+    };
+    QList<ProfileTask> m_queue;
+    QHash<QString, EffectCost> m_results;
+    mutable QMutex m_mutex;
+    QFuture<void> m_worker;
+    /** @brief Set from the main thread to stop the worker, read while measuring. */
+    QAtomicInt m_abort;
+    void processQueue();
+    /** @brief Process consecutive frames of a task and compute the cost of each effect. */
+    EffectCost measure(const ProfileTask &task);
+    static void deleteTask(const ProfileTask &task);
+
+signals:
+    /** @brief A clip was measured, result can be fetched with cost. */
+    void costReady(const QString &key);
+};
+
+#endif
@@ -0,0 +1,236 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "framecache.h"
+#include "kdenlivesettings.h"
+
+#include "kdenlive_debug.h"
+#include <QtConcurrent>
+
+#include <mlt++/Mlt.h>
+
+// Number of consecutive frames decoded after a single seek, roughly one GOP
+static const int decodeBlockSize = 25;
+
+FrameCache::FrameCache(Mlt::Profile *profile, QObject *parent) : QObject(parent)
+    , m_profile(profile)
+    , m_producer(nullptr)
+    , m_abort(false)
+    , m_running(false)
+    , m_playhead(0)
+    , m_speed(0)
+    , m_length(0)
+    , m_maxFrames(0)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+FrameCache::~FrameCache()
+{
+    stopWorker();
+    delete m_producer;
+}
+
+void FrameCache::stopWorker()
+{
+    m_mutex.lock();
+    m_abort = true;
+    m_mutex.unlock();
+    m_worker.waitForFinished();
+    m_mutex.lock();
+    m_abort = false;
+    m_mutex.unlock();
+}
+
+void FrameCache::clear()
+{
+    stopWorker();
+    QMutexLocker lock(&m_mutex);
+    m_frames.clear();
+}
+
+void FrameCache::setProducer(Mlt::Producer *producer)
+{
+    stopWorker();
+    QMutexLocker lock(&m_mutex);
+    m_frames.clear();
+    delete m_producer;
+    m_producer = nullptr;
+    m_length = 0;
+    if (!producer || !producer->is_valid() || KdenliveSettings::gpu_accel()) {
+        return;
+    }
+    // Only long GOP video files benefit from the cache
+    const QString service = QString::fromUtf8(producer->parent().get("mlt_service"));
+    if (!service.startsWith(QLatin1String("avformat")) || producer->parent().get_int("video_index") < 0) {
+        return;
+    }
+    // Use our own producer so that decoding does not interfere with the monitor's one. Created through the loader, it gets the normalizing filters.
+    m_producer = new Mlt::Producer(*m_profile, producer->parent().get("resource"));
+    if (!m_producer->is_valid()) {
+        delete m_producer;
+        m_producer = nullptr;
+        return;
+    }
+    const char *passProperties[] = {"video_index", "force_aspect_ratio", "force_fps", "force_progressive", "force_tff", "force_colorspace", "full_luma", "autorotate", "length", "out"};
+    for (const char *name : passProperties) {
+        if (producer->parent().get(name)) {
+            m_producer->set(name, producer->parent().get(name));
+        }
+    }
+    // We only need video
+    m_producer->set("audio_index", -1);
+    m_length = m_producer->get_length();
+    const int frameSize = m_profile->width() * m_profile->height() * 3 / 2;
+    m_maxFrames = qMax(decodeBlockSize * 2, (int)((qint64) KdenliveSettings::framecachesize() * 1024 * 1024 / frameSize));
+}
+
+bool FrameCache::isActive() const
+{
+    return m_producer != nullptr;
+}
+
+bool FrameCache::frameAt(int position, Mlt::Frame &frame)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_producer) {
+        return false;
+    }
+    QMap<int, Mlt::Frame>::const_iterator it = m_frames.constFind(position);
+    if (it == m_frames.constEnd()) {
+        m_misses.ref();
+        return false;
+    }
+    m_hits.ref();
+    frame = it.value();
+    return true;
+}
+
+void FrameCache::setPlayhead(int position, double speed)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_producer) {
+        return;
+    }
+    m_playhead = position;
+    m_speed = speed;
+    if (!m_running) {
+        m_running = true;
+        m_worker = QtConcurrent::run(&m_pool, this, &FrameCache::decodeFrames);
+    }
+}
+
+int FrameCache::hits() const
+{
+    return m_hits.load();
+}
+
+int FrameCache::misses() const
+{
+    return m_misses.load();
+}
+
+void FrameCache::resetStatistics()
+{
+    m_hits.store(0);
+    m_misses.store(0);
+}
+
+bool FrameCache::nextBlock(int *start, int *end)
+{
+    const int direction = m_speed < 0 ? -1 : 1;
+    // Keep two thirds of the cache in the playing direction
+    const int ahead = m_maxFrames * 2 / 3;
+    const int behind = m_maxFrames - ahead - 1;
+    const int lower = qMax(0, direction > 0 ? m_playhead - behind : m_playhead - ahead);
+    const int upper = qMin(m_length - 1, direction > 0 ? m_playhead + ahead : m_playhead + behind);
+    for (int offset = 0; offset <= qMax(ahead, behind); ++offset) {
+        for (int side = 0; side < 2; ++side) {
+            const int dir = side == 0 ? direction : -direction;
+            const int pos = m_playhead + dir * offset;
+            if (pos < lower || pos > upper || m_frames.contains(pos)) {
+                continue;
+            }
+            if (dir > 0) {
+                // Decode forward from the missing frame
+                *start = pos;
+                *end = qMin(upper, pos + decodeBlockSize - 1);
+            } else {
+                // Seek one block before the missing frame and decode up to it
+                *start = qMax(lower, pos - decodeBlockSize + 1);
+                *end = pos;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameCache::evict()
+{
+    while (m_frames.count() > m_maxFrames) {
+        if (m_playhead - m_frames.firstKey() > m_frames.lastKey() - m_playhead) {
+            m_frames.erase(m_frames.begin());
+        } else {
+            m_frames.erase(--m_frames.end());
+        }
+    }
+}
+
+void FrameCache::decodeFrames()
+{
+    int start;
+    int end;
+    while (true) {
+        m_mutex.lock();
+        if (m_abort || !nextBlock(&start, &end)) {
+            m_running = false;
+            m_mutex.unlock();
+            return;
+        }
+        const int playhead = m_playhead;
+        m_mutex.unlock();
+        for (int pos = start; pos <= end; ++pos) {
+            m_producer->seek(pos);
+            Mlt::Frame *frame = m_producer->get_frame();
+            if (!frame || !frame->is_valid()) {
+                delete frame;
+                break;
+            }
+            mlt_image_format format = mlt_image_yuv420p;
+            int width = m_profile->width();
+            int height = m_profile->height();
+            frame->set("rescale.interp", KdenliveSettings::mltinterpolation().toUtf8().constData());
+            frame->set("deinterlace_method", KdenliveSettings::mltdeinterlacer().toUtf8().constData());
+            frame->get_image(format, width, height);
+            // Mark frame as ready for display
+            frame->set("rendered", 1);
+            QMutexLocker lock(&m_mutex);
+            if (!m_frames.contains(pos)) {
+                m_frames.insert(pos, *frame);
+            }
+            delete frame;
+            evict();
+            if (m_abort || qAbs(m_playhead - playhead) > decodeBlockSize) {
+                // Playhead moved away, find a new block to decode
+                break;
+            }
+        }
+    }
+}
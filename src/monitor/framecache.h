@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QFuture>
+#include <QAtomicInt>
+
+#include <mlt++/MltFrame.h>
+
+namespace Mlt
+{
+class Producer;
+class Profile;
+}
+
+/**
+ * @class FrameCache
+ * @brief Decodes frames ahead and behind the clip monitor playhead.
+ * Seeking in long GOP sources requires decoding a full GOP for each displayed frame,
+ * which makes jog / shuttle scrubbing and reverse playback sluggish. The cache uses its
+ * own producer instance on the clip's file, and decodes blocks of consecutive frames
+ * around the playhead (favouring the playing direction) in a worker thread.
+ * Decoded frames are kept within a memory budget, frames farthest from the playhead
+ * being evicted first.
+ */
+
+class FrameCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameCache(Mlt::Profile *profile, QObject *parent = nullptr);
+    virtual ~FrameCache();
+    /** @brief Use a new source producer. Only file based clips without effects are cached. */
+    void setProducer(Mlt::Producer *producer);
+    /** @brief Stop decoding and remove all cached frames. */
+    void clear();
+    /** @brief Returns true if we have a producer to decode. */
+    bool isActive() const;
+    /** @brief Fetch a cached frame.
+     *  @param position the requested frame
+     *  @param frame will contain the cached frame on success
+     *  @return true if the frame was in cache */
+    bool frameAt(int position, Mlt::Frame &frame);
+    /** @brief The playhead moved, decode the frames around it.
+     *  @param position the playhead position
+     *  @param speed the playing speed, its sign sets the decoding direction */
+    void setPlayhead(int position, double speed = 0);
+    /** @brief Number of frames served from cache since last reset. */
+    int hits() const;
+    /** @brief Number of requests that could not be served from cache since last reset. */
+    int misses() const;
+    void resetStatistics();
+
+private:
+    Mlt::Profile *m_profile;
+    Mlt::Producer *m_producer;
+    QMap<int, Mlt::Frame> m_frames;
+    QMutex m_mutex;
+    QThreadPool m_pool;
+    QFuture<void> m_worker;
+    /** @brief Set to true to make the worker return. */
+    bool m_abort;
+    /** @brief True while the worker thread is running. */
+    bool m_running;
+    int m_playhead;
+    double m_speed;
+    /** @brief Length of the cached producer. */
+    int m_length;
+    /** @brief Maximum number of frames fitting in our memory budget. */
+    int m_maxFrames;
+    QAtomicInt m_hits;
+    QAtomicInt m_misses;
+    /** @brief Stop the worker and wait until it returns. */
+    void stopWorker();
+    /** @brief Find the next block of frames to decode, returns false if all frames around playhead are cached. Mutex must be locked. */
+    bool nextBlock(int *start, int *end);
+    /** @brief Drop frames farthest from the playhead until we fit in budget. Mutex must be locked. */
+    void evict();
+    /** @brief The worker thread, decoding blocks of frames until the window around playhead is filled. */
+    void decodeFrames();
+};
+
+#endif
@@ -782,6 +782,16 @@ void GLWidget::resetDrops()
     }
 }
 
+bool GLWidget::showFrame(Mlt::Frame &frame)
+{
+    // Cached frames are only available for the CPU rendering path
+    if (m_glslManager || !m_frameRenderer || !m_frameRenderer->semaphore()->tryAcquire(1, 0)) {
+        return false;
+    }
+    QMetaObject::invokeMethod(m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame));
+    return true;
+}
+
 void GLWidget::createAudioOverlay(bool isAudio)
 {
     if (!m_consumer) {
@@ -113,6 +113,8 @@ public:
     void setAudioThumb(int channels = 0, const QVariantList &audioCache = QList<QVariant>());
     int droppedFrames() const;
     void resetDrops();
+    /** @brief Display a frame that did not go through the consumer (for example from the frame cache). Returns false if the renderer is busy. */
+    bool showFrame(Mlt::Frame &frame);
 
 protected:
     void mouseReleaseEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
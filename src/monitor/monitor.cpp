@@ -37,6 +37,8 @@
 #include "bin/bin.h"
 #include "project/projectmanager.h"
 #include "doc/kdenlivedoc.h"
+#include "doc/thumbnailstore.h"
+#include "project/clipmanager.h"
 #include "mainwindow.h"
 
 #include "klocalizedstring.h"
@@ -335,7 +337,7 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
     int tm = 0;
     int bm = 0;
     m_toolbar->getContentsMargins(nullptr, &tm, nullptr, &bm);
-    m_audioMeterWidget = new MonitorAudioLevel(m_glMonitor->profile(), m_toolbar->height() - tm - bm, this);
+    m_audioMeterWidget = new MonitorAudioLevel(m_toolbar->height() - tm - bm, this);
     m_toolbar->addWidget(m_audioMeterWidget);
     if (!m_audioMeterWidget->isValid) {
         KdenliveSettings::setMonitoraudio(0x01);
@@ -507,6 +509,10 @@ void Monitor::setupMenu(QMenu *goMenu, QMenu *overlayMenu, QAction *playZone, QA
     QAction *switchAudioMonitor = m_configMenu->addAction(i18n("Show Audio Levels"), this, SLOT(slotSwitchAudioMonitor()));
     switchAudioMonitor->setCheckable(true);
     switchAudioMonitor->setChecked(KdenliveSettings::monitoraudio() & m_id);
+    QAction *truePeak = m_configMenu->addAction(i18n("Audio Levels Show True Peak"));
+    truePeak->setCheckable(true);
+    truePeak->setChecked(KdenliveSettings::monitoraudiotruepeak());
+    connect(truePeak, &QAction::toggled, this, &Monitor::slotSwitchTruePeak);
     m_configMenu->addAction(overlayAudio);
     m_configMenu->addAction(m_zoomVisibilityAction);
     m_contextMenu->addAction(m_zoomVisibilityAction);
@@ -1790,7 +1796,18 @@ QString Monitor::getMarkerThumb(GenTime pos)
         return QString();
     }
     if (!m_controller->getClipHash().isEmpty()) {
-        QString url = m_monitorManager->getCacheFolder(CacheThumbs).absoluteFilePath(m_controller->getClipHash() + QLatin1Char('#') + QString::number((int) pos.frames(m_monitorManager->timecode().fps())) + QStringLiteral(".png"));
+        const int frame = (int) pos.frames(m_monitorManager->timecode().fps());
+        ThumbnailStore *store = pCore->projectManager()->current()->clipManager()->thumbnailStore;
+        QString url = store->markerPath(m_controller->getClipHash(), frame);
+        if (url.isEmpty()) {
+            // Marker image stored with the frame thumbnails
+            url = store->filePath(m_controller->getClipHash(), frame);
+        }
+        if (!url.isEmpty()) {
+            return url;
+        }
+        // Marker thumbnails of older projects
+        url = m_monitorManager->getCacheFolder(CacheThumbs).absoluteFilePath(m_controller->getClipHash() + QLatin1Char('#') + QString::number(frame) + QStringLiteral(".png"));
         if (QFile::exists(url)) {
             return url;
         }
@@ -2166,6 +2183,11 @@ void Monitor::slotSwitchAudioMonitor()
     displayAudioMonitor(isActive());
 }
 
+void Monitor::slotSwitchTruePeak(bool enable)
+{
+    KdenliveSettings::setMonitoraudiotruepeak(enable);
+}
+
 void Monitor::displayAudioMonitor(bool isActive)
 {
     bool enable = isActive && (KdenliveSettings::monitoraudio() & m_id);
@@ -327,6 +327,8 @@ public slots:
     void slotGetCurrentImage(bool request);
     /** @brief Enable/disable display of monitor's audio levels widget */
     void slotSwitchAudioMonitor();
+    /** @brief Switch the audio meter peak indicators between sample peak and true peak. */
+    void slotSwitchTruePeak(bool enable);
 
 signals:
     void renderPosition(int);
@@ -22,6 +22,7 @@
 #include "audiographspectrum.h"
 #include "../monitormanager.h"
 #include "kdenlivesettings.h"
+#include "lib/audio/spectralAnalysis.h"
 
 #include <QFontDatabase>
 #include <QVBoxLayout>
@@ -267,6 +268,7 @@ void AudioGraphWidget::paintEvent(QPaintEvent *pe)
 
 AudioGraphSpectrum::AudioGraphSpectrum(MonitorManager *manager, QWidget *parent) : ScopeWidget(parent)
     , m_manager(manager)
+    , m_samples(WINDOW_SIZE, 0)
 {
     QVBoxLayout *lay = new QVBoxLayout(this);
     m_graphWidget = new AudioGraphWidget(this);
@@ -277,20 +279,6 @@ AudioGraphSpectrum::AudioGraphSpectrum(MonitorManager *manager, QWidget *parent)
     lay->setStretchFactor(m_graphWidget, 5);
     lay->setStretchFactor(m_equalizer, 3);*/
 
-    m_filter = new Mlt::Filter(*(m_manager->projectMonitor()->profile()), "fft");
-    if (!m_filter->is_valid()) {
-        KdenliveSettings::setEnableaudiospectrum(false);
-        KMessageWidget *mw = new KMessageWidget(this);
-        mw->setCloseButtonVisible(false);
-        mw->setWordWrap(true);
-        mw->setMessageType(KMessageWidget::Information);
-        mw->setText(i18n("MLT must be compiled with libfftw3 to enable Audio Spectrum"));
-        layout()->addWidget(mw);
-        mw->show();
-        setEnabled(false);
-        return;
-    }
-    m_filter->set("window_size", WINDOW_SIZE);
     QAction *a = new QAction(i18n("Enable Audio Spectrum"), this);
     a->setCheckable(true);
     a->setChecked(KdenliveSettings::enableaudiospectrum());
@@ -305,7 +293,6 @@ AudioGraphSpectrum::AudioGraphSpectrum(MonitorManager *manager, QWidget *parent)
 AudioGraphSpectrum::~AudioGraphSpectrum()
 {
     delete m_graphWidget;
-    delete m_filter;
 }
 
 void AudioGraphSpectrum::activate(bool enable)
@@ -328,31 +315,58 @@ void AudioGraphSpectrum::refreshPixmap()
 void AudioGraphSpectrum::refreshScope(const QSize & /*size*/, bool /*full*/)
 {
     SharedFrame sFrame;
+    int frequency = 0;
     while (m_queue.count() > 0) {
         sFrame = m_queue.pop();
-        if (sFrame.is_valid() && sFrame.get_audio_samples() > 0) {
+        if (!sFrame.is_valid() || sFrame.get_audio_samples() <= 0) {
+            continue;
+        }
+        int channels = sFrame.get_audio_channels();
+        int samples = sFrame.get_audio_samples();
+        int freq = sFrame.get_audio_frequency();
+        const int16_t *data = nullptr;
+        Mlt::Frame mFrame;
+        if (sFrame.get_audio_format() == mlt_audio_s16) {
+            data = sFrame.get_audio();
+        } else {
             mlt_audio_format format = mlt_audio_s16;
-            int channels = sFrame.get_audio_channels();
-            int frequency = sFrame.get_audio_frequency();
-            int samples = sFrame.get_audio_samples();
-            Mlt::Frame mFrame = sFrame.clone(true, false, false);
-            m_filter->process(mFrame);
-            mFrame.get_audio(format, frequency, channels, samples);
-            if (samples == 0 || format == 0) {
-                // There was an error processing audio from frame
-                continue;
+            mFrame = sFrame.clone(true, false, false);
+            data = static_cast<const int16_t *>(mFrame.get_audio(format, freq, channels, samples));
+        }
+        if (!data || samples == 0 || channels == 0) {
+            // There was an error processing audio from frame
+            continue;
+        }
+        // Slide our window and append the mono mix of the new samples
+        const int first = qMax(0, samples - WINDOW_SIZE);
+        const int kept = WINDOW_SIZE - (samples - first);
+        qint16 *window = m_samples.data();
+        memmove(window, window + WINDOW_SIZE - kept, kept * sizeof(qint16));
+        for (int i = first; i < samples; i++) {
+            int sum = 0;
+            for (int c = 0; c < channels; c++) {
+                sum += data[i * channels + c];
             }
-            processSpectrum();
+            window[kept + i - first] = sum / channels;
         }
+        frequency = freq;
+    }
+    if (frequency > 0) {
+        processSpectrum(frequency);
     }
 }
 
-void AudioGraphSpectrum::processSpectrum()
+void AudioGraphSpectrum::processSpectrum(int frequency)
 {
     QVector<double> bands(AUDIBLE_BAND_COUNT);
-    float *bins = (float *)m_filter->get_data("bins");
-    int bin_count = m_filter->get_int("bin_count");
-    double bin_width = m_filter->get_double("bin_width");
+    QVector<float> bins(WINDOW_SIZE / 2);
+    SpectralAnalysis::shared()->fftNormalized(m_samples, 0, 1, bins.data(), FFTTools::Window_Hamming, WINDOW_SIZE);
+    const int bin_count = bins.size();
+    const double bin_width = (double)frequency / WINDOW_SIZE;
+    // Convert the normalized dB values to magnitudes
+    for (int bin = 0; bin < bin_count; bin++) {
+        bins[bin] = pow(10.0, bins.at(bin) / 20.0);
+    }
 
     int band = 0;
     bool firstBandFound = false;
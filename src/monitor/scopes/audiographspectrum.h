@@ -30,16 +30,12 @@
 
 #include "scopewidget.h"
 #include "sharedframe.h"
+#include "definitions.h"
 
 #include <QWidget>
 #include <QVector>
 #include <QPixmap>
 
-namespace Mlt
-{
-class Filter;
-}
-
 class MonitorManager;
 
 /*class EqualizerWidget : public QWidget
@@ -84,10 +80,12 @@ public:
 
 private:
     MonitorManager *m_manager;
-    Mlt::Filter *m_filter;
     AudioGraphWidget *m_graphWidget;
+    /** @brief The last WINDOW_SIZE samples of the mono audio mix. */
+    audioShortVector m_samples;
     //EqualizerWidget *m_equalizer;
-    void processSpectrum();
+    /** @brief Compute the spectrum of our samples window and send the bands levels to the graph. */
+    void processSpectrum(int frequency);
     void refreshScope(const QSize &size, bool full) Q_DECL_OVERRIDE;
 
 public slots:
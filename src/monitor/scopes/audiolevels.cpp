@@ -0,0 +1,138 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "audiolevels.h"
+
+#include <QtGlobal>
+
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// ITU-R BS.1770-4 Annex 2 polyphase interpolation filter, 4 phases of 12 taps
+static const int truePeakTaps = 12;
+static const float truePeakFilter[4][truePeakTaps] = {
+    {0.0017089843750f, 0.0109863281250f, -0.0196533203125f, 0.0332031250000f, -0.0594482421875f, 0.1373291015625f,
+     0.9721679687500f, -0.1022949218750f, 0.0476074218750f, -0.0266113281250f, 0.0148925781250f, -0.0083007812500f},
+    {-0.0291748046875f, 0.0292968750000f, -0.0517578125000f, 0.0891113281250f, -0.1665039062500f, 0.4650878906250f,
+     0.7797851562500f, -0.2003173828125f, 0.1015625000000f, -0.0582275390625f, 0.0330810546875f, -0.0189208984375f},
+    {-0.0189208984375f, 0.0330810546875f, -0.0582275390625f, 0.1015625000000f, -0.2003173828125f, 0.7797851562500f,
+     0.4650878906250f, -0.1665039062500f, 0.0891113281250f, -0.0517578125000f, 0.0292968750000f, -0.0291748046875f},
+    {-0.0083007812500f, 0.0148925781250f, -0.0266113281250f, 0.0476074218750f, -0.1022949218750f, 0.9721679687500f,
+     0.1373291015625f, -0.0594482421875f, 0.0332031250000f, -0.0196533203125f, 0.0109863281250f, 0.0017089843750f}};
+
+static const double fullScale = 32768.0;
+
+static void measureChannel(const int16_t *samples, int sampleCount, int channels, int channel, double *peak, double *rms)
+{
+    int maxValue = 0;
+    double square = 0;
+    const int total = sampleCount * channels;
+    for (int i = channel; i < total; i += channels) {
+        const int value = samples[i];
+        maxValue = qMax(maxValue, abs(value));
+        square += value * value;
+    }
+    *peak = maxValue / fullScale;
+    *rms = sampleCount > 0 ? sqrt(square / sampleCount) / fullScale : 0;
+}
+
+void AudioLevels::measure(const int16_t *samples, int sampleCount, int channels, int count, double *peak, double *rms)
+{
+    if (channels > 8) {
+        // Unusual channel layouts, measure the channels one by one
+        for (int c = 0; c < count; ++c) {
+            measureChannel(samples, sampleCount, channels, c, peak + c, rms + c);
+        }
+        return;
+    }
+    int maxValues[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    double squares[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    const int total = sampleCount * channels;
+    int i = 0;
+#ifdef __SSE2__
+    if (channels == 1 || channels == 2 || channels == 4 || channels == 8) {
+        // Each 128 bit register holds 8 samples, lane j always belongs to channel j % channels
+        const __m128i zero = _mm_setzero_si128();
+        __m128i maxAbs = zero;
+        __m128 sumLow = _mm_setzero_ps();
+        __m128 sumHigh = _mm_setzero_ps();
+        for (; i + 8 <= total; i += 8) {
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+            // Saturating negation maps -32768 to 32767, which is close enough for a meter
+            maxAbs = _mm_max_epi16(maxAbs, _mm_max_epi16(values, _mm_subs_epi16(zero, values)));
+            // Full 32 bit squares from the low and high halves of the 16 bit products
+            const __m128i low = _mm_mullo_epi16(values, values);
+            const __m128i high = _mm_mulhi_epi16(values, values);
+            sumLow = _mm_add_ps(sumLow, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, high)));
+            sumHigh = _mm_add_ps(sumHigh, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, high)));
+        }
+        int16_t lanesMax[8];
+        float lanesSum[8];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanesMax), maxAbs);
+        _mm_storeu_ps(lanesSum, sumLow);
+        _mm_storeu_ps(lanesSum + 4, sumHigh);
+        for (int j = 0; j < 8; ++j) {
+            const int channel = j % channels;
+            maxValues[channel] = qMax(maxValues[channel], (int) lanesMax[j]);
+            squares[channel] += lanesSum[j];
+        }
+    }
+#endif
+    // Remaining samples, or the whole buffer without SIMD support
+    for (; i < total; ++i) {
+        const int channel = i % channels;
+        const int value = samples[i];
+        maxValues[channel] = qMax(maxValues[channel], abs(value));
+        squares[channel] += value * value;
+    }
+    for (int c = 0; c < count; ++c) {
+        peak[c] = maxValues[c] / fullScale;
+        rms[c] = sampleCount > 0 ? sqrt(squares[c] / sampleCount) / fullScale : 0;
+    }
+}
+
+void AudioLevels::truePeak(const int16_t *samples, int sampleCount, int channels, int count, double *peak)
+{
+    float history[truePeakTaps];
+    for (int c = 0; c < count; ++c) {
+        float maxValue = 0;
+        for (int n = 0; n < sampleCount; ++n) {
+            const float value = samples[n * channels + c];
+            maxValue = qMax(maxValue, qAbs(value));
+            if (n < truePeakTaps - 1) {
+                continue;
+            }
+            for (int k = 0; k < truePeakTaps; ++k) {
+                history[k] = samples[(n - truePeakTaps + 1 + k) * channels + c];
+            }
+            for (int phase = 0; phase < 4; ++phase) {
+                float sum = 0;
+                for (int k = 0; k < truePeakTaps; ++k) {
+                    sum += truePeakFilter[phase][k] * history[k];
+                }
+                maxValue = qMax(maxValue, qAbs(sum));
+            }
+        }
+        peak[c] = maxValue / fullScale;
+    }
+}
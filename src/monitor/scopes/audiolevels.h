@@ -0,0 +1,47 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef AUDIOLEVELS_H
+#define AUDIOLEVELS_H
+
+#include <stdint.h>
+
+/**
+ * @namespace AudioLevels
+ * @brief Level measurement on interleaved 16 bit audio buffers, as delivered with the displayed frames.
+ * Levels are linear, 1.0 being full scale.
+ */
+
+namespace AudioLevels
+{
+/** @brief Compute the sample peak and RMS level of each channel.
+ *  @param samples interleaved audio samples
+ *  @param sampleCount number of samples per channel
+ *  @param channels number of interleaved channels in the buffer
+ *  @param count number of channels to measure, starting from the first one
+ *  @param peak receives count peak levels
+ *  @param rms receives count RMS levels */
+void measure(const int16_t *samples, int sampleCount, int channels, int count, double *peak, double *rms);
+/** @brief Estimate the true peak of each channel using the 4x oversampling filter of ITU-R BS.1770.
+ *  Intersample peaks are only detected inside the buffer, there is no history kept between calls.
+ *  @param peak receives count peak levels, never lower than the sample peak */
+void truePeak(const int16_t *samples, int sampleCount, int channels, int count, double *peak);
+}
+
+#endif
@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "monitoraudiolevel.h"
+#include "audiolevels.h"
+#include "kdenlivesettings.h"
 
 #include "mlt++/Mlt.h"
 
@@ -39,56 +41,103 @@ static inline double levelToDB(double dB)
     return 100 * (1.0 - log10(dB) * log_factor);
 }
 
-MonitorAudioLevel::MonitorAudioLevel(Mlt::Profile *profile, int height, QWidget *parent) : ScopeWidget(parent)
+static inline int meterValue(double level)
+{
+    if (level == 0.0) {
+        return -100;
+    }
+    return (int) levelToDB(level);
+}
+
+MonitorAudioLevel::MonitorAudioLevel(int height, QWidget *parent) : ScopeWidget(parent)
     , audioChannels(2)
+    , isValid(true)
     , m_height(height)
     , m_channelHeight(height / 2)
     , m_channelDistance(2)
     , m_channelFillHeight(m_channelHeight)
+    , m_readSerial(0)
 {
     setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Preferred);
-    m_filter = new Mlt::Filter(*profile, "audiolevel");
-    if (!m_filter->is_valid()) {
-        isValid = false;
-        return;
-    }
-    m_filter->set("iec_scale", 0);
-    isValid = true;
 }
 
 MonitorAudioLevel::~MonitorAudioLevel()
 {
-    delete m_filter;
 }
 
 void MonitorAudioLevel::refreshScope(const QSize & /*size*/, bool /*full*/)
 {
     SharedFrame sFrame;
+    double peaks[maxMeterChannels];
+    double levels[maxMeterChannels];
+    double framePeaks[maxMeterChannels];
+    int count = 0;
     while (m_queue.count() > 0) {
         sFrame = m_queue.pop();
-        if (sFrame.is_valid() && sFrame.get_audio_samples() > 0) {
+        if (!sFrame.is_valid() || sFrame.get_audio_samples() <= 0) {
+            continue;
+        }
+        int channels = sFrame.get_audio_channels();
+        int samples = sFrame.get_audio_samples();
+        const int16_t *data = nullptr;
+        Mlt::Frame mFrame;
+        if (sFrame.get_audio_format() == mlt_audio_s16) {
+            // Read the displayed frame's audio directly
+            data = sFrame.get_audio();
+        } else {
             mlt_audio_format format = mlt_audio_s16;
-            int channels = sFrame.get_audio_channels();
             int frequency = sFrame.get_audio_frequency();
-            int samples = sFrame.get_audio_samples();
-            Mlt::Frame mFrame = sFrame.clone(true, false, false);
-            m_filter->process(mFrame);
-            mFrame.get_audio(format, frequency, channels, samples);
-            if (samples == 0) {
-                // There was an error processing audio from frame
-                continue;
-            }
-            QVector<int> levels;
-            for (int i = 0; i < audioChannels; i++) {
-                QString s = QStringLiteral("meta.media.audio_level.%1").arg(i);
-                double audioLevel = mFrame.get_double(s.toLatin1().constData());
-                if (audioLevel == 0.0) {
-                    levels << -100;
-                } else {
-                    levels << (int) levelToDB(audioLevel);
-                }
-            }
-            QMetaObject::invokeMethod(this, "setAudioValues", Qt::QueuedConnection, Q_ARG(const QVector<int> &, levels));
+            mFrame = sFrame.clone(true, false, false);
+            data = static_cast<const int16_t *>(mFrame.get_audio(format, frequency, channels, samples));
+        }
+        if (!data || samples == 0) {
+            // There was an error processing audio from frame
+            continue;
+        }
+        const int frameCount = qMin(qMin(audioChannels, channels), maxMeterChannels);
+        AudioLevels::measure(data, samples, channels, frameCount, framePeaks, levels);
+        if (KdenliveSettings::monitoraudiotruepeak()) {
+            AudioLevels::truePeak(data, samples, channels, frameCount, framePeaks);
+        }
+        // Keep the highest peak of all frames received since last refresh
+        for (int i = 0; i < frameCount; i++) {
+            peaks[i] = (i < count && peaks[i] > framePeaks[i]) ? peaks[i] : framePeaks[i];
+        }
+        count = frameCount;
+    }
+    if (count == 0) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        m_levelValues[i].store(meterValue(levels[i]));
+        m_levelPeaks[i].store(meterValue(peaks[i]));
+    }
+    m_levelChannels.store(count);
+    m_levelSerial.fetchAndAddRelease(1);
+}
+
+void MonitorAudioLevel::readAudioValues()
+{
+    const int serial = m_levelSerial.loadAcquire();
+    if (serial == m_readSerial) {
+        return;
+    }
+    m_readSerial = serial;
+    const int count = m_levelChannels.load();
+    m_values.resize(count);
+    for (int i = 0; i < count; i++) {
+        m_values[i] = m_levelValues[i].load();
+    }
+    if (m_peaks.size() != count) {
+        m_peaks.resize(count);
+        for (int i = 0; i < count; i++) {
+            m_peaks[i] = m_levelPeaks[i].load();
+        }
+        drawBackground(count);
+    } else {
+        for (int i = 0; i < count; i++) {
+            m_peaks[i] --;
+            m_peaks[i] = qMax(m_peaks.at(i), m_levelPeaks[i].load());
         }
     }
 }
@@ -193,24 +242,6 @@ void MonitorAudioLevel::drawBackground(int channels)
     p.end();
 }
 
-// cppcheck-suppress unusedFunction
-void MonitorAudioLevel::setAudioValues(const QVector<int> &values)
-{
-    m_values = values;
-    if (m_peaks.size() != m_values.size()) {
-        m_peaks = values;
-        drawBackground(values.size());
-    } else {
-        for (int i = 0; i < m_values.size(); i++) {
-            m_peaks[i] --;
-            if (m_values.at(i) > m_peaks.at(i)) {
-                m_peaks[i] = m_values.at(i);
-            }
-        }
-    }
-    update();
-}
-
 void MonitorAudioLevel::setVisibility(bool enable)
 {
     if (enable) {
@@ -228,6 +259,7 @@ void MonitorAudioLevel::paintEvent(QPaintEvent *pe)
     if (!isVisible()) {
         return;
     }
+    readAudioValues();
     QPainter p(this);
     p.setClipRect(pe->rect());
     QRect rect(0, 0, width(), height());
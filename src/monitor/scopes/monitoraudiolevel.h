@@ -24,18 +24,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "scopewidget.h"
 #include <QWidget>
+#include <QAtomicInt>
 
-namespace Mlt
-{
-class Profile;
-class Filter;
-}
+/** @brief Maximum number of channels displayed by the audio meter. */
+static const int maxMeterChannels = 16;
 
 class MonitorAudioLevel : public ScopeWidget
 {
     Q_OBJECT
 public:
-    explicit MonitorAudioLevel(Mlt::Profile *profile, int height, QWidget *parent = nullptr);
+    explicit MonitorAudioLevel(int height, QWidget *parent = nullptr);
     virtual ~MonitorAudioLevel();
     void refreshPixmap();
     int audioChannels;
@@ -47,7 +45,6 @@ protected:
     void resizeEvent(QResizeEvent *event) Q_DECL_OVERRIDE;
 
 private:
-    Mlt::Filter *m_filter;
     int m_height;
     QPixmap m_pixmap;
     QVector <int> m_peaks;
@@ -55,11 +52,18 @@ private:
     int m_channelHeight;
     int m_channelDistance;
     int m_channelFillHeight;
+    /** @brief Levels published by the worker thread for the GUI thread, no locking required. */
+    QAtomicInt m_levelValues[maxMeterChannels];
+    QAtomicInt m_levelPeaks[maxMeterChannels];
+    QAtomicInt m_levelChannels;
+    /** @brief Incremented by the worker thread each time new levels are published. */
+    QAtomicInt m_levelSerial;
+    /** @brief Serial of the last levels read by the GUI thread. */
+    int m_readSerial;
     void drawBackground(int channels = 2);
     void refreshScope(const QSize &size, bool full) Q_DECL_OVERRIDE;
-
-private slots:
-    void setAudioValues(const QVector <int> &values);
+    /** @brief Read the levels published since last paint and update the peak indicators. */
+    void readAudioValues();
 };
 
 #endif
@@ -0,0 +1,131 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "sequenceprefetcher.h"
+#include "utils/sequenceindex.h"
+
+#include <QFile>
+#include <QtConcurrent>
+
+#include <mlt++/Mlt.h>
+
+// Number of images read ahead of the playhead
+static const int prefetchCount = 12;
+// Size of the blocks read from the image files
+static const qint64 readBlockSize = 1024 * 1024;
+
+SequencePrefetcher::SequencePrefetcher()
+    : m_ttl(1)
+    , m_loop(false)
+    , m_currentImage(-1)
+{
+    m_pool.setMaxThreadCount(2);
+}
+
+SequencePrefetcher::~SequencePrefetcher()
+{
+    reset();
+    m_pool.waitForDone();
+}
+
+void SequencePrefetcher::reset()
+{
+    m_serial.ref();
+    m_pool.clear();
+    QMutexLocker lock(&m_mutex);
+    m_files.clear();
+    m_queued.clear();
+    m_currentImage = -1;
+}
+
+void SequencePrefetcher::setProducer(Mlt::Producer *producer)
+{
+    reset();
+    if (!producer || !producer->is_valid()) {
+        return;
+    }
+    Mlt::Producer parent(producer->parent());
+    const QString service = QString::fromUtf8(parent.get("mlt_service"));
+    if (service != QLatin1String("qimage") && service != QLatin1String("pixbuf")) {
+        return;
+    }
+    const QString resource = QString::fromUtf8(parent.get("resource"));
+    if (!resource.contains(QLatin1Char('%')) && !resource.contains(QLatin1String("/.all."))) {
+        // Single image
+        return;
+    }
+    m_ttl = qMax(1, parent.get_int("ttl"));
+    m_loop = parent.get_int("loop") == 1;
+    // Listing the sequence can be slow, do it in a worker
+    QtConcurrent::run(&m_pool, this, &SequencePrefetcher::loadSequence, resource, m_serial.load());
+}
+
+void SequencePrefetcher::loadSequence(const QString &resource, int serial)
+{
+    const QStringList files = SequenceIndex::shared()->resourceFiles(resource);
+    QMutexLocker lock(&m_mutex);
+    if (m_serial.load() == serial) {
+        m_files = files;
+    }
+}
+
+void SequencePrefetcher::setPlayhead(int position, double speed)
+{
+    QMutexLocker lock(&m_mutex);
+    const int count = m_files.count();
+    const int image = position / m_ttl;
+    if (count == 0 || image == m_currentImage) {
+        return;
+    }
+    m_currentImage = image;
+    if (m_queued.count() > prefetchCount * 20) {
+        m_queued.clear();
+    }
+    const int direction = speed < 0 ? -1 : 1;
+    const int serial = m_serial.load();
+    for (int i = 1; i <= prefetchCount; ++i) {
+        int next = image + i * direction;
+        if (m_loop) {
+            next = ((next % count) + count) % count;
+        } else if (next < 0 || next >= count) {
+            break;
+        }
+        if (m_queued.contains(next)) {
+            continue;
+        }
+        m_queued.insert(next);
+        QtConcurrent::run(&m_pool, &SequencePrefetcher::readFile, m_files.at(next), &m_serial, serial);
+    }
+}
+
+// static
+void SequencePrefetcher::readFile(const QString &path, QAtomicInt *serial, int expected)
+{
+    QFile file(path);
+    if (serial->load() != expected || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    // We only want the file in the system cache, discard data
+    QByteArray buffer(readBlockSize, Qt::Uninitialized);
+    while (serial->load() == expected) {
+        if (file.read(buffer.data(), readBlockSize) <= 0) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SEQUENCEPREFETCHER_H
+#define SEQUENCEPREFETCHER_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+
+namespace Mlt
+{
+class Producer;
+}
+
+/**
+ * @class SequencePrefetcher
+ * @brief Reads the images of a sequence ahead of the clip monitor playhead.
+ * MLT's image producers load each full resolution still from disk when it is displayed,
+ * which stalls playback of timelapse sequences stored on slow or network drives. The
+ * files of the next images in the playing direction are read on a small worker pool,
+ * so that the producer finds them in the system's file cache.
+ */
+
+class SequencePrefetcher
+{
+public:
+    SequencePrefetcher();
+    ~SequencePrefetcher();
+    /** @brief Use a new producer, only image sequence clips are prefetched. */
+    void setProducer(Mlt::Producer *producer);
+    /** @brief The playhead moved, read the next images.
+     *  @param speed the playing speed, its sign sets the prefetching direction */
+    void setPlayhead(int position, double speed);
+
+private:
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    /** @brief Absolute paths of the sequence images, filled by a worker. */
+    QStringList m_files;
+    /** @brief Number of frames each image is displayed. */
+    int m_ttl;
+    bool m_loop;
+    /** @brief The image displayed at last playhead update. */
+    int m_currentImage;
+    /** @brief Images already read or queued. */
+    QSet<int> m_queued;
+    /** @brief Incremented when the producer changes, so that outdated reads are skipped. */
+    QAtomicInt m_serial;
+    /** @brief Stop reading files of the current producer. */
+    void reset();
+    void loadSequence(const QString &resource, int serial);
+    static void readFile(const QString &path, QAtomicInt *serial, int expected);
+};
+
+#endif
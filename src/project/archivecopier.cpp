@@ -0,0 +1,376 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "archivecopier.h"
+
+#include "kdenlive_debug.h"
+#include <KLocalizedString>
+#include <KTar>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <functional>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+const QString ArchiveCopier::manifestName = QStringLiteral("checksums.md5");
+
+// Size of the blocks read from source files
+static const qint64 copyBlockSize = 4 * 1024 * 1024;
+
+/** @brief Compute the md5 checksum of a file. @param processed is called after each block, return false to abort */
+static QByteArray hashFile(const QString &path, const std::function<bool(qint64)> &processed)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    QByteArray buffer;
+    while (!file.atEnd()) {
+        buffer = file.read(copyBlockSize);
+        if (buffer.isEmpty() && file.error() != QFile::NoError) {
+            return QByteArray();
+        }
+        hash.addData(buffer);
+        if (processed && !processed(buffer.size())) {
+            return QByteArray();
+        }
+    }
+    return hash.result().toHex();
+}
+
+static bool isCorrupted(const QPair<QByteArray, QString> &entry)
+{
+    return hashFile(entry.second, nullptr) != entry.first;
+}
+
+ArchiveCopier::ArchiveCopier(QObject *parent) : QObject(parent)
+    , m_allowHardlinks(false)
+    , m_totalSize(0)
+{
+    // Copying is IO bound, a few concurrent copies keep the drives busy without making them seek all the time
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 4));
+}
+
+ArchiveCopier::~ArchiveCopier()
+{
+    // Workers access this object, they must have returned before it is deleted
+    m_abort.store(1);
+    m_worker.waitForFinished();
+}
+
+bool ArchiveCopier::isRunning() const
+{
+    return m_worker.isRunning();
+}
+
+void ArchiveCopier::abort()
+{
+    // Workers check the flag after each block, finished is emitted once they returned
+    m_abort.store(1);
+}
+
+void ArchiveCopier::prepare(const QMap<QString, QString> &files)
+{
+    m_worker.waitForFinished();
+    m_items.clear();
+    m_items.reserve(files.count());
+    m_totalSize = 0;
+    QMapIterator<QString, QString> i(files);
+    while (i.hasNext()) {
+        i.next();
+        CopyItem item;
+        item.source = i.key();
+        item.destination = i.value();
+        m_items << item;
+        m_totalSize += QFileInfo(item.source).size();
+    }
+    m_abort.store(0);
+    m_nextItem.store(0);
+    m_lastProgress.store(0);
+    m_processedSize.store(0);
+    m_error.clear();
+}
+
+void ArchiveCopier::copyToFolder(const QMap<QString, QString> &files, const QString &folder, bool allowHardlinks)
+{
+    prepare(files);
+    m_destination = folder;
+    m_allowHardlinks = allowHardlinks;
+    m_worker = QtConcurrent::run(this, &ArchiveCopier::doCopy);
+}
+
+void ArchiveCopier::writeArchive(const QMap<QString, QString> &files, const QStringList &folders, const QString &archivePath, const QString &projectFile, const QString &projectName)
+{
+    prepare(files);
+    m_folders = folders;
+    m_destination = archivePath;
+    m_projectFile = projectFile;
+    m_projectName = projectName;
+    m_worker = QtConcurrent::run(this, &ArchiveCopier::doArchive);
+}
+
+void ArchiveCopier::setError(const QString &error)
+{
+    QMutexLocker lock(&m_errorMutex);
+    if (m_error.isEmpty()) {
+        m_error = error;
+    }
+    // Stop the other workers
+    m_abort.store(1);
+}
+
+void ArchiveCopier::addProgress(qint64 size)
+{
+    const qint64 processed = m_processedSize.fetchAndAddRelaxed(size) + size;
+    const int percent = m_totalSize > 0 ? (int)(100 * processed / m_totalSize) : 100;
+    if (m_lastProgress.fetchAndStoreRelaxed(percent) != percent) {
+        emit progress(percent);
+    }
+}
+
+void ArchiveCopier::doCopy()
+{
+    QList<QFuture<void> > workers;
+    for (int i = 0; i < m_pool.maxThreadCount(); ++i) {
+        workers << QtConcurrent::run(&m_pool, this, &ArchiveCopier::copyFiles);
+    }
+    for (QFuture<void> &worker : workers) {
+        worker.waitForFinished();
+    }
+    if (m_abort.load() == 0) {
+        QSaveFile file(QDir(m_destination).absoluteFilePath(manifestName));
+        if (!file.open(QIODevice::WriteOnly) || file.write(manifest()) < 0 || !file.commit()) {
+            setError(i18n("Cannot write checksum file %1", file.fileName()));
+        }
+    }
+    emit finished(m_error.isEmpty() && m_abort.load() == 0, m_error);
+}
+
+void ArchiveCopier::copyFiles()
+{
+    while (m_abort.load() == 0) {
+        const int ix = m_nextItem.fetchAndAddRelaxed(1);
+        if (ix >= m_items.count()) {
+            return;
+        }
+        CopyItem &item = m_items.data()[ix];
+        if (!copyFile(item) && m_abort.load() == 0) {
+            setError(i18n("Cannot copy %1 to %2", item.source, QDir(m_destination).absoluteFilePath(item.destination)));
+        }
+    }
+}
+
+bool ArchiveCopier::copyFile(CopyItem &item)
+{
+    const QString destination = QDir(m_destination).absoluteFilePath(item.destination);
+    if (!QDir().mkpath(QFileInfo(destination).absolutePath())) {
+        return false;
+    }
+    auto processed = [this](qint64 size) {
+        addProgress(size);
+        return m_abort.load() == 0;
+    };
+    if (QFileInfo(item.source).canonicalFilePath() == QFileInfo(destination).canonicalFilePath() || linkFile(item.source, destination)) {
+        // No data was copied, we only need the checksum
+        item.checksum = hashFile(item.source, processed);
+        return !item.checksum.isEmpty();
+    }
+    QFile source(item.source);
+    QSaveFile dest(destination);
+    if (!source.open(QIODevice::ReadOnly) || !dest.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    QByteArray buffer;
+    while (!source.atEnd()) {
+        buffer = source.read(copyBlockSize);
+        if ((buffer.isEmpty() && source.error() != QFile::NoError) || dest.write(buffer) != buffer.size() || !processed(buffer.size())) {
+            dest.cancelWriting();
+            return false;
+        }
+        hash.addData(buffer);
+    }
+    if (!dest.commit()) {
+        return false;
+    }
+    item.checksum = hash.result().toHex();
+    return true;
+}
+
+bool ArchiveCopier::linkFile(const QString &source, const QString &destination) const
+{
+#ifdef Q_OS_UNIX
+    const QByteArray sourcePath = QFile::encodeName(source);
+    const QByteArray destPath = QFile::encodeName(destination);
+    struct stat sourceStat;
+    struct stat folderStat;
+    if (::stat(sourcePath.constData(), &sourceStat) != 0 || ::stat(QFile::encodeName(QFileInfo(destination).absolutePath()).constData(), &folderStat) != 0) {
+        return false;
+    }
+    if (sourceStat.st_dev != folderStat.st_dev) {
+        return false;
+    }
+    QFile::remove(destination);
+#ifdef FICLONE
+    int in = ::open(sourcePath.constData(), O_RDONLY);
+    if (in >= 0) {
+        int out = ::open(destPath.constData(), O_WRONLY | O_CREAT | O_TRUNC, sourceStat.st_mode & 0777);
+        if (out >= 0) {
+            const bool cloned = ::ioctl(out, FICLONE, in) == 0;
+            ::close(out);
+            ::close(in);
+            if (cloned) {
+                return true;
+            }
+            QFile::remove(destination);
+        } else {
+            ::close(in);
+        }
+    }
+#endif
+    if (m_allowHardlinks && ::link(sourcePath.constData(), destPath.constData()) == 0) {
+        return true;
+    }
+#else
+    Q_UNUSED(source)
+    Q_UNUSED(destination)
+#endif
+    return false;
+}
+
+QByteArray ArchiveCopier::manifest() const
+{
+    QByteArray data;
+    for (const CopyItem &item : m_items) {
+        data.append(item.checksum + "  " + item.destination.toUtf8() + '\n');
+    }
+    return data;
+}
+
+void ArchiveCopier::doArchive()
+{
+    QFileInfo dirInfo(QFileInfo(m_destination).absolutePath());
+    const QString user = dirInfo.owner();
+    const QString group = dirInfo.group();
+    KTar archive(m_destination, QStringLiteral("application/x-gzip"));
+    if (!archive.open(QIODevice::WriteOnly)) {
+        setError(i18n("Cannot create archive %1", m_destination));
+        emit finished(false, m_error);
+        return;
+    }
+    for (const QString &path : m_folders) {
+        archive.writeDir(path, user, group);
+    }
+    // A tar archive is written sequentially, files are streamed one after the other
+    for (CopyItem &item : m_items) {
+        if (m_abort.load() != 0) {
+            break;
+        }
+        if (!streamFile(archive, item, user, group)) {
+            setError(i18n("Cannot add %1 to the archive", item.source));
+        }
+    }
+    if (m_abort.load() == 0) {
+        const QByteArray data = manifest();
+        if (!archive.prepareWriting(manifestName, user, group, data.size()) || !archive.writeData(data.constData(), data.size()) || !archive.finishWriting(data.size())) {
+            setError(i18n("Cannot add %1 to the archive", manifestName));
+        } else if (!m_projectFile.isEmpty() && !archive.addLocalFile(m_projectFile, m_projectName)) {
+            setError(i18n("Cannot add %1 to the archive", m_projectName));
+        }
+    }
+    const bool closed = archive.close();
+    if (m_abort.load() != 0) {
+        QFile::remove(m_destination);
+        emit finished(false, m_error);
+        return;
+    }
+    emit finished(closed, closed ? QString() : i18n("Cannot write archive %1", m_destination));
+}
+
+bool ArchiveCopier::streamFile(KArchive &archive, CopyItem &item, const QString &user, const QString &group)
+{
+    QFile file(item.source);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QFileInfo info(file);
+    const qint64 size = file.size();
+    if (!archive.prepareWriting(item.destination, user, group, size, 0100644, info.lastRead(), info.lastModified(), info.created())) {
+        return false;
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    QByteArray buffer;
+    qint64 written = 0;
+    while (written < size) {
+        buffer = file.read(qMin(copyBlockSize, size - written));
+        if (buffer.isEmpty() || !archive.writeData(buffer.constData(), buffer.size())) {
+            return false;
+        }
+        hash.addData(buffer);
+        written += buffer.size();
+        addProgress(buffer.size());
+        if (m_abort.load() != 0) {
+            return false;
+        }
+    }
+    item.checksum = hash.result().toHex();
+    return archive.finishWriting(size);
+}
+
+// static
+QStringList ArchiveCopier::verify(const QString &folder)
+{
+    QStringList corrupted;
+    QDir dir(folder);
+    QFile file(dir.absoluteFilePath(manifestName));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return corrupted;
+    }
+    QList<QPair<QByteArray, QString> > entries;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        // md5sum format: 32 hex digits, 2 separator characters, file path
+        if (line.size() < 35) {
+            continue;
+        }
+        entries << qMakePair(line.left(32), dir.absoluteFilePath(QString::fromUtf8(line.mid(34)).remove(QLatin1Char('\n'))));
+    }
+    entries = QtConcurrent::blockingFiltered(entries, isCorrupted);
+    for (const QPair<QByteArray, QString> &entry : entries) {
+        corrupted << entry.second;
+    }
+    return corrupted;
+}
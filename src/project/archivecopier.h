@@ -0,0 +1,113 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef ARCHIVECOPIER_H
+#define ARCHIVECOPIER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+class KArchive;
+
+/**
+ * @class ArchiveCopier
+ * @brief Copies the files of an archived project and records their checksums.
+ * When archiving to a folder, files are copied by a bounded number of worker threads.
+ * If the archive folder is on the same filesystem as a source file, the file is cloned
+ * (copy on write, on filesystems supporting it) or optionally hard linked instead of
+ * being copied. When creating a compressed archive, files are streamed into the tar
+ * archive from their original location. In both cases, an md5sum compatible manifest
+ * is written in the archive so that the files can be verified after extraction.
+ */
+
+class ArchiveCopier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ArchiveCopier(QObject *parent = nullptr);
+    virtual ~ArchiveCopier();
+    /** @brief Start copying files to a folder.
+     *  @param files maps source paths to destination paths relative to @param folder
+     *  @param allowHardlinks hard link files on the same filesystem when they cannot be cloned */
+    void copyToFolder(const QMap<QString, QString> &files, const QString &folder, bool allowHardlinks);
+    /** @brief Start writing files to a compressed tar archive.
+     *  @param files maps source paths to paths in the archive
+     *  @param folders folders to create in the archive
+     *  @param projectFile the project file, added last and not listed in the manifest since it is modified on extraction
+     *  @param projectName name of the project file in the archive */
+    void writeArchive(const QMap<QString, QString> &files, const QStringList &folders, const QString &archivePath, const QString &projectFile, const QString &projectName);
+    /** @brief Ask the running copy to stop, without waiting. finished is emitted once workers returned. */
+    void abort();
+    bool isRunning() const;
+    /** @brief Check the files listed in the checksum manifest of @param folder, in parallel. Blocks until done.
+     *  @return the files that are missing or corrupted */
+    static QStringList verify(const QString &folder);
+    /** @brief Name of the checksum manifest in the archive. */
+    static const QString manifestName;
+
+private:
+    struct CopyItem {
+        QString source;
+        QString destination;
+        QByteArray checksum;
+    };
+    QVector<CopyItem> m_items;
+    QStringList m_folders;
+    QString m_destination;
+    QString m_projectFile;
+    QString m_projectName;
+    bool m_allowHardlinks;
+    QThreadPool m_pool;
+    QFuture<void> m_worker;
+    QAtomicInt m_abort;
+    /** @brief Index of the next file to be processed by a copy worker. */
+    QAtomicInt m_nextItem;
+    QAtomicInt m_lastProgress;
+    QAtomicInteger<qint64> m_processedSize;
+    qint64 m_totalSize;
+    QMutex m_errorMutex;
+    QString m_error;
+    void prepare(const QMap<QString, QString> &files);
+    void setError(const QString &error);
+    /** @brief Count processed bytes and emit progress when the percentage changed. */
+    void addProgress(qint64 size);
+    /** @brief Copy worker, processes files until all are done or an error occurred. */
+    void copyFiles();
+    bool copyFile(CopyItem &item);
+    /** @brief Clone or hard link a file if source and destination are on the same filesystem. */
+    bool linkFile(const QString &source, const QString &destination) const;
+    /** @brief Write a file to the archive, reading it only once for the archive and its checksum. */
+    bool streamFile(KArchive &archive, CopyItem &item, const QString &user, const QString &group);
+    QByteArray manifest() const;
+    void doCopy();
+    void doArchive();
+
+signals:
+    void progress(int percent);
+    void finished(bool success, const QString &message);
+};
+
+#endif
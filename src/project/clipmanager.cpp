@@ -21,6 +21,9 @@
 #include "mltcontroller/clipcontroller.h"
 #include "kdenlivesettings.h"
 #include "doc/kthumb.h"
+#include "doc/thumbnailstore.h"
+#include "doc/analysisstore.h"
+#include "doc/cacheaccounting.h"
 #include "bin/bincommands.h"
 #include "doc/kdenlivedoc.h"
 #include "project/projectmanager.h"
@@ -57,9 +60,9 @@ ClipManager::ClipManager(KdenliveDoc *doc) :
     m_closing(false),
     m_abortAudioThumb(false)
 {
-    KImageCache::deleteCache(QStringLiteral("kdenlive-thumbs"));
-    pixmapCache = new KImageCache(QStringLiteral("kdenlive-thumbs"), 10000000);
-    pixmapCache->setEvictionPolicy(KSharedDataCache::EvictOldest);
+    thumbnailStore = new ThumbnailStore();
+    analysisStore = new AnalysisStore();
+    cacheAccounting = new CacheAccounting(thumbnailStore);
 }
 
 ClipManager::~ClipManager()
@@ -74,7 +77,9 @@ ClipManager::~ClipManager()
     m_audioThumbsQueue.clear();
     m_thumbsMutex.unlock();
 
-    delete pixmapCache;
+    delete cacheAccounting;
+    delete thumbnailStore;
+    delete analysisStore;
 }
 
 void ClipManager::clear()
@@ -91,12 +96,12 @@ void ClipManager::clear()
     m_abortAudioThumb = false;
     m_folderList.clear();
     m_modifiedClips.clear();
-    pixmapCache->clear();
+    thumbnailStore->clearMemory();
 }
 
 void ClipManager::clearCache()
 {
-    pixmapCache->clear();
+    thumbnailStore->clearMemory();
 }
 
 void ClipManager::slotRequestThumbs(const QString &id, const QList<int> &frames)
@@ -27,11 +27,13 @@
 
 #include <QUrl>
 #include <KIO/CopyJob>
-#include <kimagecache.h>
 
 #include "gentime.h"
 #include "definitions.h"
 
+class ThumbnailStore;
+class AnalysisStore;
+class CacheAccounting;
 class KdenliveDoc;
 class AbstractGroupItem;
 class QUndoCommand;
@@ -83,7 +85,12 @@ Q_OBJECT public:
     /** @brief remove a clip id from the queue list. */
     void stopThumbs(const QString &id);
     void projectTreeThumbReady(const QString &id, int frame, const QImage &img, int type);
-    KImageCache *pixmapCache;
+    /** @brief Video thumbnails of the project, shared by bin, timeline and monitor. */
+    ThumbnailStore *thumbnailStore;
+    /** @brief Clip analysis data of the project. */
+    AnalysisStore *analysisStore;
+    /** @brief Disk space used by the project's cache folders. */
+    CacheAccounting *cacheAccounting;
 
 public slots:
     /** @brief Request creation of a clip thumbnail for specified frames. */
@@ -18,9 +18,12 @@
  ***************************************************************************/
 
 #include "cliptranscode.h"
+#include "transcodequeue.h"
 #include "kdenlivesettings.h"
 
+#include <QDir>
 #include <QFontDatabase>
+#include <QSet>
 #include <QStandardPaths>
 
 #include <KMessageBox>
@@ -28,7 +31,7 @@
 #include <kio_version.h>
 
 ClipTranscode::ClipTranscode(const QStringList &urls, const QString &params, const QStringList &postParams, const QString &description, const QStringList &folderInfo, bool automaticMode, QWidget *parent) :
-    QDialog(parent), m_urls(urls), m_folderInfo(folderInfo), m_duration(0), m_automaticMode(automaticMode), m_postParams(postParams)
+    QDialog(parent), m_urls(urls), m_folderInfo(folderInfo), m_automaticMode(automaticMode), m_failedJobs(0), m_postParams(postParams)
 {
     setFont(QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont));
     setupUi(this);
@@ -101,9 +104,10 @@ ClipTranscode::ClipTranscode(const QStringList &urls, const QString &params, con
 
     connect(button_start, &QAbstractButton::clicked, this, &ClipTranscode::slotStartTransCode);
 
-    m_transcodeProcess.setProcessChannelMode(QProcess::MergedChannels);
-    connect(&m_transcodeProcess, &QProcess::readyReadStandardOutput, this, &ClipTranscode::slotShowTranscodeInfo);
-    connect(&m_transcodeProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &ClipTranscode::slotTranscodeFinished);
+    m_transcodeQueue = new TranscodeQueue(this);
+    connect(m_transcodeQueue, &TranscodeQueue::overallProgress, job_progress, &QProgressBar::setValue);
+    connect(m_transcodeQueue, &TranscodeQueue::jobFinished, this, &ClipTranscode::slotJobFinished);
+    connect(m_transcodeQueue, &TranscodeQueue::finished, this, &ClipTranscode::slotTranscodeFinished);
 
     ffmpeg_params->setMaximumHeight(QFontMetrics(font()).lineSpacing() * 5);
 
@@ -113,61 +117,90 @@ ClipTranscode::ClipTranscode(const QStringList &urls, const QString &params, con
 ClipTranscode::~ClipTranscode()
 {
     KdenliveSettings::setAdd_new_clip(auto_add->isChecked());
-    if (m_transcodeProcess.state() != QProcess::NotRunning) {
-        m_transcodeProcess.close();
-    }
+    delete m_transcodeQueue;
     delete m_infoMessage;
 }
 
 void ClipTranscode::slotStartTransCode()
 {
-    if (m_transcodeProcess.state() != QProcess::NotRunning) {
+    if (m_transcodeQueue->isRunning()) {
         return;
     }
     if (KdenliveSettings::ffmpegpath().isEmpty()) {
         //FFmpeg not detected, cannot process the Job
         log_text->setPlainText(i18n("FFmpeg not found, please set path in Kdenlive's settings Environment"));
-        slotTranscodeFinished(1, QProcess::CrashExit);
+        m_failedJobs = 1;
+        slotTranscodeFinished();
         return;
     }
-    m_duration = 0;
-    m_destination.clear();
+    m_jobs.clear();
+    m_destinations.clear();
+    m_failedJobs = 0;
     m_infoMessage->animatedHide();
-    QStringList parameters;
-    QString destination;
     QString params = ffmpeg_params->toPlainText().simplified();
-    if (!m_urls.isEmpty() && urls_list->count() > 0) {
-        // We are processing multiple clips
-        source_url->setUrl(QUrl::fromLocalFile(m_urls.takeFirst()));
-        destination = QDir(dest_url->url().toLocalFile()).absoluteFilePath(source_url->url().fileName());
-        QList<QListWidgetItem *> matching = urls_list->findItems(source_url->url().toLocalFile(), Qt::MatchExactly);
-        if (!matching.isEmpty()) {
-            matching.at(0)->setFlags(Qt::ItemIsSelectable);
-            urls_list->setCurrentItem(matching.at(0));
-        }
-    } else {
-        destination = dest_url->url().toLocalFile().section(QLatin1Char('.'), 0, -2);
-    }
     QString extension = params.section(QStringLiteral("%1"), 1, 1).section(QLatin1Char(' '), 0, 0);
-    QString s_url = source_url->url().toLocalFile();
-    if (params.contains(QLatin1String("-i "))) {
-        // Filename must be inserted later
+    const bool multipleClips = urls_list->count() > 0;
+    QStringList sources;
+    if (multipleClips) {
+        sources = m_urls;
     } else {
-        parameters << QStringLiteral("-i") << s_url;
+        sources << source_url->url().toLocalFile();
     }
-    if (QFile::exists(destination + extension)) {
-        if (KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", destination + extension)) == KMessageBox::No) {
-            // Abort operation
-            if (m_automaticMode) {
-                // inform caller that we aborted
-                emit transcodedClip(source_url->url(), QUrl());
-                close();
+    // Check all destinations before starting, so that all files can be processed at once
+    QMap<QString, QStringList> jobs;
+    QSet<QString> outputs;
+    for (const QString &s_url : sources) {
+        QString destination;
+        if (multipleClips) {
+            destination = QDir(dest_url->url().toLocalFile()).absoluteFilePath(QUrl::fromLocalFile(s_url).fileName());
+            // Sources with the same file name in different folders must not write to the same file
+            const QString baseName = destination;
+            for (int suffix = 1; outputs.contains(destination + extension); ++suffix) {
+                destination = baseName + QStringLiteral("-%1").arg(suffix);
+            }
+        } else {
+            destination = dest_url->url().toLocalFile().section(QLatin1Char('.'), 0, -2);
+        }
+        QStringList parameters = transcodeParameters(params, s_url, destination);
+        if (QFile::exists(destination + extension) && !TranscodeQueue::hasValidOutput(s_url, destination + extension, parameters)) {
+            if (KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", destination + extension)) == KMessageBox::No) {
+                // Abort operation
+                if (m_automaticMode) {
+                    // inform caller that we aborted
+                    emit transcodedClip(QUrl::fromLocalFile(s_url), QUrl());
+                    close();
+                }
+                return;
             }
-            return;
+            parameters.prepend(QStringLiteral("-y"));
         }
-        parameters << QStringLiteral("-y");
+        jobs.insert(s_url, parameters);
+        m_destinations.insert(s_url, destination + extension);
+        outputs.insert(destination + extension);
     }
+    buttonBox->button(QDialogButtonBox::Abort)->setText(i18n("Abort"));
+    source_url->setEnabled(false);
+    dest_url->setEnabled(false);
+    button_start->setEnabled(false);
+    log_text->setHidden(true);
+    job_progress->setValue(0);
+    job_progress->setHidden(false);
+    QMapIterator<QString, QStringList> i(jobs);
+    while (i.hasNext()) {
+        i.next();
+        const int id = m_transcodeQueue->addJob(i.key(), m_destinations.value(i.key()), i.value());
+        m_jobs.insert(id, i.key());
+    }
+}
 
+QStringList ClipTranscode::transcodeParameters(const QString &params, const QString &source, const QString &destination) const
+{
+    QStringList parameters;
+    if (params.contains(QLatin1String("-i "))) {
+        // Filename must be inserted later
+    } else {
+        parameters << QStringLiteral("-i") << source;
+    }
     bool replaceVfParams = false;
     const QStringList splitted = params.split(QLatin1Char(' '));
     for (QString s : splitted) {
@@ -181,88 +214,52 @@ void ClipTranscode::slotStartTransCode()
             parameters << s;
         } else if (s == QLatin1String("-i")) {
             parameters << s;
-            parameters << s_url;
+            parameters << source;
         } else {
             parameters << s;
         }
     }
-    buttonBox->button(QDialogButtonBox::Abort)->setText(i18n("Abort"));
-    m_destination = destination + extension;
-    m_transcodeProcess.start(KdenliveSettings::ffmpegpath(), parameters);
-    source_url->setEnabled(false);
-    dest_url->setEnabled(false);
-    button_start->setEnabled(false);
-
+    return parameters;
 }
 
-void ClipTranscode::slotShowTranscodeInfo()
+void ClipTranscode::slotJobFinished(int id, bool success, bool reused)
 {
-    QString log = QString::fromLatin1(m_transcodeProcess.readAll());
-    if (m_duration == 0) {
-        if (log.contains(QStringLiteral("Duration:"))) {
-            QString duration = log.section(QStringLiteral("Duration:"), 1, 1).section(QLatin1Char(','), 0, 0).simplified();
-            QStringList numbers = duration.split(QLatin1Char(':'));
-            if (numbers.size() < 3) {
-                return;
-            }
-            m_duration = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
-            log_text->setHidden(true);
-            job_progress->setHidden(false);
-        } else {
-            log_text->setHidden(false);
-            job_progress->setHidden(true);
+    Q_UNUSED(reused)
+    const QString source = m_jobs.value(id);
+    QList<QListWidgetItem *> matching = urls_list->findItems(source, Qt::MatchExactly);
+    if (!matching.isEmpty()) {
+        matching.at(0)->setFlags(Qt::ItemIsSelectable);
+    }
+    if (!success) {
+        m_failedJobs++;
+        log_text->setPlainText(m_transcodeQueue->log(id));
+        if (m_automaticMode) {
+            emit transcodedClip(QUrl::fromLocalFile(source), QUrl());
         }
-    } else if (log.contains(QStringLiteral("time="))) {
-        int progress;
-        QString time = log.section(QStringLiteral("time="), 1, 1).simplified().section(QLatin1Char(' '), 0, 0);
-        if (time.contains(QLatin1Char(':'))) {
-            QStringList numbers = time.split(QLatin1Char(':'));
-            if (numbers.size() < 3) {
-                return;
-            }
-            progress = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
+        return;
+    }
+    if (auto_add->isChecked() || m_automaticMode) {
+        const QUrl url = QUrl::fromLocalFile(m_destinations.value(source));
+        if (m_automaticMode) {
+            emit transcodedClip(QUrl::fromLocalFile(source), url);
         } else {
-            progress = (int) time.toDouble();
+            emit addClip(url, m_folderInfo);
         }
-        job_progress->setValue((int)(100.0 * progress / m_duration));
     }
-    log_text->setPlainText(log);
 }
 
-void ClipTranscode::slotTranscodeFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void ClipTranscode::slotTranscodeFinished()
 {
     buttonBox->button(QDialogButtonBox::Abort)->setText(i18n("Close"));
     button_start->setEnabled(true);
     source_url->setEnabled(true);
     dest_url->setEnabled(true);
-    m_duration = 0;
-
-    if (QFileInfo(m_destination).size() <= 0) {
-        // Destination file does not exist, transcoding failed
-        exitCode = 1;
+    for (int i = 0; i < urls_list->count(); ++i) {
+        urls_list->item(i)->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
     }
-    if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
+    if (m_failedJobs == 0) {
         log_text->setHtml(log_text->toPlainText() + QStringLiteral("<br /><b>") + i18n("Transcoding finished."));
-        if (auto_add->isChecked() || m_automaticMode) {
-            QUrl url;
-            if (urls_list->count() > 0) {
-                QString params = ffmpeg_params->toPlainText().simplified();
-                QString extension = params.section(QStringLiteral("%1"), 1, 1).section(QLatin1Char(' '), 0, 0);
-                url = QUrl::fromLocalFile(dest_url->url().toLocalFile() + QDir::separator() + source_url->url().fileName() + extension);
-            } else {
-                url = dest_url->url();
-            }
-            if (m_automaticMode) {
-                emit transcodedClip(source_url->url(), url);
-            } else {
-                emit addClip(url, m_folderInfo);
-            }
-        }
-        if (urls_list->count() > 0 && m_urls.count() > 0) {
-            m_transcodeProcess.close();
-            slotStartTransCode();
-            return;
-        } else if (auto_close->isChecked()) {
+        if (auto_close->isChecked()) {
             accept();
         } else {
             m_infoMessage->setMessageType(KMessageWidget::Positive);
@@ -275,15 +272,6 @@ void ClipTranscode::slotTranscodeFinished(int exitCode, QProcess::ExitStatus exi
         m_infoMessage->animatedShow();
         log_text->setVisible(true);
     }
-    m_transcodeProcess.close();
-
-    //Refill url list in case user wants to transcode to another format
-    if (urls_list->count() > 0) {
-        m_urls.clear();
-        for (int i = 0; i < urls_list->count(); ++i) {
-            m_urls << urls_list->item(i)->text();
-        }
-    }
 }
 
 void ClipTranscode::slotUpdateParams(int ix)
@@ -25,7 +25,9 @@
 #include <QUrl>
 #include <KMessageWidget>
 
-#include <QProcess>
+#include <QMap>
+
+class TranscodeQueue;
 
 class ClipTranscode : public QDialog, public Ui::ClipTranscode_UI
 {
@@ -39,20 +41,24 @@ public slots:
     void slotStartTransCode();
 
 private slots:
-    void slotShowTranscodeInfo();
-    void slotTranscodeFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void slotJobFinished(int id, bool success, bool reused);
+    void slotTranscodeFinished();
     void slotUpdateParams(int ix = -1);
 
 private:
-    QProcess m_transcodeProcess;
+    TranscodeQueue *m_transcodeQueue;
     QStringList m_urls;
     QStringList m_folderInfo;
-    int m_duration;
     bool m_automaticMode;
-    /** @brief The path for destination transcoded file. */
-    QString m_destination;
+    /** @brief Source file of each running transcode job. */
+    QMap<int, QString> m_jobs;
+    /** @brief The path for destination transcoded file of each source file. */
+    QMap<QString, QString> m_destinations;
+    int m_failedJobs;
     QStringList m_postParams;
     KMessageWidget *m_infoMessage;
+    /** @brief Build the FFmpeg arguments for one file. */
+    QStringList transcodeParameters(const QString &params, const QString &source, const QString &destination) const;
 
 signals:
     void addClip(const QUrl &url, const QStringList &folderInfo = QStringList());
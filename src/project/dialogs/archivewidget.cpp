@@ -18,6 +18,7 @@
  ***************************************************************************/
 
 #include "archivewidget.h"
+#include "project/archivecopier.h"
 #include "projectsettings.h"
 #include "titler/titlewidget.h"
 #include "mltcontroller/clipcontroller.h"
@@ -37,11 +38,12 @@
 ArchiveWidget::ArchiveWidget(const QString &projectName, const QDomDocument &doc, const QList<ClipController *> &list, const QStringList &luma_list, QWidget *parent) :
     QDialog(parent)
     , m_requestedSize(0)
-    , m_copyJob(nullptr)
+    , m_copier(new ArchiveCopier(this))
     , m_name(projectName.section(QLatin1Char('.'), 0, -2))
     , m_doc(doc)
     , m_temp(nullptr)
     , m_abortArchive(false)
+    , m_closeRequested(false)
     , m_extractMode(false)
     , m_progressTimer(nullptr)
     , m_extractArchive(nullptr)
@@ -52,8 +54,8 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QDomDocument &doc
     setWindowTitle(i18n("Archive Project"));
     archive_url->setUrl(QUrl::fromLocalFile(QDir::homePath()));
     connect(archive_url, &KUrlRequester::textChanged, this, &ArchiveWidget::slotCheckSpace);
-    connect(this, SIGNAL(archivingFinished(bool)), this, SLOT(slotArchivingFinished(bool)));
-    connect(this, SIGNAL(archiveProgress(int)), this, SLOT(slotArchivingProgress(int)));
+    connect(m_copier, &ArchiveCopier::finished, this, &ArchiveWidget::slotArchivingFinished);
+    connect(m_copier, &ArchiveCopier::progress, this, &ArchiveWidget::slotArchivingProgress);
     connect(proxy_only, &QCheckBox::stateChanged, this, &ArchiveWidget::slotProxyOnly);
 
     // Setup categories
@@ -211,9 +213,10 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QDomDocument &doc
 ArchiveWidget::ArchiveWidget(const QUrl &url, QWidget *parent):
     QDialog(parent),
     m_requestedSize(0),
-    m_copyJob(nullptr),
+    m_copier(nullptr),
     m_temp(nullptr),
     m_abortArchive(false),
+    m_closeRequested(false),
     m_extractMode(true),
     m_extractUrl(url),
     m_extractArchive(nullptr),
@@ -232,6 +235,7 @@ ArchiveWidget::ArchiveWidget(const QUrl &url, QWidget *parent):
 
     compressed_archive->setHidden(true);
     proxy_only->setHidden(true);
+    link_files->setHidden(true);
     project_files->setHidden(true);
     files_list->setHidden(true);
     label->setText(i18n("Extract to"));
@@ -314,13 +318,21 @@ void ArchiveWidget::closeEvent(QCloseEvent *e)
 bool ArchiveWidget::closeAccepted()
 {
     if (!m_extractMode && !archive_url->isEnabled()) {
+        if (m_abortArchive) {
+            // Already stopping, the dialog closes once the copy returned
+            m_closeRequested = true;
+            return false;
+        }
         // Archiving in progress, should we stop?
         if (KMessageBox::warningContinueCancel(this, i18n("Archiving in progress, do you want to stop it?"), i18n("Stop Archiving"), KGuiItem(i18n("Stop Archiving"))) != KMessageBox::Continue) {
             return false;
         }
-        if (m_copyJob) {
-            m_copyJob->kill();
-        }
+        // Do not wait for the copy workers here, close in slotArchivingFinished
+        m_abortArchive = true;
+        m_closeRequested = true;
+        m_copier->abort();
+        buttonBox->setEnabled(false);
+        return false;
     }
     return true;
 }
@@ -500,190 +512,116 @@ void ArchiveWidget::slotCheckSpace()
     }
 }
 
-bool ArchiveWidget::slotStartArchiving(bool firstPass)
+void ArchiveWidget::slotStartArchiving()
 {
-    if (firstPass && (m_copyJob || m_archiveThread.isRunning())) {
-        // archiving in progress, abort
-        if (m_copyJob) {
-            m_copyJob->kill(KJob::EmitResult);
-        }
+    if (m_copier->isRunning()) {
+        // archiving in progress, abort. The interface is restored in slotArchivingFinished
         m_abortArchive = true;
-        return true;
+        m_copier->abort();
+        buttonBox->button(QDialogButtonBox::Apply)->setEnabled(false);
+        return;
     }
     bool isArchive = compressed_archive->isChecked();
-    if (!firstPass) {
-        m_copyJob = nullptr;
-    } else {
-        //starting archiving
-        m_abortArchive = false;
-        m_duplicateFiles.clear();
-        m_replacementList.clear();
-        m_foldersList.clear();
-        m_filesList.clear();
-        slotDisplayMessage(QStringLiteral("system-run"), i18n("Archiving..."));
-        repaint();
-        archive_url->setEnabled(false);
-        proxy_only->setEnabled(false);
-        compressed_archive->setEnabled(false);
+    if (isArchive) {
+        QString archiveName(archive_url->url().toLocalFile() + QDir::separator() + m_name + QStringLiteral(".tar.gz"));
+        if (QFile::exists(archiveName) && KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", archiveName)) == KMessageBox::No) {
+            return;
+        }
     }
-    QList<QUrl> files;
-    QUrl destUrl;
-    QString destPath;
-    QTreeWidgetItem *parentItem;
-    bool isSlideshow = false;
-    int items = 0;
-
-    // We parse all files going into one folder, then start the copy job
+    //starting archiving
+    m_abortArchive = false;
+    m_replacementList.clear();
+    m_foldersList.clear();
+    m_filesList.clear();
+    slotDisplayMessage(QStringLiteral("system-run"), i18n("Archiving..."));
+    repaint();
+    archive_url->setEnabled(false);
+    proxy_only->setEnabled(false);
+    compressed_archive->setEnabled(false);
+    link_files->setEnabled(false);
+    files_list->setEnabled(false);
+
+    // Build the list of all files with their path relative to the archive folder
     for (int i = 0; i < files_list->topLevelItemCount(); ++i) {
-        parentItem = files_list->topLevelItem(i);
-        if (parentItem->isDisabled()) {
-            parentItem->setExpanded(false);
+        QTreeWidgetItem *parentItem = files_list->topLevelItem(i);
+        if (parentItem->childCount() == 0) {
             continue;
         }
-        if (parentItem->childCount() > 0) {
-            if (parentItem->data(0, Qt::UserRole).toString() == QLatin1String("slideshows")) {
-                QUrl slideFolder = QUrl::fromLocalFile(archive_url->url().toLocalFile() + QStringLiteral("/slideshows"));
-                if (isArchive) {
-                    m_foldersList.append(QStringLiteral("slideshows"));
-                } else {
-                    QDir dir(slideFolder.toLocalFile());
-                    if (!dir.mkpath(QStringLiteral("."))) {
-                        KMessageBox::sorry(this, i18n("Cannot create directory %1", slideFolder.toLocalFile()));
-                    }
-                }
-                isSlideshow = true;
-            } else {
-                isSlideshow = false;
+        const QString destPath = parentItem->data(0, Qt::UserRole).toString() + QLatin1Char('/');
+        bool isSlideshow = parentItem->data(0, Qt::UserRole).toString() == QLatin1String("slideshows");
+        m_foldersList.append(destPath);
+        for (int j = 0; j < parentItem->childCount(); ++j) {
+            QTreeWidgetItem *item = parentItem->child(j);
+            if (item->isDisabled()) {
+                continue;
             }
-            files_list->setCurrentItem(parentItem);
-            parentItem->setExpanded(true);
-            destPath = parentItem->data(0, Qt::UserRole).toString() + QLatin1Char('/');
-            destUrl = QUrl::fromLocalFile(archive_url->url().toLocalFile() + QLatin1Char('/') + destPath);
-            QTreeWidgetItem *item;
-            for (int j = 0; j < parentItem->childCount(); ++j) {
-                item = parentItem->child(j);
-                if (item->isDisabled()) {
-                    continue;
+            if (isSlideshow) {
+                const QString slidePath = destPath + item->data(0, Qt::UserRole).toString() + QLatin1Char('/');
+                m_foldersList.append(slidePath);
+                const QStringList srcFiles = item->data(0, Qt::UserRole + 1).toStringList();
+                for (const QString &src : srcFiles) {
+                    m_filesList.insert(src, slidePath + QFileInfo(src).fileName());
                 }
-                // Special case: slideshows
-                items++;
-                if (isSlideshow) {
-                    destPath += item->data(0, Qt::UserRole).toString() + QLatin1Char('/');
-                    destUrl = QUrl::fromLocalFile(archive_url->url().toLocalFile() + QDir::separator() + destPath);
-                    QStringList srcFiles = item->data(0, Qt::UserRole + 1).toStringList();
-                    for (int k = 0; k < srcFiles.count(); ++k) {
-                        files << QUrl::fromLocalFile(srcFiles.at(k));
-                    }
-                    item->setDisabled(true);
-                    if (parentItem->indexOfChild(item) == parentItem->childCount() - 1) {
-                        // We have processed all slideshows
-                        parentItem->setDisabled(true);
-                    }
-                    break;
-                } else if (item->data(0, Qt::UserRole).isNull()) {
-                    files << QUrl::fromLocalFile(item->text(0));
-                } else {
-                    // We must rename the destination file, since another file with same name exists
-                    //TODO: monitor progress
-                    if (isArchive) {
-                        m_filesList.insert(item->text(0), destPath + item->data(0, Qt::UserRole).toString());
-                    } else {
-                        m_duplicateFiles.insert(QUrl::fromLocalFile(item->text(0)), QUrl::fromLocalFile(destUrl.toLocalFile() + QLatin1Char('/') + item->data(0, Qt::UserRole).toString()));
-                    }
-                }
-            }
-            if (!isSlideshow) {
-                parentItem->setDisabled(true);
+            } else if (item->data(0, Qt::UserRole).isNull()) {
+                m_filesList.insert(item->text(0), destPath + QFileInfo(item->text(0)).fileName());
+            } else {
+                // We must rename the destination file, since another file with same name exists
+                m_filesList.insert(item->text(0), destPath + item->data(0, Qt::UserRole).toString());
             }
-            break;
-        }
-    }
-
-    if (items == 0) {
-        // No clips to archive
-        slotArchivingFinished(nullptr, true);
-        return true;
-    }
-
-    if (destPath.isEmpty()) {
-        if (m_duplicateFiles.isEmpty()) {
-            return false;
-        }
-        QMapIterator<QUrl, QUrl> i(m_duplicateFiles);
-        if (i.hasNext()) {
-            i.next();
-            QUrl startJobSrc = i.key();
-            QUrl startJobDst = i.value();
-            m_duplicateFiles.remove(startJobSrc);
-            KIO::CopyJob *job = KIO::copyAs(startJobSrc, startJobDst, KIO::HideProgressInfo);
-            connect(job, SIGNAL(result(KJob *)), this, SLOT(slotArchivingFinished(KJob *)));
-            connect(job, SIGNAL(processedSize(KJob *, KIO::filesize_t)), this, SLOT(slotArchivingProgress(KJob *, KIO::filesize_t)));
         }
-        return true;
     }
 
+    progressBar->setValue(0);
+    buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Abort"));
     if (isArchive) {
-        m_foldersList.append(destPath);
-        for (int i = 0; i < files.count(); ++i) {
-            m_filesList.insert(files.at(i).toLocalFile(), destPath + files.at(i).fileName());
+        // Files are streamed to the archive once the project file is ready
+        if (!processProjectFile()) {
+            slotArchivingFinished(false, QString());
         }
-        slotArchivingFinished();
-    } else if (files.isEmpty()) {
-        slotStartArchiving(false);
     } else {
-        QDir dir(destUrl.toLocalFile());
-        if (!dir.mkpath(QStringLiteral("."))) {
-            KMessageBox::sorry(this, i18n("Cannot create directory %1", destUrl.toLocalFile()));
-        }
-        m_copyJob = KIO::copy(files, destUrl, KIO::HideProgressInfo);
-        connect(m_copyJob, SIGNAL(result(KJob *)), this, SLOT(slotArchivingFinished(KJob *)));
-        connect(m_copyJob, SIGNAL(processedSize(KJob *, KIO::filesize_t)), this, SLOT(slotArchivingProgress(KJob *, KIO::filesize_t)));
-    }
-    if (firstPass) {
-        progressBar->setValue(0);
-        buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Abort"));
+        m_copier->copyToFolder(m_filesList, archive_url->url().toLocalFile(), link_files->isChecked());
     }
-    return true;
 }
 
-void ArchiveWidget::slotArchivingFinished(KJob *job, bool finished)
+void ArchiveWidget::slotArchivingFinished(bool success, const QString &message)
 {
-    if (job == nullptr || job->error() == 0) {
-        if (!finished && slotStartArchiving(false)) {
-            // We still have files to archive
-            return;
-        } else if (!compressed_archive->isChecked()) {
-            // Archiving finished
-            progressBar->setValue(100);
-            if (processProjectFile()) {
-                slotJobResult(true, i18n("Project was successfully archived."));
-            } else {
-                slotJobResult(false, i18n("There was an error processing project file"));
-            }
-        } else {
-            processProjectFile();
+    bool isArchive = compressed_archive->isChecked();
+    if (success && !isArchive) {
+        // Files are copied, write the project file
+        success = processProjectFile();
+    }
+    delete m_temp;
+    m_temp = nullptr;
+    if (success) {
+        progressBar->setValue(100);
+        slotJobResult(true, i18n("Project was successfully archived."));
+        if (isArchive) {
+            buttonBox->button(QDialogButtonBox::Apply)->setEnabled(false);
         }
+    } else if (m_abortArchive) {
+        slotJobResult(false, i18n("Archiving was aborted"));
+        buttonBox->button(QDialogButtonBox::Apply)->setEnabled(true);
+    } else if (!message.isEmpty()) {
+        slotJobResult(false, i18n("There was an error while copying the files: %1", message));
     } else {
-        m_copyJob = nullptr;
-        slotJobResult(false, i18n("There was an error while copying the files: %1", job->errorString()));
+        slotJobResult(false, i18n("There was an error processing project file"));
     }
-    if (!compressed_archive->isChecked()) {
-        buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Archive"));
-        archive_url->setEnabled(true);
-        proxy_only->setEnabled(true);
-        compressed_archive->setEnabled(true);
-        for (int i = 0; i < files_list->topLevelItemCount(); ++i) {
-            files_list->topLevelItem(i)->setDisabled(false);
-            for (int j = 0; j < files_list->topLevelItem(i)->childCount(); ++j) {
-                files_list->topLevelItem(i)->child(j)->setDisabled(false);
-            }
-        }
+    buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Archive"));
+    archive_url->setEnabled(true);
+    proxy_only->setEnabled(true);
+    compressed_archive->setEnabled(true);
+    link_files->setEnabled(true);
+    files_list->setEnabled(true);
+    buttonBox->setEnabled(true);
+    if (m_closeRequested) {
+        m_closeRequested = false;
+        reject();
     }
 }
 
-void ArchiveWidget::slotArchivingProgress(KJob *, KIO::filesize_t size)
+void ArchiveWidget::slotArchivingProgress(int p)
 {
-    progressBar->setValue(static_cast<int>(100 * size / m_requestedSize));
+    progressBar->setValue(p);
 }
 
 bool ArchiveWidget::processProjectFile()
@@ -841,7 +779,8 @@ bool ArchiveWidget::processProjectFile()
         }
         m_temp->write(playList.toUtf8());
         m_temp->close();
-        m_archiveThread = QtConcurrent::run(this, &ArchiveWidget::createArchive);
+        QString archiveName(archive_url->url().toLocalFile() + QDir::separator() + m_name + QStringLiteral(".tar.gz"));
+        m_copier->writeArchive(m_filesList, m_foldersList, archiveName, m_temp->fileName(), m_name + QStringLiteral(".kdenlive"));
         return true;
     }
 
@@ -866,70 +805,6 @@ bool ArchiveWidget::processProjectFile()
     return true;
 }
 
-void ArchiveWidget::createArchive()
-{
-    QString archiveName(archive_url->url().toLocalFile() + QDir::separator() + m_name + QStringLiteral(".tar.gz"));
-    if (QFile::exists(archiveName) && KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", archiveName)) == KMessageBox::No) {
-        return;
-    }
-    QFileInfo dirInfo(archive_url->url().toLocalFile());
-    QString user = dirInfo.owner();
-    QString group = dirInfo.group();
-    KTar archive(archiveName, QStringLiteral("application/x-gzip"));
-    archive.open(QIODevice::WriteOnly);
-
-    // Create folders
-    foreach (const QString &path, m_foldersList) {
-        archive.writeDir(path, user, group);
-    }
-
-    // Add files
-    int ix = 0;
-    QMapIterator<QString, QString> i(m_filesList);
-    while (i.hasNext()) {
-        i.next();
-        archive.addLocalFile(i.key(), i.value());
-        emit archiveProgress((int) 100 * ix / m_filesList.count());
-        ix++;
-    }
-
-    // Add project file
-    bool result = false;
-    if (m_temp) {
-        archive.addLocalFile(m_temp->fileName(), m_name + QStringLiteral(".kdenlive"));
-        result = archive.close();
-        delete m_temp;
-        m_temp = nullptr;
-    }
-    emit archivingFinished(result);
-}
-
-void ArchiveWidget::slotArchivingFinished(bool result)
-{
-    if (result) {
-        slotJobResult(true, i18n("Project was successfully archived."));
-        buttonBox->button(QDialogButtonBox::Apply)->setEnabled(false);
-    } else {
-        slotJobResult(false, i18n("There was an error processing project file"));
-    }
-    progressBar->setValue(100);
-    buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Archive"));
-    archive_url->setEnabled(true);
-    proxy_only->setEnabled(true);
-    compressed_archive->setEnabled(true);
-    for (int i = 0; i < files_list->topLevelItemCount(); ++i) {
-        files_list->topLevelItem(i)->setDisabled(false);
-        for (int j = 0; j < files_list->topLevelItem(i)->childCount(); ++j) {
-            files_list->topLevelItem(i)->child(j)->setDisabled(false);
-        }
-    }
-}
-
-void ArchiveWidget::slotArchivingProgress(int p)
-{
-    progressBar->setValue(p);
-}
-
 void ArchiveWidget::slotStartExtracting()
 {
     if (m_archiveThread.isRunning()) {
@@ -967,6 +842,8 @@ void ArchiveWidget::doExtracting()
 {
     m_extractArchive->directory()->copyTo(archive_url->url().toLocalFile() + QDir::separator());
     m_extractArchive->close();
+    emit showMessage(QStringLiteral("system-run"), i18n("Verifying files..."));
+    m_corruptedFiles = ArchiveCopier::verify(archive_url->url().toLocalFile());
     emit extractingFinished();
 }
 
@@ -1006,6 +883,9 @@ void ArchiveWidget::slotExtractingFinished()
         KMessageBox::sorry(QApplication::activeWindow(), i18n("Cannot open project file %1", extractedProjectFile()), i18n("Cannot open file"));
         reject();
     } else {
+        if (!m_corruptedFiles.isEmpty()) {
+            KMessageBox::errorList(QApplication::activeWindow(), i18n("The following files do not match the archived data, they may be corrupted."), m_corruptedFiles);
+        }
         accept();
     }
 }
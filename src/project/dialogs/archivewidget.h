@@ -23,7 +23,6 @@
 #include "ui_archivewidget_ui.h"
 
 #include <kio/global.h>
-#include <KIO/CopyJob>
 #include <QTemporaryFile>
 
 #include <QDialog>
@@ -33,6 +32,7 @@
 
 class KJob;
 class KArchive;
+class ArchiveCopier;
 class ClipController;
 
 /**
@@ -57,14 +57,11 @@ public:
 
 private slots:
     void slotCheckSpace();
-    bool slotStartArchiving(bool firstPass = true);
-    void slotArchivingFinished(KJob *job = nullptr, bool finished = false);
-    void slotArchivingProgress(KJob *, KIO::filesize_t);
+    void slotStartArchiving();
     void done(int r) Q_DECL_OVERRIDE;
     bool closeAccepted();
-    void createArchive();
     void slotArchivingProgress(int);
-    void slotArchivingFinished(bool result);
+    void slotArchivingFinished(bool success, const QString &message);
     void slotStartExtracting();
     void doExtracting();
     void slotExtractingFinished();
@@ -80,13 +77,14 @@ protected:
 
 private:
     KIO::filesize_t m_requestedSize;
-    KIO::CopyJob *m_copyJob;
-    QMap<QUrl, QUrl> m_duplicateFiles;
+    ArchiveCopier *m_copier;
     QMap<QUrl, QUrl> m_replacementList;
     QString m_name;
     QDomDocument m_doc;
     QTemporaryFile *m_temp;
     bool m_abortArchive;
+    /** @brief The dialog should close once the aborted copy returned. */
+    bool m_closeRequested;
     QFuture<void> m_archiveThread;
     QStringList m_foldersList;
     QMap<QString, QString> m_filesList;
@@ -97,6 +95,8 @@ private:
     KArchive *m_extractArchive;
     int m_missingClips;
     KMessageWidget *m_infoMessage;
+    /** @brief Extracted files not matching the checksum manifest. */
+    QStringList m_corruptedFiles;
 
     /** @brief Generate tree widget subitems from a string list of urls. */
     void generateItems(QTreeWidgetItem *parentItem, const QStringList &items);
@@ -106,8 +106,6 @@ private:
     bool processProjectFile();
 
 signals:
-    void archivingFinished(bool);
-    void archiveProgress(int);
     void extractingFinished();
     void showMessage(const QString &, const QString &);
 };
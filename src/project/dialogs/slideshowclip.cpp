@@ -20,6 +20,7 @@
 #include "slideshowclip.h"
 #include "kdenlivesettings.h"
 #include "bin/projectclip.h"
+#include "utils/sequenceindex.h"
 
 #include <KFileItem>
 #include <klocalizedstring.h>
@@ -29,6 +30,7 @@
 #include <QFontDatabase>
 #include <QDir>
 #include <QStandardPaths>
+#include <QScrollBar>
 
 SlideshowClip::SlideshowClip(const Timecode &tc, QString clipFolder, ProjectClip *clip, QWidget *parent) :
     QDialog(parent),
@@ -49,6 +51,11 @@ SlideshowClip::SlideshowClip(const Timecode &tc, QString clipFolder, ProjectClip
     m_view.folder_url->setUrl(QUrl::fromLocalFile(KRecentDirs::dir(QStringLiteral(":KdenliveSlideShowFolder"))));
     m_view.icon_list->setIconSize(QSize(50, 50));
     m_view.show_thumbs->setChecked(KdenliveSettings::showslideshowthumbs());
+    m_thumbTimer.setSingleShot(true);
+    m_thumbTimer.setInterval(100);
+    connect(&m_thumbTimer, &QTimer::timeout, this, &SlideshowClip::slotGenerateThumbs);
+    connect(m_view.icon_list->verticalScrollBar(), &QAbstractSlider::valueChanged, this, &SlideshowClip::slotScrollThumbs);
+    connect(m_view.icon_list->horizontalScrollBar(), &QAbstractSlider::valueChanged, this, &SlideshowClip::slotScrollThumbs);
 
     connect(m_view.show_thumbs, &QCheckBox::stateChanged, this, &SlideshowClip::slotEnableThumbs);
     connect(m_view.slide_fade, &QCheckBox::stateChanged, this, &SlideshowClip::slotEnableLuma);
@@ -209,6 +216,13 @@ void SlideshowClip::slotEnableThumbs(int state)
 
 }
 
+void SlideshowClip::slotScrollThumbs()
+{
+    if (m_view.show_thumbs->isChecked()) {
+        m_thumbTimer.start();
+    }
+}
+
 void SlideshowClip::slotEnableLumaFile(int state)
 {
     bool enable = false;
@@ -235,19 +249,14 @@ void SlideshowClip::parseFolder()
 
     QIcon unknownicon(QStringLiteral("unknown"));
     QStringList result;
-    QStringList filters;
     QString filter;
     if (isMime) {
         // TODO: improve jpeg image detection with extension like jpeg, requires change in MLT image producers
         filter = m_view.image_type->itemData(m_view.image_type->currentIndex()).toString();
-        filters << QStringLiteral("*.") + filter;
-        dir.setNameFilters(filters);
-        result = dir.entryList(QDir::Files);
+        result = SequenceIndex::shared()->files(path, filter);
     } else {
         int offset = 0;
         QString path_pattern = m_view.pattern_url->text();
-        QDir abs_dir = QFileInfo(m_view.pattern_url->text()).absoluteDir();
-        result = abs_dir.entryList(QDir::Files);
         // find pattern
         if (path_pattern.contains(QLatin1Char('?'))) {
             // New MLT syntax
@@ -261,33 +270,22 @@ void SlideshowClip::parseFolder()
         }
         filter = QFileInfo(path_pattern).fileName();
         QString ext = filter.section(QLatin1Char('.'), -1);
+        int precision;
         if (filter.contains(QLatin1Char('%'))) {
+            precision = filter.section(QLatin1Char('%'), -1).section(QLatin1Char('d'), 0, 0).toInt();
             filter = filter.section(QLatin1Char('%'), 0, -2);
         } else {
             filter = filter.section(QLatin1Char('.'), 0, -2);
+            const int fullSize = filter.size();
             while (!filter.isEmpty() && filter.at(filter.count() - 1).isDigit()) {
                 filter.remove(filter.count() - 1, 1);
             }
+            precision = fullSize - filter.size();
+            // The sequence starts at the selected image, as when importing it
+            offset = QFileInfo(path_pattern).fileName().section(QLatin1Char('.'), 0, -2).right(precision).toInt();
         }
         // qCDebug(KDENLIVE_LOG) << " / /" << path_pattern << " / " << ext << " / " << filter;
-        QString regexp = QLatin1Char('^') + filter + QStringLiteral("\\d+\\.") + ext + QLatin1Char('$');
-        QRegExp rx(regexp);
-        QStringList entries;
-        int ix;
-        foreach (const QString &p, result) {
-            if (rx.exactMatch(p)) {
-                if (offset > 0) {
-                    // make sure our image is in the range we want (> begin)
-                    ix = p.section(filter, 1).section(QLatin1Char('.'), 0, 0).toInt();
-                    ix = p.section(filter, 1).section('.', 0, 0).toInt();
-                    if (ix < offset) {
-                        continue;
-                    }
-                }
-                entries << p;
-            }
-        }
-        result = entries;
+        result = SequenceIndex::shared()->sequence(QFileInfo(path_pattern).absolutePath(), filter, QLatin1Char('.') + ext, precision, offset);
     }
     foreach (const QString &p, result) {
         QListWidgetItem *item = new QListWidgetItem(unknownicon, p);
@@ -302,25 +300,39 @@ void SlideshowClip::parseFolder()
         m_view.label_info->setText(i18np("1 image found", "%1 images found", m_count));
     }
     if (m_view.show_thumbs->isChecked()) {
-        slotGenerateThumbs();
+        // Wait until the list is laid out to find the visible images
+        m_thumbTimer.start();
     }
     m_view.icon_list->setCurrentRow(0);
 }
 
 void SlideshowClip::slotGenerateThumbs()
 {
-    delete m_thumbJob;
+    if (m_thumbJob) {
+        disconnect(m_thumbJob, &KIO::PreviewJob::gotPreview, this, &SlideshowClip::slotSetPixmap);
+        m_thumbJob->kill();
+        delete m_thumbJob;
+        m_thumbJob = nullptr;
+    }
+    // Only create thumbnails for the visible images and the next page, sequences can have thousands of images
+    const QRect viewRect = m_view.icon_list->viewport()->rect();
+    const QRect visible = viewRect.adjusted(0, 0, viewRect.width(), viewRect.height());
+    const QModelIndex first = m_view.icon_list->indexAt(QPoint(1, 1));
     KFileItemList fileList;
-    for (int i = 0; i < m_view.icon_list->count(); ++i) {
+    for (int i = first.isValid() ? first.row() : 0; i < m_view.icon_list->count(); ++i) {
         QListWidgetItem *item = m_view.icon_list->item(i);
-        if (item) {
-            QString path = item->data(Qt::UserRole).toString();
-            if (!path.isEmpty()) {
-                KFileItem f(QUrl::fromLocalFile(path));
-                f.setDelayedMimeTypes(true);
-                fileList.append(f);
-            }
+        if (!item || !m_view.icon_list->visualItemRect(item).intersects(visible)) {
+            break;
         }
+        QString path = item->data(Qt::UserRole).toString();
+        if (!path.isEmpty()) {
+            KFileItem f(QUrl::fromLocalFile(path));
+            f.setDelayedMimeTypes(true);
+            fileList.append(f);
+        }
+    }
+    if (fileList.isEmpty()) {
+        return;
     }
     m_thumbJob = new KIO::PreviewJob(fileList, QSize(50, 50));
     m_thumbJob->setScaleType(KIO::PreviewJob::Scaled);
@@ -381,11 +393,7 @@ QString SlideshowClip::selectedPath(const QUrl &url, bool isMime, QString extens
             folder.append(QDir::separator());
         }
         // Check how many files we have
-        QDir dir(folder);
-        QStringList filters;
-        filters << QStringLiteral("*.") + extension.section(QLatin1Char('.'), -1);
-        dir.setNameFilters(filters);
-        *list = dir.entryList(QDir::Files);
+        *list = SequenceIndex::shared()->files(folder, extension.section(QLatin1Char('.'), -1));
     } else {
         folder = url.adjusted(QUrl::RemoveFilename).toLocalFile();
         QString filter = url.fileName();
@@ -403,17 +411,9 @@ QString SlideshowClip::selectedPath(const QUrl &url, bool isMime, QString extens
         int firstFrame = firstFrameData.rightRef(precision).toInt();
 
         // Check how many files we have
-        QDir dir(folder);
-        QString path;
-        int gap = 0;
-        for (int i = firstFrame; gap < 100; ++i) {
-            path = filter + QString::number(i).rightJustified(precision, QLatin1Char('0'), false) + ext;
-            if (dir.exists(path)) {
-                (*list).append(folder + path);
-                gap = 0;
-            } else {
-                gap++;
-            }
+        const QStringList files = SequenceIndex::shared()->sequence(folder, filter, ext, precision, firstFrame);
+        for (const QString &path : files) {
+            (*list).append(folder + path);
         }
         extension = filter + QStringLiteral("%0") + QString::number(precision) + QLatin1Char('d') + ext;
         if (firstFrame > 0) {
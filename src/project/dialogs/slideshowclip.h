@@ -25,6 +25,7 @@
 #include "ui_slideshowclip_ui.h"
 
 #include <KIO/PreviewJob>
+#include <QTimer>
 
 class ProjectClip;
 
@@ -61,7 +62,10 @@ private slots:
     void slotEnableThumbs(int state);
     void slotEnableLumaFile(int state);
     void slotUpdateDurationFormat(int ix);
+    /** @brief Create thumbnails for the visible images. */
     void slotGenerateThumbs();
+    /** @brief The image list was scrolled, update thumbnails once scrolling stops. */
+    void slotScrollThumbs();
     void slotSetPixmap(const KFileItem &fileItem, const QPixmap &pix);
     /** @brief Display correct widget depenging on user choice (MIME type or pattern method). */
     void slotMethodChanged(bool active);
@@ -71,6 +75,7 @@ private:
     int m_count;
     Timecode m_timecode;
     KIO::PreviewJob *m_thumbJob;
+    QTimer m_thumbTimer;
 };
 
 #endif
@@ -21,6 +21,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "temporarydata.h"
 #include "doc/kdenlivedoc.h"
+#include "doc/thumbnailstore.h"
+#include "doc/cacheaccounting.h"
+#include "project/clipmanager.h"
 #include "utils/KoIconUtils.h"
 
 #include <KLocalizedString>
@@ -82,6 +85,7 @@ void ChartWidget::paintEvent(QPaintEvent *event)
 TemporaryData::TemporaryData(KdenliveDoc *doc, bool currentProjectOnly, QWidget *parent) :
     QWidget(parent)
     , m_doc(doc)
+    , m_accounting(doc->clipManager()->cacheAccounting)
     , m_globalPage(nullptr)
     , m_globalDelete(nullptr)
 {
@@ -189,6 +193,7 @@ TemporaryData::TemporaryData(KdenliveDoc *doc, bool currentProjectOnly, QWidget
 
     m_currentPage->setLayout(m_grid);
     m_proxies = m_doc->getProxyHashList();
+    m_accounting->setProjectProxies(m_proxies);
     for (int i = 0; i < m_proxies.count(); i++) {
         m_proxies[i].append(QLatin1Char('*'));
     }
@@ -207,110 +212,68 @@ TemporaryData::TemporaryData(KdenliveDoc *doc, bool currentProjectOnly, QWidget
     }
     setLayout(lay);
     updateDataInfo();
+    if (m_globalPage) {
+        updateGlobalInfo();
+    }
+    connect(m_accounting, &CacheAccounting::sizesChanged, this, &TemporaryData::refreshSizes);
+    // Check the running totals against the folders content in the background
+    m_accounting->reconcile();
 }
 
 void TemporaryData::updateDataInfo()
 {
-    m_totalCurrent = 0;
     bool ok = false;
-    QDir preview = m_doc->getCacheDir(CacheBase, &ok);
+    m_doc->getCacheDir(CacheBase, &ok);
     if (!ok) {
         m_currentPage->setEnabled(false);
         return;
     }
-    preview = m_doc->getCacheDir(CachePreview, &ok);
-    if (ok) {
-        KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
-        connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotPreviewSize);
-    }
-
-    preview = m_doc->getCacheDir(CacheProxy, &ok);
-    if (ok) {
-        preview.setNameFilters(m_proxies);
-        const QFileInfoList fList = preview.entryInfoList();
-        KIO::filesize_t size = 0;
-        for (const QFileInfo &info : fList) {
-            size += info.size();
-        }
-        gotProxySize(size);
-    }
-
-    preview = m_doc->getCacheDir(CacheAudio, &ok);
-    if (ok) {
-        KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
-        connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotAudioSize);
-    }
-    preview = m_doc->getCacheDir(CacheThumbs, &ok);
-    if (ok) {
-        KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
-        connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotThumbSize);
-    }
-    if (m_globalPage) {
-        updateGlobalInfo();
-    }
-}
-
-void TemporaryData::gotPreviewSize(KJob *job)
-{
-    KIO::DirectorySizeJob *sourceJob = static_cast<KIO::DirectorySizeJob *>(job);
-    KIO::filesize_t total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
-    }
-    QLayoutItem *button = m_grid->itemAtPosition(0, 4);
-    if (button && button->widget()) {
-        button->widget()->setEnabled(total > 0);
-    }
-    m_totalCurrent += total;
-    mCurrentSizes[0] = total;
-    m_previewSize->setText(KIO::convertSize(total));
+    m_totalCurrent = 0;
+    setCurrentSize(0, m_previewSize, m_accounting->size(CachePreview));
+    setCurrentSize(1, m_proxySize, m_accounting->size(CacheProxy));
+    setCurrentSize(2, m_audioSize, m_accounting->size(CacheAudio));
+    setCurrentSize(3, m_thumbSize, m_accounting->size(CacheThumbs));
     updateTotal();
 }
 
-void TemporaryData::gotProxySize(KIO::filesize_t total)
+void TemporaryData::setCurrentSize(int row, QLabel *label, KIO::filesize_t total)
 {
-    QLayoutItem *button = m_grid->itemAtPosition(1, 4);
+    QLayoutItem *button = m_grid->itemAtPosition(row, 4);
     if (button && button->widget()) {
         button->widget()->setEnabled(total > 0);
     }
     m_totalCurrent += total;
-    mCurrentSizes[1] = total;
-    m_proxySize->setText(KIO::convertSize(total));
-    updateTotal();
+    mCurrentSizes[row] = total;
+    label->setText(KIO::convertSize(total));
 }
 
-void TemporaryData::gotAudioSize(KJob *job)
+void TemporaryData::refreshSizes()
 {
-    KIO::DirectorySizeJob *sourceJob = static_cast<KIO::DirectorySizeJob *>(job);
-    KIO::filesize_t total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
-    }
-    QLayoutItem *button = m_grid->itemAtPosition(2, 4);
-    if (button && button->widget()) {
-        button->widget()->setEnabled(total > 0);
+    updateDataInfo();
+    if (!m_globalPage) {
+        return;
     }
-    m_totalCurrent += total;
-    mCurrentSizes[2] = total;
-    m_audioSize->setText(KIO::convertSize(total));
-    updateTotal();
-}
-
-void TemporaryData::gotThumbSize(KJob *job)
-{
-    KIO::DirectorySizeJob *sourceJob = static_cast<KIO::DirectorySizeJob *>(job);
-    KIO::filesize_t total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
+    const QMap<QString, qint64> sizes = m_accounting->folderSizes();
+    if (sizes.count() != m_listWidget->topLevelItemCount()) {
+        // Folders were added or removed
+        updateGlobalInfo();
+        return;
     }
-    QLayoutItem *button = m_grid->itemAtPosition(3, 4);
-    if (button && button->widget()) {
-        button->widget()->setEnabled(total > 0);
+    m_totalGlobal = 0;
+    for (int i = 0; i < m_listWidget->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *item = m_listWidget->topLevelItem(i);
+        const QString folder = item->data(0, Qt::UserRole).toString();
+        if (!sizes.contains(folder)) {
+            updateGlobalInfo();
+            return;
+        }
+        const KIO::filesize_t total = sizes.value(folder);
+        m_totalGlobal += total;
+        item->setText(1, KIO::convertSize(total));
+        item->setData(1, Qt::UserRole, total);
     }
-    m_totalCurrent += total;
-    mCurrentSizes[3] = total;
-    m_thumbSize->setText(KIO::convertSize(total));
-    updateTotal();
+    m_globalSize->setText(KIO::convertSize(m_totalGlobal));
+    refreshGlobalPie();
 }
 
 void TemporaryData::updateTotal()
@@ -343,6 +306,7 @@ void TemporaryData::deletePreview()
     }
     if (dir.dirName() == QLatin1String("preview")) {
         dir.removeRecursively();
+        m_accounting->folderRemoved(CachePreview, dir.absolutePath());
         dir.mkpath(QStringLiteral("."));
         emit disablePreview();
         updateDataInfo();
@@ -363,6 +327,7 @@ void TemporaryData::deleteProxy()
     }
     foreach (const QString &file, files) {
         dir.remove(file);
+        m_accounting->fileRemoved(CacheProxy, dir.absoluteFilePath(file));
     }
     emit disableProxies();
     updateDataInfo();
@@ -380,6 +345,7 @@ void TemporaryData::deleteAudio()
     }
     if (dir.dirName() == QLatin1String("audiothumbs")) {
         dir.removeRecursively();
+        m_accounting->folderRemoved(CacheAudio, dir.absolutePath());
         dir.mkpath(QStringLiteral("."));
         updateDataInfo();
     }
@@ -397,7 +363,9 @@ void TemporaryData::deleteThumbs()
     }
     if (dir.dirName() == QLatin1String("videothumbs")) {
         dir.removeRecursively();
+        m_accounting->folderRemoved(CacheThumbs, dir.absolutePath());
         dir.mkpath(QStringLiteral("."));
+        m_doc->clipManager()->thumbnailStore->setFolder(dir);
         updateDataInfo();
     }
 }
@@ -415,7 +383,19 @@ void TemporaryData::deleteCurrentCacheData()
     if (dir.dirName() == m_doc->getDocumentProperty(QStringLiteral("documentid"))) {
         emit disablePreview();
         emit disableProxies();
-        dir.removeRecursively();
+        // Analysis data is referenced by the project file, keep it
+        const QStringList entries = dir.entryList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+        for (const QString &entry : entries) {
+            if (entry == QLatin1String("analysis")) {
+                continue;
+            }
+            if (QFileInfo(dir.absoluteFilePath(entry)).isDir()) {
+                QDir(dir.absoluteFilePath(entry)).removeRecursively();
+            } else {
+                dir.remove(entry);
+            }
+        }
+        // Accounting is reset and the project folder scanned again
         m_doc->initCacheDirs();
         updateDataInfo();
     }
@@ -488,38 +468,29 @@ void TemporaryData::updateGlobalInfo()
     QDir preview = m_doc->getCacheDir(SystemCacheRoot, &ok);
     if (!ok) {
         m_globalPage->setEnabled(false);
+        m_listWidget->blockSignals(false);
         return;
     }
     m_globalDir = preview;
-    m_globalDirectories.clear();
-    m_processingDirectory.clear();
-    m_globalDirectories = m_globalDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    m_globalDelete->setEnabled(!m_globalDirectories.isEmpty());
-    processglobalDirectories();
+    const QMap<QString, qint64> sizes = m_accounting->folderSizes();
+    QMapIterator<QString, qint64> i(sizes);
+    while (i.hasNext()) {
+        i.next();
+        addFolderItem(i.key(), i.value());
+    }
+    m_globalDelete->setEnabled(!sizes.isEmpty());
+    m_globalSize->setText(KIO::convertSize(m_totalGlobal));
+    m_listWidget->setCurrentItem(m_listWidget->topLevelItem(0));
     m_listWidget->blockSignals(false);
+    refreshGlobalPie();
 }
 
-void TemporaryData::processglobalDirectories()
+void TemporaryData::addFolderItem(const QString &folder, KIO::filesize_t total)
 {
-    if (m_globalDirectories.isEmpty()) {
-        return;
-    }
-    m_processingDirectory = m_globalDirectories.takeFirst();
-    KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(m_globalDir.absoluteFilePath(m_processingDirectory)));
-    connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotFolderSize);
-}
-
-void TemporaryData::gotFolderSize(KJob *job)
-{
-    KIO::DirectorySizeJob *sourceJob = static_cast<KIO::DirectorySizeJob *>(job);
-    KIO::filesize_t total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
-    }
     m_totalGlobal += total;
     TreeWidgetItem *item = new TreeWidgetItem(m_listWidget);
     // Check last save path for this cache folder
-    QDir dir(m_globalDir.absoluteFilePath(m_processingDirectory));
+    QDir dir(m_globalDir.absoluteFilePath(folder));
     QStringList filters;
     filters << QStringLiteral("*.kdenlive");
     QStringList str = dir.entryList(filters, QDir::Files | QDir::Hidden, QDir::Time);
@@ -527,19 +498,19 @@ void TemporaryData::gotFolderSize(KJob *job)
         QString path = QUrl::fromPercentEncoding(str.at(0).toUtf8());
         // Remove leading dot
         path.remove(0, 1);
-        item->setText(0, m_processingDirectory + QStringLiteral(" (%1)").arg(QUrl::fromLocalFile(path).fileName()));
+        item->setText(0, folder + QStringLiteral(" (%1)").arg(QUrl::fromLocalFile(path).fileName()));
         if (QFile::exists(path)) {
             item->setIcon(0, KoIconUtils::themedIcon(QStringLiteral("kdenlive")));
         } else {
             item->setIcon(0, KoIconUtils::themedIcon(QStringLiteral("dialog-close")));
         }
     } else {
-        item->setText(0, m_processingDirectory);
-        if (m_processingDirectory == QLatin1String("proxy")) {
+        item->setText(0, folder);
+        if (folder == QLatin1String("proxy")) {
             item->setIcon(0, KoIconUtils::themedIcon(QStringLiteral("kdenlive-show-video")));
         }
     }
-    item->setData(0, Qt::UserRole, m_processingDirectory);
+    item->setData(0, Qt::UserRole, folder);
     item->setText(1, KIO::convertSize(total));
     QDateTime date = QFileInfo(dir.absolutePath()).lastModified();
     item->setText(2, date.toString(Qt::SystemLocaleShortDate));
@@ -548,12 +519,6 @@ void TemporaryData::gotFolderSize(KJob *job)
     m_listWidget->addTopLevelItem(item);
     m_listWidget->resizeColumnToContents(0);
     m_listWidget->resizeColumnToContents(1);
-    if (m_globalDirectories.isEmpty()) {
-        m_globalSize->setText(KIO::convertSize(m_totalGlobal));
-        m_listWidget->setCurrentItem(m_listWidget->topLevelItem(0));
-    } else {
-        processglobalDirectories();
-    }
 }
 
 void TemporaryData::refreshGlobalPie()
@@ -596,8 +561,10 @@ void TemporaryData::deleteSelected()
         }
         QDir toRemove(m_globalDir.absoluteFilePath(folder));
         toRemove.removeRecursively();
+        m_accounting->folderRemoved(SystemCacheRoot, toRemove.absolutePath());
         if (folder == QLatin1String("proxy")) {
             // We deleted proxy folder, recreate it
+            m_accounting->folderRemoved(CacheProxy, toRemove.absolutePath());
             toRemove.mkpath(QStringLiteral("."));
         }
     }
@@ -26,9 +26,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QWidget>
 #include <QDir>
-#include <KIO/DirectorySizeJob>
+#include <KIO/Global>
 
 class KdenliveDoc;
+class CacheAccounting;
 class QPaintEvent;
 class QLabel;
 class QGridLayout;
@@ -93,6 +94,7 @@ public:
 
 private:
     KdenliveDoc *m_doc;
+    CacheAccounting *m_accounting;
     ChartWidget *m_currentPie;
     ChartWidget *m_globalPie;
     QLabel *m_previewSize;
@@ -110,8 +112,6 @@ private:
     KIO::filesize_t m_totalGlobal;
     QList<KIO::filesize_t> mCurrentSizes;
     QList<KIO::filesize_t> mGlobalSizes;
-    QStringList m_globalDirectories;
-    QString m_processingDirectory;
     QDir m_globalDir;
     QStringList m_proxies;
     QPushButton *m_globalDelete;
@@ -119,14 +119,14 @@ private:
     void updateGlobalInfo();
     void updateTotal();
     void buildGlobalCacheDialog(int minHeight);
-    void processglobalDirectories();
+    /** @brief Display the size of a project cache type, @param row being its row in the chart legend. */
+    void setCurrentSize(int row, QLabel *label, KIO::filesize_t total);
+    /** @brief Add a cache folder to the all projects list. */
+    void addFolderItem(const QString &folder, KIO::filesize_t total);
 
 private slots:
-    void gotPreviewSize(KJob *job);
-    void gotProxySize(KIO::filesize_t total);
-    void gotAudioSize(KJob *job);
-    void gotThumbSize(KJob *job);
-    void gotFolderSize(KJob *job);
+    /** @brief The cache accounting totals changed, update the displayed sizes. */
+    void refreshSizes();
     void refreshGlobalPie();
     void deletePreview();
     void deleteProxy();
@@ -21,6 +21,8 @@
 #include "filterjob.h"
 #include "meltjob.h"
 #include "kdenlivesettings.h"
+#include "core.h"
+#include "project/projectmanager.h"
 #include "doc/kdenlivedoc.h"
 #include "bin/projectclip.h"
 #include "project/clipstabilize.h"
@@ -190,6 +192,13 @@ QHash<ProjectClip *, AbstractClipJob *> FilterJob::prepareJob(const QList<Projec
             producerParams.insert(QStringLiteral("in"), QString::number(in));
             producerParams.insert(QStringLiteral("out"), QString::number(out));
             producerParams.insert(QStringLiteral("producer"), sources.at(i));
+            if (KdenliveSettings::analyseproxy() && pCore->projectManager()->current()->useProxy() && clip->hasProxy()) {
+                // Scene detection works on small images, decoding the proxy is enough
+                const QString proxy = clip->getProducerProperty(QStringLiteral("kdenlive:proxy"));
+                if (QFile::exists(proxy)) {
+                    producerParams.insert(QStringLiteral("producer"), proxy);
+                }
+            }
 
             // Destination
             // Since this job is only doing analysis, we have a null consumer and no destination
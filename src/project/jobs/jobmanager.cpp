@@ -287,6 +287,17 @@ void JobManager::prepareJobs(const QList<ProjectClip *> &clips, double fps, Abst
 
 void JobManager::launchJob(ProjectClip *clip, AbstractClipJob *job, bool runQueue)
 {
+    if (job->jobType == AbstractClipJob::MLTJOB) {
+        // Analysis jobs on the same clip zone share a single decoding pass
+        QMutexLocker lock(&m_jobMutex);
+        for (AbstractClipJob *pending : m_jobList) {
+            if (pending->jobType == AbstractClipJob::MLTJOB && pending->status() == JobWaiting && static_cast<MeltJob *>(pending)->addAnalysis(static_cast<MeltJob *>(job))) {
+                clip->setJobStatus(pending->jobType, JobWaiting, 0, pending->statusMessage());
+                delete job;
+                return;
+            }
+        }
+    }
     if (job->isExclusive() && hasPendingJob(clip->clipId(), job->jobType)) {
         delete job;
         return;
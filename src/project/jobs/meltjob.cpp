@@ -21,11 +21,24 @@
 #include "meltjob.h"
 #include "kdenlivesettings.h"
 #include "doc/kdenlivedoc.h"
+#include "utils/geometryutils.h"
 
 #include <klocalizedstring.h>
 
 #include <mlt++/Mlt.h>
 
+static void resizeProfile(Mlt::Profile *profile, int height)
+{
+    // Reduced analysis resolution, keep the display aspect ratio
+    const double dar = profile->dar();
+    profile->set_height(height);
+    int width = (int)(profile->height() * dar / profile->sar() + 0.5);
+    if (width % 2 == 1) {
+        width++;
+    }
+    profile->set_width(width);
+}
+
 static void consumer_frame_render(mlt_consumer, MeltJob *self, mlt_frame frame_ptr)
 {
     Mlt::Frame frame(frame_ptr);
@@ -38,7 +51,6 @@ MeltJob::MeltJob(ClipType cType, const QString &id, const QMap<QString, QString>
       m_consumer(nullptr),
       m_producer(nullptr),
       m_profile(nullptr),
-      m_filter(nullptr),
       m_showFrameEvent(nullptr),
       m_producerParams(producerParams),
       m_filterParams(filterParams),
@@ -53,6 +65,73 @@ MeltJob::MeltJob(ClipType cType, const QString &id, const QMap<QString, QString>
         m_dest = consum.section(QLatin1Char(':'), 1);
     }
     m_url = producerParams.value(QStringLiteral("producer"));
+    m_analyses << qMakePair(filterParams, extraParams);
+}
+
+bool MeltJob::isAudioOnly() const
+{
+    return m_consumerParams.value(QStringLiteral("video_off")) == QLatin1String("1");
+}
+
+bool MeltJob::addAnalysis(const MeltJob *job)
+{
+    if (job->clipId() != m_clipId || m_jobStatus != JobWaiting) {
+        return false;
+    }
+    // Only analysis jobs on the same zone can share a decoding pass
+    if (!m_dest.isEmpty() || !job->m_dest.isEmpty() || m_producerParams != job->m_producerParams) {
+        return false;
+    }
+    if (m_consumerParams.value(QStringLiteral("consumer")) != QLatin1String("null") || job->m_consumerParams.value(QStringLiteral("consumer")) != QLatin1String("null")) {
+        return false;
+    }
+    if (m_filterParams.value(QStringLiteral("filter")).isEmpty() || job->m_filterParams.value(QStringLiteral("filter")).isEmpty()) {
+        return false;
+    }
+    for (const QPair<stringMap, stringMap> &analysis : job->m_analyses) {
+        if (m_analyses.contains(analysis)) {
+            // Same analysis queued twice, it is already part of this pass and the job can be discarded
+            return true;
+        }
+    }
+    if (m_extra.contains(QStringLiteral("producer_profile")) != job->m_extra.contains(QStringLiteral("producer_profile"))) {
+        return false;
+    }
+    // Proxy analyses map their results with their own resolution and frame step
+    if (m_extra.contains(QStringLiteral("proxyanalysis")) || job->m_extra.contains(QStringLiteral("proxyanalysis"))) {
+        return false;
+    }
+    // Analysis resolution: only reduce it if all analyses working on images accept it
+    const QString resize = m_extra.value(QStringLiteral("resize_profile"));
+    const QString jobResize = job->m_extra.value(QStringLiteral("resize_profile"));
+    QString mergedResize;
+    if (!isAudioOnly() && !job->isAudioOnly()) {
+        if (!resize.isEmpty() && !jobResize.isEmpty()) {
+            mergedResize = QString::number(qMax(resize.toInt(), jobResize.toInt()));
+        }
+    } else if (!isAudioOnly()) {
+        mergedResize = resize;
+    } else if (!job->isAudioOnly()) {
+        mergedResize = jobResize;
+    }
+    if (mergedResize.isEmpty()) {
+        m_extra.remove(QStringLiteral("resize_profile"));
+    } else {
+        m_extra.insert(QStringLiteral("resize_profile"), mergedResize);
+    }
+    // Keep consumer settings that suit both analyses, for example video_off is dropped if one of them needs images
+    QMap<QString, QString> consumerParams;
+    QMapIterator<QString, QString> i(m_consumerParams);
+    while (i.hasNext()) {
+        i.next();
+        if (job->m_consumerParams.contains(i.key()) && job->m_consumerParams.value(i.key()) == i.value()) {
+            consumerParams.insert(i.key(), i.value());
+        }
+    }
+    m_consumerParams = consumerParams;
+    m_analyses << job->m_analyses;
+    description.append(QStringLiteral(", ") + job->description);
+    return true;
 }
 
 void MeltJob::startJob()
@@ -70,26 +149,18 @@ void MeltJob::startJob()
         return;
     }
     int in = m_producerParams.value(QStringLiteral("in")).toInt();
-    if (in > 0 && !m_extra.contains(QStringLiteral("offset"))) {
-        m_extra.insert(QStringLiteral("offset"), QString::number(in));
-    }
     int out = m_producerParams.value(QStringLiteral("out")).toInt();
-    QString filterName = m_filterParams.value(QStringLiteral("filter"));
-
-    // optional params
-    int startPos = -1;
-    int track = -1;
-
-    // used when triggering a job from an effect
-    if (m_extra.contains(QStringLiteral("clipStartPos"))) {
-        startPos = m_extra.value(QStringLiteral("clipStartPos")).toInt();
-    }
-    if (m_extra.contains(QStringLiteral("clipTrack"))) {
-        track = m_extra.value(QStringLiteral("clipTrack")).toInt();
-    }
-
-    if (!m_extra.contains(QStringLiteral("finalfilter"))) {
-        m_extra.insert(QStringLiteral("finalfilter"), filterName);
+    // Analysis running on a proxy clip, optionally on one frame every frameStep
+    const bool proxyAnalysis = m_extra.contains(QStringLiteral("proxyanalysis"));
+    const int frameStep = proxyAnalysis ? qMax(1, m_extra.value(QStringLiteral("framestep")).toInt()) : 1;
+    for (int ix = 0; ix < m_analyses.count(); ++ix) {
+        stringMap &extra = m_analyses[ix].second;
+        if (in > 0 && !extra.contains(QStringLiteral("offset"))) {
+            extra.insert(QStringLiteral("offset"), QString::number(in));
+        }
+        if (!extra.contains(QStringLiteral("finalfilter"))) {
+            extra.insert(QStringLiteral("finalfilter"), m_analyses.at(ix).first.value(QStringLiteral("filter")));
+        }
     }
 
     if (out != -1 && out <= in) {
@@ -106,18 +177,34 @@ void MeltJob::startJob()
         m_profile = projectProfile;
     }
     if (m_extra.contains(QStringLiteral("resize_profile"))) {
-        m_profile->set_height(m_extra.value(QStringLiteral("resize_profile")).toInt());
-        m_profile->set_width(m_profile->height() * m_profile->sar());
+        resizeProfile(m_profile, m_extra.value(QStringLiteral("resize_profile")).toInt());
     }
-    double fps = projectProfile->fps();
+    // With a frame step, the analysis profile uses a lower frame rate so that the producer skips frames
+    double fps = projectProfile->fps() / frameStep;
     int fps_num = projectProfile->frame_rate_num();
-    int fps_den = projectProfile->frame_rate_den();
+    int fps_den = projectProfile->frame_rate_den() * frameStep;
     Mlt::Producer *producer = new Mlt::Producer(*m_profile,  m_url.toUtf8().constData());
     if (producer && producerProfile) {
         m_profile->from_producer(*producer);
         m_profile->set_explicit(true);
     }
-    if (qAbs(m_profile->fps() - fps) > 0.01 || producerProfile) {
+    // Geometry factors from analysis coordinates to the original profile
+    double scaleX = 1;
+    double scaleY = 1;
+    bool resized = false;
+    if (producer && proxyAnalysis) {
+        // Analyse at the proxy resolution instead of upscaling it
+        const int proxyHeight = producer->get_int("meta.media.height");
+        if (proxyHeight > 0 && proxyHeight < m_profile->height()) {
+            const int width = m_profile->width();
+            const int height = m_profile->height();
+            resizeProfile(m_profile, proxyHeight);
+            scaleX = (double) width / m_profile->width();
+            scaleY = (double) height / m_profile->height();
+            resized = true;
+        }
+    }
+    if (qAbs(m_profile->fps() - fps) > 0.01 || producerProfile || resized) {
         // Reload producer
         delete producer;
         // Force same fps as projec profile or the resulting .mlt will not load in our project
@@ -150,7 +237,7 @@ void MeltJob::startJob()
     if (out == -1 && in == -1) {
         m_producer = producer;
     } else {
-        m_producer = producer->cut(in, out);
+        m_producer = producer->cut(in / frameStep, out == -1 ? -1 : out / frameStep);
         delete producer;
     }
 
@@ -184,24 +271,38 @@ void MeltJob::startJob()
         m_consumer->set("root", QFileInfo(m_dest).absolutePath().toUtf8().constData());
     }
 
-    // Build filter
-    if (!filterName.isEmpty()) {
-        m_filter = new Mlt::Filter(*m_profile, filterName.toUtf8().data());
-        if (!m_filter || !m_filter->is_valid()) {
+    // Build filters
+    for (int ix = 0; ix < m_analyses.count(); ++ix) {
+        const QMap<QString, QString> &filterParams = m_analyses.at(ix).first;
+        QString filterName = filterParams.value(QStringLiteral("filter"));
+        if (filterName.isEmpty()) {
+            m_filters << nullptr;
+            continue;
+        }
+        Mlt::Filter *filter = new Mlt::Filter(*m_profile, filterName.toUtf8().data());
+        m_filters << filter;
+        if (!filter->is_valid()) {
             m_errorMessage = i18n("Filter %1 crashed", filterName);
             setStatus(JobCrashed);
             return;
         }
 
         // Process filter params
-        QMapIterator<QString, QString> k(m_filterParams);
+        const QStringList geometryParams = m_analyses.at(ix).second.value(QStringLiteral("proxyanalysis")).split(QLatin1Char(' '), QString::SkipEmptyParts);
+        QMapIterator<QString, QString> k(filterParams);
         ignoredProps.clear();
         ignoredProps << QStringLiteral("filter");
         while (k.hasNext()) {
             k.next();
             QString key = k.key();
-            if (!ignoredProps.contains(key)) {
-                m_filter->set(k.key().toUtf8().constData(), k.value().toUtf8().constData());
+            if (ignoredProps.contains(key)) {
+                continue;
+            }
+            if (geometryParams.contains(key)) {
+                // Initial rectangle is given in full resolution coordinates
+                filter->set(k.key().toUtf8().constData(), GeometryUtils::mapGeometry(k.value(), 1 / scaleX, 1 / scaleY, 1.0 / frameStep).toUtf8().constData());
+            } else {
+                filter->set(k.key().toUtf8().constData(), k.value().toUtf8().constData());
             }
         }
     }
@@ -216,20 +317,33 @@ void MeltJob::startJob()
     if (m_length == 0) {
         m_length = m_producer->get_length();
     }
-    if (m_filter) {
-        m_producer->attach(*m_filter);
+    for (Mlt::Filter *filter : m_filters) {
+        if (filter) {
+            m_producer->attach(*filter);
+        }
     }
     m_showFrameEvent = m_consumer->listen("consumer-frame-render", this, (mlt_listener) consumer_frame_render);
     m_producer->set_speed(1);
     m_consumer->run();
 
-    QMap<QString, QString> jobResults;
-    if (m_jobStatus != JobAborted && m_extra.contains(QStringLiteral("key"))) {
-        QString result = QString::fromLatin1(m_filter->get(m_extra.value(QStringLiteral("key")).toUtf8().constData()));
-        jobResults.insert(m_extra.value(QStringLiteral("key")), result);
-    }
-    if (!jobResults.isEmpty() && m_jobStatus != JobAborted) {
-        emit gotFilterJobResults(m_clipId, startPos, track, jobResults, m_extra);
+    // Report the results of each analysis separately
+    for (int ix = 0; ix < m_analyses.count() && m_jobStatus != JobAborted; ++ix) {
+        const stringMap &extra = m_analyses.at(ix).second;
+        Mlt::Filter *filter = m_filters.at(ix);
+        if (!filter || !extra.contains(QStringLiteral("key"))) {
+            continue;
+        }
+        // optional params, used when triggering a job from an effect
+        int startPos = extra.value(QStringLiteral("clipStartPos"), QStringLiteral("-1")).toInt();
+        int track = extra.value(QStringLiteral("clipTrack"), QStringLiteral("-1")).toInt();
+        QMap<QString, QString> jobResults;
+        QString result = QString::fromLatin1(filter->get(extra.value(QStringLiteral("key")).toUtf8().constData()));
+        if (proxyAnalysis) {
+            // Back to full resolution coordinates and project frames, skipped frames are interpolated between keyframes
+            result = GeometryUtils::mapGeometry(result, scaleX, scaleY, frameStep);
+        }
+        jobResults.insert(extra.value(QStringLiteral("key")), result);
+        emit gotFilterJobResults(m_clipId, startPos, track, jobResults, extra);
     }
     if (m_jobStatus == JobWorking) {
         m_jobStatus = JobDone;
@@ -239,7 +353,7 @@ void MeltJob::startJob()
 MeltJob::~MeltJob()
 {
     delete m_showFrameEvent;
-    delete m_filter;
+    qDeleteAll(m_filters);
     delete m_producer;
     delete m_consumer;
     delete m_profile;
@@ -35,7 +35,8 @@ class Event;
 /**
  * @class MeltJob
  * @brief This class contains a Job that will run an MLT Producer, with some optional filter
- *
+ * Several analysis filters working on the same clip zone can be attached to a single job,
+ * so that the clip is only decoded once. The results of each filter are reported separately.
  */
 
 class MeltJob : public AbstractClipJob
@@ -69,12 +70,18 @@ public:
     void setStatus(ClipJobStatus status) Q_DECL_OVERRIDE;
     /** @brief Here we will send the current progress info to anyone interested. */
     void emitFrameNumber(int pos);
+    /** @brief Attach the analysis filter of another waiting job to this one, so that both are processed in the same decoding pass.
+     *  Only analysis jobs (null consumer, no destination) working on the same clip zone can be merged.
+     *  @param job the job whose filter should be added, it can be deleted once merged
+     *  @return true if the analysis was added to this job or was already part of it */
+    bool addAnalysis(const MeltJob *job);
 
 private:
     Mlt::Consumer *m_consumer;
     Mlt::Producer *m_producer;
     Mlt::Profile *m_profile;
-    Mlt::Filter *m_filter;
+    /** @brief The filters attached to the producer, one per analysis (nullptr when an analysis has no filter). */
+    QList<Mlt::Filter *> m_filters;
     Mlt::Event *m_showFrameEvent;
     QMap<QString, QString> m_producerParams;
     QMap<QString, QString> m_filterParams;
@@ -83,6 +90,10 @@ private:
     QString m_url;
     int m_length;
     QMap<QString, QString> m_extra;
+    /** @brief The filter and extra parameters of each analysis processed by this job. */
+    QList<QPair<stringMap, stringMap> > m_analyses;
+    /** @brief Returns true if this job's consumer does not need to fetch images. */
+    bool isAudioOnly() const;
 
 signals:
     /** @brief When user requested a to process an Mlt::Filter, this will send back all necessary infos. */
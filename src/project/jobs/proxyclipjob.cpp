@@ -26,13 +26,24 @@
 #include "bin/bin.h"
 #include <QProcess>
 #include <QTemporaryFile>
+#include <QElapsedTimer>
+#include <QRegularExpression>
 
 #include <klocalizedstring.h>
 
+#include <mlt++/Mlt.h>
+
+// Video codecs only using intra frames, decoding any frame does not depend on other frames
+static const QStringList intraCodecs = QStringList() << QStringLiteral("prores") << QStringLiteral("dnxhd") << QStringLiteral("mjpeg")
+                                       << QStringLiteral("dvvideo") << QStringLiteral("huffyuv") << QStringLiteral("ffvhuff") << QStringLiteral("rawvideo")
+                                       << QStringLiteral("utvideo") << QStringLiteral("magicyuv") << QStringLiteral("v210") << QStringLiteral("cfhd")
+                                       << QStringLiteral("qtrle") << QStringLiteral("hap");
+
 ProxyJob::ProxyJob(ClipType cType, const QString &id, const QStringList &parameters, QTemporaryFile *playlist)
     : AbstractClipJob(PROXYJOB, cType, id),
       m_jobDuration(0),
-      m_isFfmpegJob(true)
+      m_isFfmpegJob(true),
+      m_lowResStream(-1)
 {
     m_jobStatus = JobWaiting;
     description = i18n("proxy");
@@ -43,6 +54,9 @@ ProxyJob::ProxyJob(ClipType cType, const QString &id, const QStringList &paramet
     m_renderWidth = parameters.at(4).toInt();
     m_renderHeight = parameters.at(5).toInt();
     m_playlist = playlist;
+    if (parameters.count() > 6) {
+        m_lowResStream = parameters.at(6).toInt();
+    }
     replaceClip = true;
 }
 
@@ -97,6 +111,10 @@ void ProxyJob::startJob()
             mltParameters << t;
         }
 
+        if (clipType == SlideShow) {
+            // Each frame of an image sequence may differ, encode all frames as keyframes so that seeking in the proxy is fast
+            mltParameters << QStringLiteral("g=1") << QStringLiteral("bf=0");
+        }
         mltParameters.append(QStringLiteral("real_time=-%1").arg(KdenliveSettings::mltthreads()));
 
         //TODO: currently, when rendering an xml file through melt, the display ration is lost, so we enforce it manualy
@@ -172,18 +190,46 @@ void ProxyJob::startJob()
             setStatus(JobCrashed);
             return;
         }
+        if (m_lowResStream > -1) {
+            // Remux the embedded low resolution stream, much faster than transcoding
+            QStringList parameters;
+            parameters << QStringLiteral("-i") << m_src << QStringLiteral("-map") << QStringLiteral("0:%1").arg(m_lowResStream);
+            parameters << QStringLiteral("-map") << QStringLiteral("0:a?") << QStringLiteral("-c") << QStringLiteral("copy") << QStringLiteral("-y") << m_dest;
+            m_jobProcess = new QProcess;
+            m_jobProcess->setProcessChannelMode(QProcess::MergedChannels);
+            m_jobProcess->start(KdenliveSettings::ffmpegpath(), parameters, QIODevice::ReadOnly);
+            m_jobProcess->waitForStarted();
+            waitForProcess();
+            if (m_jobStatus == JobAborted) {
+                delete m_jobProcess;
+                return;
+            }
+            bool success = m_jobProcess->exitStatus() == QProcess::NormalExit && m_jobProcess->exitCode() == 0 && QFileInfo(m_dest).size() > 0;
+            delete m_jobProcess;
+            m_jobProcess = nullptr;
+            if (success) {
+                setStatus(JobDone);
+                return;
+            }
+            // Stream cannot be copied in the proxy container, transcode instead
+            qCDebug(KDENLIVE_LOG) << "Cannot remux stream" << m_lowResStream << "of" << m_src << ", transcoding proxy";
+            QFile::remove(m_dest);
+            m_jobDuration = 0;
+        }
+        const double decodeLoad = measureDecodeLoad();
+        const QString proxyParams = adaptParameters(m_proxyParams, decodeLoad);
+        qCDebug(KDENLIVE_LOG) << "Proxy for" << m_src << "decode load:" << decodeLoad << "parameters:" << proxyParams;
         QStringList parameters;
-        if (m_proxyParams.contains(QStringLiteral("-noautorotate"))) {
+        if (proxyParams.contains(QStringLiteral("-noautorotate"))) {
             // The noautorotate flag must be passed before input source
             parameters << QStringLiteral("-noautorotate");
         }
-        if (m_proxyParams.contains(QLatin1String("-i "))) {
+        if (proxyParams.contains(QLatin1String("-i "))) {
             // we have some pre-filename parameters, filename will be inserted later
         } else {
             parameters << QStringLiteral("-i") << m_src;
         }
-        QString params = m_proxyParams;
-        foreach (const QString &s, params.split(QLatin1Char(' '))) {
+        foreach (const QString &s, proxyParams.split(QLatin1Char(' '))) {
             QString t = s.simplified();
             if (t != QLatin1String("-noautorotate")) {
                 parameters << t;
@@ -201,16 +247,7 @@ void ProxyJob::startJob()
         m_jobProcess->start(KdenliveSettings::ffmpegpath(), parameters, QIODevice::ReadOnly);
         m_jobProcess->waitForStarted();
     }
-    while (m_jobProcess->state() != QProcess::NotRunning) {
-        processLogInfo();
-        if (m_jobStatus == JobAborted) {
-            emit cancelRunningJob(m_clipId, cancelProperties());
-            m_jobProcess->close();
-            m_jobProcess->waitForFinished();
-            QFile::remove(m_dest);
-        }
-        m_jobProcess->waitForFinished(400);
-    }
+    waitForProcess();
     // remove temporary playlist if it exists
     delete m_playlist;
     if (m_jobStatus != JobAborted) {
@@ -233,6 +270,90 @@ void ProxyJob::startJob()
     delete m_jobProcess;
 }
 
+void ProxyJob::waitForProcess()
+{
+    while (m_jobProcess->state() != QProcess::NotRunning) {
+        processLogInfo();
+        if (m_jobStatus == JobAborted) {
+            emit cancelRunningJob(m_clipId, cancelProperties());
+            m_jobProcess->close();
+            m_jobProcess->waitForFinished();
+            QFile::remove(m_dest);
+        }
+        m_jobProcess->waitForFinished(400);
+    }
+}
+
+double ProxyJob::measureDecodeLoad() const
+{
+    Mlt::Profile profile;
+    profile.set_explicit(false);
+    Mlt::Producer *producer = new Mlt::Producer(profile, m_src.toUtf8().constData());
+    if (!producer->is_valid()) {
+        delete producer;
+        return -1;
+    }
+    // Decode at the source resolution and frame rate
+    profile.from_producer(*producer);
+    profile.set_explicit(true);
+    delete producer;
+    Mlt::Producer source(profile, m_src.toUtf8().constData());
+    if (!source.is_valid() || source.get_length() < 2 || profile.fps() <= 0) {
+        return -1;
+    }
+    source.set("audio_index", -1);
+    // Seek to the middle of the clip so that the measure includes the seeking cost of long GOP codecs
+    source.seek(source.get_length() / 2);
+    const int frameCount = qMin(12, source.get_length() / 2);
+    int decoded = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < frameCount; ++i) {
+        Mlt::Frame *frame = source.get_frame();
+        if (!frame || !frame->is_valid()) {
+            delete frame;
+            break;
+        }
+        mlt_image_format format = mlt_image_yuv422;
+        int width = profile.width();
+        int height = profile.height();
+        frame->get_image(format, width, height);
+        delete frame;
+        decoded++;
+    }
+    if (decoded == 0) {
+        return -1;
+    }
+    return timer.elapsed() * profile.fps() / 1000.0 / decoded;
+}
+
+// static
+QString ProxyJob::adaptParameters(const QString &params, double decodeLoad)
+{
+    if (decodeLoad < 0) {
+        return params;
+    }
+    QString result = params;
+    if (decodeLoad > 0.5 && !result.contains(QLatin1String("-g "))) {
+        // Source is expensive to decode, make an intra only proxy so that seeking never has to decode a GOP
+        result.append(QStringLiteral(" -g 1 -bf 0"));
+    }
+    if (decodeLoad > 2) {
+        // Source cannot be decoded in real time, reduce proxy resolution
+        QRegularExpression scale(QStringLiteral("scale=(\\d+):"));
+        QRegularExpressionMatch match = scale.match(result);
+        if (match.hasMatch()) {
+            int width = match.captured(1).toInt();
+            int reduced = qMax(480, width * 2 / 3);
+            reduced -= reduced % 2;
+            if (reduced < width) {
+                result.replace(match.capturedStart(1), match.capturedLength(1), QString::number(reduced));
+            }
+        }
+    }
+    return result;
+}
+
 void ProxyJob::processLogInfo()
 {
     if (!m_jobProcess || m_jobStatus == JobAborted) {
@@ -366,9 +487,73 @@ QHash<ProjectClip *, AbstractClipJob *> ProxyJob::prepareJob(Bin *bin, const QLi
         }
         qCDebug(KDENLIVE_LOG)<<" * *PROXY PATH: "<<path<<", "<<sourcePath;
         parameters << path << sourcePath << item->getProducerProperty(QStringLiteral("_exif_orientation")) << params << QString::number(renderSize.width()) << QString::number(renderSize.height());
+        if (item->clipType() == AV || item->clipType() == Video) {
+            parameters << QString::number(lowResStream(item, proxyWidth(params)));
+        }
         ProxyJob *job = new ProxyJob(item->clipType(), id, parameters, playlist);
         jobs.insert(item, job);
     }
     return jobs;
 }
 
+
+// static
+int ProxyJob::proxyWidth(const QString &params)
+{
+    QRegularExpressionMatch match = QRegularExpression(QStringLiteral("scale=(\\d+):")).match(params);
+    if (match.hasMatch()) {
+        return match.captured(1).toInt();
+    }
+    match = QRegularExpression(QStringLiteral("-s (\\d+)x")).match(params);
+    if (match.hasMatch()) {
+        return match.captured(1).toInt();
+    }
+    return 0;
+}
+
+// static
+int ProxyJob::lowResStream(ProjectClip *clip, int proxyWidth)
+{
+    if (proxyWidth <= 0) {
+        return -1;
+    }
+    const int videoIndex = clip->getProducerIntProperty(QStringLiteral("video_index"));
+    const QString frameRate = clip->getProducerProperty(QStringLiteral("meta.media.%1.stream.frame_rate").arg(videoIndex));
+    const int streams = clip->getProducerIntProperty(QStringLiteral("meta.media.nb_streams"));
+    for (int i = 0; i < streams; ++i) {
+        if (i == videoIndex || clip->getProducerProperty(QStringLiteral("meta.media.%1.stream.type").arg(i)) != QLatin1String("video")) {
+            continue;
+        }
+        // Skip embedded cover pictures
+        const QString codec = clip->getProducerProperty(QStringLiteral("meta.media.%1.codec.name").arg(i));
+        if (codec == QLatin1String("png") || codec == QLatin1String("mjpeg") || codec == QLatin1String("bmp")) {
+            continue;
+        }
+        if (!frameRate.isEmpty() && clip->getProducerProperty(QStringLiteral("meta.media.%1.stream.frame_rate").arg(i)) != frameRate) {
+            continue;
+        }
+        // Use a stream close to the requested proxy size, not a tiny preview
+        const int width = clip->getProducerIntProperty(QStringLiteral("meta.media.%1.codec.width").arg(i));
+        if (width >= proxyWidth / 2 && width <= proxyWidth) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// static
+bool ProxyJob::isLightweight(ProjectClip *clip)
+{
+    if (clip->decodeStats().isValid()) {
+        // Use the measured decoding cost if the clip was profiled
+        return clip->decodeStats().decodeTime * clip->getOriginalFps() / 1000.0 < 0.5;
+    }
+    const int videoIndex = clip->getProducerIntProperty(QStringLiteral("video_index"));
+    const QString codec = clip->getProducerProperty(QStringLiteral("meta.media.%1.codec.name").arg(videoIndex));
+    if (!intraCodecs.contains(codec)) {
+        return false;
+    }
+    const int width = clip->getProducerIntProperty(QStringLiteral("meta.media.width"));
+    const int height = clip->getProducerIntProperty(QStringLiteral("meta.media.height"));
+    return width * height <= 1920 * 1088;
+}
@@ -41,6 +41,8 @@ public:
     void processLogInfo() Q_DECL_OVERRIDE;
     static QList<ProjectClip *> filterClips(const QList<ProjectClip *> &clips);
     static QHash<ProjectClip *, AbstractClipJob *> prepareJob(Bin *bin, const QList<ProjectClip *> &clips);
+    /** @brief Returns true if the clip decodes fast enough without proxy: measured decoding load if the clip was profiled, otherwise an intra-frame codec at a moderate resolution. */
+    static bool isLightweight(ProjectClip *clip);
 
 private:
     QString m_dest;
@@ -52,6 +54,18 @@ private:
     int m_jobDuration;
     bool m_isFfmpegJob;
     QTemporaryFile *m_playlist;
+    /** @brief Index of an embedded low resolution video stream that can be remuxed as proxy, -1 if none. */
+    int m_lowResStream;
+    /** @brief Find an embedded video stream small enough to be used as proxy. */
+    static int lowResStream(ProjectClip *clip, int proxyWidth);
+    /** @brief Width requested in the proxy parameters, 0 if not set. */
+    static int proxyWidth(const QString &params);
+    /** @brief Decode a few frames of the source, returns the decoding time relative to the frame duration (1 means real time), or -1 on failure. */
+    double measureDecodeLoad() const;
+    /** @brief Adjust GOP and resolution of the proxy parameters to the source decoding load. */
+    static QString adaptParameters(const QString &params, double decodeLoad);
+    /** @brief Process the running job's output until it finishes or is aborted. */
+    void waitForProcess();
 };
 
 #endif
@@ -17,6 +17,7 @@ the Free Software Foundation, either version 3 of the License, or
 #include "kdenlivesettings.h"
 #include "monitor/monitormanager.h"
 #include "doc/kdenlivedoc.h"
+#include "doc/cacheaccounting.h"
 #include "timeline/timeline.h"
 #include "project/dialogs/projectsettings.h"
 #include "timeline/customtrackview.h"
@@ -301,6 +302,8 @@ bool ProjectManager::saveFileAs(const QString &outputFileName)
     // This timer is set by KdenliveDoc::setModified()
     const QString projectId = QCryptographicHash::hash(url.fileName().toUtf8(), QCryptographicHash::Md5).toHex();
     QUrl autosaveUrl = QUrl::fromLocalFile(QFileInfo(outputFileName).absoluteDir().absoluteFilePath(projectId + QStringLiteral(".kdenlive")));
+    // Make sure a pending autosave is not writing while we change the file
+    m_project->m_autosaveThread.waitForFinished();
     if (m_project->m_autosave == nullptr) {
         // The temporary file is not opened or created until actually needed.
         // The file filename does not have to exist for KAutoSaveFile to be constructed (if it exists, it will not be touched).
@@ -591,6 +594,8 @@ void ProjectManager::doOpenFile(const QUrl &url, KAutoSaveFile *stale)
         return;
     }
     m_trackView->setDuration(m_trackView->duration());
+    // All project clips are known, allow evicting the proxies of other projects
+    pCore->bin()->cacheAccounting()->setProjectProxies(pCore->bin()->getProxyHashList());
 
     pCore->window()->slotGotProgressInfo(QString(), 100);
     pCore->monitorManager()->projectMonitor()->adjustRulerSize(m_trackView->duration() - 1);
@@ -704,6 +709,7 @@ QString ProjectManager::projectSceneList(const QString &outputFolder)
         m_trackView->slotMultitrackView(false);
     }
     m_trackView->connectOverlayTrack(false);
+    m_project->prepareSceneList();
     QString scene = pCore->monitorManager()->projectMonitor()->sceneList(outputFolder);
     m_trackView->connectOverlayTrack(true);
     if (multitrackEnabled) {
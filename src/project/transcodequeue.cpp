@@ -0,0 +1,318 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "transcodequeue.h"
+#include "kdenlivesettings.h"
+
+#include "kdenlive_debug.h"
+#include <KConfig>
+#include <KConfigGroup>
+#include <KLocalizedString>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTimer>
+
+static KConfigGroup outputsGroup(KConfig &config)
+{
+    return KConfigGroup(&config, "Outputs");
+}
+
+static QString outputsFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/transcodedfiles");
+}
+
+/** @brief Returns a quick fingerprint of a file, made of its size, modification time and first and last MB. */
+static QByteArray sourceFingerprint(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(file.size()));
+    hash.addData(QByteArray::number(QFileInfo(file).lastModified().toMSecsSinceEpoch()));
+    if (file.size() > 2000000) {
+        hash.addData(file.read(1000000));
+        if (file.seek(file.size() - 1000000)) {
+            hash.addData(file.readAll());
+        }
+    } else {
+        hash.addData(file.readAll());
+    }
+    return hash.result();
+}
+
+TranscodeQueue::TranscodeQueue(QObject *parent) : QObject(parent)
+    , m_lastId(0)
+    , m_reusedJobs(0)
+{
+}
+
+TranscodeQueue::~TranscodeQueue()
+{
+    blockSignals(true);
+    abort();
+}
+
+int TranscodeQueue::addJob(const QString &source, const QString &destination, const QStringList &parameters)
+{
+    const int id = ++m_lastId;
+    if (!isRunning()) {
+        m_progress.clear();
+    }
+    m_progress.insert(id, 0);
+    if (hasValidOutput(source, destination, parameters)) {
+        m_reusedJobs++;
+        m_logs.insert(id, QString());
+        QTimer::singleShot(0, this, [this, id]() {
+            m_reusedJobs--;
+            updateProgress(id, 100);
+            emit jobFinished(id, true, true);
+            if (!isRunning()) {
+                emit finished();
+            }
+        });
+        return id;
+    }
+    TranscodeJob *job = new TranscodeJob;
+    job->id = id;
+    job->source = source;
+    job->destination = destination;
+    job->parameters = parameters;
+    job->process = nullptr;
+    job->duration = 0;
+    job->progress = 0;
+    m_waiting << job;
+    startJobs();
+    return id;
+}
+
+void TranscodeQueue::startJobs()
+{
+    const int maxProcesses = qMax(1, KdenliveSettings::transcodeprocesses());
+    while (m_running.count() < maxProcesses && !m_waiting.isEmpty()) {
+        TranscodeJob *job = m_waiting.takeFirst();
+        job->process = new QProcess(this);
+        job->process->setProcessChannelMode(QProcess::MergedChannels);
+        connect(job->process, &QProcess::readyReadStandardOutput, this, &TranscodeQueue::slotReadOutput);
+        connect(job->process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &TranscodeQueue::slotProcessFinished);
+        connect(job->process, &QProcess::errorOccurred, this, &TranscodeQueue::slotProcessError);
+        m_running.insert(job->process, job);
+        qCDebug(KDENLIVE_LOG) << "Starting transcode job" << KdenliveSettings::ffmpegpath() << job->parameters;
+        job->process->start(KdenliveSettings::ffmpegpath(), job->parameters);
+        emit jobStarted(job->id);
+    }
+}
+
+void TranscodeQueue::deleteJob(TranscodeJob *job)
+{
+    if (job->process) {
+        m_running.remove(job->process);
+        job->process->disconnect(this);
+        if (job->process->state() != QProcess::NotRunning) {
+            job->process->close();
+            job->process->waitForFinished();
+        }
+        job->process->deleteLater();
+    }
+    delete job;
+}
+
+void TranscodeQueue::abort()
+{
+    qDeleteAll(m_waiting);
+    m_waiting.clear();
+    m_progress.clear();
+    const QList<TranscodeJob *> running = m_running.values();
+    for (TranscodeJob *job : running) {
+        const QString destination = job->destination;
+        deleteJob(job);
+        QFile::remove(destination);
+    }
+}
+
+bool TranscodeQueue::isRunning() const
+{
+    return !m_running.isEmpty() || !m_waiting.isEmpty() || m_reusedJobs > 0;
+}
+
+QString TranscodeQueue::log(int id) const
+{
+    return m_logs.value(id);
+}
+
+void TranscodeQueue::updateProgress(int id, int percent)
+{
+    if (!m_progress.contains(id)) {
+        // Job was aborted
+        return;
+    }
+    m_progress.insert(id, percent);
+    int total = 0;
+    for (int progress : m_progress) {
+        total += progress;
+    }
+    emit overallProgress(total / m_progress.count());
+}
+
+void TranscodeQueue::slotReadOutput()
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    TranscodeJob *job = m_running.value(process);
+    if (!job) {
+        return;
+    }
+    const QString log = QString::fromLatin1(process->readAll());
+    job->log.append(log);
+    if (job->duration == 0) {
+        if (log.contains(QStringLiteral("Duration:"))) {
+            const QString duration = log.section(QStringLiteral("Duration:"), 1, 1).section(QLatin1Char(','), 0, 0).simplified();
+            const QStringList numbers = duration.split(QLatin1Char(':'));
+            if (numbers.size() < 3) {
+                return;
+            }
+            job->duration = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
+        }
+    } else if (log.contains(QStringLiteral("time="))) {
+        double time;
+        const QString timeString = log.section(QStringLiteral("time="), 1, 1).simplified().section(QLatin1Char(' '), 0, 0);
+        if (timeString.contains(QLatin1Char(':'))) {
+            const QStringList numbers = timeString.split(QLatin1Char(':'));
+            if (numbers.size() < 3) {
+                return;
+            }
+            time = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
+        } else {
+            time = timeString.toDouble();
+        }
+        const int progress = qBound(0, (int)(100.0 * time / job->duration), 100);
+        if (progress != job->progress) {
+            job->progress = progress;
+            emit jobProgress(job->id, progress);
+            updateProgress(job->id, progress);
+        }
+    }
+}
+
+void TranscodeQueue::slotProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    TranscodeJob *job = m_running.value(process);
+    if (!job) {
+        return;
+    }
+    job->log.append(QString::fromLatin1(process->readAll()));
+    // A missing or empty destination file means transcoding failed
+    const bool success = exitCode == 0 && exitStatus == QProcess::NormalExit && QFileInfo(job->destination).size() > 0;
+    if (success) {
+        storeOutput(job->source, job->destination, job->parameters);
+    }
+    finishJob(job, success);
+}
+
+void TranscodeQueue::slotProcessError(QProcess::ProcessError error)
+{
+    // Other errors are followed by the finished signal
+    if (error != QProcess::FailedToStart) {
+        return;
+    }
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    TranscodeJob *job = m_running.value(process);
+    if (!job) {
+        return;
+    }
+    job->log.append(i18n("Cannot start %1: %2", KdenliveSettings::ffmpegpath(), process->errorString()));
+    finishJob(job, false);
+}
+
+void TranscodeQueue::finishJob(TranscodeJob *job, bool success)
+{
+    const int id = job->id;
+    m_logs.insert(id, job->log);
+    deleteJob(job);
+    startJobs();
+    updateProgress(id, 100);
+    emit jobFinished(id, success, false);
+    if (!isRunning()) {
+        emit finished();
+    }
+}
+
+// static
+QString TranscodeQueue::outputKey(const QString &source, const QStringList &parameters)
+{
+    const QByteArray fingerprint = sourceFingerprint(source);
+    if (fingerprint.isEmpty()) {
+        return QString();
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(fingerprint);
+    // The overwrite flag depends on the destination existing, it does not change the output
+    for (const QString &param : parameters) {
+        if (param != QLatin1String("-y")) {
+            hash.addData(param.toUtf8());
+            hash.addData("\n", 1);
+        }
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+// static
+bool TranscodeQueue::hasValidOutput(const QString &source, const QString &destination, const QStringList &parameters)
+{
+    QFileInfo info(destination);
+    if (!info.exists()) {
+        return false;
+    }
+    KConfig config(outputsFile(), KConfig::SimpleConfig);
+    const QStringList entry = outputsGroup(config).readEntry(destination, QStringList());
+    // The output file must not have been modified since it was created
+    if (entry.count() != 3 || entry.at(1).toLongLong() != info.size() || entry.at(2).toLongLong() != info.lastModified().toMSecsSinceEpoch()) {
+        return false;
+    }
+    return entry.at(0) == outputKey(source, parameters);
+}
+
+// static
+void TranscodeQueue::storeOutput(const QString &source, const QString &destination, const QStringList &parameters)
+{
+    const QString key = outputKey(source, parameters);
+    if (key.isEmpty()) {
+        return;
+    }
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    KConfig config(outputsFile(), KConfig::SimpleConfig);
+    KConfigGroup group = outputsGroup(config);
+    // Forget about outputs that were deleted
+    const QStringList destinations = group.keyList();
+    for (const QString &path : destinations) {
+        if (!QFile::exists(path)) {
+            group.deleteEntry(path);
+        }
+    }
+    QFileInfo info(destination);
+    group.writeEntry(destination, QStringList() << key << QString::number(info.size()) << QString::number(info.lastModified().toMSecsSinceEpoch()));
+    config.sync();
+}
@@ -0,0 +1,109 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef TRANSCODEQUEUE_H
+#define TRANSCODEQUEUE_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QProcess>
+#include <QStringList>
+
+/**
+ * @class TranscodeQueue
+ * @brief Runs FFmpeg transcoding jobs, several of them at the same time.
+ * Jobs are started in the order they were added, up to the configured number of
+ * concurrent processes. Progress is parsed from each process output and reported per
+ * job, and as an average of the jobs queued since the queue was last idle. When a job
+ * completes, its source fingerprint and parameters are recorded, so that a later identical
+ * job reuses the existing output file instead of transcoding again.
+ */
+
+class TranscodeQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TranscodeQueue(QObject *parent = nullptr);
+    virtual ~TranscodeQueue();
+    /** @brief Queue a transcoding job.
+     *  @param source the file to transcode
+     *  @param destination the output file written by FFmpeg
+     *  @param parameters the FFmpeg arguments
+     *  @return the job id */
+    int addJob(const QString &source, const QString &destination, const QStringList &parameters);
+    /** @brief Stop all jobs. */
+    void abort();
+    /** @brief Returns true if jobs are running or waiting. */
+    bool isRunning() const;
+    /** @brief Returns the FFmpeg output of a finished job. */
+    QString log(int id) const;
+    /** @brief Returns true if @param destination was created from the same source with the same parameters and can be reused. */
+    static bool hasValidOutput(const QString &source, const QString &destination, const QStringList &parameters);
+
+private:
+    struct TranscodeJob {
+        int id;
+        QString source;
+        QString destination;
+        QStringList parameters;
+        QProcess *process;
+        double duration;
+        int progress;
+        QString log;
+    };
+    QList<TranscodeJob *> m_waiting;
+    QMap<QProcess *, TranscodeJob *> m_running;
+    QMap<int, QString> m_logs;
+    /** @brief Progress of each job queued since the queue was last idle. */
+    QMap<int, int> m_progress;
+    int m_lastId;
+    /** @brief Number of reused outputs not yet reported. */
+    int m_reusedJobs;
+    /** @brief Start waiting jobs if less than the allowed number of processes run. */
+    void startJobs();
+    void deleteJob(TranscodeJob *job);
+    /** @brief Store the job log, delete it, start the next jobs and report the result. */
+    void finishJob(TranscodeJob *job, bool success);
+    /** @brief Store the progress of a job and report the average progress. */
+    void updateProgress(int id, int percent);
+    /** @brief Returns the key identifying the output of a job. */
+    static QString outputKey(const QString &source, const QStringList &parameters);
+    /** @brief Record that a job output is valid. */
+    static void storeOutput(const QString &source, const QString &destination, const QStringList &parameters);
+
+private slots:
+    void slotReadOutput();
+    void slotProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    /** @brief A process could not be started, it will never emit finished. */
+    void slotProcessError(QProcess::ProcessError error);
+
+signals:
+    void jobStarted(int id);
+    void jobProgress(int id, int percent);
+    /** @brief Average progress of the jobs queued since the queue was last idle. */
+    void overallProgress(int percent);
+    /** @brief A job is over. @param reused is true if an existing output file was used. */
+    void jobFinished(int id, bool success, bool reused);
+    /** @brief All jobs are over. */
+    void finished();
+};
+
+#endif
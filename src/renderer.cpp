@@ -32,6 +32,8 @@
 #include "bin/projectclip.h"
 #include "timeline/clip.h"
 #include "monitor/glwidget.h"
+#include "monitor/framecache.h"
+#include "monitor/sequenceprefetcher.h"
 #include "mltcontroller/clipcontroller.h"
 #include "timeline/transitionhandler.h"
 #include "core.h"
@@ -49,6 +51,7 @@
 #include <cstdarg>
 #include <KRecentDirs>
 #include <QPushButton>
+#include <QtMath>
 
 #define SEEK_INACTIVE (-1)
 
@@ -69,7 +72,12 @@ Render::Render(Kdenlive::MonitorId rendererName, BinController *binController, G
     m_isLoopMode(false),
     m_blackClip(nullptr),
     m_isActive(false),
-    m_isRefreshing(false)
+    m_isRefreshing(false),
+    m_frameCache(nullptr),
+    m_sequencePrefetcher(nullptr),
+    m_cachePlaySpeed(0),
+    m_cachePlayPosition(0),
+    m_editRange(-1, -1)
 {
     qRegisterMetaType<stringMap> ("stringMap");
     analyseAudio = KdenliveSettings::monitor_audio();
@@ -83,6 +91,12 @@ Render::Render(Kdenlive::MonitorId rendererName, BinController *binController, G
         m_mltProducer = m_blackClip->cut(0, 1);
         m_qmlView->setProducer(m_mltProducer);
         m_mltConsumer = qmlView->consumer();
+        if (m_name == Kdenlive::ClipMonitor && KdenliveSettings::monitor_framecache()) {
+            m_frameCache = new FrameCache(m_qmlView->profile(), this);
+        }
+        if (m_name == Kdenlive::ClipMonitor) {
+            m_sequencePrefetcher = new SequencePrefetcher();
+        }
     }
     /*m_mltConsumer->connect(*m_mltProducer);
     m_mltProducer->set_speed(0.0);*/
@@ -90,6 +104,10 @@ Render::Render(Kdenlive::MonitorId rendererName, BinController *binController, G
     m_refreshTimer.setInterval(50);
     connect(&m_refreshTimer, &QTimer::timeout, this, &Render::refresh);
     connect(this, &Render::checkSeeking, this, &Render::slotCheckSeeking);
+    connect(&m_cachePlayTimer, &QTimer::timeout, this, &Render::slotCachePlayStep);
+    m_editTimer.setSingleShot(true);
+    m_editTimer.setInterval(0);
+    connect(&m_editTimer, &QTimer::timeout, this, &Render::slotApplyEdits);
     if (m_name == Kdenlive::ProjectMonitor) {
         connect(m_binController, &BinController::prepareTimelineReplacement, this, &Render::prepareTimelineReplacement, Qt::DirectConnection);
         connect(m_binController, &BinController::replaceTimelineProducer, this, &Render::replaceTimelineProducer, Qt::DirectConnection);
@@ -105,6 +123,10 @@ Render::~Render()
 
 void Render::closeMlt()
 {
+    delete m_frameCache;
+    m_frameCache = nullptr;
+    delete m_sequencePrefetcher;
+    m_sequencePrefetcher = nullptr;
     delete m_showFrameEvent;
     delete m_pauseEvent;
     delete m_mltConsumer;
@@ -122,6 +144,13 @@ void Render::slotSwitchFullscreen()
 void Render::prepareProfileReset(double fps)
 {
     m_refreshTimer.stop();
+    stopCachePlayback();
+    if (m_frameCache) {
+        m_frameCache->setProducer(nullptr);
+    }
+    if (m_sequencePrefetcher) {
+        m_sequencePrefetcher->setProducer(nullptr);
+    }
     m_fps = fps;
 }
 
@@ -158,6 +187,13 @@ void Render::seek(int time)
 {
     resetZoneMode();
     time = qBound(0, time, m_mltProducer->get_length() - 1);
+    if (m_mltProducer->get_speed() == 0 && showCachedFrame(time)) {
+        if (requestedSeekPosition != SEEK_INACTIVE) {
+            // A consumer seek is in progress, make sure it ends on the displayed frame
+            requestedSeekPosition = time;
+        }
+        return;
+    }
     if (requestedSeekPosition == SEEK_INACTIVE) {
         requestedSeekPosition = time;
         if (m_mltProducer->get_speed() != 0) {
@@ -354,12 +390,20 @@ bool Render::updateProducer(Mlt::Producer *producer)
         m_qmlView->setProducer(producer);
         m_mltConsumer = m_qmlView->consumer();
     }
+    if (m_frameCache) {
+        // Capture producers cannot be cached
+        m_frameCache->setProducer(nullptr);
+    }
+    if (m_sequencePrefetcher) {
+        m_sequencePrefetcher->setProducer(nullptr);
+    }
     return true;
 }
 
 bool Render::setProducer(Mlt::Producer *producer, int position, bool isActive)
 {
     m_refreshTimer.stop();
+    stopCachePlayback();
     requestedSeekPosition = SEEK_INACTIVE;
     QMutexLocker locker(&m_mutex);
     QString currentId;
@@ -405,6 +449,13 @@ bool Render::setProducer(Mlt::Producer *producer, int position, bool isActive)
     blockSignals(false);
     m_mltProducer = producer;
     m_mltProducer->set_speed(0);
+    if (m_frameCache) {
+        m_frameCache->setProducer(m_mltProducer);
+        m_frameCache->setPlayhead(m_mltProducer->position());
+    }
+    if (m_sequencePrefetcher) {
+        m_sequencePrefetcher->setProducer(m_mltProducer);
+    }
     if (m_qmlView) {
         m_qmlView->setProducer(producer);
         m_mltConsumer = m_qmlView->consumer();
@@ -457,12 +508,21 @@ int Render::setSceneList(QString playlist, int position)
 
     //qCDebug(KDENLIVE_LOG) << "//////  RENDER, SET SCENE LIST:\n" << playlist <<"\n..........:::.";
 
-    // Remove previous profile info
-    QDomDocument doc;
-    doc.setContent(playlist);
-    QDomElement profile = doc.documentElement().firstChildElement(QStringLiteral("profile"));
-    doc.documentElement().removeChild(profile);
-    playlist = doc.toString();
+    // Remove previous profile info. Large projects take seconds to parse, so don't build a DOM just for that
+    int profileStart = playlist.indexOf(QLatin1String("<profile"));
+    if (profileStart > -1 && profileStart + 8 < playlist.length() && !playlist.at(profileStart + 8).isLetterOrNumber()) {
+        int profileEnd = playlist.indexOf(QLatin1Char('>'), profileStart);
+        if (profileEnd > -1 && playlist.at(profileEnd - 1) != QLatin1Char('/')) {
+            // Not a self closing element
+            profileEnd = playlist.indexOf(QLatin1String("</profile>"), profileEnd);
+            if (profileEnd > -1) {
+                profileEnd += 9;
+            }
+        }
+        if (profileEnd > -1) {
+            playlist.remove(profileStart, profileEnd - profileStart + 1);
+        }
+    }
 
     if (m_mltConsumer) {
         if (!m_mltConsumer->is_stopped()) {
@@ -601,8 +661,16 @@ const QString Render::sceneList(const QString &root)
     if (!prod.is_valid()) {
         return QString();
     }
+    // Project files always store the playlist audio at 100%, set it here so that we don't need to patch the xml afterwards
+    const QString volume = QString::fromUtf8(prod.get("meta.volume"));
+    prod.set("meta.volume", 1);
     xmlConsumer.connect(prod);
     xmlConsumer.run();
+    if (volume.isEmpty()) {
+        prod.set("meta.volume", (char *) nullptr);
+    } else {
+        prod.set("meta.volume", volume.toUtf8().constData());
+    }
     playlist = QString::fromUtf8(xmlConsumer.get("kdenlive_playlist"));
     return playlist;
 }
@@ -748,6 +816,17 @@ void Render::switchPlay(bool play, double speed)
     if (m_isZoneMode) {
         resetZoneMode();
     }
+    if (play && speed < 0 && canUseFrameCache()) {
+        startCachePlayback(speed);
+        return;
+    }
+    if (m_cachePlayTimer.isActive()) {
+        stopCachePlayback();
+        if (!play) {
+            // Producer is already paused on the last displayed frame
+            return;
+        }
+    }
     if (play) {
         double currentSpeed = m_mltProducer->get_speed();
         if (m_name == Kdenlive::ClipMonitor && m_mltConsumer->position() == m_mltProducer->get_out() && speed > 0) {
@@ -788,6 +867,11 @@ void Render::play(double speed)
         return;
     }
     double current_speed = m_mltProducer->get_speed();
+    if (speed < 0 && canUseFrameCache()) {
+        startCachePlayback(speed);
+        return;
+    }
+    stopCachePlayback();
     if (current_speed == speed) {
         return;
     }
@@ -958,6 +1042,9 @@ bool Render::isPlaying() const
 
 double Render::playSpeed() const
 {
+    if (m_cachePlayTimer.isActive()) {
+        return m_cachePlaySpeed;
+    }
     if (m_mltProducer) {
         return m_mltProducer->get_speed();
     }
@@ -1016,6 +1103,9 @@ bool Render::checkFrameNumber(int pos)
         requestedSeekPosition = SEEK_INACTIVE;
     }
     const double speed = m_mltProducer->get_speed();
+    if (m_sequencePrefetcher) {
+        m_sequencePrefetcher->setPlayhead(pos, speed);
+    }
     if (requestedSeekPosition != SEEK_INACTIVE) {
         m_mltProducer->set_speed(0);
         m_mltProducer->seek(requestedSeekPosition);
@@ -1032,6 +1122,14 @@ bool Render::checkFrameNumber(int pos)
         }
     } else {
         m_isRefreshing = false;
+        if (speed == 0 && m_frameCache) {
+            if (m_cachePlayTimer.isActive() && pos <= 0) {
+                // Reverse playback from cache reached clip start
+                stopCachePlayback();
+                return false;
+            }
+            m_frameCache->setPlayhead(pos, m_cachePlaySpeed);
+        }
         if (m_isZoneMode) {
             if (pos >= m_mltProducer->get_int("out") - 1) {
                 if (m_isLoopMode) {
@@ -1050,6 +1148,88 @@ bool Render::checkFrameNumber(int pos)
     return true;
 }
 
+FrameCache *Render::frameCache() const
+{
+    return m_frameCache;
+}
+
+bool Render::canUseFrameCache() const
+{
+    if (!m_frameCache || !m_frameCache->isActive() || externalConsumer || !m_isActive || !m_mltProducer) {
+        return false;
+    }
+    // Effects are not applied on cached frames, ignore normalizing filters attached by the loader
+    Mlt::Producer parent(m_mltProducer->parent());
+    for (int i = 0; i < parent.filter_count(); ++i) {
+        Mlt::Filter *filter = parent.filter(i);
+        const bool loaderFilter = filter->get_int("_loader") == 1;
+        delete filter;
+        if (!loaderFilter) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Render::showCachedFrame(int pos)
+{
+    if (!canUseFrameCache()) {
+        return false;
+    }
+    m_frameCache->setPlayhead(pos, m_cachePlaySpeed);
+    Mlt::Frame frame;
+    if (!m_frameCache->frameAt(pos, frame)) {
+        return false;
+    }
+    mlt_frame_set_position(frame.get_frame(), pos);
+    if (!m_qmlView->showFrame(frame)) {
+        return false;
+    }
+    // Keep producer in sync so that playback and refresh start from the displayed frame
+    m_mltProducer->seek(pos);
+    return true;
+}
+
+void Render::startCachePlayback(double speed)
+{
+    if (m_mltProducer->get_speed() != 0) {
+        m_mltProducer->set_speed(0);
+        m_mltProducer->seek(m_mltConsumer->position());
+        m_mltConsumer->purge();
+    }
+    m_cachePlaySpeed = speed;
+    m_cachePlayPosition = m_mltProducer->position();
+    m_frameCache->setPlayhead(m_mltProducer->position(), speed);
+    if (!m_cachePlayTimer.isActive()) {
+        m_cachePlayTimer.start(qMax(1, (int)(1000 / m_fps)));
+    }
+}
+
+void Render::stopCachePlayback()
+{
+    m_cachePlayTimer.stop();
+    m_cachePlaySpeed = 0;
+}
+
+void Render::slotCachePlayStep()
+{
+    if (!m_mltProducer || !canUseFrameCache()) {
+        stopCachePlayback();
+        return;
+    }
+    const int current = m_mltProducer->position();
+    if (qFloor(m_cachePlayPosition) != current) {
+        // The playhead was moved by a seek
+        m_cachePlayPosition = current;
+    }
+    const double next = qMax(0., m_cachePlayPosition + m_cachePlaySpeed);
+    const int pos = qFloor(next);
+    // If the frame is not decoded yet, hold the current frame until the cache catches up
+    if (pos == current || showCachedFrame(pos)) {
+        m_cachePlayPosition = next;
+    }
+}
+
 void Render::slotCheckSeeking()
 {
     if (requestedSeekPosition != SEEK_INACTIVE) {
@@ -1181,14 +1361,12 @@ Mlt::Producer *Render::getProducerForTrack(Mlt::Playlist &trackPlaylist, const Q
 
 Mlt::Tractor *Render::lockService()
 {
-    // we are going to replace some clips, purge consumer
+    // Locking the tractor prevents the consumer from fetching a frame during the edit.
+    // Queued frames are discarded after the edit if needed, see slotApplyEdits
     if (!m_mltProducer) {
         return nullptr;
     }
     QMutexLocker locker(&m_mutex);
-    if (m_mltConsumer) {
-        m_mltConsumer->purge();
-    }
     Mlt::Service service(m_mltProducer->parent().get_service());
     if (service.type() != tractor_type) {
         return nullptr;
@@ -1212,6 +1390,51 @@ void Render::unlockService(Mlt::Tractor *tractor)
         return;
     }
     service.unlock();
+    refreshRange(0, -1);
+}
+
+void Render::refreshRange(int start, int end)
+{
+    if (m_editRange.x() < 0) {
+        m_editRange = QPoint(start, end);
+    } else {
+        m_editRange.setX(qMin(m_editRange.x(), start));
+        m_editRange.setY(end < 0 || m_editRange.y() < 0 ? -1 : qMax(m_editRange.y(), end));
+    }
+    if (!m_editTimer.isActive()) {
+        m_editTimer.start();
+    }
+}
+
+void Render::slotApplyEdits()
+{
+    const int start = m_editRange.x();
+    const int end = m_editRange.y();
+    m_editRange = QPoint(-1, -1);
+    if (start < 0 || !m_mltProducer || !m_mltConsumer || !m_isActive) {
+        return;
+    }
+    const double speed = m_mltProducer->get_speed();
+    if (speed == 0) {
+        // Paused, only refresh if the displayed frame is affected
+        const int pos = m_mltProducer->position();
+        if (pos >= start && (end < 0 || pos <= end)) {
+            doRefresh();
+        }
+        return;
+    }
+    // While playing, the consumer holds frames between the displayed position and the producer position
+    const int shown = m_mltConsumer->position();
+    const int fetched = m_mltProducer->position();
+    if ((end >= 0 && end < qMin(shown, fetched)) || start > qMax(shown, fetched)) {
+        // Edit is outside of queued frames, it will be rendered when reached
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    const int drops = m_qmlView->droppedFrames();
+    m_mltConsumer->purge();
+    m_mltProducer->seek(shown + (speed > 0 ? 1 : -1));
+    qCDebug(KDENLIVE_LOG) << "Timeline edit invalidated queued frames" << shown << "-" << fetched << ", dropped frames:" << drops;
 }
 
 void Render::mltInsertSpace(const QMap<int, int> &trackClipStartList, const QMap<int, int> &trackTransitionStartList, int track, const GenTime &duration, const GenTime &timeOffset)
@@ -1732,21 +1955,23 @@ void Render::updateSlowMotionProducers(const QString &id, const QMap<QString, QS
     }
 }
 
-void Render::preparePreviewRendering(const QString &sceneListFile)
+const QString Render::previewSceneList(const QString &root)
 {
-    // Save temporary scenelist
-    Mlt::Consumer xmlConsumer(*m_qmlView->profile(), "xml", sceneListFile.toUtf8().constData());
+    // Capture the scenelist for timeline preview, the file is written by the preview thread
+    Mlt::Consumer xmlConsumer(*m_qmlView->profile(), "xml:kdenlive_preview");
     if (!xmlConsumer.is_valid()) {
-        return;
+        return QString();
     }
     m_mltProducer->optimise();
+    xmlConsumer.set("root", root.toUtf8().constData());
     xmlConsumer.set("terminate_on_pause", 1);
     xmlConsumer.set("no_meta", 1);
     Mlt::Producer prod(m_mltProducer->get_producer());
     if (!prod.is_valid()) {
-        return;
+        return QString();
     }
     xmlConsumer.connect(prod);
     xmlConsumer.run();
+    return QString::fromUtf8(xmlConsumer.get("kdenlive_preview"));
 }
 
@@ -55,6 +55,8 @@ class KComboBox;
 class BinController;
 class ClipController;
 class GLWidget;
+class FrameCache;
+class SequencePrefetcher;
 
 namespace Mlt
 {
@@ -209,8 +211,12 @@ Q_OBJECT public:
 
     /** @brief Lock the MLT service */
     Mlt::Tractor *lockService();
-    /** @brief Unlock the MLT service */
+    /** @brief Unlock the MLT service, the whole timeline is considered modified */
     void unlockService(Mlt::Tractor *tractor);
+    /** @brief Timeline frames from @param start to @param end (-1 for end of timeline) were modified.
+     *  All edits made during an event loop iteration are applied to the consumer at once, and queued frames are only
+     *  discarded if they are in the modified range, so that playback is not interrupted by edits elsewhere. */
+    void refreshRange(int start, int end = -1);
     const QString activeClipId();
     /** @brief Fill a combobox with the found blackmagic devices */
     static bool getBlackMagicDeviceList(KComboBox *devicelist, bool force = false);
@@ -249,8 +255,12 @@ Q_OBJECT public:
     void prepareProfileReset(double fps);
     void finishProfileReset();
     void updateSlowMotionProducers(const QString &id, const QMap<QString, QString> &passProperties);
-    void preparePreviewRendering(const QString &sceneListFile);
+    /** @brief Returns the MLT xml used for timeline preview rendering, without metadata.
+     *  @param root the folder the preview playlist will be written to */
+    const QString previewSceneList(const QString &root);
     void silentSeek(int time);
+    /** @brief Returns the decode ahead frame cache (only used by clip monitor), nullptr if disabled. */
+    FrameCache *frameCache() const;
 
 private:
 
@@ -288,6 +298,19 @@ private:
     bool m_isRefreshing;
     void closeMlt();
     QMap<QString, Mlt::Producer *> m_slowmotionProducers;
+    /** @brief Decoded frames around the playhead, used for scrubbing and reverse playback. */
+    FrameCache *m_frameCache;
+    /** @brief Reads image sequence files ahead of the playhead. */
+    SequencePrefetcher *m_sequencePrefetcher;
+    /** @brief Steps the playhead when reverse playing from the frame cache. */
+    QTimer m_cachePlayTimer;
+    double m_cachePlaySpeed;
+    /** @brief Playhead position during cache playback, fractional so that slow speeds move. */
+    double m_cachePlayPosition;
+    /** @brief Timeline range modified since last edit was applied, x is start and y end (-1 for end of timeline), x is -1 if no edit is pending. */
+    QPoint m_editRange;
+    /** @brief Applies pending edits once control returns to the event loop. */
+    QTimer m_editTimer;
 
     /** @brief Build the MLT Consumer object with initial settings.
      *  @param profileName The MLT profile to use for the consumer */
@@ -301,12 +324,23 @@ private:
     void cloneProperties(Mlt::Properties &dest, Mlt::Properties &source);
     /** @brief Get a track producer from a clip's id */
     Mlt::Producer *getProducerForTrack(Mlt::Playlist &trackPlaylist, const QString &clipId);
+    /** @brief Returns true if current producer can be displayed from the frame cache. */
+    bool canUseFrameCache() const;
+    /** @brief Display a frame from the frame cache, returns false if it is not available. */
+    bool showCachedFrame(int pos);
+    /** @brief Start playing from the frame cache at speed (used for reverse playback). */
+    void startCachePlayback(double speed);
+    void stopCachePlayback();
 
 private slots:
 
     /** @brief Refreshes the monitor display. */
     void refresh();
     void slotCheckSeeking();
+    /** @brief Display next frame when playing from the frame cache. */
+    void slotCachePlayStep();
+    /** @brief Update the consumer after timeline edits. */
+    void slotApplyEdits();
 
 signals:
     /** @brief The renderer stopped, either playing or rendering. */
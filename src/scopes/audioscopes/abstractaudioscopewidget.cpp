@@ -25,12 +25,14 @@ AbstractAudioScopeWidget::AbstractAudioScopeWidget(bool trackMouse, QWidget *par
     m_freq(0),
     m_nChannels(0),
     m_nSamples(0),
+    m_renderBlock(-1),
     m_audioFrame(),
-    m_newData(0)
+    m_newData(0),
+    m_audioBlock(-1)
 {
 }
 
-void AbstractAudioScopeWidget::slotReceiveAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples)
+void AbstractAudioScopeWidget::slotReceiveAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples, int block)
 {
 #ifdef DEBUG_AASW
     qCDebug(KDENLIVE_LOG) << "Received audio for " << widgetName() << '.';
@@ -39,6 +41,7 @@ void AbstractAudioScopeWidget::slotReceiveAudio(const audioShortVector &sampleDa
     m_freq = freq;
     m_nChannels = num_channels;
     m_nSamples = num_samples;
+    m_audioBlock.store(block);
 
     m_newData.fetchAndAddAcquire(1);
 
@@ -52,6 +55,7 @@ AbstractAudioScopeWidget::~AbstractAudioScopeWidget()
 QImage AbstractAudioScopeWidget::renderScope(uint accelerationFactor)
 {
     const int newData = m_newData.fetchAndStoreAcquire(0);
+    m_renderBlock = m_audioBlock.load();
 
     return renderAudioScope(accelerationFactor, m_audioFrame, m_freq, m_nChannels, m_nSamples, newData);
 }
@@ -31,7 +31,9 @@ public:
     virtual ~AbstractAudioScopeWidget();
 
 public slots:
-    void slotReceiveAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples);
+    /** @brief New audio to analyse.
+        block identifies the audio block, it is the same for all scopes receiving the same samples. */
+    void slotReceiveAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples, int block);
 
 protected:
     /** @brief This is just a wrapper function, subclasses can use renderAudioScope. */
@@ -48,10 +50,13 @@ protected:
     int m_freq;
     int m_nChannels;
     int m_nSamples;
+    /** @brief The audio block being rendered, to share its analysis with other scopes (see SpectralAnalysis). */
+    int m_renderBlock;
 
 private:
     audioShortVector m_audioFrame;
     QAtomicInt m_newData;
+    QAtomicInt m_audioBlock;
 
 };
 
@@ -13,7 +13,7 @@
 
 #include "abstractaudioscopewidget.h"
 #include "lib/external/kiss_fft/tools/kiss_fftr.h"
-#include "lib/audio/fftTools.h"
+#include "lib/audio/spectralAnalysis.h"
 #include "ui_audiospectrum_ui.h"
 
 // Enables debugging
@@ -63,7 +63,6 @@ private:
     QAction *m_aTrackMouse;
     QAction *m_aShowMax;
 
-    FFTTools m_fftTools;
     QVector<float> m_lastFFT;
     QSemaphore m_lastFFTLock;
 
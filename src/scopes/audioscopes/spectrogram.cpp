@@ -36,7 +36,6 @@
 
 Spectrogram::Spectrogram(QWidget *parent) :
     AbstractAudioScopeWidget(true, parent)
-    , m_fftTools()
     , m_fftHistory()
     , m_fftHistoryImg()
     , m_dBmin(-70)
@@ -338,18 +337,13 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
 
         if (newDataAvailable) {
 
-            float freqSpectrum[fftWindow / 2];
-
             // Get the spectral power distribution of the input samples,
             // using the given window size and function
             FFTTools::WindowType windowType = (FFTTools::WindowType) ui->windowFunction->itemData(ui->windowFunction->currentIndex()).toInt();
-            m_fftTools.fftNormalized(audioFrame, 0, num_channels, freqSpectrum, windowType, fftWindow, 0);
 
             // This methid might be called also when a simple refresh is required.
             // In this case there is no data to append to the history. Only append new data.
-            QVector<float> spectrumVector(fftWindow / 2);
-            memcpy(spectrumVector.data(), &freqSpectrum[0], fftWindow / 2 * sizeof(float));
-            m_fftHistory.prepend(spectrumVector);
+            m_fftHistory.prepend(SpectralAnalysis::shared()->spectrum(m_renderBlock, audioFrame, 0, num_channels, windowType, fftWindow));
         }
 #ifdef DEBUG_SPECTROGRAM
         else {
@@ -27,7 +27,7 @@
 
 #include "abstractaudioscopewidget.h"
 #include "ui_spectrogram_ui.h"
-#include "lib/audio/fftTools.h"
+#include "lib/audio/spectralAnalysis.h"
 
 class Spectrogram_UI;
 class Spectrogram : public AbstractAudioScopeWidget
@@ -56,7 +56,6 @@ protected:
 
 private:
     Ui::Spectrogram_UI *ui;
-    FFTTools m_fftTools;
     QAction *m_aResetHz;
     QAction *m_aGrid;
     QAction *m_aTrackMouse;
@@ -32,7 +32,8 @@
 
 ScopeManager::ScopeManager(QObject *parent) :
     QObject(parent),
-    m_lastConnectedRenderer(nullptr)
+    m_lastConnectedRenderer(nullptr),
+    m_audioBlock(0)
 {
     m_signalMapper = new QSignalMapper(this);
 
@@ -118,11 +119,13 @@ void ScopeManager::slotDistributeAudio(const audioShortVector &sampleData, int f
 #ifdef DEBUG_SM
     qCDebug(KDENLIVE_LOG) << "ScopeManager: Starting to distribute audio.";
 #endif
+    // All scopes get the same block number, so that they can share the spectral analysis
+    m_audioBlock = (m_audioBlock + 1) & 0x7fffffff;
     for (int i = 0; i < m_audioScopes.size(); ++i) {
         // Distribute audio to all scopes that are visible and want to be refreshed
         if (!m_audioScopes[i].scope->visibleRegion().isEmpty()) {
             if (m_audioScopes[i].scope->autoRefreshEnabled()) {
-                m_audioScopes[i].scope->slotReceiveAudio(sampleData, freq, num_channels, num_samples);
+                m_audioScopes[i].scope->slotReceiveAudio(sampleData, freq, num_channels, num_samples, m_audioBlock);
 #ifdef DEBUG_SM
                 qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed audio to " << m_audioScopes[i].scope->widgetName();
 #endif
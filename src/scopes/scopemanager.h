@@ -70,6 +70,8 @@ private:
     QList<GfxScopeData> m_colorScopes;
 
     AbstractRender *m_lastConnectedRenderer;
+    /** @brief Number of the last audio block distributed to the scopes. */
+    int m_audioBlock;
 
     QSignalMapper *m_signalMapper;
 
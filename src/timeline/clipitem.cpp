@@ -28,12 +28,14 @@
 #include "doc/kthumb.h"
 #include "bin/projectclip.h"
 #include "mltcontroller/effectscontroller.h"
+#include "mltcontroller/effectprofiler.h"
 #include "onmonitoritems/rotoscoping/rotowidget.h"
 #include "utils/KoIconUtils.h"
 
 #include <klocalizedstring.h>
 #include "kdenlive_debug.h"
 #include <QPainter>
+#include <QtMath>
 #include <QTimer>
 #include <QStyleOptionGraphicsItem>
 #include <QGraphicsScene>
@@ -41,9 +43,14 @@
 
 static int FRAME_SIZE;
 
+// Width in pixels of the cached waveform chunks, and maximum number of cached chunks per clip
+static const int audioThumbChunkWidth = 256;
+static const int maxAudioThumbChunks = 16;
+
 ClipItem::ClipItem(ProjectClip *clip, const ItemInfo &info, double fps, double speed, int strobe, int frame_width, bool generateThumbs) :
     AbstractClipItem(info, QRectF(), fps),
     m_binClip(clip),
+    m_effectsLoad(-1),
     m_startFade(0),
     m_endFade(0),
     m_clipState(PlaylistState::Original),
@@ -57,6 +64,7 @@ ClipItem::ClipItem(ProjectClip *clip, const ItemInfo &info, double fps, double s
     //m_hover(false),
     m_speed(speed),
     m_strobe(strobe),
+    m_audioThumbCacheKey({0, 0, 0, false, 0, 0}),
     m_framePixelWidth(0)
 {
     setZValue(2);
@@ -92,6 +100,7 @@ ClipItem::ClipItem(ProjectClip *clip, const ItemInfo &info, double fps, double s
             m_endThumbTimer.setSingleShot(true);
             connect(&m_endThumbTimer, &QTimer::timeout, this, &ClipItem::slotGetEndThumb);
             connect(m_binClip, SIGNAL(thumbReady(int, QImage)), this, SLOT(slotThumbReady(int, QImage)));
+            connect(m_binClip, &ProjectClip::filmstripTileReady, this, &ClipItem::slotFilmstripTileReady);
             if (generateThumbs && KdenliveSettings::videothumbnails()) {
                 QTimer::singleShot(0, this, &ClipItem::slotFetchThumbs);
             }
@@ -107,12 +116,15 @@ ClipItem::ClipItem(ProjectClip *clip, const ItemInfo &info, double fps, double s
         m_baseColor = QColor(141, 215, 166);
     }
     connect(m_binClip, &ProjectClip::gotAudioData, this, &ClipItem::slotGotAudioData);
+    connect(EffectProfiler::shared(), &EffectProfiler::costReady, this, &ClipItem::slotEffectCostReady);
     m_paintColor = m_baseColor;
 }
 
 ClipItem::~ClipItem()
 {
     blockSignals(true);
+    // The key could be reused by another item
+    EffectProfiler::shared()->forget(profilerKey());
     m_endThumbTimer.stop();
     m_startThumbTimer.stop();
     if (scene()) {
@@ -473,12 +485,22 @@ void ClipItem::slotThumbReady(int frame, const QImage &img)
         m_endPix = pix;
         m_endThumbRequested = false;
         update(r.right() - width, r.top(), width, r.height());
-    } else if (projectScene()->scale().x() == FRAME_SIZE) {
-        // We are in full zoom, each frame should be painted
-        update();
     }
 }
 
+void ClipItem::slotFilmstripTileReady(int level, int index)
+{
+    if (scene() == nullptr || level != ProjectClip::filmstripLevel(FRAME_SIZE / projectScene()->scale().x())) {
+        return;
+    }
+    // Repaint the part of the clip covered by the tile
+    const int tileLength = ProjectClip::filmstripStep(level) * ProjectClip::filmstripTileFrames;
+    const int tileStart = index * tileLength - m_info.cropStart.frames(m_fps);
+    const double thumbFrames = FRAME_SIZE / projectScene()->scale().x();
+    const QRectF r = boundingRect();
+    update(r.intersected(QRectF(r.left() + tileStart - 1, r.top(), tileLength + thumbFrames + 2, r.height())));
+}
+
 void ClipItem::slotSetStartThumb(const QPixmap &pix)
 {
     m_startPix = pix;
@@ -502,6 +524,7 @@ QPixmap ClipItem::endThumb() const
 void ClipItem::slotGotAudioData()
 {
     m_audioThumbReady = true;
+    m_audioThumbCachePic.clear();
     if (m_clipType == AV && m_clipState != PlaylistState::AudioOnly) {
         QRectF r = boundingRect();
         r.setTop(r.top() + r.height() / 2 - 1);
@@ -511,6 +534,140 @@ void ClipItem::slotGotAudioData()
     }
 }
 
+void ClipItem::drawCachedAudioThumb(QPainter *painter, const QRectF &mappedRect, const QRectF &exposed, double scale)
+{
+    // Waveforms are rendered in chunks of fixed pixel width, reused until zoom, height or clip crop change
+    const qreal pixelRatio = painter->device()->devicePixelRatioF();
+    const AudioThumbCacheKey cacheKey = {scale, mappedRect.height(), m_info.cropStart.frames(m_fps), KdenliveSettings::displayallchannels(), m_binClip->audioFrameCache.count(), pixelRatio};
+    if (!(cacheKey == m_audioThumbCacheKey)) {
+        m_audioThumbCachePic.clear();
+        m_audioThumbCacheKey = cacheKey;
+    }
+    const int height = qCeil(mappedRect.height());
+    const int firstChunk = qMax(0, (int)(exposed.left() * scale / audioThumbChunkWidth));
+    const int lastChunk = qMax(0, (int)(exposed.right() * scale / audioThumbChunkWidth));
+    for (int chunk = firstChunk; chunk <= lastChunk; ++chunk) {
+        if (!m_audioThumbCachePic.contains(chunk)) {
+            if (m_audioThumbCachePic.count() >= maxAudioThumbChunks) {
+                // Drop the chunk farthest from the painted area
+                if (chunk - m_audioThumbCachePic.firstKey() > m_audioThumbCachePic.lastKey() - chunk) {
+                    m_audioThumbCachePic.erase(m_audioThumbCachePic.begin());
+                } else {
+                    m_audioThumbCachePic.erase(--m_audioThumbCachePic.end());
+                }
+            }
+            // Render at the screen resolution, painting is done in logical coordinates
+            QPixmap pix(qCeil(audioThumbChunkWidth * pixelRatio), qCeil(height * pixelRatio));
+            pix.setDevicePixelRatio(pixelRatio);
+            pix.fill(Qt::transparent);
+            QPainter p(&pix);
+            const int startpixel = (int)(chunk * audioThumbChunkWidth / scale);
+            const int endpixel = qMin((int) rect().width() + 1, (int)((chunk + 1) * audioThumbChunkWidth / scale) + 1);
+            drawAudioThumb(&p, QRectF(-chunk * audioThumbChunkWidth, 0, mappedRect.width(), mappedRect.height()), scale, startpixel, endpixel);
+            p.end();
+            m_audioThumbCachePic.insert(chunk, pix);
+        }
+        painter->drawPixmap(QPointF(mappedRect.left() + chunk * audioThumbChunkWidth, mappedRect.top()), m_audioThumbCachePic.value(chunk));
+    }
+}
+
+void ClipItem::drawAudioThumb(QPainter *painter, const QRectF &mappedRect, double scale, int startpixel, int endpixel)
+{
+    int channels = m_binClip->audioChannels();
+    int cropLeft = m_info.cropStart.frames(m_fps);
+    double startx = mappedRect.left() + startpixel * scale;
+    double endx = mappedRect.left() + endpixel * scale;
+    int offset = 1;
+    if (scale < 1) {
+        offset = (int)(1.0 / scale);
+    }
+    int audioLevelCount = m_binClip->audioFrameCache.count() - 1;
+    if (!KdenliveSettings::displayallchannels()) {
+        // simplified audio
+        int channelHeight = mappedRect.height();
+        int startOffset = startpixel + cropLeft;
+        int i = startOffset;
+        if (offset * scale > 1.0) {
+            // Pixels are smaller than a frame, draw using painterpath
+            QPainterPath positiveChannelPath;
+            positiveChannelPath.moveTo(startx, mappedRect.bottom());
+            for (; i < endpixel + cropLeft + offset; i += offset) {
+                double value = m_binClip->audioFrameCache.at(qMin(i * channels, audioLevelCount)).toDouble() / 256;
+                for (int channel = 1; channel < channels; channel ++) {
+                    value = qMax(value, m_binClip->audioFrameCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256);
+                }
+                positiveChannelPath.lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - (value * channelHeight));
+            }
+            positiveChannelPath.lineTo(startx + (i - startOffset) * scale, mappedRect.bottom());
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(QBrush(QColor(80, 80, 150, 200)));
+            painter->drawPath(positiveChannelPath);
+        } else {
+            // Pixels are larger than frames, draw simple lines
+            painter->setPen(QColor(80, 80, 150, 200));
+            i = startx;
+            for (; i < endx; i++) {
+                int framePos = startOffset + ((i - startx) / scale);
+                double value = m_binClip->audioFrameCache.at(qMin(framePos * channels, audioLevelCount)).toDouble() / 256;
+                for (int channel = 1; channel < channels; channel ++) {
+                    value = qMax(value, m_binClip->audioFrameCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256);
+                }
+                painter->drawLine(i, mappedRect.bottom() - (value * channelHeight), i, mappedRect.bottom());
+            }
+        }
+    } else if (channels >= 0) {
+        int channelHeight = (int)(mappedRect.height() + 0.5) / channels;
+        int startOffset = startpixel + cropLeft;
+        double value = 0;
+        if (offset * scale > 1.0) {
+            // Pixels are smaller than a frame, draw using painterpath
+            QMap<int, QPainterPath > positiveChannelPaths;
+            QMap<int, QPainterPath > negativeChannelPaths;
+            int i;
+            painter->setPen(QColor(80, 80, 150));
+            for (int channel = 0; channel < channels; channel ++) {
+                int y = channelHeight * channel + channelHeight / 2;
+                positiveChannelPaths[channel].moveTo(startx, mappedRect.bottom() - y);
+                negativeChannelPaths[channel].moveTo(startx, mappedRect.bottom() - y);
+                // Draw channel median line
+                i = startOffset;
+                painter->drawLine(startx, mappedRect.bottom() - y, endx, mappedRect.bottom() - y);
+                for (; i < endpixel + cropLeft + offset; i += offset) {
+                    value = m_binClip->audioFrameCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256 * channelHeight / 2;
+                    positiveChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y - value);
+                    negativeChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y + value);
+                }
+            }
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(QBrush(QColor(80, 80, 150, 200)));
+            for (int channel = 0; channel < channels; channel ++) {
+                int y = channelHeight * channel + channelHeight / 2;
+                positiveChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y);
+                negativeChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y);
+                painter->drawPath(positiveChannelPaths.value(channel));
+                painter->drawPath(negativeChannelPaths.value(channel));
+            }
+        } else {
+            // Pixels are larger than frames, draw simple lines
+            painter->setPen(QColor(80, 80, 150));
+            for (int channel = 0; channel < channels; channel ++) {
+                // Draw channel median line
+                painter->drawLine(startx, mappedRect.bottom() - (channelHeight * channel + channelHeight / 2), endx, mappedRect.bottom() - (channelHeight * channel + channelHeight / 2));
+            }
+            int i = startx;
+            painter->setPen(QColor(80, 80, 150, 200));
+            for (; i < endx; i++) {
+                int framePos = startOffset + ((i - startx) / scale);
+                for (int channel = 0; channel < channels; channel ++) {
+                    int y = channelHeight * channel + channelHeight / 2;
+                    value = m_binClip->audioFrameCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256 * channelHeight / 2;
+                    painter->drawLine(i, mappedRect.bottom() - value - y, i, mappedRect.bottom() - y + value);
+                }
+            }
+        }
+    }
+}
+
 int ClipItem::type() const
 {
     return AVWidget;
@@ -638,142 +795,66 @@ void ClipItem::paint(QPainter *painter,
             painter->drawPixmap(thumbRect, m_startPix, m_startPix.rect());
         }
 
-        // if we are in full zoom, paint thumbnail for every frame
-        if (clipType() != Color && clipType() != Audio && transformation.m11() == FRAME_SIZE) {
+        if (clipType() != Color && clipType() != Audio) {
+            const double frameWidth = transformation.m11();
             int offset = (m_info.startPos - m_info.cropStart).frames(m_fps);
-            int left = qMax((int) m_info.cropStart.frames(m_fps) + 1, (int) mapToScene(exposed.left(), 0).x() - offset);
-            int right = qMin((int)(m_info.cropStart + m_info.cropDuration).frames(m_fps) - 1, (int) mapToScene(exposed.right(), 0).x() - offset);
-            QPointF startPos = mapped.topLeft();
             int startOffset = m_info.cropStart.frames(m_fps);
+            int endOffset = (m_info.cropStart + m_info.cropDuration).frames(m_fps) - 1;
+            QPointF startPos = mapped.topLeft();
             if (clipType() == Image || clipType() == Text || clipType() == QText || m_clipType == TextTemplate) {
-                for (int i = left; i <= right; ++i) {
-                    painter->drawPixmap(startPos + QPointF(FRAME_SIZE * (i - startOffset), 0), m_startPix);
+                // if we are in full zoom, paint thumbnail for every frame
+                if (frameWidth == FRAME_SIZE) {
+                    int left = qMax(startOffset + 1, (int) mapToScene(exposed.left(), 0).x() - offset);
+                    int right = qMin(endOffset, (int) mapToScene(exposed.right(), 0).x() - offset);
+                    for (int i = left; i <= right; ++i) {
+                        painter->drawPixmap(startPos + QPointF(FRAME_SIZE * (i - startOffset), 0), m_startPix);
+                    }
                 }
             } else {
-                QImage img;
-                QPen pen(Qt::white);
-                pen.setStyle(Qt::DotLine);
-                QSet <int> missing;
-                for (int i = left; i <= right; ++i) {
-                    QPointF xpos = startPos + QPointF(FRAME_SIZE * (i - startOffset), 0);
-                    thumbRect.moveTopLeft(xpos);
-                    img = m_binClip->findCachedThumb(i);
-                    if (img.isNull()) {
-                        missing << i;
-                    } else {
-                        painter->drawImage(thumbRect, img);
+                // Paint a filmstrip from the cached tiles of the zoom level where thumbnails don't overlap
+                int level = ProjectClip::filmstripLevel(FRAME_SIZE / frameWidth);
+                if (level >= 0) {
+                    const int step = ProjectClip::filmstripStep(level);
+                    const int tileLength = step * ProjectClip::filmstripTileFrames;
+                    // Frames covered by the start and end thumbnails are not painted
+                    const int margin = qCeil(FRAME_SIZE / frameWidth - 0.001);
+                    int left = qMax(startOffset + margin, (int) mapToScene(exposed.left(), 0).x() - offset - step + 1);
+                    int right = qMin(endOffset - margin, (int) mapToScene(exposed.right(), 0).x() - offset);
+                    left = (left + step - 1) / step * step;
+                    QImage tile;
+                    int tileIndex = -1;
+                    QSet <int> missing;
+                    for (int i = left; i <= right; i += step) {
+                        if (i / tileLength != tileIndex) {
+                            tileIndex = i / tileLength;
+                            tile = m_binClip->findFilmstripTile(level, tileIndex);
+                            if (tile.isNull()) {
+                                missing << tileIndex;
+                            }
+                        }
+                        QPointF xpos = startPos + QPointF(frameWidth * (i - startOffset), 0);
+                        if (!tile.isNull()) {
+                            const int tileFrameWidth = tile.width() / ProjectClip::filmstripTileFrames;
+                            const QRect source(i % tileLength / step * tileFrameWidth, 0, tileFrameWidth, tile.height());
+                            painter->drawImage(QRectF(xpos.x(), xpos.y(), mapped.height() * tileFrameWidth / tile.height(), mapped.height()), tile, source);
+                        }
+                        painter->drawLine(xpos, xpos + QPointF(0, mapped.height()));
+                    }
+                    if (!missing.isEmpty()) {
+                        m_binClip->slotQueryFilmstripTiles(level, missing.toList());
                     }
-                    painter->drawLine(xpos, xpos + QPointF(0, mapped.height()));
-                }
-                if (!missing.isEmpty()) {
-                    m_binClip->slotQueryIntraThumbs(missing.toList());
                 }
             }
         }
     }
     // draw audio thumbnails
     if (KdenliveSettings::audiothumbnails() && m_speed == 1.0 && m_clipState != PlaylistState::VideoOnly && m_originalClipState != PlaylistState::VideoOnly && (((m_clipType == AV || m_clipType == Playlist) && (exposed.bottom() > (rect().height() / 2) || m_originalClipState == PlaylistState::AudioOnly || m_clipState == PlaylistState::AudioOnly)) || m_clipType == Audio) && m_audioThumbReady && !m_binClip->audioFrameCache.isEmpty()) {
-        int startpixel = qMax(0, (int) exposed.left());
-        int endpixel = qMax(0, (int)(exposed.right() + 0.5) + 1);
         QRectF mappedRect = mapped;
         if (m_clipType != Audio && m_clipState != PlaylistState::AudioOnly && m_originalClipState != PlaylistState::AudioOnly && KdenliveSettings::videothumbnails()) {
             mappedRect.setTop(mappedRect.bottom() - mapped.height() / 2);
         }
 
-        double scale = transformation.m11();
-        int channels = m_binClip->audioChannels();
-        int cropLeft = m_info.cropStart.frames(m_fps);
-        double startx = transformation.map(QPoint(startpixel, 0)).x();
-        double endx = transformation.map(QPoint(endpixel, 0)).x();
-        int offset = 1;
-        if (scale < 1) {
-            offset = (int)(1.0 / scale);
-        }
-        int audioLevelCount = m_binClip->audioFrameCache.count() - 1;
-        if (!KdenliveSettings::displayallchannels()) {
-            // simplified audio
-            int channelHeight = mappedRect.height();
-            int startOffset = startpixel + cropLeft;
-            int i = startOffset;
-            if (offset * scale > 1.0) {
-                // Pixels are smaller than a frame, draw using painterpath
-                QPainterPath positiveChannelPath;
-                positiveChannelPath.moveTo(startx, mappedRect.bottom());
-                for (; i < endpixel + cropLeft + offset; i += offset) {
-                    double value = m_binClip->audioFrameCache.at(qMin(i * channels, audioLevelCount)).toDouble() / 256;
-                    for (int channel = 1; channel < channels; channel ++) {
-                        value = qMax(value, m_binClip->audioFrameCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256);
-                    }
-                    positiveChannelPath.lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - (value * channelHeight));
-                }
-                positiveChannelPath.lineTo(startx + (i - startOffset) * scale, mappedRect.bottom());
-                painter->setPen(Qt::NoPen);
-                painter->setBrush(QBrush(QColor(80, 80, 150, 200)));
-                painter->drawPath(positiveChannelPath);
-            } else {
-                // Pixels are larger than frames, draw simple lines
-                painter->setPen(QColor(80, 80, 150, 200));
-                i = startx;
-                for (; i < endx; i++) {
-                    int framePos = startOffset + ((i - startx) / scale);
-                    double value = m_binClip->audioFrameCache.at(qMin(framePos * channels, audioLevelCount)).toDouble() / 256;
-                    for (int channel = 1; channel < channels; channel ++) {
-                        value = qMax(value, m_binClip->audioFrameCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256);
-                    }
-                    painter->drawLine(i, mappedRect.bottom() - (value * channelHeight), i, mappedRect.bottom());
-                }
-            }
-        } else if (channels >= 0) {
-            int channelHeight = (int)(mappedRect.height() + 0.5) / channels;
-            int startOffset = startpixel + cropLeft;
-            double value = 0;
-            if (offset * scale > 1.0) {
-                // Pixels are smaller than a frame, draw using painterpath
-                QMap<int, QPainterPath > positiveChannelPaths;
-                QMap<int, QPainterPath > negativeChannelPaths;
-                int i;
-                painter->setPen(QColor(80, 80, 150));
-                for (int channel = 0; channel < channels; channel ++) {
-                    int y = channelHeight * channel + channelHeight / 2;
-                    positiveChannelPaths[channel].moveTo(startx, mappedRect.bottom() - y);
-                    negativeChannelPaths[channel].moveTo(startx, mappedRect.bottom() - y);
-                    // Draw channel median line
-                    i = startOffset;
-                    painter->drawLine(startx, mappedRect.bottom() - y, endx, mappedRect.bottom() - y);
-                    for (; i < endpixel + cropLeft + offset; i += offset) {
-                        value = m_binClip->audioFrameCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256 * channelHeight / 2;
-                        positiveChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y - value);
-                        negativeChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y + value);
-                    }
-                }
-                painter->setPen(Qt::NoPen);
-                painter->setBrush(QBrush(QColor(80, 80, 150, 200)));
-                for (int channel = 0; channel < channels; channel ++) {
-                    int y = channelHeight * channel + channelHeight / 2;
-                    positiveChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y);
-                    negativeChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y);
-                    painter->drawPath(positiveChannelPaths.value(channel));
-                    painter->drawPath(negativeChannelPaths.value(channel));
-                }
-            } else {
-                // Pixels are larger than frames, draw simple lines
-                painter->setPen(QColor(80, 80, 150));
-                for (int channel = 0; channel < channels; channel ++) {
-                    // Draw channel median line
-                    painter->drawLine(startx, mappedRect.bottom() - (channelHeight * channel + channelHeight / 2), endx, mappedRect.bottom() - (channelHeight * channel + channelHeight / 2));
-                }
-                int i = startx;
-                painter->setPen(QColor(80, 80, 150, 200));
-                for (; i < endx; i++) {
-                    int framePos = startOffset + ((i - startx) / scale);
-                    for (int channel = 0; channel < channels; channel ++) {
-                        int y = channelHeight * channel + channelHeight / 2;
-                        value = m_binClip->audioFrameCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256 * channelHeight / 2;
-                        painter->drawLine(i, mappedRect.bottom() - value - y, i, mappedRect.bottom() - y + value);
-                    }
-                }
-            }
-        }
+        drawCachedAudioThumb(painter, mappedRect, exposed, transformation.m11());
         painter->setPen(QPen());
     }
     if (m_clipState == PlaylistState::Disabled) {
@@ -810,9 +891,14 @@ void ClipItem::paint(QPainter *painter,
 
         // Draw effects names
         if (!m_effectNames.isEmpty() && mapped.width() > (5 * fontUnit)) {
-            QRectF txtBounding = painter->boundingRect(mapped, Qt::AlignLeft | Qt::AlignTop, m_effectNames);
-            QColor bColor = palette.window().color();
-            QColor tColor = palette.text().color();
+            QString effectNames = m_effectNames;
+            if (m_effectsLoad >= 0) {
+                effectNames.append(i18n(" (load %1)", QLocale().toString(m_effectsLoad, 'f', 1)));
+            }
+            QRectF txtBounding = painter->boundingRect(mapped, Qt::AlignLeft | Qt::AlignTop, effectNames);
+            // Clips that cannot play in real time are highlighted
+            QColor bColor = m_effectsLoad > 1 ? QColor(200, 50, 50) : palette.window().color();
+            QColor tColor = m_effectsLoad > 1 ? QColor(Qt::white) : palette.text().color();
             tColor.setAlpha(220);
             if (m_timeLine && m_timeLine->state() == QTimeLine::Running) {
                 qreal value = m_timeLine->currentValue();
@@ -824,7 +910,7 @@ void ClipItem::paint(QPainter *painter,
             painter->setPen(Qt::NoPen);
             painter->drawRoundedRect(txtBounding.adjusted(-1 + effectOffset, -2, 4 + effectOffset, -1), 3, 3);
             painter->setPen(tColor);
-            painter->drawText(txtBounding.adjusted(2 + effectOffset, 0, 1 + effectOffset, -1), Qt::AlignCenter, m_effectNames);
+            painter->drawText(txtBounding.adjusted(2 + effectOffset, 0, 1 + effectOffset, -1), Qt::AlignCenter, effectNames);
         }
 
         // Draw clip name
@@ -2120,3 +2206,32 @@ bool ClipItem::hasVisibleVideo() const
 {
     return (m_clipType != Audio && m_clipState != PlaylistState::AudioOnly && m_clipState != PlaylistState::Disabled);
 }
+
+void ClipItem::setEffectsLoad(double load)
+{
+    if (qFuzzyCompare(load, m_effectsLoad)) {
+        return;
+    }
+    m_effectsLoad = load;
+    update();
+}
+
+double ClipItem::effectsLoad() const
+{
+    return m_effectsLoad;
+}
+
+QString ClipItem::profilerKey() const
+{
+    // Measures follow the item when it is moved, they are forgotten when it is deleted
+    return QStringLiteral("timeline:%1").arg(reinterpret_cast<quintptr>(this));
+}
+
+void ClipItem::slotEffectCostReady(const QString &key)
+{
+    if (key != profilerKey()) {
+        return;
+    }
+    const EffectCost cost = EffectProfiler::shared()->cost(key);
+    setEffectsLoad(cost.isValid() ? cost.load() : -1);
+}
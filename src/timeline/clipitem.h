@@ -195,6 +195,12 @@ public:
     PlaylistState::ClipState originalState() const;
     /** @brief Returns true if this clip is currently displaying video. */
     bool hasVisibleVideo() const;
+    /** @brief Set the measured playback load of the clip with its effects, -1 if unknown. */
+    void setEffectsLoad(double load);
+    /** @brief Returns the measured playback load of the clip with its effects, above 1 it cannot play in real time. */
+    double effectsLoad() const;
+    /** @brief Returns the key of the effect measures of this clip, it does not change when the clip is moved. */
+    QString profilerKey() const;
 
 protected:
     void dragEnterEvent(QGraphicsSceneDragDropEvent *event) Q_DECL_OVERRIDE;
@@ -210,6 +216,7 @@ private:
     ItemInfo m_speedIndependantInfo;
     ClipType m_clipType;
     QString m_effectNames;
+    double m_effectsLoad;
     int m_startFade;
     int m_endFade;
     PlaylistState::ClipState m_clipState;
@@ -233,10 +240,31 @@ private:
 
     EffectsList m_effectList;
     QList<Transition *> m_transitionsList;
+    /** @brief Rendered waveform chunks, by chunk index. */
     QMap<int, QPixmap> m_audioThumbCachePic;
+    /** @brief Parameters of the cached waveform chunks, they are rendered again when one changes. */
+    struct AudioThumbCacheKey {
+        double scale;
+        double height;
+        int cropStart;
+        bool allChannels;
+        int dataCount;
+        qreal pixelRatio;
+        bool operator==(const AudioThumbCacheKey &other) const
+        {
+            return scale == other.scale && height == other.height && cropStart == other.cropStart && allChannels == other.allChannels &&
+                   dataCount == other.dataCount && pixelRatio == other.pixelRatio;
+        }
+    };
+    AudioThumbCacheKey m_audioThumbCacheKey;
     bool m_audioThumbReady;
     double m_framePixelWidth;
 
+    /** @brief Paint the audio waveform from cached chunks, rendering the missing ones. */
+    void drawCachedAudioThumb(QPainter *painter, const QRectF &mappedRect, const QRectF &exposed, double scale);
+    /** @brief Render the audio waveform of frames @param startpixel to @param endpixel in device coordinates. */
+    void drawAudioThumb(QPainter *painter, const QRectF &mappedRect, double scale, int startpixel, int endpixel);
+
 private slots:
     void slotGetStartThumb();
     void slotGetEndThumb();
@@ -245,10 +273,14 @@ private slots:
     void slotSetStartThumb(const QImage &img);
     void slotSetEndThumb(const QImage &img);
     void slotThumbReady(int frame, const QImage &img);
+    /** @brief A filmstrip tile was created, repaint the frames it covers. */
+    void slotFilmstripTileReady(int level, int index);
     /** @brief For fixed thumbnail clip (image / titles), update thumb to reflect bin thumbnail. */
     void slotUpdateThumb(const QImage &);
     /** @brief Something changed a detail in clip (thumbs, markers,...), repaint. */
     void slotRefreshClip();
+    /** @brief Effects were profiled, display the load if they are ours. */
+    void slotEffectCostReady(const QString &key);
 
 public slots:
     void slotFetchThumbs();
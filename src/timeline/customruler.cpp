@@ -20,6 +20,7 @@
 #include "customruler.h"
 
 #include "kdenlivesettings.h"
+#include "lib/audio/loudnessMeter.h"
 
 #include <QIcon>
 #include <klocalizedstring.h>
@@ -538,6 +539,21 @@ void CustomRuler::paintEvent(QPaintEvent *e)
         p.drawLine(paintRect.left(), MAX_HEIGHT + PREVIEW_SIZE, paintRect.right(), MAX_HEIGHT + PREVIEW_SIZE);
     }
 
+    // draw loudness curve, 0 LUFS on top and silence at the bottom of the ruler
+    if (!m_loudnessCurve.isEmpty()) {
+        const double secondWidth = m_timecode.fps() * m_factor;
+        const int first = qMax(0, (int)((paintRect.left() + m_offset) / secondWidth) - 1);
+        const int last = qMin(m_loudnessCurve.count() - 1, (int)((paintRect.right() + m_offset) / secondWidth) + 1);
+        QPolygonF curve;
+        for (int i = first; i <= last; ++i) {
+            curve << QPointF((i + 0.5) * secondWidth - m_offset, MAX_HEIGHT * m_loudnessCurve.at(i) / LoudnessMeter::silence);
+        }
+        QColor loudness(Qt::darkMagenta);
+        loudness.setAlpha(180);
+        p.setPen(loudness);
+        p.drawPolyline(curve);
+    }
+
     if (m_headPosition == m_view->cursorPos()) {
         m_headPosition = SEEK_INACTIVE;
     }
@@ -554,6 +570,12 @@ void CustomRuler::paintEvent(QPaintEvent *e)
     p.drawPolygon(pa);
 }
 
+void CustomRuler::setLoudnessCurve(const QVector<double> &curve)
+{
+    m_loudnessCurve = curve;
+    update();
+}
+
 void CustomRuler::activateZone()
 {
     m_zoneBG.setAlpha(KdenliveSettings::useTimelineZoneToEdit() ? 180 : 60);
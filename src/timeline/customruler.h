@@ -66,6 +66,8 @@ public:
     void updatePreviewDisplay(int start, int end);
     bool isUnderPreview(int start, int end);
     void hidePreview(bool hide);
+    /** @brief Display a loudness curve (one LUFS value per second) on the ruler, an empty curve hides it. */
+    void setLoudnessCurve(const QVector<double> &curve);
 
 protected:
     void paintEvent(QPaintEvent * /*e*/) Q_DECL_OVERRIDE;
@@ -101,6 +103,8 @@ private:
     QMenu *m_goMenu;
     QList<int> m_renderingPreviews;
     QList<int> m_dirtyRenderingPreviews;
+    /** @brief Loudness of each second of the timeline, in LUFS */
+    QVector<double> m_loudnessCurve;
 
 public slots:
     void slotMoveRuler(int newPos);
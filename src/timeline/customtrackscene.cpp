@@ -20,6 +20,9 @@
 #include "customtrackscene.h"
 #include "timeline.h"
 
+#include <algorithm>
+#include <cmath>
+
 CustomTrackScene::CustomTrackScene(Timeline *timeline, QObject *parent) :
     QGraphicsScene(parent),
     isZooming(false),
@@ -42,44 +45,41 @@ double CustomTrackScene::getSnapPointForPos(double pos, bool doSnap)
         } else {
             maximumOffset = 6 / m_scale.x();
         }
-        for (int i = 0; i < m_snapPoints.size(); ++i) {
-            if (qAbs((int)(pos - m_snapPoints.at(i).frames(m_timeline->fps()))) < maximumOffset) {
-                return m_snapPoints.at(i).frames(m_timeline->fps());
+        // Skip all points that are too far before pos, then check the closest ones
+        QVector<int>::const_iterator it = std::lower_bound(m_snapPoints.constBegin(), m_snapPoints.constEnd(), (int) std::floor(pos - maximumOffset));
+        for (; it != m_snapPoints.constEnd(); ++it) {
+            if (qAbs((int)(pos - *it)) < maximumOffset) {
+                return *it;
             }
-            if (m_snapPoints.at(i).frames(m_timeline->fps()) > pos) {
+            if (*it > pos) {
                 break;
             }
         }
     }
-    return GenTime(pos, m_timeline->fps()).frames(m_timeline->fps());
+    return std::floor(pos + 0.5);
 }
 
-void CustomTrackScene::setSnapList(const QList<GenTime> &snaps)
+void CustomTrackScene::setSnapList(const QVector<int> &snaps)
 {
     m_snapPoints = snaps;
 }
 
-GenTime CustomTrackScene::previousSnapPoint(const GenTime &pos) const
+int CustomTrackScene::previousSnapPoint(int pos) const
 {
-    for (int i = 0; i < m_snapPoints.size(); ++i) {
-        if (m_snapPoints.at(i) >= pos) {
-            if (i == 0) {
-                return GenTime();
-            }
-            return m_snapPoints.at(i - 1);
-        }
+    QVector<int>::const_iterator it = std::lower_bound(m_snapPoints.constBegin(), m_snapPoints.constEnd(), pos);
+    if (it == m_snapPoints.constBegin()) {
+        return 0;
     }
-    return GenTime();
+    return *(--it);
 }
 
-GenTime CustomTrackScene::nextSnapPoint(const GenTime &pos) const
+int CustomTrackScene::nextSnapPoint(int pos) const
 {
-    foreach (const GenTime &seekPoint, m_snapPoints) {
-        if (seekPoint > pos) {
-            return seekPoint;
-        }
+    QVector<int>::const_iterator it = std::upper_bound(m_snapPoints.constBegin(), m_snapPoints.constEnd(), pos);
+    if (it == m_snapPoints.constEnd()) {
+        return pos;
     }
-    return pos;
+    return *it;
 }
 
 void CustomTrackScene::setScale(double scale, double vscale)
@@ -26,7 +26,7 @@
 #ifndef CUSTOMTRACKSCENE_H
 #define CUSTOMTRACKSCENE_H
 
-#include <QList>
+#include <QVector>
 #include <QGraphicsScene>
 
 #include "gentime.h"
@@ -42,9 +42,12 @@ class CustomTrackScene : public QGraphicsScene
 public:
     explicit CustomTrackScene(Timeline *timeline, QObject *parent = nullptr);
     ~CustomTrackScene();
-    void setSnapList(const QList<GenTime> &snaps);
-    GenTime previousSnapPoint(const GenTime &pos) const;
-    GenTime nextSnapPoint(const GenTime &pos) const;
+    /** @brief Set the snap points, as sorted unique frame numbers. */
+    void setSnapList(const QVector<int> &snaps);
+    /** @brief Returns the last snap point before frame @param pos, or 0. */
+    int previousSnapPoint(int pos) const;
+    /** @brief Returns the first snap point after frame @param pos, or @param pos if there is none. */
+    int nextSnapPoint(int pos) const;
     double getSnapPointForPos(double pos, bool doSnap = true);
     void setScale(double scale, double vscale);
     QPointF scale() const;
@@ -58,7 +61,8 @@ private:
     Timeline *m_timeline;
     QPointF m_scale;
     TimelineMode::EditMode m_editMode;
-    QList<GenTime> m_snapPoints;
+    /** @brief Sorted snap points (in frames), searched with a binary search. */
+    QVector<int> m_snapPoints;
 };
 
 #endif
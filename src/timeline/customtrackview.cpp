@@ -53,6 +53,7 @@
 #include "managers/resizemanager.h"
 #include "lib/audio/audioEnvelope.h"
 #include "lib/audio/audioCorrelation.h"
+#include "mltcontroller/effectprofiler.h"
 
 #include "kdenlive_debug.h"
 #include <klocalizedstring.h>
@@ -69,6 +70,8 @@
 
 #include <QGraphicsDropShadowEffect>
 
+#include <algorithm>
+
 #define SEEK_INACTIVE (-1)
 //#define DEBUG
 
@@ -180,6 +183,8 @@ CustomTrackView::CustomTrackView(KdenliveDoc *doc, Timeline *timeline, CustomTra
 
 CustomTrackView::~CustomTrackView()
 {
+    // Measures are kept by timeline position, they are meaningless for another project
+    EffectProfiler::shared()->clear();
     qDeleteAll(m_toolManagers);
     qDeleteAll(m_guides);
     m_guides.clear();
@@ -4307,10 +4312,8 @@ void CustomTrackView::checkScrolling()
     double xPos = seekPosition();
     QRectF viewRect = mapToScene(rect()).boundingRect();
     if (xPos - viewRect.left() < 50 || viewRect.right() - xPos < 50) {
-        QGraphicsView::ViewportUpdateMode mode = viewportUpdateMode();
-        setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+        // Scrolling moves the viewport content, only the newly exposed area is repainted
         ensureVisible(xPos, viewRect.top() + 5, 2, 2, 50, 0);
-        setViewportUpdateMode(mode);
     }
 }
 
@@ -4404,6 +4407,10 @@ void CustomTrackView::mouseReleaseEvent(QMouseEvent *event)
     }
 
     QGraphicsView::mouseReleaseEvent(event);
+    if (dragMode() == QGraphicsView::RubberBandDrag) {
+        // Rubber band selection is over, only repaint the changed areas again
+        setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+    }
     setDragMode(QGraphicsView::NoDrag);
 
     if (m_moveOpMode == Seek || m_moveOpMode == ScrollTimeline || m_moveOpMode == ZoomTimeline) {
@@ -5854,11 +5861,42 @@ double CustomTrackView::getSnapPointForPos(double pos)
 
 void CustomTrackView::updateSnapPoints(AbstractClipItem *selected, QList<GenTime> offsetList, bool skipSelectedItems)
 {
-    QList<GenTime> snaps;
+    // Snap points are collected as integer frames, sorted and deduplicated once at the end
+    const double fps = m_document->fps();
+    QVector<int> snaps;
     if (selected && offsetList.isEmpty()) {
         offsetList.append(selected->cropDuration());
     }
+    QVector<int> offsets;
+    offsets.reserve(offsetList.size());
+    for (const GenTime &offset : offsetList) {
+        offsets << (int) offset.frames(fps);
+    }
+    // Adds a snap point and its offsets, only keeping positive offsets unless @param allowNegative is set
+    auto addSnapPoint = [&snaps, &offsets](int frame, bool withOffsets, bool allowNegative) {
+        snaps << frame;
+        if (withOffsets) {
+            for (int offset : offsets) {
+                if (allowNegative || frame - offset > 0) {
+                    snaps << frame - offset;
+                }
+            }
+        }
+    };
+    // Adds an item's boundaries, offsets from its start are only used if its end offset is positive
+    auto addItemSnapPoints = [&snaps, &offsets](int start, int end) {
+        snaps << start << end;
+        for (int offset : offsets) {
+            if (end - offset > 0) {
+                snaps << end - offset;
+                if (start - offset > 0) {
+                    snaps << start - offset;
+                }
+            }
+        }
+    };
     QList<QGraphicsItem *> itemList = items();
+    snaps.reserve(itemList.count() * 2);
     for (int i = 0; i < itemList.count(); ++i) {
         if (itemList.at(i) == selected) {
             continue;
@@ -5871,28 +5909,7 @@ void CustomTrackView::updateSnapPoints(AbstractClipItem *selected, QList<GenTime
             if (!item) {
                 continue;
             }
-            GenTime start = item->startPos();
-            GenTime end = item->endPos();
-            if (!snaps.contains(start)) {
-                snaps.append(start);
-            }
-            if (!snaps.contains(end)) {
-                snaps.append(end);
-            }
-            if (!offsetList.isEmpty()) {
-                for (int j = 0; j < offsetList.size(); ++j) {
-                    GenTime offset = end - offsetList.at(j);
-                    if (offset > GenTime()) {
-                        if (!snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                        offset = start - offsetList.at(j);
-                        if (offset > GenTime() && !snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                    }
-                }
-            }
+            addItemSnapPoints((int) item->startPos().frames(fps), (int) item->endPos().frames(fps));
             // Add clip markers
             QList<GenTime> markers;
             ClipController *controller = m_document->getClipController(item->getBinId());
@@ -5902,107 +5919,45 @@ void CustomTrackView::updateSnapPoints(AbstractClipItem *selected, QList<GenTime
                 qWarning("No controller!");
             }
             for (int j = 0; j < markers.size(); ++j) {
-                GenTime t = markers.at(j);
-                if (!snaps.contains(t)) {
-                    snaps.append(t);
-                }
-                if (!offsetList.isEmpty()) {
-                    for (int k = 0; k < offsetList.size(); ++k) {
-                        GenTime offset = t - offsetList.at(k);
-                        if (offset > GenTime() && !snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                    }
-                }
+                addSnapPoint((int) markers.at(j).frames(fps), true, false);
             }
         } else if (itemList.at(i)->type() == TransitionWidget) {
             Transition *transition = static_cast <Transition *>(itemList.at(i));
             if (!transition) {
                 continue;
             }
-            GenTime start = transition->startPos();
-            GenTime end = transition->endPos();
-            if (!snaps.contains(start)) {
-                snaps.append(start);
-            }
-            if (!snaps.contains(end)) {
-                snaps.append(end);
-            }
-            if (!offsetList.isEmpty()) {
-                for (int j = 0; j < offsetList.size(); ++j) {
-                    GenTime offset = end - offsetList.at(j);
-                    if (offset > GenTime()) {
-                        if (!snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                        offset = start - offsetList.at(j);
-                        if (offset > GenTime() && !snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                    }
-                }
-            }
+            addItemSnapPoints((int) transition->startPos().frames(fps), (int) transition->endPos().frames(fps));
         }
     }
 
     // add cursor position
-    GenTime pos = GenTime(m_cursorPos, m_document->fps());
-    if (!snaps.contains(pos)) {
-        snaps.append(pos);
-    }
-    if (!offsetList.isEmpty()) {
-        for (int j = 0; j < offsetList.size(); ++j) {
-            GenTime offset = pos - offsetList.at(j);
-            if (!snaps.contains(offset)) {
-                snaps.append(offset);
-            }
-        }
-    }
+    addSnapPoint(m_cursorPos, true, true);
 
     // add guides
     for (int i = 0; i < m_guides.count(); ++i) {
-        GenTime cur_pos = m_guides.at(i)->position();
-        if (!snaps.contains(cur_pos)) {
-            snaps.append(cur_pos);
-        }
-        if (!offsetList.isEmpty()) {
-            for (int j = 0; j < offsetList.size(); ++j) {
-                GenTime offset = cur_pos - offsetList.at(j);
-                if (!snaps.contains(offset)) {
-                    snaps.append(offset);
-                }
-            }
-        }
+        addSnapPoint((int) m_guides.at(i)->position().frames(fps), true, true);
     }
 
     // add render zone
     QPoint z = m_document->zone();
-    pos = GenTime(z.x(), m_document->fps());
-    if (!snaps.contains(pos)) {
-        snaps.append(pos);
-    }
-    pos = GenTime(z.y(), m_document->fps());
-    if (!snaps.contains(pos)) {
-        snaps.append(pos);
-    }
+    snaps << z.x() << z.y();
 
-    qSort(snaps);
+    std::sort(snaps.begin(), snaps.end());
+    snaps.erase(std::unique(snaps.begin(), snaps.end()), snaps.end());
     m_scene->setSnapList(snaps);
-    //for (int i = 0; i < m_snapPoints.size(); ++i)
-    //    //qCDebug(KDENLIVE_LOG) << "SNAP POINT: " << m_snapPoints.at(i).frames(25);
 }
 
 void CustomTrackView::slotSeekToPreviousSnap()
 {
     updateSnapPoints(nullptr);
-    seekCursorPos((int) m_scene->previousSnapPoint(GenTime(m_cursorPos, m_document->fps())).frames(m_document->fps()));
+    seekCursorPos(m_scene->previousSnapPoint(m_cursorPos));
     checkScrolling();
 }
 
 void CustomTrackView::slotSeekToNextSnap()
 {
     updateSnapPoints(nullptr);
-    seekCursorPos((int) m_scene->nextSnapPoint(GenTime(m_cursorPos, m_document->fps())).frames(m_document->fps()));
+    seekCursorPos(m_scene->nextSnapPoint(m_cursorPos));
     checkScrolling();
 }
 
@@ -7665,25 +7620,17 @@ void CustomTrackView::disableClip()
 
 void CustomTrackView::monitorRefresh(const QList<ItemInfo> &range, bool invalidateRange)
 {
-    bool refreshMonitor = false;
     for (int i = 0; i < range.count(); i++) {
-        if (range.at(i).contains(GenTime(m_cursorPos, m_document->fps()))) {
-            refreshMonitor = true;
-        }
+        m_document->renderer()->refreshRange(range.at(i).startPos.frames(m_document->fps()), range.at(i).endPos.frames(m_document->fps()));
         if (invalidateRange) {
             m_timeline->invalidateRange(range.at(i));
         }
     }
-    if (refreshMonitor) {
-        m_document->renderer()->doRefresh();
-    }
 }
 
 void CustomTrackView::monitorRefresh(const ItemInfo &range, bool invalidateRange)
 {
-    if (range.contains(GenTime(m_cursorPos, m_document->fps()))) {
-        m_document->renderer()->doRefresh();
-    }
+    m_document->renderer()->refreshRange(range.startPos.frames(m_document->fps()), range.endPos.frames(m_document->fps()));
     if (invalidateRange) {
         m_timeline->invalidateRange(range);
     }
@@ -7691,7 +7638,7 @@ void CustomTrackView::monitorRefresh(const ItemInfo &range, bool invalidateRange
 
 void CustomTrackView::monitorRefresh(bool invalidateRange)
 {
-    m_document->renderer()->doRefresh();
+    m_document->renderer()->refreshRange(0, -1);
     if (invalidateRange) {
         m_timeline->invalidateRange();
     }
@@ -8357,6 +8304,26 @@ void CustomTrackView::slotGotFilterJobResults(const QString &/*id*/, int startPo
     }
 }
 
+void CustomTrackView::slotProfileClipEffects(ClipItem *item)
+{
+    if (!item) {
+        return;
+    }
+    const ItemInfo info = item->info();
+    Track *track = m_timeline->track(info.track);
+    if (!track) {
+        return;
+    }
+    const int startFrame = info.startPos.frames(m_document->fps());
+    Mlt::Playlist &playlist = track->playlist();
+    playlist.lock();
+    QScopedPointer<Mlt::Producer> cut(playlist.get_clip(playlist.get_clip_index_at(startFrame)));
+    if (cut && cut->is_valid() && !cut->is_blank()) {
+        EffectProfiler::shared()->profile(item->profilerKey(), *cut);
+    }
+    playlist.unlock();
+}
+
 void CustomTrackView::slotImportClipKeyframes(GraphicsRectItem type, const ItemInfo &info, const QDomElement &xml, QMap<QString, QString> keyframes)
 {
     ClipItem *item = nullptr;
@@ -8387,7 +8354,9 @@ void CustomTrackView::slotImportClipKeyframes(GraphicsRectItem type, const ItemI
             emit displayMessage(i18n("No clip found"), ErrorMessage);
             return;
         }
-        keyframes = item->binClip()->analysisData();
+        // Only read the analysis keyframes covering the clip
+        const ItemInfo clipInfo = item->info();
+        keyframes = item->binClip()->analysisData(false, clipInfo.cropStart.frames(m_document->fps()), (clipInfo.cropStart + clipInfo.cropDuration).frames(m_document->fps()));
     }
     if (keyframes.isEmpty()) {
         emit displayMessage(i18n("No keyframe data found in clip"), ErrorMessage);
@@ -415,6 +415,8 @@ public slots:
     /** @brief Cycle through timeline trim modes */
     void switchTrimMode(TrimMode mode = NormalTrim);
     void switchTrimMode(int mode);
+    /** @brief Measure the cost of a clip's effects in a background thread. */
+    void slotProfileClipEffects(ClipItem *item);
 
 protected:
     void drawBackground(QPainter *painter, const QRectF &rect) Q_DECL_OVERRIDE;
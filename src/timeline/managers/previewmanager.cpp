@@ -21,6 +21,9 @@
 #include "../customruler.h"
 #include "kdenlivesettings.h"
 #include "doc/kdenlivedoc.h"
+#include "doc/cacheaccounting.h"
+#include "project/clipmanager.h"
+#include "renderer.h"
 
 #include <KLocalizedString>
 #include <QtConcurrent>
@@ -29,6 +32,7 @@
 
 PreviewManager::PreviewManager(KdenliveDoc *doc, CustomRuler *ruler, Mlt::Tractor *tractor) : QObject()
     , m_doc(doc)
+    , m_accounting(doc->clipManager()->cacheAccounting)
     , m_ruler(ruler)
     , m_tractor(tractor)
     , m_previewTrack(nullptr)
@@ -94,6 +98,9 @@ bool PreviewManager::initialize()
     connect(&m_previewTimer, &QTimer::timeout, this, &PreviewManager::startPreviewRender);
     connect(this, &PreviewManager::previewRender, this, &PreviewManager::gotPreviewRender);
     connect(&m_previewGatherTimer, &QTimer::timeout, this, &PreviewManager::slotProcessDirtyChunks);
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(5000);
+    connect(&m_idleTimer, &QTimer::timeout, this, &PreviewManager::slotIdle);
     m_initialized = true;
     return true;
 }
@@ -120,6 +127,7 @@ void PreviewManager::loadChunks(const QStringList &previewChunks, QStringList di
             if (!documentDate.isNull() && QFileInfo(file).lastModified() > documentDate) {
                 // Timeline preview file was created after document, invalidate
                 file.remove();
+                m_accounting->fileRemoved(CachePreview, fileName);
                 dirtyChunks << frame;
             } else {
                 gotPreviewRender(frame.toInt(), fileName, 1000);
@@ -223,6 +231,8 @@ void PreviewManager::invalidatePreviews(const QList<int> &chunks)
         foreach (int i, chunks) {
             QString current = QStringLiteral("%1.%2").arg(i).arg(m_extension);
             if (m_cacheDir.rename(current, QStringLiteral("undo/%1/%2").arg(ix).arg(current))) {
+                m_accounting->fileRemoved(CachePreview, m_cacheDir.absoluteFilePath(current));
+                m_accounting->fileAdded(CachePreview, m_undoDir.absoluteFilePath(QStringLiteral("%1/%2").arg(ix).arg(current)));
                 foundPreviews = true;
             }
         }
@@ -245,6 +255,8 @@ void PreviewManager::invalidatePreviews(const QList<int> &chunks)
                 foreach (int i, chunks) {
                     QString current = QStringLiteral("%1.%2").arg(i).arg(m_extension);
                     if (m_cacheDir.rename(current, QStringLiteral("undo/%1/%2").arg(stackMax).arg(current))) {
+                        m_accounting->fileRemoved(CachePreview, m_cacheDir.absoluteFilePath(current));
+                        m_accounting->fileAdded(CachePreview, m_undoDir.absoluteFilePath(QStringLiteral("%1/%2").arg(stackMax).arg(current)));
                         foundPreviews = true;
                     }
                 }
@@ -263,9 +275,11 @@ void PreviewManager::invalidatePreviews(const QList<int> &chunks)
             QString cacheFileName = QStringLiteral("%1.%2").arg(i).arg(m_extension);
             if (!lastUndo) {
                 m_cacheDir.remove(cacheFileName);
+                m_accounting->fileRemoved(CachePreview, m_cacheDir.absoluteFilePath(cacheFileName));
             }
             if (moveFile) {
                 if (QFile::copy(tmpDir.absoluteFilePath(cacheFileName), m_cacheDir.absoluteFilePath(cacheFileName))) {
+                    m_accounting->fileAdded(CachePreview, m_cacheDir.absoluteFilePath(cacheFileName));
                     foundChunks << i;
                 }
             }
@@ -302,6 +316,7 @@ void PreviewManager::doCleanupOldPreviews()
         dirName.toInt(&ok);
         if (ok && tmp.cd(dirName)) {
             tmp.removeRecursively();
+            m_accounting->folderRemoved(CachePreview, tmp.absolutePath());
         }
     }
 }
@@ -315,6 +330,7 @@ void PreviewManager::clearPreviewRange()
     bool hasPreview = m_previewTrack != nullptr;
     foreach (int ix, toProcess) {
         m_cacheDir.remove(QStringLiteral("%1.%2").arg(ix).arg(m_extension));
+        m_accounting->fileRemoved(CachePreview, m_cacheDir.absoluteFilePath(QStringLiteral("%1.%2").arg(ix).arg(m_extension)));
         if (!hasPreview) {
             continue;
         }
@@ -361,6 +377,7 @@ void PreviewManager::addPreviewRange(bool add)
         bool hasPreview = m_previewTrack != nullptr;
         foreach (int ix, toProcess) {
             m_cacheDir.remove(QStringLiteral("%1.%2").arg(ix).arg(m_extension));
+            m_accounting->fileRemoved(CachePreview, m_cacheDir.absoluteFilePath(QStringLiteral("%1.%2").arg(ix).arg(m_extension)));
             if (!hasPreview) {
                 continue;
             }
@@ -397,27 +414,114 @@ void PreviewManager::startPreviewRender()
     if (!m_ruler->hasPreviewRange()) {
         addPreviewRange(true);
     }
-    QList<int> chunks = m_ruler->getDirtyChunks();
+    renderChunks(m_ruler->getDirtyChunks(), false);
+}
+
+void PreviewManager::renderChunks(const QList<int> &chunks, bool background)
+{
     if (!chunks.isEmpty()) {
         // Abort any rendering
         abortRendering();
         m_waitingThumbs.clear();
         const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
-        m_doc->saveMltPlaylist(sceneList);
+        const QString sceneData = m_doc->previewSceneList(m_cacheDir.absolutePath());
         m_waitingThumbs = chunks;
-        m_previewThread = QtConcurrent::run(this, &PreviewManager::doPreviewRender, sceneList);
+        m_previewThread = QtConcurrent::run(this, &PreviewManager::doPreviewRender, sceneList, sceneData, background);
+    }
+}
+
+void PreviewManager::setAutoPlanning(bool enable)
+{
+    if (enable) {
+        m_idleTimer.start();
+    } else {
+        m_idleTimer.stop();
+    }
+}
+
+void PreviewManager::slotIdle()
+{
+    if (!KdenliveSettings::autopreviewheavy()) {
+        return;
+    }
+    if (m_previewThread.isRunning() || m_previewGatherTimer.isActive() || m_doc->renderer()->isPlaying()) {
+        // User is busy or we are already rendering, try again later
+        m_idleTimer.start();
+        return;
     }
+    emit requestHeavyChunks();
 }
 
-void PreviewManager::doPreviewRender(const QString &scene)
+void PreviewManager::addHeavyChunks(const QList<int> &chunks)
 {
+    const QList<int> processed = m_ruler->getProcessedChunks();
+    const QList<int> dirty = m_ruler->getDirtyChunks();
+    // Dirty chunks are only rendered without user request if automatic preview is enabled
+    QList<int> toRender;
+    if (KdenliveSettings::autopreview()) {
+        toRender = dirty;
+    }
+    const qint64 cacheSize = m_accounting->size(CachePreview);
+    // Estimate the size of a chunk from the rendered ones (undo history included, so we err on the safe side)
+    qint64 chunkBytes;
+    if (!processed.isEmpty() && cacheSize > 0) {
+        chunkBytes = cacheSize / processed.count();
+    } else {
+        chunkBytes = (qint64) m_doc->width() * m_doc->height() * KdenliveSettings::timelinechunks() / 4;
+    }
+    qint64 budget = (qint64) KdenliveSettings::autopreviewdiskspace() * 1024 * 1024;
+    if (KdenliveSettings::previewcachesize() > 0) {
+        // Preview files are never evicted, so the preview quota also limits automatic rendering
+        budget = qMin(budget, (qint64) KdenliveSettings::previewcachesize() * 1024 * 1024);
+    }
+    qint64 available = budget - cacheSize - toRender.count() * chunkBytes;
+    QList<int> frames;
+    QList<int> heavy;
+    for (int frame : chunks) {
+        if (processed.contains(frame) || toRender.contains(frame)) {
+            continue;
+        }
+        if (available < chunkBytes) {
+            break;
+        }
+        available -= chunkBytes;
+        // Heavy chunks left dirty by an interrupted render or an edit are rendered again
+        if (!dirty.contains(frame)) {
+            frames << frame;
+        }
+        heavy << frame;
+    }
+    if (!frames.isEmpty()) {
+        m_ruler->addChunks(frames, true);
+    }
+    // Keep the priority order, the ruler sorts its chunks
+    toRender << heavy;
+    renderChunks(toRender, true);
+}
+
+void PreviewManager::doPreviewRender(const QString &scene, const QString &sceneData, bool background)
+{
+    // Write the playlist here so that the timeline is not blocked during encoding and disk access
+    if (!KdenliveDoc::writeSceneList(scene, sceneData.toUtf8())) {
+        emit previewRender(0, i18n("Cannot write to file %1", scene), -1);
+        return;
+    }
     int progress;
     int chunkSize = KdenliveSettings::timelinechunks();
     // initialize progress bar
     emit previewRender(0, QString(), 0);
     int ct = 0;
-    qSort(m_waitingThumbs);
+    if (!background) {
+        // Background renders are sorted by priority
+        qSort(m_waitingThumbs);
+    }
     while (!m_waitingThumbs.isEmpty()) {
+        if (background && m_doc->renderer()->isPlaying()) {
+            // Leave the remaining chunks dirty, they will be rendered on next idle time
+            QMetaObject::invokeMethod(&m_idleTimer, "start", Qt::QueuedConnection);
+            emit previewRender(0, QString(), 1000);
+            break;
+        }
         int i = m_waitingThumbs.takeFirst();
         ct++;
         QString fileName = QStringLiteral("%1.%2").arg(i).arg(m_extension);
@@ -438,11 +542,34 @@ void PreviewManager::doPreviewRender(const QString &scene)
         args << QStringLiteral("out=") + QString::number(i + chunkSize - 1);
         args << QStringLiteral("-consumer") << QStringLiteral("avformat:") + m_cacheDir.absoluteFilePath(fileName);
         args << m_consumerParams;
+        if (background) {
+            // Stay within the processing budget of automatic rendering
+            args << QStringLiteral("real_time=-%1").arg(KdenliveSettings::autopreviewthreads()) << QStringLiteral("threads=%1").arg(KdenliveSettings::autopreviewthreads());
+        }
         QProcess previewProcess;
         connect(this, &PreviewManager::abortPreview, &previewProcess, &QProcess::kill, Qt::DirectConnection);
         previewProcess.start(KdenliveSettings::rendererpath(), args);
         if (previewProcess.waitForStarted()) {
-            previewProcess.waitForFinished(-1);
+            bool interrupted = false;
+            if (background) {
+                // Don't compete with playback for the processor, the chunk stays dirty
+                while (!previewProcess.waitForFinished(200) && previewProcess.state() != QProcess::NotRunning) {
+                    if (m_doc->renderer()->isPlaying()) {
+                        interrupted = true;
+                        previewProcess.kill();
+                        previewProcess.waitForFinished(-1);
+                        break;
+                    }
+                }
+            } else {
+                previewProcess.waitForFinished(-1);
+            }
+            if (interrupted) {
+                QFile::remove(m_cacheDir.absoluteFilePath(fileName));
+                QMetaObject::invokeMethod(&m_idleTimer, "start", Qt::QueuedConnection);
+                emit previewRender(0, QString(), 1000);
+                break;
+            }
             if (previewProcess.exitStatus() != QProcess::NormalExit || previewProcess.exitCode() != 0) {
                 // Something went wrong
                 if (m_abortPreview) {
@@ -453,6 +580,7 @@ void PreviewManager::doPreviewRender(const QString &scene)
                 QFile::remove(m_cacheDir.absoluteFilePath(fileName));
                 break;
             } else {
+                m_accounting->fileAdded(CachePreview, m_cacheDir.absoluteFilePath(fileName));
                 emit previewRender(i, m_cacheDir.absoluteFilePath(fileName), progress);
             }
         } else {
@@ -491,6 +619,7 @@ void PreviewManager::slotRemoveInvalidUndo(int ix)
             QDir tmp = m_undoDir;
             if (tmp.cd(dir)) {
                 tmp.removeRecursively();
+                m_accounting->folderRemoved(CachePreview, tmp.absolutePath());
             }
         }
     }
@@ -498,6 +627,10 @@ void PreviewManager::slotRemoveInvalidUndo(int ix)
 
 void PreviewManager::invalidatePreview(int startFrame, int endFrame)
 {
+    if (KdenliveSettings::autopreviewheavy()) {
+        // Timeline changed, wait until user is idle before planning heavy chunks
+        m_idleTimer.start();
+    }
     int chunkSize = KdenliveSettings::timelinechunks();
     int start = startFrame / chunkSize;
     int end = lrintf(endFrame / chunkSize);
@@ -554,6 +687,10 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
     if (m_previewTrack == nullptr) {
         return;
     }
+    if (progress == 1000 && KdenliveSettings::autopreviewheavy()) {
+        // Rendering finished or was interrupted, look for remaining heavy chunks later
+        m_idleTimer.start();
+    }
     if (file.isEmpty() || progress < 0) {
         m_doc->previewProgress(progress);
         if (progress < 0) {
@@ -28,6 +28,7 @@
 #include <QFuture>
 
 class KdenliveDoc;
+class CacheAccounting;
 class CustomRuler;
 
 namespace Mlt
@@ -44,6 +45,8 @@ class Playlist;
  * This allow us to get a preview with a smooth playback of our project.
  * Only the preview zone is rendered. Once defined, a preview zone shows as a red line below
  * the timeline ruler. As chunks are rendered, the zone turns to green.
+ * When enabled, chunks estimated too heavy to play in real time are also added to the preview
+ * zone and rendered in the background once the user stops editing and playing.
  */
 
 class PreviewManager : public QObject
@@ -79,9 +82,15 @@ public:
     const QDir getCacheDir() const;
     /** @brief: Load existing ruler chunks. */
     void loadChunks(const QStringList &previewChunks, QStringList dirtyChunks, const QDateTime &documentDate);
+    /** @brief: Start or stop looking for heavy timeline regions to render when the user is idle. */
+    void setAutoPlanning(bool enable);
+    /** @brief: Add chunks (sorted by decreasing priority) to the preview zone and render them in the background, within the disk budget.
+     *  Other dirty chunks are only rendered with them if automatic preview is enabled. */
+    void addHeavyChunks(const QList<int> &chunks);
 
 private:
     KdenliveDoc *m_doc;
+    CacheAccounting *m_accounting;
     CustomRuler *m_ruler;
     Mlt::Tractor *m_tractor;
     Mlt::Playlist *m_previewTrack;
@@ -96,22 +105,28 @@ private:
     QTimer m_previewTimer;
     /** @brief: Since some timeline operations generate several invalidate calls, use a timer to get them all. */
     QTimer m_previewGatherTimer;
+    /** @brief: Timer restarted on each timeline change, heavy chunks are planned when it times out. */
+    QTimer m_idleTimer;
     bool m_initialized;
     bool m_abortPreview;
     QList<int> m_waitingThumbs;
     QFuture <void> m_previewThread;
     /** @brief: After an undo/redo, if we have preview history, use it. */
     void reloadChunks(const QList<int> &chunks);
+    /** @brief: Render chunks, background renders keep the chunks order, use the automatic preview thread budget and stop on playback. */
+    void renderChunks(const QList<int> &chunks, bool background);
 
 private slots:
     /** @brief: To avoid filling the hard drive, remove preview undo history after 5 steps. */
     void doCleanupOldPreviews();
     /** @brief: Start the real rendering process. */
-    void doPreviewRender(const QString &scene);
+    void doPreviewRender(const QString &scene, const QString &sceneData, bool background);
     /** @brief: If user does an undo, then makes a new timeline operation, delete undo history of more recent stack . */
     void slotRemoveInvalidUndo(int ix);
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
+    /** @brief: The user did not change the timeline for a while, ask for heavy chunks if we are not busy. */
+    void slotIdle();
 
 public slots:
     /** @brief: Prepare and start rendering. */
@@ -123,6 +138,8 @@ signals:
     void abortPreview();
     void cleanupOldPreviews();
     void previewRender(int frame, const QString &file, int progress);
+    /** @brief: The timeline should be analysed for chunks that cannot play in real time. */
+    void requestHeavyChunks();
 };
 
 #endif
@@ -0,0 +1,144 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "previewplanner.h"
+#include "timeline/clipitem.h"
+#include "bin/projectclip.h"
+
+#include <QPair>
+
+// Guessed load of an effect that was not measured
+static const double effectLoad = 0.15;
+// Guessed load of blending a video layer or transition over the frame
+static const double compositeLoad = 0.2;
+
+static double sourceLoad(ClipItem *clip, ProjectClip *binClip, int profilePixels)
+{
+    switch (clip->clipType()) {
+    case Color:
+        return 0.02;
+    case Image:
+    case Text:
+    case TextTemplate:
+    case QText:
+    case SlideShow:
+        return 0.1;
+    case Playlist:
+        // Nested project, with its own tracks and effects
+        return 1.0;
+    default:
+        break;
+    }
+    if (!binClip) {
+        return 0.5;
+    }
+    // Properties of the producer used for playback, so the proxy if enabled
+    const int videoIndex = binClip->getProducerIntProperty(QStringLiteral("video_index"));
+    const QString codec = binClip->getProducerProperty(QStringLiteral("meta.media.%1.codec.name").arg(videoIndex));
+    double load = 0.4;
+    if (codec == QLatin1String("prores") || codec == QLatin1String("dnxhd") || codec == QLatin1String("mjpeg") || codec == QLatin1String("dvvideo") ||
+        codec == QLatin1String("mpeg2video") || codec == QLatin1String("rawvideo") || codec == QLatin1String("huffyuv")) {
+        // Intra frame or simple codecs
+        load = 0.2;
+    } else if (codec == QLatin1String("hevc") || codec == QLatin1String("vp9") || codec == QLatin1String("av1")) {
+        load = 0.7;
+    }
+    const int pixels = binClip->getProducerIntProperty(QStringLiteral("meta.media.width")) * binClip->getProducerIntProperty(QStringLiteral("meta.media.height"));
+    if (pixels > 0 && profilePixels > 0) {
+        // Decoding time grows with the source frame size
+        load *= qMax(0.25, (double) pixels / profilePixels);
+    }
+    return load;
+}
+
+PreviewPlanner::PreviewPlanner(int chunkSize) :
+    m_chunkSize(qMax(1, chunkSize))
+{
+}
+
+// static
+double PreviewPlanner::clipLoad(ClipItem *clip, int profilePixels)
+{
+    const PlaylistState::ClipState state = clip->clipState();
+    if (clip->clipType() == Audio || state == PlaylistState::AudioOnly || state == PlaylistState::Disabled) {
+        return 0;
+    }
+    if (clip->effectsLoad() >= 0) {
+        // The clip was profiled with its effect stack at this timeline position
+        return clip->effectsLoad();
+    }
+    ProjectClip *binClip = clip->binClip();
+    double load;
+    if (binClip && binClip->decodeStats().isValid()) {
+        load = binClip->decodeStats().load;
+    } else {
+        load = sourceLoad(clip, binClip, profilePixels);
+    }
+    return load + clip->effectsCount() * effectLoad;
+}
+
+void PreviewPlanner::addClip(int track, int startFrame, int endFrame, double load)
+{
+    if (load <= 0 || endFrame <= startFrame) {
+        return;
+    }
+    for (int frame = startFrame / m_chunkSize * m_chunkSize; frame < endFrame; frame += m_chunkSize) {
+        double &layer = m_layers[frame][track];
+        layer = qMax(layer, load);
+    }
+}
+
+void PreviewPlanner::addTransition(int startFrame, int endFrame)
+{
+    for (int frame = startFrame / m_chunkSize * m_chunkSize; frame < endFrame; frame += m_chunkSize) {
+        m_transitions[frame]++;
+    }
+}
+
+double PreviewPlanner::chunkLoad(int frame) const
+{
+    const QMap<int, double> layers = m_layers.value(frame);
+    double load = 0;
+    for (double layer : layers) {
+        load += layer;
+    }
+    load += qMax(0, layers.count() - 1) * compositeLoad;
+    load += m_transitions.value(frame) * compositeLoad;
+    return load;
+}
+
+QList<int> PreviewPlanner::heavyChunks(double threshold) const
+{
+    QList<QPair<double, int> > loads;
+    for (auto it = m_layers.constBegin(); it != m_layers.constEnd(); ++it) {
+        const double load = chunkLoad(it.key());
+        if (load > threshold) {
+            loads << qMakePair(load, it.key());
+        }
+    }
+    std::sort(loads.begin(), loads.end(), [](const QPair<double, int> &a, const QPair<double, int> &b) {
+        return a.first > b.first;
+    });
+    QList<int> chunks;
+    chunks.reserve(loads.count());
+    for (const QPair<double, int> &load : loads) {
+        chunks << load.second;
+    }
+    return chunks;
+}
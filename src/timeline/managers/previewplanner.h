@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef PREVIEWPLANNER_H
+#define PREVIEWPLANNER_H
+
+#include <QList>
+#include <QMap>
+
+class ClipItem;
+
+/**
+ * @class PreviewPlanner
+ * @brief Estimates which timeline preview chunks cannot be played in real time.
+ * Each visible video clip gets a load (time needed to produce a frame relative to the frame
+ * duration), taken from the effect stack measures or the bin clip decoding measures when
+ * available, or guessed from the clip type, codec and number of effects. The load of a chunk
+ * is the sum of the heaviest clip of each track in the chunk, plus a compositing cost for each
+ * extra video layer and transition.
+ */
+
+class PreviewPlanner
+{
+public:
+    /** @brief Prepare an estimation for chunks of chunkSize frames. */
+    explicit PreviewPlanner(int chunkSize);
+    /** @brief Returns the estimated load of a timeline clip, 0 if it has no video.
+     *  @param profilePixels the number of pixels in a project frame */
+    static double clipLoad(ClipItem *clip, int profilePixels);
+    /** @brief Add a video clip of track between startFrame and endFrame (excluded). */
+    void addClip(int track, int startFrame, int endFrame, double load);
+    /** @brief Add a transition between startFrame and endFrame (excluded). */
+    void addTransition(int startFrame, int endFrame);
+    /** @brief Returns the estimated load of the chunk starting at frame. */
+    double chunkLoad(int frame) const;
+    /** @brief Returns the first frame of the chunks above threshold, heaviest first. */
+    QList<int> heavyChunks(double threshold) const;
+
+private:
+    int m_chunkSize;
+    /** @brief The heaviest clip load of each track, by chunk start frame. */
+    QMap<int, QMap<int, double> > m_layers;
+    /** @brief The number of transitions, by chunk start frame. */
+    QMap<int, int> m_transitions;
+};
+
+#endif
@@ -40,7 +40,10 @@
 #include "effectslist/initeffects.h"
 #include "mltcontroller/effectscontroller.h"
 #include "managers/previewmanager.h"
+#include "managers/previewplanner.h"
 #include "managers/trimmanager.h"
+#include "lib/audio/loudnessAnalysis.h"
+#include "core.h"
 
 #include <QScrollBar>
 #include <QLocale>
@@ -78,6 +81,7 @@ Timeline::Timeline(KdenliveDoc *doc, const QList<QAction *> &actions, const QLis
     , m_verticalZoom(1)
     , m_timelinePreview(nullptr)
     , m_usePreview(false)
+    , m_loudnessAnalysis(nullptr)
 {
     m_trackActions << actions;
     setupUi(this);
@@ -180,6 +184,7 @@ Timeline::Timeline(KdenliveDoc *doc, const QList<QAction *> &actions, const QLis
 
 Timeline::~Timeline()
 {
+    delete m_loudnessAnalysis;
     if (m_timelinePreview) {
         delete m_timelinePreview;
     }
@@ -1992,6 +1997,7 @@ void Timeline::loadPreviewRender()
     } else {
         m_ruler->hidePreview(true);
     }
+    checkAutoPreview();
 }
 
 void Timeline::updatePreviewSettings(const QString &profile)
@@ -2045,6 +2051,7 @@ void Timeline::initializePreview()
             m_timelinePreview = nullptr;
         } else {
             m_ruler->hidePreview(false);
+            connect(m_timelinePreview, &PreviewManager::requestHeavyChunks, this, &Timeline::slotQueueHeavyChunks);
         }
     }
     QAction *previewRender = m_doc->getAction(QStringLiteral("prerender_timeline_zone"));
@@ -2057,6 +2064,36 @@ void Timeline::initializePreview()
     m_disablePreview->blockSignals(false);
 }
 
+void Timeline::analyseLoudness()
+{
+    if (!checkProjectAudio()) {
+        pCore->window()->slotGotProgressInfo(i18n("No audio in timeline"), 100, InformationMessage);
+        return;
+    }
+    if (!m_loudnessAnalysis) {
+        m_loudnessAnalysis = new LoudnessAnalysis;
+        connect(m_loudnessAnalysis, &LoudnessAnalysis::progress, this, &Timeline::slotLoudnessProgress);
+        connect(m_loudnessAnalysis, &LoudnessAnalysis::finished, this, &Timeline::slotLoudnessFinished);
+    }
+    m_ruler->setLoudnessCurve(QVector<double>());
+    m_loudnessAnalysis->start(m_doc->previewSceneList(m_doc->projectDataFolder()), duration());
+    slotLoudnessProgress(0);
+}
+
+void Timeline::slotLoudnessProgress(int progress)
+{
+    pCore->window()->slotGotProgressInfo(i18n("Analysing loudness"), progress, ProcessingJobMessage);
+}
+
+void Timeline::slotLoudnessFinished(const LoudnessMeter::Result &result)
+{
+    pCore->window()->slotGotProgressInfo(QString(), 100);
+    m_ruler->setLoudnessCurve(result.curve);
+    KMessageBox::information(this, i18n("Integrated loudness: %1 LUFS\nLoudness range: %2 LU\nTrue peak: %3 dBTP",
+                                        QString::number(result.integrated, 'f', 1), QString::number(result.range, 'f', 1), QString::number(result.truePeak, 'f', 1)),
+                             i18n("Timeline Loudness"));
+}
+
 void Timeline::startPreviewRender()
 {
     // Timeline preview stuff
@@ -2075,6 +2112,65 @@ void Timeline::startPreviewRender()
     }
 }
 
+void Timeline::checkAutoPreview()
+{
+    if (!KdenliveSettings::autopreviewheavy()) {
+        if (m_timelinePreview) {
+            m_timelinePreview->setAutoPlanning(false);
+        }
+        return;
+    }
+    if (!m_timelinePreview) {
+        initializePreview();
+    }
+    if (m_timelinePreview) {
+        m_timelinePreview->setAutoPlanning(true);
+    }
+}
+
+void Timeline::slotQueueHeavyChunks()
+{
+    if (!m_timelinePreview || m_disablePreview->isChecked()) {
+        return;
+    }
+    QList<int> videoTracks;
+    for (int i = 1; i < m_tracks.count(); i++) {
+        Track *tk = m_tracks.at(i);
+        if (tk->type == VideoTrack && (tk->state() & 1) == 0) {
+            videoTracks << i;
+        }
+    }
+    const double fps = m_doc->fps();
+    const int profilePixels = m_doc->width() * m_doc->height();
+    PreviewPlanner planner(KdenliveSettings::timelinechunks());
+    const QList<QGraphicsItem *> items = m_scene->items();
+    for (QGraphicsItem *item : items) {
+        if (item->type() != AVWidget && item->type() != TransitionWidget) {
+            continue;
+        }
+        AbstractClipItem *clip = static_cast<AbstractClipItem *>(item);
+        if (!videoTracks.contains(clip->track())) {
+            continue;
+        }
+        const ItemInfo info = clip->info();
+        if (item->type() == AVWidget) {
+            planner.addClip(clip->track(), info.startPos.frames(fps), info.endPos.frames(fps), PreviewPlanner::clipLoad(static_cast<ClipItem *>(clip), profilePixels));
+        } else {
+            planner.addTransition(info.startPos.frames(fps), info.endPos.frames(fps));
+        }
+    }
+    const QList<int> chunks = planner.heavyChunks(1.0);
+    if (chunks.isEmpty() && m_ruler->getDirtyChunks().isEmpty()) {
+        return;
+    }
+    if (!m_usePreview) {
+        m_timelinePreview->buildPreviewTrack();
+        m_ruler->hidePreview(false);
+        m_usePreview = true;
+    }
+    m_timelinePreview->addHeavyChunks(chunks);
+}
+
 void Timeline::disablePreview(bool disable)
 {
     if (disable) {
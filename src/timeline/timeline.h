@@ -30,6 +30,7 @@
 #include "effectslist/effectslist.h"
 #include "ui_timeline_ui.h"
 #include "definitions.h"
+#include "lib/audio/loudnessMeter.h"
 
 #include <QGraphicsScene>
 #include <QGraphicsLineItem>
@@ -45,6 +46,7 @@ class TransitionHandler;
 class CustomRuler;
 class QUndoCommand;
 class PreviewManager;
+class LoudnessAnalysis;
 
 class ScrollEventEater : public QObject
 {
@@ -184,12 +186,16 @@ public:
     void invalidateTrack(int ix);
     /** @brief Start rendering preview rendering range. */
     void startPreviewRender();
+    /** @brief Start or stop the background rendering of regions that cannot play in real time, depending on settings. */
+    void checkAutoPreview();
     /** @brief Toggle current project's compositing mode. */
     void switchComposite(int mode);
     /** @brief Temporarily hide a clip if it is at cursor position so that we can extract an image. 
      *  @returns true if a track was temporarily hidden
     */
     bool hideClip(const QString &id, bool hide);
+    /** @brief Start an EBU R128 loudness analysis of the timeline audio mix. */
+    void analyseLoudness();
 
 public slots:
     void slotDeleteClip(const QString &clipId, QUndoCommand *deleteCommand);
@@ -230,6 +236,7 @@ private:
     /** @brief sometimes grouped commands quickly send invalidate commands, so wait a little bit before processing*/
     PreviewManager *m_timelinePreview;
     bool m_usePreview;
+    LoudnessAnalysis *m_loudnessAnalysis;
     QAction *m_disablePreview;
 
     void adjustTrackHeaders();
@@ -280,6 +287,11 @@ private slots:
     void resizeRuler(int height);
     /** @brief The timeline track headers were resized, store width. */
     void storeHeaderSize(int pos, int index);
+    void slotLoudnessProgress(int progress);
+    /** @brief Loudness analysis is over, display the results. */
+    void slotLoudnessFinished(const LoudnessMeter::Result &result);
+    /** @brief Estimate the load of the timeline chunks and queue the ones that cannot play in real time for preview rendering. */
+    void slotQueueHeavyChunks();
 
 signals:
     void mousePosition(int);
@@ -0,0 +1,61 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "geometryutils.h"
+
+#include <QRegularExpression>
+#include <QStringList>
+
+QString GeometryUtils::mapGeometry(const QString &geometry, double scaleX, double scaleY, double frameScale)
+{
+    static const QRegularExpression keyExp(QStringLiteral("^(-?\\d+)(\\D*)$"));
+    static const QRegularExpression numberExp(QStringLiteral("-?\\d+(\\.\\d+)?%?"));
+    QStringList keyframes = geometry.split(QLatin1Char(';'));
+    for (QString &keyframe : keyframes) {
+        QString key;
+        QString value = keyframe;
+        if (keyframe.contains(QLatin1Char('='))) {
+            key = keyframe.section(QLatin1Char('='), 0, 0);
+            value = keyframe.section(QLatin1Char('='), 1);
+            QRegularExpressionMatch match = keyExp.match(key);
+            if (match.hasMatch() && !qFuzzyCompare(frameScale, 1.0)) {
+                key = QString::number(qRound(match.captured(1).toInt() * frameScale)) + match.captured(2);
+            }
+        }
+        QString mapped;
+        int last = 0;
+        int index = 0;
+        QRegularExpressionMatchIterator it = numberExp.globalMatch(value);
+        while (it.hasNext() && index < 4) {
+            QRegularExpressionMatch match = it.next();
+            QString number = match.captured(0);
+            if (!number.endsWith(QLatin1Char('%'))) {
+                const double factor = index % 2 == 0 ? scaleX : scaleY;
+                const double result = number.toDouble() * factor;
+                number = match.captured(1).isEmpty() ? QString::number(qRound(result)) : QString::number(result, 'f', match.captured(1).length() - 1);
+            }
+            mapped.append(value.midRef(last, match.capturedStart() - last)).append(number);
+            last = match.capturedEnd();
+            index++;
+        }
+        mapped.append(value.midRef(last));
+        keyframe = key.isEmpty() ? mapped : key + QLatin1Char('=') + mapped;
+    }
+    return keyframes.join(QLatin1Char(';'));
+}
@@ -0,0 +1,32 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef GEOMETRYUTILS_H
+#define GEOMETRYUTILS_H
+
+#include <QString>
+
+namespace GeometryUtils
+{
+/** @brief Scale the rectangles of a geometry or animation string ("0=x y w h;..." or "0=x/y:wxh:mix;...") and their frame positions.
+ *  Only the 4 first values of a keyframe are coordinates, percent values are left untouched. */
+QString mapGeometry(const QString &geometry, double scaleX, double scaleY, double frameScale);
+}
+
+#endif
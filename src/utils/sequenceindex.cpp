@@ -0,0 +1,170 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "sequenceindex.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QRegExp>
+
+#include <algorithm>
+
+// Maximum number of file names kept in the cache, for all folders
+static const int maxCachedFiles = 1000000;
+// Like MLT's image producers, a sequence ends after this many missing frames
+static const int maxSequenceGap = 100;
+
+class SequenceIndexCreator
+{
+public:
+    SequenceIndex object;
+};
+
+Q_GLOBAL_STATIC(SequenceIndexCreator, creator)
+
+SequenceIndex::SequenceIndex()
+{
+    m_folders.setMaxCost(maxCachedFiles);
+}
+
+// static
+SequenceIndex *SequenceIndex::shared()
+{
+    return &creator->object;
+}
+
+// static
+QString SequenceIndex::sequenceKey(const QString &prefix, int digits, const QString &extension)
+{
+    return prefix + QLatin1Char('/') + QString::number(digits) + QLatin1Char('/') + extension;
+}
+
+SequenceIndex::FolderIndex *SequenceIndex::folderIndex(const QString &folder)
+{
+    const QFileInfo info(folder);
+    if (!info.isDir()) {
+        return nullptr;
+    }
+    const QString path = info.absoluteFilePath();
+    const QDateTime modified = info.lastModified();
+    FolderIndex *index = m_folders.object(path);
+    if (index && index->modified == modified) {
+        return index;
+    }
+    index = new FolderIndex;
+    index->modified = modified;
+    // A single listing of the folder, without sorting by QDir
+    QDirIterator it(path, QDir::Files);
+    while (it.hasNext()) {
+        it.next();
+        index->files << it.fileName();
+    }
+    std::sort(index->files.begin(), index->files.end());
+    for (const QString &name : index->files) {
+        const int dot = name.lastIndexOf(QLatin1Char('.'));
+        if (dot < 1) {
+            continue;
+        }
+        int start = dot;
+        while (start > 0 && name.at(start - 1).isDigit()) {
+            start--;
+        }
+        const int digits = dot - start;
+        // Frame numbers must fit in an int
+        if (digits == 0 || digits > 9) {
+            continue;
+        }
+        const QString key = sequenceKey(name.left(start), digits, name.mid(dot));
+        index->sequences[key].insert(name.midRef(start, digits).toInt(), name);
+    }
+    m_folders.insert(path, index, qBound(1, index->files.count(), maxCachedFiles));
+    return index;
+}
+
+QStringList SequenceIndex::sequence(const QString &folder, const QString &prefix, const QString &extension, int precision, int first)
+{
+    QStringList result;
+    QMutexLocker lock(&m_mutex);
+    FolderIndex *index = folderIndex(folder);
+    if (!index) {
+        return result;
+    }
+    // Frame numbers are padded to the precision, larger numbers use more digits
+    QMap<int, QString> frames;
+    for (int digits = qMax(1, precision); digits <= 9; ++digits) {
+        const QMap<int, QString> files = index->sequences.value(sequenceKey(prefix, digits, extension));
+        QMap<int, QString>::const_iterator it = files.constBegin();
+        for (; it != files.constEnd(); ++it) {
+            if (qMax(precision, QString::number(it.key()).size()) == digits) {
+                frames.insert(it.key(), it.value());
+            }
+        }
+    }
+    int last = first - 1;
+    QMap<int, QString>::const_iterator it = frames.lowerBound(first);
+    for (; it != frames.constEnd(); ++it) {
+        if (it.key() - last > maxSequenceGap) {
+            break;
+        }
+        result << it.value();
+        last = it.key();
+    }
+    return result;
+}
+
+QStringList SequenceIndex::files(const QString &folder, const QString &extension)
+{
+    QStringList result;
+    QMutexLocker lock(&m_mutex);
+    FolderIndex *index = folderIndex(folder);
+    if (!index) {
+        return result;
+    }
+    const QString suffix = QLatin1Char('.') + extension;
+    for (const QString &name : index->files) {
+        if (name.endsWith(suffix, Qt::CaseInsensitive)) {
+            result << name;
+        }
+    }
+    return result;
+}
+
+QStringList SequenceIndex::resourceFiles(const QString &resource)
+{
+    const QString path = resource.section(QLatin1Char('?'), 0, 0);
+    // Both the begin=x and deprecated begin:x syntax
+    const int first = resource.section(QLatin1Char('?'), 1).section(QRegExp(QStringLiteral("[:=]")), -1).toInt();
+    const QFileInfo info(path);
+    const QDir dir = info.absoluteDir();
+    const QString name = info.fileName();
+    QStringList names;
+    if (name.startsWith(QLatin1String(".all."))) {
+        names = files(dir.absolutePath(), name.section(QLatin1Char('.'), -1));
+    } else if (name.contains(QLatin1Char('%'))) {
+        const int precision = name.section(QLatin1Char('%'), -1).section(QLatin1Char('d'), 0, 0).toInt();
+        names = sequence(dir.absolutePath(), name.section(QLatin1Char('%'), 0, -2), QLatin1Char('.') + name.section(QLatin1Char('.'), -1), precision, first);
+    }
+    QStringList result;
+    result.reserve(names.count());
+    for (const QString &file : names) {
+        result << dir.absoluteFilePath(file);
+    }
+    return result;
+}
@@ -0,0 +1,73 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SEQUENCEINDEX_H
+#define SEQUENCEINDEX_H
+
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+
+/**
+ * @class SequenceIndex
+ * @brief Cached listing of the numbered image sequences of a folder.
+ * Finding the images of a sequence used to check the existence of each possible file name
+ * or to match every file of the folder against a pattern, for each query. Timelapse folders
+ * hold tens of thousands of stills, often on network storage. A folder is now listed once,
+ * when a sequence of this folder is first requested, and its files are grouped by sequence
+ * (name prefix, number of digits and extension). The listing is kept until the folder's
+ * modification time changes. Access is thread safe.
+ */
+
+class SequenceIndex
+{
+public:
+    /** @brief The instance shared by the slideshow dialog, clip import and monitors. */
+    static SequenceIndex *shared();
+    /** @brief Returns the file names of a numbered sequence, sorted by frame number.
+     *  Like MLT, frames are listed from @param first until more than 100 consecutive frames are missing.
+     *  @param prefix the file name before the frame number
+     *  @param extension the file extension, including the dot
+     *  @param precision the minimum number of digits of the frame number, smaller numbers being padded with zeros */
+    QStringList sequence(const QString &folder, const QString &prefix, const QString &extension, int precision, int first = 0);
+    /** @brief Returns the names of the files with @param extension (without dot, case insensitive), sorted by name. */
+    QStringList files(const QString &folder, const QString &extension);
+    /** @brief Returns the absolute paths of the images used by an MLT slideshow resource (pattern or .all.ext). */
+    QStringList resourceFiles(const QString &resource);
+
+private:
+    struct FolderIndex {
+        QDateTime modified;
+        QStringList files;
+        /** @brief Frame number -> file name, keyed by prefix, number of digits and extension. */
+        QHash<QString, QMap<int, QString> > sequences;
+    };
+    QMutex m_mutex;
+    QCache<QString, FolderIndex> m_folders;
+    SequenceIndex();
+    /** @brief Returns the index of a folder, listing it if needed. Mutex must be locked. */
+    FolderIndex *folderIndex(const QString &folder);
+    static QString sequenceKey(const QString &prefix, int digits, const QString &extension);
+    friend class SequenceIndexCreator;
+};
+
+#endif
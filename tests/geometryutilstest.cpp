@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) 2017 by Kdenlive team (kdenlive@kde.org)                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "utils/geometryutils.h"
+
+#include <QTest>
+
+class GeometryUtilsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void mapGeometry_data();
+    void mapGeometry();
+};
+
+void GeometryUtilsTest::mapGeometry_data()
+{
+    QTest::addColumn<QString>("geometry");
+    QTest::addColumn<double>("scaleX");
+    QTest::addColumn<double>("scaleY");
+    QTest::addColumn<double>("frameScale");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("identity") << QStringLiteral("0=10 20 30 40;25=11 21 31 41") << 1.0 << 1.0 << 1.0 << QStringLiteral("0=10 20 30 40;25=11 21 31 41");
+    QTest::newRow("space separated") << QStringLiteral("0=10 20 30 40") << 2.0 << 3.0 << 1.0 << QStringLiteral("0=20 60 60 120");
+    QTest::newRow("mlt geometry") << QStringLiteral("0=10/20:30x40:100") << 2.0 << 2.0 << 1.0 << QStringLiteral("0=20/40:60x80:100");
+    QTest::newRow("frame positions") << QStringLiteral("0=1 2 3 4;10=1 2 3 4") << 1.0 << 1.0 << 4.0 << QStringLiteral("0=1 2 3 4;40=1 2 3 4");
+    QTest::newRow("keyframe type") << QStringLiteral("5~=10 10 10 10") << 0.5 << 0.5 << 2.0 << QStringLiteral("10~=5 5 5 5");
+    QTest::newRow("percent") << QStringLiteral("0=10% 20 30% 40") << 2.0 << 2.0 << 1.0 << QStringLiteral("0=10% 40 30% 80");
+    QTest::newRow("decimals") << QStringLiteral("0=1.5 2.25 3 4") << 2.0 << 2.0 << 1.0 << QStringLiteral("0=3.0 4.50 6 8");
+    QTest::newRow("negative") << QStringLiteral("0=-10 -20 30 40") << 0.5 << 0.5 << 1.0 << QStringLiteral("0=-5 -10 15 20");
+    QTest::newRow("no key") << QStringLiteral("10 20 30 40") << 2.0 << 2.0 << 2.0 << QStringLiteral("20 40 60 80");
+    QTest::newRow("extra values") << QStringLiteral("0=10 20 30 40 50") << 2.0 << 2.0 << 1.0 << QStringLiteral("0=20 40 60 80 50");
+}
+
+void GeometryUtilsTest::mapGeometry()
+{
+    QFETCH(QString, geometry);
+    QFETCH(double, scaleX);
+    QFETCH(double, scaleY);
+    QFETCH(double, frameScale);
+    QFETCH(QString, expected);
+    QCOMPARE(GeometryUtils::mapGeometry(geometry, scaleX, scaleY, frameScale), expected);
+}
+
+QTEST_GUILESS_MAIN(GeometryUtilsTest)
+
+#include "geometryutilstest.moc"